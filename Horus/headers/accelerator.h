@@ -1,6 +1,8 @@
 #pragma once
 #include "hrs.h"
 #include <memory_resource>
+#include <algorithm>
+#include <unordered_map>
 
 using Allocator = std::pmr::polymorphic_allocator<std::byte>;
 
@@ -45,6 +47,7 @@ struct linearBVH
 		void setSecondChildOffset(int32_t offset) { secondChildOffset = offset; }
 
 		BoundingBox& getBoundingBox() { return boundingBox; }
+		const BoundingBox& getBoundingBox() const { return boundingBox; }
 		int32_t getPrimitiveOffset() const { return primitiveOffset; }
 		int32_t getNPrimitives() const { return nPrimitives; }
 		int32_t getSecondChildOffset() const { return secondChildOffset; }
@@ -111,7 +114,25 @@ public:
 
 	void buildBVH(std::vector<GeometryObject*>& objects);
 
-	GeometryObject* traversal(Ray& ray, float tMin, float tMax);
+	// Incremental build: add the geometries batch by batch as they are parsed, then call finishBuild() once. Same result as buildBVH().
+	bool addPrimitives(const std::vector<GeometryObject*>& objects);
+	void finishBuild();
+
+	// Installs an already flattened BVH, e.g. one stored in a compiled scene, instead of building it.
+	void setNodes(std::vector<linearBVH>&& nodes, std::vector<GeometryObject*>&& primitives);
+
+	bool isBuilt() const { return !linearNodes.empty(); }
+
+	// Drops the tree and the collected primitives so the BVH can be built again.
+	void clear();
+
+	// Keeps the tree topology: swaps the geometries found in 'replacements' (old -> new) and recomputes the node bounds bottom up.
+	void refit(const std::unordered_map<GeometryObject*, GeometryObject*>& replacements);
+
+	const std::vector<linearBVH>& getNodes() const { return linearNodes; }
+	const std::vector<GeometryObject*>& getOrderedPrimitives() const { return orderedPrimitives; }
+
+	GeometryObject* traversal(Ray& ray, float tMin, float tMax, HitRecord& hit);
 
 private:
 	void* BVHNode_memory = nullptr;
@@ -122,6 +143,10 @@ private:
 	BVHNode* root = nullptr;
 
 	std::vector<BoundingBox> boundingBoxes;
+	std::vector<GeometryObject*> primitives;
+
+	Vector3D<float> centroidMin;
+	Vector3D<float> centroidMax;
 
 	std::vector<MortonPrimitive> mortonPrimitives;
 	std::vector<Treelet> treelets;
@@ -135,11 +160,9 @@ private:
 	void sortMortonPrimitive(std::vector<MortonPrimitive>& mortonPrimitives);
 	void remapCoordinatesForMorton(std::vector<GeometryObject*>& objects, Vector3D<float> min, Vector3D<float> max);
 
-	bool collectBoundingBoxes(std::vector<GeometryObject*>& objects);
-	bool createBoundingBoxFromCentroids(std::vector<GeometryObject*>& objects, int32_t begin, int32_t end);
-	bool mergeBoundingBoxes(std::vector<GeometryObject*>& objects, BVHNode* node,  int32_t begin, int32_t end);
-
-	bool buildRoot(std::vector<GeometryObject*>& objects);
+	bool collectBoundingBoxes(const std::vector<GeometryObject*>& objects);
+	bool createBoundingBoxFromCentroids(int32_t begin, int32_t end);
+	bool mergeBoundingBoxes(BVHNode* node, int32_t begin, int32_t end);
 	bool computeMorton(std::vector<GeometryObject*>& objects);
 
 	bool treeletSearch(std::vector<MortonPrimitive>& mortonPrimitives);
@@ -153,4 +176,118 @@ private:
 	BVHNode* connectNodes(std::vector<Treelet>& treelets, BVHNode* nodes, int32_t& nodeIndex);
 
 	int32_t flattenBVH(BVHNode* node, int32_t& offset);
-};
\ No newline at end of file
+};
+
+// Compact node used by PrimitiveBVH. Interior nodes store the offset of their second child, leaves the first primitive index.
+struct CompactBVHNode
+{
+	float min[3];
+	float max[3];
+
+	int32_t offset;
+	uint16_t count;
+	uint8_t axis;
+	uint8_t pad;
+};
+
+// BVH over the primitives of a single aggregate geometry (mesh triangles, particles, patches).
+// Primitives are referred to by index, so the owner keeps its data in packed arrays instead of one GeometryObject per primitive.
+class PrimitiveBVH
+{
+public:
+	PrimitiveBVH() {}
+
+	void build(const std::vector<BoundingBox>& bounds, int32_t maxLeafSize = 4);
+	void clear() { nodes.clear(); indices.clear(); }
+
+	bool empty() const { return nodes.empty(); }
+
+	BoundingBox getBounds() const;
+	const std::vector<uint32_t>& getIndices() const { return indices; }
+	size_t getMemoryUsage() const { return nodes.capacity() * sizeof(CompactBVHNode) + indices.capacity() * sizeof(uint32_t); }
+
+	// Calls intersect(primitiveIndex, tMin, closestT) for every primitive whose leaf is reached by the ray.
+	// The callback returns the new hit distance when it finds a closer hit, or a negative value otherwise.
+	template <typename F>
+	bool traversal(const Ray& ray, float tMin, float& tMax, F&& intersect) const;
+
+private:
+	std::vector<CompactBVHNode> nodes;
+	std::vector<uint32_t> indices;
+
+	int32_t buildRecursive(const std::vector<BoundingBox>& bounds, std::vector<Vector3D<float>>& centroids, int32_t begin, int32_t end, int32_t maxLeafSize, int32_t depth);
+};
+
+template <typename F>
+bool PrimitiveBVH::traversal(const Ray& ray, float tMin, float& tMax, F&& intersect) const
+{
+	if (nodes.empty()) { return false; }
+
+	const float origin[3] = { ray.origin.x, ray.origin.y, ray.origin.z };
+	const float invDir[3] = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+	const bool negative[3] = { invDir[0] < 0.0f, invDir[1] < 0.0f, invDir[2] < 0.0f };
+
+	bool hit = false;
+
+	int32_t stack[64];
+	int32_t stackIndex = 0;
+	int32_t nodeIndex = 0;
+
+	while (true)
+	{
+		const CompactBVHNode& node = nodes[nodeIndex];
+
+		float t0 = tMin;
+		float t1 = tMax;
+
+		for (int32_t i = 0; i < 3; ++i)
+		{
+			float tNear = ((negative[i] ? node.max[i] : node.min[i]) - origin[i]) * invDir[i];
+			float tFar = ((negative[i] ? node.min[i] : node.max[i]) - origin[i]) * invDir[i];
+
+			if (tNear > t0) { t0 = tNear; }
+			if (tFar < t1) { t1 = tFar; }
+		}
+
+		if (t0 <= t1)
+		{
+			if (node.count > 0)
+			{
+				for (int32_t i = 0; i < node.count; ++i)
+				{
+					float t = intersect(indices[node.offset + i], tMin, tMax);
+
+					if (t >= 0.0f)
+					{
+						tMax = t;
+						hit = true;
+					}
+				}
+
+				if (stackIndex == 0) { break; }
+				nodeIndex = stack[--stackIndex];
+			}
+			else
+			{
+				// Visit the child on the near side of the split first.
+				if (negative[node.axis])
+				{
+					stack[stackIndex++] = nodeIndex + 1;
+					nodeIndex = node.offset;
+				}
+				else
+				{
+					stack[stackIndex++] = node.offset;
+					++nodeIndex;
+				}
+			}
+		}
+		else
+		{
+			if (stackIndex == 0) { break; }
+			nodeIndex = stack[--stackIndex];
+		}
+	}
+
+	return hit;
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+// Least recently used cache bounded by the memory reported by its values (Value::getMemoryUsage()).
+// Values are handed out as shared pointers, so an entry evicted while a ray still uses it stays alive until that ray is done.
+template <typename Key, typename Value>
+class LRUCache
+{
+	public:
+		LRUCache(size_t capacityBytes = 0) : capacity(capacityBytes) {}
+
+		void setCapacity(size_t capacityBytes)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			capacity = capacityBytes;
+			evict();
+		}
+
+		// Returns the cached value for 'key', calling load() to create it on a miss. load() returns a std::shared_ptr<Value>, or nullptr on failure.
+		template <typename Loader>
+		std::shared_ptr<const Value> get(const Key& key, Loader&& load)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				auto it = entries.find(key);
+
+				if (it != entries.end())
+				{
+					++hits;
+					order.splice(order.begin(), order, it->second);
+					return it->second->second;
+				}
+
+				++misses;
+			}
+
+			// Load outside the lock so other threads can keep hitting the cache meanwhile.
+			std::shared_ptr<const Value> value = load();
+
+			if (!value)
+			{
+				return nullptr;
+			}
+
+			std::lock_guard<std::mutex> lock(mutex);
+
+			auto it = entries.find(key);
+
+			if (it != entries.end())
+			{
+				// Another thread loaded the same entry first.
+				return it->second->second;
+			}
+
+			order.emplace_front(key, value);
+			entries[key] = order.begin();
+			used += value->getMemoryUsage();
+
+			evict();
+
+			return value;
+		}
+
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			order.clear();
+			entries.clear();
+			used = 0;
+		}
+
+		uint64_t getHits() const { return hits; }
+		uint64_t getMisses() const { return misses; }
+		uint64_t getEvictions() const { return evictions; }
+
+		size_t getMemoryUsage() const { return used; }
+		size_t getCapacity() const { return capacity; }
+		size_t getEntryCount() const { return entries.size(); }
+
+	private:
+		using Entry = std::pair<Key, std::shared_ptr<const Value>>;
+
+		std::list<Entry> order;
+		std::unordered_map<Key, typename std::list<Entry>::iterator> entries;
+
+		size_t capacity;
+		size_t used = 0;
+
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+
+		std::mutex mutex;
+
+		// Drops least recently used entries until the cache fits its capacity. The most recent entry is always kept.
+		void evict()
+		{
+			while (used > capacity && order.size() > 1)
+			{
+				Entry& last = order.back();
+
+				used -= last.second->getMemoryUsage();
+				entries.erase(last.first);
+				order.pop_back();
+
+				++evictions;
+			}
+		}
+};
\ No newline at end of file
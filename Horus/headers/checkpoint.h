@@ -0,0 +1,87 @@
+#pragma once
+#include "framebuffer.h"
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <vector>
+#include <condition_variable>
+
+// Where a progressive render stands: the passes completed, and how far the current pass got. Pixels of rows [0, nextRow) hold
+// total + passSamples samples, the others total, so the per pixel sample counts take three numbers rather than a buffer.
+struct CheckpointHeader
+{
+	char magic[4];
+	uint32_t version;
+
+	int32_t width;
+	int32_t height;
+
+	// Settings the buffers depend on; a checkpoint only resumes a render with the same ones.
+	uint32_t samplerType;
+	int32_t plannedSamples;
+	uint32_t filterType;	// 0 without a film filter, FilterType + 1 otherwise
+	float filterRadius;
+	uint32_t aovMask;		// bit per AOVType
+	uint32_t bufferCount;
+
+	int32_t pass;
+	int32_t total;
+	int32_t passSamples;	// 0 between passes
+	int32_t nextRow;
+
+	uint32_t samplerStateSize;
+};
+
+// Accumulation buffers (color, AOVs, denoiser features) and random number streams of a render, enough to continue it and end up with
+// the image an uninterrupted render would have given.
+struct Checkpoint
+{
+	CheckpointHeader header = {};
+	std::string samplerState;
+	std::vector<Framebuffer> buffers;
+};
+
+// Little-endian binary file: the header, the sampler state, then each buffer (Framebuffer::write). Written next to 'filePath' and
+// renamed over it, so a render killed while writing leaves the previous checkpoint intact.
+bool writeCheckpoint(const std::string& filePath, const Checkpoint& checkpoint);
+
+// Reads the header and the sampler state; the buffers are left in the stream for the caller to read into its own framebuffers.
+bool readCheckpointHeader(std::istream& stream, Checkpoint& checkpoint);
+
+// Writes checkpoints from a background thread, like ProgressiveWriter does previews: every 'interval' it asks for one, the render
+// thread polls snapshotRequested() between rows and hands over copies of its buffers with submit(), and the writing happens here.
+class CheckpointWriter
+{
+	public:
+		CheckpointWriter(const std::string& filePath) : filePath(filePath) {}
+		~CheckpointWriter() { stop(); }
+
+		void start(std::chrono::milliseconds interval);
+
+		// Writes a checkpoint submitted after the last request before returning.
+		void stop();
+
+		bool snapshotRequested() const { return requested.load(std::memory_order_relaxed); }
+		void submit(Checkpoint&& checkpoint);
+
+		int32_t getCheckpointCount() const { return checkpointCount; }
+
+	private:
+		std::string filePath;
+
+		std::chrono::milliseconds interval{ 0 };
+		std::thread thread;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::atomic<bool> requested{ false };
+		bool submitted = false;
+		bool stopping = false;
+
+		Checkpoint checkpoint;
+		int32_t checkpointCount = 0;
+
+		void run();
+};
\ No newline at end of file
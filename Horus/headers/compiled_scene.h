@@ -0,0 +1,101 @@
+#pragma once
+#include "scene.h"
+#include <string>
+#include <cstdint>
+
+// Compiled scene files (.hrsb) hold a parsed .hrs scene as packed little-endian record arrays: the material table with the shaders
+// inlined, the cameras, lights and geometries, a string table for data file paths, and optionally the flattened top level BVH.
+// Loading one maps the file and fills per type arrays (SceneArena), so no text is parsed and no shader file is opened.
+
+struct CompiledSceneHeader
+{
+	char magic[4];
+	uint32_t version;
+
+	uint32_t materialCount;
+	uint32_t cameraCount;
+	uint32_t lightCount;
+	uint32_t geometryCount;
+	uint32_t bvhNodeCount;
+	uint32_t bvhPrimitiveCount;
+
+	uint64_t materialOffset;
+	uint64_t cameraOffset;
+	uint64_t lightOffset;
+	uint64_t geometryOffset;
+	uint64_t bvhNodeOffset;
+	uint64_t bvhPrimitiveOffset;
+	uint64_t stringOffset;
+	uint64_t stringSize;
+};
+
+// 'type' is the alternative of the Material variant (Shader, Constant, Depth, Surface).
+struct MaterialRecord
+{
+	uint32_t type;
+	float color[3];
+	float diffuseGain;
+	float diffuseColor[3];
+	float roughness;
+};
+
+struct CameraRecord
+{
+	uint32_t type;
+	float position[3];
+	float rotation[3];
+	float lookAt[3];
+	float width;
+	float height;
+};
+
+struct LightRecord
+{
+	uint32_t type;
+	float position[3];
+	float rotation[3];
+	float color[3];
+	float size;
+	float intensity;
+};
+
+// Parameters of any geometry type; each type reads the fields its parser would set. 'flags' keeps the plane update flags
+// and whether a reference has proxy bounds.
+struct GeometryRecord
+{
+	uint32_t type;
+	uint32_t material;
+	uint32_t flags;
+	float position[3];
+	float rotation[3];
+	float size;
+	float width;
+	float height;
+	float displacement;
+	float frequency;
+	int32_t resolution;
+	float cache;
+	float bounds[6];
+	uint32_t fileOffset;
+	uint32_t fileLength;
+};
+
+// Flattened BVH node; leaves refer to a range of the primitive table, which stores geometry indices.
+struct BVHNodeRecord
+{
+	float min[3];
+	float max[3];
+	int32_t primitiveOffset;
+	int32_t nPrimitives;
+	int32_t secondChildOffset;
+};
+
+bool isCompiledScene(const std::string& filePath);
+
+// Parses 'scenePath' and writes it to 'outputPath'. The top level BVH is built and stored as well unless 'includeBVH' is false.
+bool compileScene(const std::string& scenePath, const std::string& outputPath, bool includeBVH = true);
+
+bool writeCompiledScene(const std::string& filePath, Scene& scene, bool includeBVH);
+
+// Loads a compiled scene into 'scene', including its prebuilt BVH when the file has one.
+bool loadCompiledScene(const std::string& filePath, Scene& scene);
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Deflate (RFC 1951) compressor: LZ77 over a 32 KB window with hash chains, then dynamic Huffman blocks.
+// Chunks compressed independently can be concatenated into one stream: every chunk but the last ends on an empty stored block,
+// which leaves the stream byte aligned, and only the last chunk (final = true) sets the final block bit.
+void deflateCompress(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out);
+
+// Adler-32 checksum of the zlib format, continued from 'adler'.
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler = 1);
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "framebuffer.h"
+#include "render.h"
+#include <vector>
+
+// Edge-avoiding a-trous wavelet denoiser (Dammertz et al. 2010), with the luminance edge stopping function scaled by a per pixel
+// variance estimate as in SVGF (Schied et al. 2017). The color is divided by the first hit albedo, so textures are not blurred,
+// then filtered by five passes of a 5x5 B3 spline kernel whose taps are spread 1, 2, 4, 8 and 16 pixels apart. Each tap is weighted
+// by how close its normal, depth, albedo and luminance are to the center pixel; the luminance tolerance follows the standard
+// deviation of the pixel mean, which shrinks as samples are added. Rows are filtered in parallel.
+class Denoiser
+{
+	public:
+		// Allocates the feature buffers; weighted ones accumulate the features of several passes.
+		void resize(int32_t width, int32_t height, bool weighted = false);
+
+		// Records the features of pixel (x, y) from the sums samplePixel() returns for 'samples' samples.
+		void addSample(int32_t x, int32_t y, const AOVSample& aov, int32_t samples);
+
+		// Filters 'color', the mean radiance of 'samples' samples per pixel, in place.
+		void apply(Framebuffer& color, int32_t samples, int32_t threads = 0) const;
+
+		size_t getMemorySize() const { return normal.getMemorySize() + albedo.getMemorySize() + moments.getMemorySize(); }
+
+		// The feature buffers, which checkpoints save and restore.
+		std::vector<Framebuffer*> getFeatureBuffers() { return { &normal, &albedo, &moments }; }
+
+	private:
+		Framebuffer normal;
+		Framebuffer albedo;
+
+		// Depth, mean squared luminance, 0.
+		Framebuffer moments;
+};
\ No newline at end of file
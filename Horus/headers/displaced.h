@@ -0,0 +1,80 @@
+#pragma once
+#include "mesh.h"
+#include "cache.h"
+
+// Micro-triangles of one tessellated patch with their own BVH.
+struct TessellatedPatch
+{
+	std::vector<Vector3D<float>> vertices;
+	std::vector<uint32_t> indices;
+	PrimitiveBVH bvh;
+
+	size_t getMemoryUsage() const { return sizeof(TessellatedPatch) + vertices.capacity() * sizeof(Vector3D<float>) + indices.capacity() * sizeof(uint32_t) + bvh.getMemoryUsage(); }
+};
+
+// Sphere displaced along its normal by a procedural height field. The surface is split into patches of which only conservative bounds
+// are kept; a patch is tessellated into a micro BVH the first time a ray enters its bounds, and kept in a size capped LRU cache.
+class DisplacedSurfaceObject : public GeometryObject {
+
+	public:
+
+		DisplacedSurfaceObject();
+
+		std::string_view getObjectName() override
+		{
+			return name;
+		}
+
+		void setRadius(float r) { size = r; updatePatches(); }
+		void setDisplacement(float d) { displacement = d; updatePatches(); }
+		void setFrequency(float f) { frequency = f; updatePatches(); }
+		void setResolution(int32_t r) { resolution = std::max(1, r); cache.clear(); }
+
+		float getDisplacement() const { return displacement; }
+		float getFrequency() const { return frequency; }
+		int32_t getResolution() const { return resolution; }
+
+		void setCacheSize(float megabytes) override { cache.setCapacity(static_cast<size_t>(megabytes * 1024.0f * 1024.0f)); }
+		float getCacheSize() override { return cache.getCapacity() / (1024.0f * 1024.0f); }
+
+		virtual void setBoundingBox() override;
+
+		virtual void printProperties() override
+		{
+			GeometryObject::printProperties();
+			std::cout << "Type: " << getObjectName() << std::endl;
+			std::cout << "radius: " << size << std::endl;
+			std::cout << "displacement: " << displacement << std::endl;
+			std::cout << "frequency: " << frequency << std::endl;
+			std::cout << "patches: " << patchBounds.size() << " of " << resolution << "x" << resolution << " quads" << std::endl;
+		}
+
+		virtual void printStatistics() override;
+
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override;
+
+		// Cache counters, for tests and statistics.
+		const LRUCache<uint32_t, TessellatedPatch>& getCache() const { return cache; }
+		size_t getPatchCount() const { return patchBounds.size(); }
+
+	private:
+
+		static const int32_t patchesU = 32;
+		static const int32_t patchesV = 16;
+
+		float displacement = 0.1f;
+		float frequency = 8.0f;
+		int32_t resolution = 16;
+
+		std::vector<BoundingBox> patchBounds;
+		PrimitiveBVH patchBVH;
+
+		LRUCache<uint32_t, TessellatedPatch> cache;
+
+		Vector3D<float> evaluate(float u, float v) const;
+
+		void updatePatches();
+		std::shared_ptr<TessellatedPatch> tessellate(uint32_t patch) const;
+
+		static constexpr const char name[] = "Displaced Surface";
+};
\ No newline at end of file
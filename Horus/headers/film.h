@@ -0,0 +1,62 @@
+#pragma once
+#include "framebuffer.h"
+#include <mutex>
+#include <memory>
+#include <string_view>
+
+enum class FilterType {
+	BOX,
+	TENT,
+	GAUSSIAN,
+	MITCHELL
+};
+
+// Pixel reconstruction filter, separable, centered on the pixel center and zero from 'radius' pixels on. Default radii: box 0.5
+// (each sample counts for the pixel it falls in only), tent 1, Gaussian 1.5 (exp(-2 x^2), shifted to reach 0 at the radius) and
+// Mitchell-Netravali 2 (B = C = 1/3, whose negative lobes sharpen the edges back).
+class Filter
+{
+	public:
+		Filter(FilterType type = FilterType::BOX, float radius = 0.0f);
+
+		FilterType getType() const { return type; }
+		float getRadius() const { return radius; }
+
+		float evaluate(float x, float y) const { return evaluate1D(x) * evaluate1D(y); }
+		float evaluate1D(float x) const;
+
+	private:
+		FilterType type;
+		float radius;
+		float gaussianEdge = 0.0f;
+};
+
+bool stringToFilterType(std::string_view name, FilterType& type);
+
+// Weighted framebuffer that samples are splatted into: each sample at a continuous film position is added to every pixel whose center
+// is within the filter radius, with the filter weight, and get() resolves the filtered color. A splat takes the lock of each tile it
+// writes to, one at a time, so threads may splat anywhere; threads working on different tiles only meet at the tile borders.
+// The accumulation is kept in float precision even for half framebuffers: with negative filter lobes the weight of a pixel can come
+// close to zero, where the running mean of the half storage is not stable.
+class Film
+{
+	public:
+		void setFilter(const Filter& filter) { this->filter = filter; }
+		const Filter& getFilter() const { return filter; }
+
+		// Allocates the accumulation and clears it.
+		void resize(int32_t width, int32_t height);
+
+		// Adds a sample at film position (x, y), in pixels from the top left corner of the image: pixel (i, j) covers [i, i + 1) x [j, j + 1).
+		void addSample(float x, float y, const Vector3D<float>& radiance);
+
+		Framebuffer& getFramebuffer() { return framebuffer; }
+		const Framebuffer& getFramebuffer() const { return framebuffer; }
+
+		size_t getMemorySize() const { return framebuffer.getMemorySize(); }
+
+	private:
+		Filter filter;
+		Framebuffer framebuffer;
+		std::unique_ptr<std::mutex[]> tileLocks;
+};
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include "vec_math.h"
+#include "half.h"
+#include <vector>
+#include <iosfwd>
+#include <cstdint>
+
+// Image being rendered, allocated once from the camera window and written by pixel coordinates, so pixels can arrive in any order.
+// Pixels are stored in tiles of tileSize x tileSize: a tile is one contiguous run of memory, so a thread rendering a tile writes
+// to its own cache lines. The optional weight channel lets samples be accumulated over several passes and resolved when read.
+// With half precision the colors are stored as binary16, 6 bytes per pixel instead of 12 (weights stay float). A weighted half
+// framebuffer keeps the running mean rather than the sum, so large sample counts cannot overflow the half range. Each store rounds
+// to within 2^-11 relative; with passes that double the sample count the earlier roundings are diluted and the mean stays within
+// 2^-10. On an 8 bit output that is at most a quarter of a step, so a value changes by at most one step, and only next to a step.
+static_assert(sizeof(Vector3D<float>) == 3 * sizeof(float), "Framebuffer pixels are accessed as a flat float array");
+
+class Framebuffer
+{
+	public:
+		static constexpr int32_t tileSize = 16;
+
+		Framebuffer() {}
+		Framebuffer(int32_t width, int32_t height, bool weighted = false) { resize(width, height, weighted); }
+
+		// Allocates the image and clears it to black (weight 0).
+		void resize(int32_t width, int32_t height, bool weighted = false);
+		void clear();
+
+		// Storage of the colors, applied by the next resize().
+		void setHalfPrecision(bool half) { halfPrecision = half; }
+		bool isHalfPrecision() const { return halfPrecision; }
+
+		// Bytes allocated for colors and weights.
+		size_t getMemorySize() const;
+
+		int32_t getWidth() const { return width; }
+		int32_t getHeight() const { return height; }
+		int32_t getTilesX() const { return tilesX; }
+		int32_t getTilesY() const { return tilesY; }
+		bool isWeighted() const { return !weights.empty(); }
+
+		// Offset of pixel (x, y), (0, 0) being the top left corner.
+		size_t index(int32_t x, int32_t y) const
+		{
+			size_t tile = static_cast<size_t>(y / tileSize) * tilesX + (x / tileSize);
+
+			return tile * (tileSize * tileSize) + (y % tileSize) * tileSize + (x % tileSize);
+		}
+
+		void set(int32_t x, int32_t y, const Vector3D<float>& color)
+		{
+			size_t i = index(x, y);
+
+			if (halfPrecision)
+			{
+				floatsToHalves(&color.x, &halfPixels[i * 3], 3);
+			}
+			else
+			{
+				pixels[i] = color;
+			}
+		}
+
+		// Adds a sample with the given weight; needs the weight channel.
+		void accumulate(int32_t x, int32_t y, const Vector3D<float>& color, float weight = 1.0f)
+		{
+			size_t i = index(x, y);
+
+			if (halfPrecision)
+			{
+				Vector3D<float> mean;
+				halvesToFloats(&halfPixels[i * 3], &mean.x, 3);
+
+				weights[i] += weight;
+				mean += (color - mean) * (weight / weights[i]);
+
+				floatsToHalves(&mean.x, &halfPixels[i * 3], 3);
+			}
+			else
+			{
+				pixels[i] += color * weight;
+				weights[i] += weight;
+			}
+		}
+
+		// Tile row 'tileY' (image rows tileY * tileSize up to the next tileSize rows) is one contiguous block of channels, edge padding
+		// included; the float or the half one, depending on the storage.
+		float* getTileRowData(int32_t tileY) { return &pixels[static_cast<size_t>(tileY) * tilesX * tileSize * tileSize].x; }
+		uint16_t* getTileRowHalfData(int32_t tileY) { return &halfPixels[static_cast<size_t>(tileY) * tilesX * tileSize * tileSize * 3]; }
+		size_t getTileRowFloats() const { return static_cast<size_t>(tilesX) * tileSize * tileSize * 3; }
+
+		// Stored color, divided by the accumulated weight when the framebuffer is weighted.
+		Vector3D<float> get(int32_t x, int32_t y) const;
+
+		// Copies row 'y' in scanline order into 'row', which holds at least getWidth() pixels.
+		void getRow(int32_t y, Vector3D<float>* row) const;
+
+		// Stores getWidth() pixels of 'row' as row 'y' of an unweighted framebuffer.
+		void setRow(int32_t y, const Vector3D<float>* row);
+
+		// Raw contents in storage order, after the size and the storage flags. read() fails, leaving the contents undefined, unless
+		// the stored size and storage match this framebuffer's.
+		bool write(std::ostream& stream) const;
+		bool read(std::istream& stream);
+
+	private:
+		int32_t width = 0;
+		int32_t height = 0;
+		int32_t tilesX = 0;
+		int32_t tilesY = 0;
+
+		bool halfPrecision = false;
+
+		std::vector<Vector3D<float>> pixels;
+		std::vector<uint16_t> halfPixels;
+		std::vector<float> weights;
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+// Procedural .hrs scenes for stress testing the parser and the BVH. The output depends only on the settings (the generator carries
+// its own random number generator), so a given seed produces the same file on every platform and version.
+
+enum class SceneDistribution {
+	UNIFORM,
+	CLUSTERED,
+	COINCIDENT
+};
+
+struct GeneratorSettings
+{
+	uint64_t count = 1000;
+	SceneDistribution distribution = SceneDistribution::UNIFORM;
+	uint64_t seed = 1;
+
+	// Every planeInterval-th geometry is a small plane instead of a sphere; 0 generates spheres only.
+	uint32_t planeInterval = 8;
+
+	int32_t width = 160;
+	int32_t height = 90;
+};
+
+bool stringToDistribution(std::string_view name, SceneDistribution& distribution);
+const char* distributionToString(SceneDistribution distribution);
+
+// Writes a scene with a camera, a dome light and settings.count geometries placed according to settings.distribution:
+// UNIFORM fills a cube at constant density, CLUSTERED packs them around a few centers, and COINCIDENT gives every geometry
+// the same centroid (nested spheres and crossing planes), the degenerate input for Morton codes and splits.
+bool generateScene(const std::string& filePath, const GeneratorSettings& settings);
+
+// Generates scenes of 1e3, 1e4, ... up to maxCount geometries and reports the parse, BVH build and render time of each.
+// When resultsPath is not empty the timings are also appended to it as CSV rows, so runs of different versions can be compared.
+bool runScalingBenchmark(SceneDistribution distribution, uint64_t maxCount, const std::string& resultsPath);
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// IEEE 754 binary16 conversions. Rounding is to nearest even, so a stored value is within 2^-11 of the float it came from
+// (relative, for the normal range of 6.1e-5 up to 65504); larger values become infinity.
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+// Bulk conversions, four values per instruction when the CPU has F16C, with the same results as the scalar functions.
+void floatsToHalves(const float* values, uint16_t* halves, size_t count);
+void halvesToFloats(const uint16_t* halves, float* values, size_t count);
+
+// True when the bulk conversions run on F16C.
+bool hasF16C();
\ No newline at end of file
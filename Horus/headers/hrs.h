@@ -1,14 +1,14 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
 #include <iostream>
 #include <unordered_map>
 #include <string_view>
-#include <variant>
 #include "vec_math.h"
 #include "ray.h"
-#include "shader.h"
-#include "BxDF.h"
+#include "tokenizer.h"
+#include "material.h"
 
 struct Morton
 {
@@ -121,19 +121,6 @@ inline BoundingBox operator+(const BoundingBox& a, const BoundingBox& b)
 	return c += b;
 }
 
-enum class ShaderType {
-	CONSTANT,
-	DEPTH,
-	SURFACE
-};
-
-enum class ShaderParameterType {
-	COLOR,
-	DIFFUSE_GAIN,
-	DIFFUSE_COLOR,
-	ROUGHNESS,
-};
-
 struct HitRecord
 {
 	bool front = false;
@@ -141,6 +128,14 @@ struct HitRecord
 
 	Vector3D<float> hitPoint;
 	float t = 0.0f;
+
+	uint32_t primitive = 0;
+
+	// Set by the geometries that find the normal while intersecting (meshes); the others compute it in getNormal().
+	Vector3D<float> normal;
+
+	// Material of the object hit inside a referenced asset; null for the material of the geometry itself.
+	Material* shader = nullptr;
 };
 
 enum class ParameterType {
@@ -157,10 +152,16 @@ enum class ParameterType {
 	ROUGHNESS,
 	LAT,
 	WINDOW,
-	SHADER
+	SHADER,
+	FILE,
+	CACHE,
+	DISPLACEMENT,
+	FREQUENCY,
+	RESOLUTION,
+	BOUNDS
 };
 
-extern std::unordered_map<std::string, ParameterType> parameterMap;
+extern std::unordered_map<std::string_view, ParameterType> parameterMap;
 
 enum class SceneObjectType {
 	GEOMETRY,
@@ -170,7 +171,12 @@ enum class SceneObjectType {
 
 enum class GeometryType {
 	SPHERE,
-	PLANE
+	PLANE,
+	MESH,
+	PARTICLES,
+	PAGED_MESH,
+	DISPLACED,
+	REFERENCE
 };
 
 enum class LightType {
@@ -216,6 +222,8 @@ class SceneObject {
 
 // GEOMETRY ###############################################
 
+class CameraObject;
+
 // Derived classes for specific scene objects
 class GeometryObject : public SceneObject {
 
@@ -250,38 +258,59 @@ class GeometryObject : public SceneObject {
 
 		bool checkPositionRotationWidthHeightUpdated() { return positionUpdated && rotationUpdated && widthUpdated && heightUpdated; }
 
-		virtual Vector3D<float> getNormal() { return Vector3D<float>(0.0f, 0.0f, 0.0f); };
+		// Normal at the hit, facing the incoming ray for meshes.
+		virtual Vector3D<float> getNormal(const HitRecord& hit) { return hit.normal; };
+
+		// Records the closest hit in (tMin, tMax) in 'hit', which is left untouched when there is none. The geometry keeps no state of its
+		// own about the hit, so any number of threads may trace rays through it.
+		virtual bool rayIntersection(Ray&, float, float, HitRecord&) { return false; };
+
+		// Loads external data referenced by the -file- parameter. Only geometries backed by a data file override this.
+		virtual bool loadFile(const std::string&) { return false; }
+		virtual std::string_view getFilePath() { return std::string_view(); }
+
+		// Sets the memory budget of geometries that load their data on demand.
+		virtual void setCacheSize(float) {}
+		virtual float getCacheSize() { return 0.0f; }
+
+		// Prints per-render statistics, such as cache counters, after the image is written.
+		virtual void printStatistics() {}
+
+		// Called by the parser once every parameter of the object has been read.
+		virtual void endParameters() {}
+
+		// Called before rendering, once the camera is set up.
+		virtual void prepare(CameraObject&) {}
 
-		virtual bool rayIntersection(Ray& ray, float tMin, float tMax) { return false; };
+		// Points the geometry at the shared material parsed from 'shaderFilePath'.
+		bool linkShader(std::string_view shaderFilePath) { return MaterialLibrary::getInstance().load(shaderFilePath, material); }
 
-		bool linkShader(std::string& shaderFilePath);
+		uint32_t getMaterial() const { return material; }
+		void setMaterial(uint32_t index) { material = index; }
 
-		std::variant<Shader, Constant, Depth, Surface>& getShader() { return shader; }
+		// Position of the geometry in the scene, counted from 1, written to the primitive id AOV.
+		uint32_t getObjectId() const { return objectId; }
+		void setObjectId(uint32_t id) { objectId = id; }
 
-		bool getHitRecordFront() { return hitRecord.front; }
-		bool getHitRecordBack() { return hitRecord.back; }
+		Material& getShader() { return MaterialLibrary::getInstance().get(material); }
+
+		// Material at the hit, which differs from the geometry's own for references.
+		Material& getShader(const HitRecord& hit) { return hit.shader ? *hit.shader : getShader(); }
 
 		void createMorton() { morton.code = computeMorton(boundingBox.getCentroid()); }
 
 		Morton getMorton() { return morton; }
 
 		float size;
-		HitRecord hitRecord;
 
 		BoundingBox boundingBox;
 
 	private:
 
 		GeometryType geometryType;
-		std::ifstream shaderFile;
-
-		std::string token;
-
-		std::variant<Shader, Constant, Depth, Surface> shader;
 
-		bool parse();
-
-		bool assignShader(ShaderType sType);
+		uint32_t material = 0;
+		uint32_t objectId = 0;
 
 		bool positionUpdated = false;
 		bool rotationUpdated = false;
@@ -295,7 +324,7 @@ class SphereObject : public GeometryObject {
 
 	public:
 
-		SphereObject(float r = 1.0f) : GeometryObject(GeometryType::SPHERE), normal(0.0f, 0.0f, 0.0f) { GeometryObject::size = r; setBoundingBox(); }
+		SphereObject(float r = 1.0f) : GeometryObject(GeometryType::SPHERE) { GeometryObject::size = r; setBoundingBox(); }
 		
 		std::string_view getObjectName() override
 		{
@@ -313,14 +342,11 @@ class SphereObject : public GeometryObject {
 			boundingBox.computeCentroid();
 		}
 
-		virtual void computeNormal() override
+		virtual Vector3D<float> getNormal(const HitRecord& hit) override
 		{
-			normal = hitRecord.hitPoint - position;
+			Vector3D<float> normal = hit.hitPoint - position;
 			normal.normalize();
-		}
 
-		virtual Vector3D<float> getNormal() override
-		{
 			return normal;
 		}
 
@@ -332,7 +358,7 @@ class SphereObject : public GeometryObject {
 		}
 
 		// Implements ray-sphere intersection using the quadratic formula.
-		bool rayIntersection(Ray& ray, float tMin, float tMax) override
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override
 		{
 			float a = ray.direction * ray.direction;
 
@@ -356,17 +382,17 @@ class SphereObject : public GeometryObject {
 
 			if (t1 > tMin && t1 < tMax)
 			{
-				hitRecord.front = true;
-				hitRecord.hitPoint = ray.getPointat(t1);
-				hitRecord.t = t1;
+				hit.front = true;
+				hit.hitPoint = ray.getPointat(t1);
+				hit.t = t1;
 				return true;
 			}
 
 			if (t2 > tMin && t2 < tMax)
 			{
-				hitRecord.front = false;
-				hitRecord.hitPoint = ray.getPointat(t2);
-				hitRecord.t = t2;
+				hit.front = false;
+				hit.hitPoint = ray.getPointat(t2);
+				hit.t = t2;
 
 				return true;
 			}
@@ -376,8 +402,6 @@ class SphereObject : public GeometryObject {
 
 	private:
 
-		Vector3D<float> normal;
-
 		static constexpr const char name[] = "Sphere";
 };
 
@@ -400,7 +424,7 @@ class PlaneObject : public GeometryObject {
 
 		virtual void computeNormal() override;
 
-		virtual Vector3D<float> getNormal() override
+		virtual Vector3D<float> getNormal(const HitRecord&) override
 		{
 			return normal;
 		}
@@ -444,7 +468,7 @@ class PlaneObject : public GeometryObject {
 			boundingBox.computeCentroid();
 		}
 
-		virtual bool rayIntersection(Ray& ray, float tMin, float tMax) override
+		virtual bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override
 		{
 			if (ray.direction * normal == 0.0f) { return false; }
 
@@ -462,10 +486,10 @@ class PlaneObject : public GeometryObject {
 				//if (hitPoint > min && hitPoint < max)
 				if (fabs(lx) <= width * 0.5f && fabs(lz) <= height * 0.5f)
 				{
-					hitRecord.front = true;
-					hitRecord.back = false;
-					hitRecord.hitPoint = hitPoint;
-					hitRecord.t = t;
+					hit.front = true;
+					hit.back = false;
+					hit.hitPoint = hitPoint;
+					hit.t = t;
 
 					return true;
 				}
@@ -655,6 +679,9 @@ class CameraObject : public SceneObject {
 		float getHeight() { return height; }
 
 		Ray genRay(float u, float v); 
+
+		// Returns false if 'box' lies entirely outside the viewing frustum set up by setWindow().
+		bool isInFrustum(const BoundingBox& box);
 		
 
 		Vector3D<float> lookAt;
@@ -696,8 +723,36 @@ class PerspectiveCameraObject : public CameraObject {
 		float fieldOfView;
 };
 
-bool SceneBuilder(const std::string&, std::vector<std::unique_ptr<SceneObject>>&);
+// Scene objects stored by value in one array per type, so a loaded scene costs one allocation per type instead of one per object.
+// Geometries that own large buffers (meshes, particle sets, ...) are still allocated one by one. 'objects' lists every object,
+// keeping the file order within cameras, lights and geometries.
+// The arrays are reserved up front and never grow afterwards, which keeps the pointers in 'objects' valid.
+struct SceneArena
+{
+	std::vector<SphereObject> spheres;
+	std::vector<PlaneObject> planes;
+	std::vector<PerspectiveCameraObject> cameras;
+	std::vector<PointLightObject> pointLights;
+	std::vector<DomeLightObject> domeLights;
+
+	std::vector<std::unique_ptr<SceneObject>> aggregates;
+
+	std::vector<SceneObject*> objects;
+};
+
+bool SceneBuilder(const std::string&, std::vector<std::unique_ptr<SceneObject>>&, int32_t threads = 0);
+
+// A -shader- parameter whose file is linked after parsing. The path is copied: it may point into an include file that is closed by then.
+struct ShaderLink
+{
+	GeometryObject* object;
+	std::string shaderFilePath;
+};
+
+void parseObjects(Tokenizer& file, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, std::vector<ShaderLink>* shaderLinks = nullptr);
+void linkShaders(const std::vector<ShaderLink>& shaderLinks);
+const char* nextObjectBoundary(const char* p, const char* end);
 
-void tokenSearch(std::ifstream& file, char c, std::string& token);
-void charSearch(std::ifstream& file, char c, std::string& token);
-void setObjectParameters(std::ifstream& file, std::string& token, std::vector<std::unique_ptr<SceneObject>>& sceneObjects);
\ No newline at end of file
+void tokenSearch(Tokenizer& file, char c, std::string_view& token);
+void charSearch(Tokenizer& file, char c, std::string_view& token);
+void setObjectParameters(Tokenizer& file, std::string_view& token, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, std::vector<ShaderLink>* shaderLinks = nullptr);
\ No newline at end of file
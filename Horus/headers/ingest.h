@@ -0,0 +1,8 @@
+#pragma once
+#include "scene.h"
+#include <string>
+
+// Streams a text scene into 'scene'. The mapped file is cut into batches at object boundaries, parser threads turn the batches into
+// objects, and the calling thread hands every finished batch, in file order, to the BVH (bounds collection and merging) while the
+// following batches are still being parsed. Only the Morton, sort and treelet stages wait for the end of the file.
+bool ingestScene(const std::string& filePath, Scene& scene, int32_t threads = 0);
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// Read-only view of a whole file mapped into the address space.
+class MappedFile
+{
+	public:
+		MappedFile() {}
+		MappedFile(const std::string& filePath) { open(filePath); }
+		~MappedFile() { close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& filePath);
+		void close();
+
+		bool isOpen() const { return data != nullptr || (opened && length == 0); }
+
+		const char* getData() const { return data; }
+		size_t getSize() const { return length; }
+
+		const char* begin() const { return data; }
+		const char* end() const { return data + length; }
+
+	private:
+		const char* data = nullptr;
+		size_t length = 0;
+		bool opened = false;
+
+#ifdef _WIN32
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+#else
+		int fileDescriptor = -1;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <string>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <variant>
+#include <string_view>
+#include <unordered_map>
+#include "shader.h"
+#include "BxDF.h"
+#include "tokenizer.h"
+
+enum class ShaderType {
+	CONSTANT,
+	DEPTH,
+	SURFACE
+};
+
+enum class ShaderParameterType {
+	COLOR,
+	DIFFUSE_GAIN,
+	DIFFUSE_COLOR,
+	ROUGHNESS,
+};
+
+using Material = std::variant<Shader, Constant, Depth, Surface>;
+
+// Process wide table of the materials referenced by -shader- parameters. Each shader file is parsed once, keyed by its canonical path,
+// and geometries keep only the index of their material. Index 0 is the default material used by geometries without a shader.
+class MaterialLibrary
+{
+	public:
+		static MaterialLibrary& getInstance();
+
+		// Returns the index of the material described by 'shaderFilePath' in 'index', parsing the file on first use.
+		bool load(std::string_view shaderFilePath, uint32_t& index);
+
+		// Appends a material that does not come from a shader file, e.g. one read from a compiled scene, and returns its index.
+		uint32_t add(const Material& material);
+
+		// Entries are never removed and live in blocks that never move, so references stay valid while more materials are loaded, and
+		// render threads can look materials up without the lock while an asset loaded on demand adds its own.
+		Material& get(uint32_t index) { return blocks[index / blockSize][index % blockSize]; }
+
+		size_t getMaterialCount() const { return materialCount; }
+
+	private:
+		MaterialLibrary();
+
+		static constexpr uint32_t blockSize = 1024;
+		static constexpr uint32_t blockCount = 4096;
+
+		std::unique_ptr<Material[]> blocks[blockCount];
+		uint32_t materialCount = 0;
+
+		// Appends a default material under the lock; returns false when the library is full.
+		bool append(uint32_t& index);
+
+		// Canonical path -> index, plus the spelling used in the scene -> index so repeated references skip the path resolution.
+		std::unordered_map<std::string, uint32_t> canonicalIndices;
+		std::unordered_map<std::string, uint32_t> pathIndices;
+
+		std::mutex mutex;
+
+		bool parse(Tokenizer& shaderFile, Material& material);
+};
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include "hrs.h"
+#include "accelerator.h"
+
+// Triangle mesh stored in packed vertex and index buffers, with its own BVH over the triangles.
+class MeshObject : public GeometryObject {
+
+	public:
+
+		MeshObject();
+
+		std::string_view getObjectName() override
+		{
+			return name;
+		}
+
+		bool loadFile(const std::string& filePath) override;
+		std::string_view getFilePath() override { return sourceFilePath; }
+
+		size_t getVertexCount() const { return vertices.size(); }
+		size_t getTriangleCount() const { return indices.size() / 3; }
+
+		virtual void setBoundingBox() override;
+
+		virtual void printProperties() override
+		{
+			GeometryObject::printProperties();
+			std::cout << "Type: " << getObjectName() << std::endl;
+			std::cout << "vertices: " << getVertexCount() << std::endl;
+			std::cout << "triangles: " << getTriangleCount() << std::endl;
+		}
+
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override;
+
+	private:
+
+		std::string sourceFilePath;
+
+		std::vector<Vector3D<float>> vertices;
+		std::vector<uint32_t> indices;
+
+		PrimitiveBVH bvh;
+
+		Matrix4X4<float> R;
+
+		static constexpr const char name[] = "Mesh";
+};
+
+// Moller-Trumbore ray-triangle intersection. Returns the hit distance, or a negative value if the ray misses the triangle within (tMin, tMax).
+inline float intersectTriangle(const Vector3D<float>& origin, const Vector3D<float>& direction, const Vector3D<float>& v0, const Vector3D<float>& v1, const Vector3D<float>& v2, float tMin, float tMax)
+{
+	Vector3D<float> e1 = v1 - v0;
+	Vector3D<float> e2 = v2 - v0;
+
+	Vector3D<float> p = direction | e2;
+	float det = e1 * p;
+
+	if (std::fabs(det) < 1e-12f) { return -1.0f; }
+
+	float invDet = 1.0f / det;
+
+	Vector3D<float> s = origin - v0;
+	float u = (s * p) * invDet;
+
+	if (u < 0.0f || u > 1.0f) { return -1.0f; }
+
+	Vector3D<float> q = s | e1;
+	float v = (direction * q) * invDet;
+
+	if (v < 0.0f || u + v > 1.0f) { return -1.0f; }
+
+	float t = (e2 * q) * invDet;
+
+	return (t > tMin && t < tMax) ? t : -1.0f;
+}
+
+// Moves a world space ray into the space of an object placed at 'position' and rotated by 'R'. Rigid transforms keep the hit distance unchanged.
+inline Ray toObjectSpace(const Ray& ray, const Vector3D<float>& position, const Matrix4X4<float>& R)
+{
+	Vector3D<float> d = ray.origin - position;
+	Vector3D<float> dir = ray.direction;
+
+	Ray localRay;
+	localRay.origin = Vector3D<float>(R.getValue(0, 0) * d.x + R.getValue(1, 0) * d.y + R.getValue(2, 0) * d.z,
+	                                  R.getValue(0, 1) * d.x + R.getValue(1, 1) * d.y + R.getValue(2, 1) * d.z,
+	                                  R.getValue(0, 2) * d.x + R.getValue(1, 2) * d.y + R.getValue(2, 2) * d.z);
+
+	localRay.direction = Vector3D<float>(R.getValue(0, 0) * dir.x + R.getValue(1, 0) * dir.y + R.getValue(2, 0) * dir.z,
+	                                     R.getValue(0, 1) * dir.x + R.getValue(1, 1) * dir.y + R.getValue(2, 1) * dir.z,
+	                                     R.getValue(0, 2) * dir.x + R.getValue(1, 2) * dir.y + R.getValue(2, 2) * dir.z);
+
+	return localRay;
+}
+
+// Returns the world space box enclosing the eight transformed corners of an object space box.
+inline BoundingBox toWorldBounds(const BoundingBox& local, const Vector3D<float>& position, const Matrix4X4<float>& R)
+{
+	Vector3D<float> mn = position + (R * local.getMin());
+	Vector3D<float> mx = mn;
+
+	for (int32_t i = 1; i < 8; ++i)
+	{
+		Vector3D<float> corner((i & 1) ? local.getMax().x : local.getMin().x, (i & 2) ? local.getMax().y : local.getMin().y, (i & 4) ? local.getMax().z : local.getMin().z);
+		Vector3D<float> c = position + (R * corner);
+
+		if (c.x < mn.x) { mn.x = c.x; }
+		if (c.y < mn.y) { mn.y = c.y; }
+		if (c.z < mn.z) { mn.z = c.z; }
+		if (c.x > mx.x) { mx.x = c.x; }
+		if (c.y > mx.y) { mx.y = c.y; }
+		if (c.z > mx.z) { mx.z = c.z; }
+	}
+
+	return BoundingBox(mn, mx);
+}
+
+// Returns the object rotation matrix, using the same Y * X * Z order as PlaneObject and CameraObject.
+inline Matrix4X4<float> rotationMatrix(const Vector3D<float>& rotation)
+{
+	return Matrix4X4<float>::RotationY(rotation.y * DegreeToRadians) * Matrix4X4<float>::RotationX(rotation.x * DegreeToRadians) * Matrix4X4<float>::RotationZ(rotation.z * DegreeToRadians);
+}
\ No newline at end of file
@@ -1,11 +1,18 @@
 #pragma once
 #include "vec_math.h"
+#include "framebuffer.h"
+#include "png.h"
+#include "qoi.h"
 #include <vector>
 #include <iostream>
 #include <fstream>
 
 enum class RenderOutput {
-	PPM
+	PPM,
+	P6,
+	PFM,
+	PNG,
+	QOI
 };
 
 class Output
@@ -26,18 +33,52 @@ class Output
 		float getWidth() { return width; }
 		float getHeight() { return height; }
 
-		void writeBuffer(Vector3D<float> value) { buffer.push_back(value); };
+		// Streaming: every format is encoded and written as rows are finished, so the whole image never has to be in memory.
+		// P6 and PFM always stream; PPM, PNG and QOI otherwise wait for write().
+		void setStreaming(bool s) { streaming = s; }
+		bool isStreaming() const { return streaming; }
 
-		void write();
+		// Opens the file of the binary formats and writes their header, so rows can be written while the image is rendered.
+		bool open();
+
+		// Rows [begin, end) of the framebuffer are final. The binary formats encode and write them right away; rows must be passed top to bottom.
+		void writeRows(const Framebuffer& framebuffer, int32_t begin, int32_t end);
+
+		// Writes whatever has not been written yet and closes the file. When streaming, every row must have gone through writeRows().
+		void write(const Framebuffer& framebuffer);
 
 	private:
 		RenderOutput renderOutput;
 		std::string_view filePathWrite;
 
+		bool streaming = false;
+
 		float width = 0.0f;
 		float height = 0.0f;
 
-		std::vector<Vector3D<float>> buffer;
+		// One row in scanline order, read from the tiled framebuffer.
+		std::vector<Vector3D<float>> row;
+
+		// Streamed formats (P6, PFM) encode rows into a block that is written out once it holds about 1 MB.
+		std::ofstream file;
+		std::vector<char> block;
+		std::streamoff headerSize = 0;
+		size_t rowSize = 0;
+		int32_t rowsPerBlock = 0;
+		int32_t blockFirstRow = 0;
+		int32_t blockRows = 0;
+
+		// Encoders of the formats that only stream on request.
+		PNGStreamWriter pngWriter;
+		QOIStreamWriter qoiWriter;
+		std::vector<uint8_t> rowBytes;
+
+		bool isStreamed() const { return streaming || renderOutput == RenderOutput::P6 || renderOutput == RenderOutput::PFM; }
+		void encodeRow(const Vector3D<float>* pixels);
+		void writeBlock();
+
+		void writePPM(const Framebuffer& framebuffer);
 
-		void writePPM();
+		// PNG and QOI are encoded from the whole 8 bit image once rendering is done.
+		void quantize(const Framebuffer& framebuffer, std::vector<uint8_t>& rgb);
 };
\ No newline at end of file
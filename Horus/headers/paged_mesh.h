@@ -0,0 +1,89 @@
+#pragma once
+#include "mesh.h"
+#include "cache.h"
+#include <mutex>
+
+// Triangles of one page, de-indexed (three vertices per triangle) so a page can be loaded without the rest of the mesh, with the index
+// each triangle has in the source mesh.
+struct GeometryPage
+{
+	std::vector<Vector3D<float>> vertices;
+	std::vector<uint32_t> triangleIds;
+	PrimitiveBVH bvh;
+
+	size_t getMemoryUsage() const
+	{
+		return sizeof(GeometryPage) + vertices.capacity() * sizeof(Vector3D<float>) + triangleIds.capacity() * sizeof(uint32_t) + bvh.getMemoryUsage();
+	}
+};
+
+// Entry of the page table stored at the start of a page file.
+struct GeometryPageInfo
+{
+	uint64_t offset;
+	uint32_t triangleCount;
+	uint32_t pad;
+
+	float min[3];
+	float max[3];
+};
+
+// Out-of-core triangle mesh. The triangles live in a page file (.hrsp) on disk; only the page table and a BVH over the page bounds
+// stay in memory, and pages reached by rays are loaded on demand into a bounded LRU cache.
+class PagedMeshObject : public GeometryObject {
+
+	public:
+
+		PagedMeshObject();
+
+		std::string_view getObjectName() override
+		{
+			return name;
+		}
+
+		// Accepts a page file directly, or a PLY file which is converted to '<file>.hrsp' the first time (or when the PLY is newer).
+		bool loadFile(const std::string& filePath) override;
+		std::string_view getFilePath() override { return sourceFilePath; }
+
+		void setCacheSize(float megabytes) override { cache.setCapacity(static_cast<size_t>(megabytes * 1024.0f * 1024.0f)); }
+		float getCacheSize() override { return cache.getCapacity() / (1024.0f * 1024.0f); }
+
+		virtual void setBoundingBox() override;
+
+		virtual void printProperties() override
+		{
+			GeometryObject::printProperties();
+			std::cout << "Type: " << getObjectName() << std::endl;
+			std::cout << "pages: " << pages.size() << std::endl;
+			std::cout << "cache: " << cache.getCapacity() / (1024 * 1024) << " MB" << std::endl;
+		}
+
+		virtual void printStatistics() override;
+
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override;
+
+		static bool buildPageFile(const std::string& plyFilePath, const std::string& pageFilePath, uint32_t trianglesPerPage = 4096);
+
+		// Cache counters, for tests and statistics.
+		const LRUCache<uint32_t, GeometryPage>& getCache() const { return cache; }
+		size_t getPageCount() const { return pages.size(); }
+
+	private:
+
+		std::string sourceFilePath;
+		std::string pageFilePath;
+		std::ifstream pageFile;
+		std::mutex pageFileMutex;
+
+		std::vector<GeometryPageInfo> pages;
+		uint32_t trianglesPerPage = 0;
+		PrimitiveBVH pageBVH;
+
+		LRUCache<uint32_t, GeometryPage> cache;
+
+		Matrix4X4<float> R;
+
+		std::shared_ptr<GeometryPage> loadPage(uint32_t page);
+
+		static constexpr const char name[] = "Paged Mesh";
+};
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include "hrs.h"
+#include "accelerator.h"
+
+// Set of spheres stored as packed center and radius arrays, sharing one shader and one BVH.
+// Points are read from a CSV file (x,y,z[,r] per line) or from a binary file of little-endian float32 x,y,z,r records.
+// A missing or non-positive radius falls back to the -radius- parameter of the set.
+class ParticleSetObject : public GeometryObject {
+
+	public:
+
+		ParticleSetObject();
+
+		std::string_view getObjectName() override
+		{
+			return name;
+		}
+
+		bool loadFile(const std::string& filePath) override;
+		std::string_view getFilePath() override { return sourceFilePath; }
+
+		void setRadius(float r);
+
+		size_t getParticleCount() const { return centers.size(); }
+
+		float getRadius(uint32_t i) const { return radii.empty() ? size : radii[i]; }
+
+		virtual void setBoundingBox() override;
+
+		virtual Vector3D<float> getNormal(const HitRecord& hit) override
+		{
+			Vector3D<float> normal = hit.hitPoint - (centers[hit.primitive] + position);
+			normal.normalize();
+
+			return normal;
+		}
+
+		virtual void printProperties() override
+		{
+			GeometryObject::printProperties();
+			std::cout << "Type: " << getObjectName() << std::endl;
+			std::cout << "particles: " << getParticleCount() << std::endl;
+			std::cout << "radius: " << size << std::endl;
+		}
+
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override;
+
+	private:
+
+		std::string sourceFilePath;
+
+		std::vector<Vector3D<float>> centers;
+		std::vector<float> radii;
+
+		PrimitiveBVH bvh;
+
+		bool loadCSV(const std::string& filePath);
+		bool loadBinary(const std::string& filePath);
+
+		void buildBVH();
+
+		static constexpr const char name[] = "Particle Set";
+};
\ No newline at end of file
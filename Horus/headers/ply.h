@@ -0,0 +1,8 @@
+#pragma once
+#include "vec_math.h"
+#include <string>
+#include <vector>
+
+// Loads the vertex positions and triangulated faces of a PLY file. Binary little-endian files are read straight from a memory-mapped view;
+// big-endian and ASCII files are supported through slower fallback paths. Returns true if successful, false otherwise.
+bool loadPLY(const std::string& filePath, std::vector<Vector3D<float>>& vertices, std::vector<uint32_t>& indices);
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+
+// Writes 8 bit RGB pixels ('rgb' holds width * height * 3 bytes, top row first) as a PNG file. Rows are filtered with the
+// per row filter of smallest absolute sum, and the image is deflated in independent stripes of rows on 'threads' threads
+// (0 = one per core); the stripes are concatenated into a single zlib stream. Returns true if successful, false otherwise.
+bool writePNG(const std::string& filePath, const std::vector<uint8_t>& rgb, int32_t width, int32_t height, int32_t threads = 0);
+
+// Writes a PNG a row at a time, top row first, for images that are not held in memory as a whole. Filtered rows are buffered and
+// deflated into an IDAT chunk whenever 256 KB are buffered, so memory use depends on the width only.
+class PNGStreamWriter
+{
+	public:
+		bool open(const std::string& filePath, int32_t width, int32_t height);
+
+		// 'rgb' holds width * 3 bytes.
+		void writeRow(const uint8_t* rgb);
+
+		// Writes the rest of the stream after the last row. Returns true if every write succeeded.
+		bool close();
+
+	private:
+		std::string filePath;
+		std::ofstream file;
+		size_t rowSize = 0;
+		int32_t rows = 0;
+		uint32_t adler = 1;
+
+		std::vector<uint8_t> previous;
+		std::vector<uint8_t> filtered;
+		std::vector<uint8_t> compressed;
+		std::vector<uint8_t> scratch;
+
+		void flush(bool final);
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include "output.h"
+#include "framebuffer.h"
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <functional>
+#include <condition_variable>
+
+// Writes previews of a progressive render from a background thread. Every 'interval' the writer asks for a snapshot; the render
+// thread polls snapshotRequested() between rows and hands over a copy of the accumulation buffer with submit(). The copy is all the
+// render thread pays: resolving, encoding and writing the preview happen on the writer thread while rendering goes on.
+// Previews are written next to the output and renamed over it, so a viewer never reads a partially written file.
+class ProgressiveWriter
+{
+	public:
+		// 'resolve' turns the accumulation buffer into the image to write (weighted mean, gamma).
+		ProgressiveWriter(RenderOutput renderOutput, std::string_view filePath, std::function<void(const Framebuffer&, Framebuffer&)> resolve)
+			: renderOutput(renderOutput), filePath(filePath), resolve(std::move(resolve)) {}
+
+		~ProgressiveWriter() { stop(); }
+
+		void start(std::chrono::milliseconds interval);
+		void stop();
+
+		bool snapshotRequested() const { return requested.load(std::memory_order_relaxed); }
+		void submit(const Framebuffer& accumulation);
+
+		int32_t getPreviewCount() const { return previewCount; }
+
+	private:
+		RenderOutput renderOutput;
+		std::string filePath;
+		std::function<void(const Framebuffer&, Framebuffer&)> resolve;
+
+		std::chrono::milliseconds interval{ 0 };
+		std::thread thread;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::atomic<bool> requested{ false };
+		bool submitted = false;
+		bool stopping = false;
+
+		Framebuffer snapshot;
+		Framebuffer image;
+		int32_t previewCount = 0;
+
+		void run();
+		void writePreview();
+};
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+
+// Writes 8 bit RGB pixels ('rgb' holds width * height * 3 bytes, top row first) as a QOI file, a lossless format that encodes
+// in a single fast pass. Returns true if successful, false otherwise.
+bool writeQOI(const std::string& filePath, const std::vector<uint8_t>& rgb, int32_t width, int32_t height);
+
+struct QOIPixel
+{
+	uint8_t r = 0;
+	uint8_t g = 0;
+	uint8_t b = 0;
+	uint8_t a = 255;
+
+	bool operator==(const QOIPixel& p) const { return r == p.r && g == p.g && b == p.b && a == p.a; }
+};
+
+// The QOI encoder fed a row at a time, top row first; the encoded bytes are written out every 64 KB.
+class QOIStreamWriter
+{
+	public:
+		bool open(const std::string& filePath, int32_t width, int32_t height);
+
+		// 'rgb' holds width * 3 bytes.
+		void writeRow(const uint8_t* rgb);
+
+		// Writes the end marker. Returns true if every write succeeded.
+		bool close();
+
+	private:
+		std::string filePath;
+		std::ofstream file;
+		std::vector<uint8_t> out;
+
+		int32_t width = 0;
+		size_t pixelsLeft = 0;
+
+		QOIPixel index[64];
+		QOIPixel previous;
+		int32_t run = 0;
+
+		void flush();
+};
\ No newline at end of file
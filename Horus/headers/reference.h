@@ -0,0 +1,88 @@
+#pragma once
+#include "hrs.h"
+#include "accelerator.h"
+#include <mutex>
+#include <unordered_set>
+
+// Geometries of a referenced asset file and the BVH over them, shared by every reference to the file.
+struct SceneAsset
+{
+	std::vector<std::unique_ptr<SceneObject>> objects;
+	std::vector<GeometryObject*> geometries;
+
+	BVH bvh;
+	BoundingBox bounds;
+};
+
+// Process wide cache of referenced assets keyed by canonical path, so every asset file is parsed and its BVH built only once.
+class AssetLibrary
+{
+	public:
+		static AssetLibrary& getInstance();
+
+		// Returns the asset in 'filePath', loading it on first use, or nullptr if it cannot be loaded.
+		std::shared_ptr<SceneAsset> load(const std::string& filePath);
+
+		size_t getAssetCount() const { return assets.size(); }
+
+	private:
+		AssetLibrary() {}
+
+		// Recursive, so an asset that references other assets can load them while its own load holds the lock.
+		std::recursive_mutex mutex;
+
+		std::unordered_map<std::string, std::shared_ptr<SceneAsset>> assets;
+		std::unordered_set<std::string> loading;
+};
+
+// Instance of an asset file placed at -pos-. With -bounds- (the asset space proxy bounds) the asset is only loaded before rendering
+// if the proxy is inside the camera frustum, otherwise when a ray first enters the proxy. Without -bounds- it is loaded while parsing.
+class ReferenceObject : public GeometryObject {
+
+	public:
+
+		ReferenceObject();
+
+		std::string_view getObjectName() override
+		{
+			return name;
+		}
+
+		// Only records the asset path; loading is decided in endParameters() once -bounds- is known.
+		bool loadFile(const std::string& filePath) override { assetPath = filePath; return true; }
+		std::string_view getFilePath() override { return assetPath; }
+
+		void setProxyBounds(const BoundingBox& bounds) { proxyBounds = bounds; hasProxyBounds = true; setBoundingBox(); }
+		bool getProxyBounds(BoundingBox& bounds) const { bounds = proxyBounds; return hasProxyBounds; }
+
+		virtual void endParameters() override;
+		virtual void prepare(CameraObject& camera) override;
+
+		virtual void setBoundingBox() override;
+
+		virtual void printProperties() override
+		{
+			GeometryObject::printProperties();
+			std::cout << "Type: " << getObjectName() << std::endl;
+			std::cout << "asset: " << assetPath << std::endl;
+		}
+
+		virtual void printStatistics() override;
+
+		bool rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit) override;
+
+	private:
+
+		std::string assetPath;
+		std::shared_ptr<SceneAsset> asset;
+		std::once_flag loadFlag;
+
+		BoundingBox proxyBounds;
+		bool hasProxyBounds = false;
+
+		bool loadedOnDemand = false;
+
+		void ensureLoaded(bool onDemand);
+
+		static constexpr const char name[] = "Reference";
+};
\ No newline at end of file
@@ -4,19 +4,53 @@
 #include "hrs.h"
 #include "accelerator.h"
 #include "sampler.h"
+#include <string_view>
+
+// Arbitrary output variables: properties of the first hit of the camera rays, rendered along with the beauty image.
+enum class AOVType {
+	DEPTH,
+	NORMAL,
+	ALBEDO,
+	PRIMITIVE_ID
+};
+
+// What a camera ray records at its first hit; everything stays zero when the ray escapes.
+struct AOVSample
+{
+	float depth = 0.0f;
+	Vector3D<float> normal;
+	Vector3D<float> albedo;
+
+	// Object id (GeometryObject::getObjectId), primitive index within the object (triangle, patch), 0.
+	Vector3D<float> id;
+
+	// Squared luminance of the path radiance, for the variance estimate of the denoiser; filled in by Scene::samplePixel.
+	float luminanceSquared = 0.0f;
+};
+
+bool stringToAOVType(std::string_view name, AOVType& type);
+const char* aovTypeToString(AOVType type);
 
 class Integrator
 {
 	public:
-		Integrator(std::vector<LightObject*>& lights) : lights(lights) { };
-		Vector3D<float> rayPath(Ray& ray, BVH& bvh, int nBounces);
+		// Bounce directions are drawn from 'sampler', which must outlive the integrator.
+		Integrator(std::vector<LightObject*>& lights, Sampler& sampler) : lights(lights), sampler(sampler) { };
+
+		// 'aov', when given, receives the first hit of the path.
+		Vector3D<float> rayPath(Ray& ray, BVH& bvh, int nBounces, AOVSample* aov = nullptr);
 
 		std::vector<LightObject*>& getLights() { return lights; }
+		Sampler& getSampler() { return sampler; }
+
+		// Rays traced so far, camera rays and bounces.
+		uint64_t getRayCount() const { return rayCount; }
 
 	private:
 
 		std::vector<LightObject*> lights;
-		UnitRandom unitRandom;
+		Sampler& sampler;
+		uint64_t rayCount = 0;
 
 		Vector3D<float> toWorld(Vector3D<float> v, Vector3D<float> refVector);
 };
\ No newline at end of file
@@ -2,6 +2,9 @@
 #define _USE_MATH_DEFINES
 #include <random>
 #include <cmath>
+#include <memory>
+#include <string>
+#include <string_view>
 #include "vec_math.h"
 
 class UnitRandom
@@ -11,18 +14,121 @@ class UnitRandom
 		UnitRandom();
 		float Generate();
 
+		// Position in the stream, as the text form of the engine state.
+		std::string getState() const;
+		bool setState(const std::string& state);
+
+		void seed(uint32_t value) { gen.seed(value); }
+
 	private:
 
 		std::mt19937 gen;
 		std::uniform_real_distribution<float> dis;
 };
 
+enum class SamplerType {
+	RANDOM,
+	STRATIFIED,
+	SOBOL,
+	BLUE_NOISE
+};
+
+// Source of the random numbers of a render, indexed by pixel, sample and dimension. Each camera sample starts with startSample();
+// get1D() then returns its dimensions in order: the first cameraDimensions jitter the camera ray, the bounces of the path draw two
+// each from pathDimensions on, so that every bounce gets an aligned pair of the low discrepancy samplers.
+// The base class draws independent uniform numbers, one stream for the camera and one for the paths, as the renderer always did.
 class Sampler
 {
 	public:
+		static constexpr int32_t cameraDimensions = 3;
+		static constexpr int32_t pathDimensions = 4;
+
 		Sampler();
+		virtual ~Sampler() {}
+
 		static Vector3D<float> cosineWeightSampleHemisphere(float r1, float r2);
 
+		// Sample 'index' of pixel (x, y), out of 'count' samples for the pixel in the whole render.
+		void startSample(int32_t x, int32_t y, int32_t index, int32_t count)
+		{
+			pixelX = x;
+			pixelY = y;
+			sampleIndex = index;
+			sampleCount = count;
+			dimension = 0;
+		}
+
+		// Positions of the random streams, for checkpoints; the other samplers compute every sample from its indices alone.
+		std::string getState() const;
+		bool setState(const std::string& state);
+
+		// Restarts the random streams from 'value'. Progressive passes seed them for every row, from the row and the pass, so rows
+		// rendered by several threads in any order draw the same numbers as on one thread.
+		void seed(uint32_t value);
+
+		// Next dimension of the current sample, in [0, 1).
+		float get1D()
+		{
+			if (dimension == cameraDimensions)
+			{
+				dimension = pathDimensions;
+			}
+
+			return generate(dimension++);
+		}
+
+	protected:
+		int32_t pixelX = 0;
+		int32_t pixelY = 0;
+		int32_t sampleIndex = 0;
+		int32_t sampleCount = 1;
+
+		virtual float generate(int32_t dim);
+
+		// Seed of the current pixel and a dimension, well mixed.
+		uint32_t pixelSeed(int32_t dim) const;
+
 	private:
-		UnitRandom unitRandom;
-};
\ No newline at end of file
+		int32_t dimension = 0;
+
+		UnitRandom cameraRandom;
+		UnitRandom pathRandom;
+};
+
+// Every dimension is split into 'count' strata, visited in a random order per pixel and dimension, with a random position in each
+// stratum (Latin hypercube sampling): any one dimension is stratified, whatever the sample count.
+class StratifiedSampler : public Sampler
+{
+	protected:
+		float generate(int32_t dim) override;
+};
+
+// Sobol sequence with hash based Owen scrambling (Burley 2020). Dimensions are taken in sets of four from the first four Sobol
+// dimensions, each set with its own shuffle of the sample index, so any 2D projection is well stratified for every prefix of the
+// samples, which also suits progressive passes.
+class SobolSampler : public Sampler
+{
+	protected:
+		float generate(int32_t dim) override;
+};
+
+// One shuffled Sobol sequence shared by all pixels, shifted per pixel by a 64x64 blue noise mask (void and cluster) offset for each
+// dimension (Georgiev and Fajardo 2016). Neighboring pixels get well spread samples, which turns the remaining error into blue noise,
+// far less visible than white noise at equal energy.
+class BlueNoiseSampler : public Sampler
+{
+	public:
+		static constexpr int32_t maskSize = 64;
+
+		// Mask value in [0, 1) at (x, y), wrapping around.
+		static float getMask(int32_t x, int32_t y);
+
+	protected:
+		float generate(int32_t dim) override;
+};
+
+bool stringToSamplerType(std::string_view name, SamplerType& type);
+std::unique_ptr<Sampler> createSampler(SamplerType type);
+
+// Owen scrambled Sobol value of 'index' in 'dim' (0 to 3) for 'seed'.
+uint32_t sobolOwen(uint32_t index, int32_t dim, uint32_t seed);
\ No newline at end of file
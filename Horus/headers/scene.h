@@ -3,10 +3,27 @@
 #include "output.h"
 #include "render.h"
 #include "accelerator.h"
+#include "postprocess.h"
+#include "denoise.h"
+#include "film.h"
+#include "checkpoint.h"
+#include <chrono>
 
 enum class GammaCorrection
 {
-	GAMMA2
+	GAMMA2,
+	SRGB
+};
+
+// One AOV of a render: its own framebuffer (a band of it when streaming), written as PFM next to the beauty image.
+struct AOVPass
+{
+	AOVPass(AOVType t, const std::string& path) : type(t), filePath(path) {}
+
+	AOVType type;
+	std::string filePath;
+	Framebuffer framebuffer;
+	Output output;
 };
 
 class Scene {
@@ -14,20 +31,61 @@ class Scene {
 	public:
 		Scene();
 		bool getScene(std::vector<std::unique_ptr<SceneObject>>& scene);
+		bool getScene(SceneArena& scene);
 
+		// Uses objects owned by the caller, e.g. the watch mode, which keeps them across reloads of the scene file.
+		bool setObjects(const std::vector<SceneObject*>& sceneObjects);
+
+		const std::vector<SceneObject*>& getObjects() { return objects; }
 		CameraObject* getCamera() { return camera; }
 		std::vector<GeometryObject*> getGeometries() { return geometries; }
 		std::vector<LightObject*> getLights() { return lights; }
 		bool setRenderOutput(const std::string_view& ro);
 		bool setGammaCorrection(const std::string_view gc);
+
+		// "-exposure:STOPS", "-tonemap:none|reinhard|aces", "-dither" or "-denoise". Returns false if the option is not one of them.
+		bool setPostProcessOption(const std::string_view option);
+
+		// "-half": store the framebuffers in half precision. "-stream": render into one band of tile rows at a time and write each
+		// band out as soon as it is done, so memory use does not depend on the image height. Returns false for any other option.
+		bool setFramebufferOption(const std::string_view option);
+
+		// "-spp:N": samples per pixel. "-sampler:random|stratified|sobol|bluenoise": the sample sequence. "-filter:box|tent|gaussian|mitchell"
+		// or "-filter:NAME:RADIUS": sample the pixel area and splat the samples with the filter. Returns false for any other option, and for
+		// a filter with an unknown name or an invalid radius.
+		bool setSamples(const std::string_view option);
+
+		// "-aov" renders every AOV, "-aov:NAME,NAME,..." the listed ones (depth, normal, albedo, id). Returns false for any other option.
+		bool setAOVOption(const std::string_view option);
+
+		// "-progressive" or "-progressive:SECONDS": render in passes and write a preview every SECONDS (default 10).
+		bool setProgressive(const std::string_view option);
+
+		// "-time-budget:SECONDS" (or "--time-budget:SECONDS"): render progressive passes until the wall clock time since the option was
+		// read runs out, then write the image. -spp, when given, still caps the samples per pixel.
+		bool setTimeBudget(const std::string_view option);
+
+		// "-checkpoint" or "-checkpoint:SECONDS": render in passes and save the state of the render every SECONDS (default 60) next to
+		// the output, as OUTPUT.checkpoint. "-resume" (or "--resume") continues from that checkpoint and keeps saving new ones.
+		// Returns false for any other option.
+		bool setCheckpointOption(const std::string_view option);
 		bool getGammaCorrectionSet() { return gammaCorrectionSet; }
 		RenderOutput getRenderOutput() { return renderOutput; }
+		void buildAccelerator();
+		BVH& getBVH() { return bvh; }
 		void render();
+
+		// Threads rendering the progressive passes, 0 for one per core.
+		void setRenderThreads(int32_t threads) { renderThreads = threads; }
+
 		bool setFilePathWrite(const std::string_view& path);
 		const std::string_view& getFilePathWrite() { return filePathWrite; }
 
 	private:
 		std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+		SceneArena sceneArena;
+		std::vector<SceneObject*> objects;
+
 		CameraObject* camera;
 		std::vector<GeometryObject*> geometries;
 		std::vector<LightObject*> lights;
@@ -35,15 +93,67 @@ class Scene {
 		bool cameraCheck();
 		bool geometriesCheck();
 		bool lightCheck();
+		bool objectsCheck();
+
+		BVH bvh;
 
 		RenderOutput renderOutput = RenderOutput::PPM;
 		Output output;
+		Framebuffer framebuffer;
 		std::string_view filePathWrite;
 
-		UnitRandom unitRandom;
+		SamplerType samplerType = SamplerType::RANDOM;
+		std::unique_ptr<Sampler> sampler;
 
 		bool gammaCorrectionSet = false;
 		GammaCorrection gammaCorrection = GammaCorrection::GAMMA2;
 
 		int32_t numberOfSamples = 10; //100
+		bool samplesSet = false;
+
+		// Samples per pixel the sampler plans for in the current render: numberOfSamples, or maxBudgetSamples for a time budget alone.
+		int32_t plannedSamples = 10;
+		static constexpr int32_t maxBudgetSamples = 1 << 16;
+
+		float timeBudget = 0.0f;
+		std::chrono::steady_clock::time_point budgetStart;
+
+		static constexpr float defaultCheckpointInterval = 60.0f;
+		float checkpointInterval = 0.0f;
+		bool resume = false;
+
+		bool progressive = false;
+		int32_t renderThreads = 0;
+		bool halfFramebuffer = false;
+		bool streamOutput = false;
+		float previewInterval = 10.0f;
+
+		PostProcessSettings postProcessSettings;
+		PostProcess postProcess;
+
+		bool denoise = false;
+		Denoiser denoiser;
+
+		bool filtered = false;
+		Film film;
+
+		std::vector<AOVType> aovTypes;
+		std::vector<AOVPass> aovPasses;
+
+		// Traces samples [firstSample, firstSample + samples) of the pixel; 'aov', when given, receives the sums of their first hits
+		// (the id of the first ray).
+		Vector3D<float> samplePixel(Integrator& integrator, int32_t i, int32_t j, int32_t firstSample, int32_t samples, AOVSample* aov = nullptr);
+
+		bool openAOVPasses(int32_t width, int32_t height, bool weighted);
+		void storeAOVs(int32_t x, int32_t y, const AOVSample& aov, int32_t samples, bool firstPass);
+		size_t getFramebufferMemory() const;
+		void updatePostProcess();
+		void renderProgressive();
+		void renderRow(Integrator& integrator, int32_t row, int32_t firstSample, int32_t samples, bool recordFeatures);
+		static void resolveFilm(const Framebuffer& accumulation, Framebuffer& image);
+
+		std::string getCheckpointPath() const;
+		std::vector<Framebuffer*> getCheckpointBuffers(Framebuffer& accumulation);
+		CheckpointHeader getCheckpointHeader() const;
+		bool loadCheckpoint(const std::vector<Framebuffer*>& buffers, CheckpointHeader& header);
 };
\ No newline at end of file
@@ -6,7 +6,30 @@
 enum class TestSelection {
 	DEFAULT,
 	MAIN_LINE_ARGS,
-	SCENE_BUILDER
+	SCENE_BUILDER,
+	PLY_LOADER,
+	PAGED_MESH,
+	COMPILED_SCENE,
+	PARALLEL_PARSE,
+	FRAMEBUFFER,
+	DEFLATE,
+	QOI,
+	POST_PROCESS,
+	HALF_FLOAT,
+	DENOISE,
+	SAMPLER,
+	FILM_FILTER,
+	CHECKPOINT,
+	PROGRESSIVE,
+	TIME_BUDGET,
+	IMAGE_OUTPUT,
+	TOKENIZER,
+	REFERENCE,
+	PARTICLES,
+	DISPLACED,
+	MATERIAL_LIBRARY,
+	WATCH,
+	AOV
 };
 
 int32_t Testing(int& argc, char* argv[]);
@@ -0,0 +1,62 @@
+#pragma once
+#include "vec_math.h"
+#include <string_view>
+#include <cstdio>
+
+// Cursor over a scene or shader description held in memory (usually a MappedFile), scanned with plain pointer arithmetic.
+// Mirrors the get()/peek()/eof() calls the parser used to make on std::ifstream, without the per character stream overhead.
+class Tokenizer
+{
+	public:
+		Tokenizer(const char* begin, const char* end) : p(begin), end(end) {}
+		Tokenizer(std::string_view text) : p(text.data()), end(text.data() + text.size()) {}
+
+		bool eof() const { return p >= end; }
+		int peek() const { return (p < end) ? static_cast<unsigned char>(*p) : EOF; }
+		void get() { if (p < end) { ++p; } }
+
+		const char* getPosition() const { return p; }
+		const char* getEnd() const { return end; }
+
+		// Returns the text from the current position up to (not including) the next 'c', and moves past 'c'.
+		std::string_view readUntil(char c)
+		{
+			const char* begin = p;
+
+			while (p < end && *p != c)
+			{
+				++p;
+			}
+
+			std::string_view text(begin, p - begin);
+
+			get();
+
+			return text;
+		}
+
+		void skipWhitespace()
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f' || *p == '\v'))
+			{
+				++p;
+			}
+		}
+
+	private:
+		const char* p;
+		const char* end;
+};
+
+// Number parsing for parameter values, based on std::from_chars. Leading whitespace and '+' are accepted like the stream based parser did.
+bool parseFloat(std::string_view token, float& value);
+bool parseInt(std::string_view token, int32_t& value);
+
+// Parses comma separated components, e.g. "0.5, 1, -2".
+bool parseFloats(std::string_view token, float* values, int32_t count);
+bool parseVector3(std::string_view token, float& x, float& y, float& z);
+bool parseVector2(std::string_view token, float& x, float& y);
+
+// Returns the parsed value, or 0 with a warning if the token is not a number.
+float tokenToFloat(std::string_view token);
+int32_t tokenToInt(std::string_view token);
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+#include "scene.h"
+#include <string>
+#include <filesystem>
+
+// Top level object of the watched scene file: a hash of its text and the objects parsed from it (several for an include).
+struct WatchedObject
+{
+	uint64_t hash = 0;
+	std::vector<std::unique_ptr<SceneObject>> objects;
+
+	size_t getGeometryCount() const;
+};
+
+// Keeps a text scene loaded between edits of its file. On every change the file is split at object boundaries and only objects whose
+// text changed are parsed again; the others keep their parsed state, loaded meshes and assets. Geometry edited in place is refitted
+// into the existing BVH, other changes (objects added, removed or reordered, or edits touching many geometries) rebuild it.
+// Included files and shader files are not watched; touching the scene file picks up an object whose include or shader text changed.
+class SceneWatcher
+{
+	public:
+		SceneWatcher(const std::string& filePath, Scene& scene) : filePath(filePath), scene(scene) {}
+
+		// Brings the scene in line with the current file content. Returns false if the file cannot be read or has no camera.
+		bool update();
+
+		// Renders the scene, then polls the file every 'interval' milliseconds and renders again after each change.
+		// Stops after 'maxRenders' renders, or never when it is 0.
+		void run(int32_t interval, int32_t maxRenders = 0);
+
+	private:
+		std::string filePath;
+		Scene& scene;
+
+		std::vector<WatchedObject> watched;
+		std::filesystem::file_time_type writeTime;
+};
\ No newline at end of file
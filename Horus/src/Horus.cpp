@@ -3,7 +3,13 @@
 #include "test.h"
 #include "hrs.h"
 #include "scene.h"
+#include "compiled_scene.h"
+#include "ingest.h"
+#include "generator.h"
+#include "watch.h"
 #include <iostream>
+#include <charconv>
+#include <cstring>
 
 // Validates the input arguments for the program.
 bool inputValidation(const std::vector<std::string>& inputDescription)
@@ -25,6 +31,21 @@ bool inputValidation(const std::vector<std::string>& inputDescription)
 	return true;
 }
 
+// Parses a whole command line argument as an unsigned number, printing an error naming 'what' if it is not one.
+static bool parseArgument(const char* argument, const char* what, uint64_t& value)
+{
+	const char* end = argument + std::strlen(argument);
+	std::from_chars_result result = std::from_chars(argument, end, value);
+
+	if (result.ec != std::errc() || result.ptr != end)
+	{
+		std::cout << "Invalid " << what << ": " << argument << " (expected an unsigned integer)" << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
 // The main function of the program.
 int main(int argc, char* argv[])
 {
@@ -41,23 +62,67 @@ int main(int argc, char* argv[])
 	 
 	std::cout << "Horus" << std::endl;
 
+	// Compile mode: Horus --compile scene.hrs scene.hrsb [-nobvh]
+	if (argc > 1 && std::string(argv[1]) == "--compile")
+	{
+		if (argc < 4)
+		{
+			std::cout << "syntax for compiling:" << std::endl;
+			std::cout << "Horus --compile [SCENE.hrs] [OUTPUT.hrsb] [-nobvh]" << std::endl;
+			return 1;
+		}
+
+		bool includeBVH = !(argc > 4 && std::string(argv[4]) == "-nobvh");
+
+		return compileScene(argv[2], argv[3], includeBVH) ? 0 : 1;
+	}
+
+	// Generate mode: Horus --generate scene.hrs COUNT [uniform|clustered|coincident] [SEED]
+	if (argc > 1 && std::string(argv[1]) == "--generate")
+	{
+		if (argc < 4)
+		{
+			std::cout << "syntax for generating:" << std::endl;
+			std::cout << "Horus --generate [OUTPUT.hrs] [COUNT] [uniform|clustered|coincident] [SEED]" << std::endl;
+			return 1;
+		}
+
+		GeneratorSettings settings;
+
+		if (!parseArgument(argv[3], "COUNT", settings.count)) { return 1; }
+
+		if (argc > 4 && !stringToDistribution(argv[4], settings.distribution)) { return 1; }
+
+		if (argc > 5 && !parseArgument(argv[5], "SEED", settings.seed)) { return 1; }
+
+		return generateScene(argv[2], settings) ? 0 : 1;
+	}
+
+	// Benchmark mode: Horus --benchmark [uniform|clustered|coincident] [MAX_COUNT] [RESULTS.csv]
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		SceneDistribution distribution = SceneDistribution::UNIFORM;
+
+		if (argc > 2 && !stringToDistribution(argv[2], distribution)) { return 1; }
+
+		uint64_t maxCount = 10000000;
+
+		if (argc > 3 && !parseArgument(argv[3], "MAX_COUNT", maxCount)) { return 1; }
+
+		return runScalingBenchmark(distribution, maxCount, (argc > 4) ? argv[4] : "") ? 0 : 1;
+	}
+
+	// Watch mode: Horus --watch scene.hrs -ppm -output.ppm [-gamma2] takes the usual render arguments after the flag
+	bool watch = argc > 1 && std::string(argv[1]) == "--watch";
+
 	std::vector<std::string> inputDescription;
 
 	// Get command line arguments
-	inputDescription = GetMainLineArgs(argv);
+	inputDescription = GetMainLineArgs(watch ? argv + 1 : argv);
 
 	// Validate input arguments
 	if (!inputValidation(inputDescription)) { return 1; }
 
-	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
-	bool result = SceneBuilder(inputDescription[0], sceneObjects);
-
-	// Check if scene was built correctly
-	if (!result) { return 1; }
-
-	// Check if scene contains objects
-	if (sceneObjects.size() == 0) { return 1; }
-
 	Scene scene;
 
 	// Set render output type
@@ -65,17 +130,50 @@ int main(int argc, char* argv[])
 
 	if (!scene.setFilePathWrite(inputDescription[2])) { return 1; }
 
-	// Set gamma correction option if provided
-	if (inputDescription.size() > 3 && !inputDescription[3].empty())
+	// Options after the output path: -gamma2, -srgb, -exposure:STOPS, -tonemap:NAME, -dither, -denoise, -half, -stream,
+	// -aov[:NAMES], -spp:N, -sampler:NAME, -filter:NAME[:RADIUS], -progressive[:SECONDS], --time-budget:SECONDS,
+	// -checkpoint[:SECONDS], --resume
+	for (size_t i = 3; i < inputDescription.size(); ++i)
 	{
-		if (!scene.setGammaCorrection(inputDescription[3]))
+		if (inputDescription[i].empty()) { continue; }
+
+		if (inputDescription[i].find("progressive") != std::string::npos)
 		{
-			std::cout << "Invalid gamma correction option!" << std::endl;
+			if (!scene.setProgressive(inputDescription[i])) { return 1; }
 		}
+		else if (inputDescription[i].find("filter:") != std::string::npos)
+		{
+			// Rendering with a filter other than the one asked for would waste the render.
+			if (!scene.setSamples(inputDescription[i])) { return 1; }
+		}
+		else if (!scene.setGammaCorrection(inputDescription[i]) && !scene.setPostProcessOption(inputDescription[i]) && !scene.setFramebufferOption(inputDescription[i])
+			&& !scene.setAOVOption(inputDescription[i]) && !scene.setSamples(inputDescription[i]) && !scene.setTimeBudget(inputDescription[i])
+			&& !scene.setCheckpointOption(inputDescription[i]))
+		{
+			std::cout << "Invalid option: " << inputDescription[i] << std::endl;
+		}
+	}
+
+	if (watch)
+	{
+		if (isCompiledScene(inputDescription[0]))
+		{
+			std::cout << "Watch mode needs a text scene (.hrs)" << std::endl;
+			return 1;
+		}
+
+		SceneWatcher watcher(inputDescription[0], scene);
+		watcher.run(250);
+
+		return 0;
 	}
 
-	// Get scene from scene objects
-	if (!scene.getScene(sceneObjects)) { return 1; }
+	// Load the scene: compiled scenes (.hrsb) are mapped directly, text scenes are parsed and streamed into the BVH build
+	if (isCompiledScene(inputDescription[0]))
+	{
+		if (!loadCompiledScene(inputDescription[0], scene)) { return 1; }
+	}
+	else if (!ingestScene(inputDescription[0], scene)) { return 1; }
 
 	// Render the scene
 	scene.render();
@@ -67,14 +67,15 @@ void BVH::remapCoordinatesForMorton(std::vector<GeometryObject*>& objects, Vecto
 	}
 }
 
-// Collects the bounding boxes of the geometry objects and stores them in the 'boundingBoxes' vector. Returns true if successful, false otherwise.
-bool BVH::collectBoundingBoxes(std::vector<GeometryObject*>& objects)
+// Collects the bounding boxes of the geometry objects and appends them to the 'boundingBoxes' vector. Returns true if successful, false otherwise.
+bool BVH::collectBoundingBoxes(const std::vector<GeometryObject*>& objects)
 {
 	if (!objects.empty())
 	{
 		for (GeometryObject* obj : objects)
 		{
 			boundingBoxes.push_back(obj->getBoundingBox());
+			primitives.push_back(obj);
 		}
 
 		return true;
@@ -83,45 +84,47 @@ bool BVH::collectBoundingBoxes(std::vector<GeometryObject*>& objects)
 	return false;
 }
 
-// Creates a bounding box that encompasses the centroids of the geometry objects in the specified range. Returns true if successful, false otherwise.
-bool BVH::createBoundingBoxFromCentroids(std::vector<GeometryObject*>& objects, int32_t begin, int32_t end)
+// Grows the bounding box of the centroids by the centroids of the primitives in the specified range. Returns true if successful, false otherwise.
+bool BVH::createBoundingBoxFromCentroids(int32_t begin, int32_t end)
 {
-	if (!objects.empty())
+	if (begin < end)
 	{
-		Vector3D<float> min = objects[begin]->getBoundingBox().getCentroid();
-		Vector3D<float> max = min;
+		if (begin == 0)
+		{
+			centroidMin = primitives[0]->getBoundingBox().getCentroid();
+			centroidMax = centroidMin;
+		}
 
-		for (int32_t i = begin + 1; i < end; ++i)
+		for (int32_t i = begin; i < end; ++i)
 		{
-			Vector3D<float> centroid = objects[i]->getBoundingBox().getCentroid();
+			Vector3D<float> centroid = primitives[i]->getBoundingBox().getCentroid();
 
-			if (centroid.x < min.x) { min.x = centroid.x; }
-			if (centroid.y < min.y) { min.y = centroid.y; }
-			if (centroid.z < min.z) { min.z = centroid.z; }
+			if (centroid.x < centroidMin.x) { centroidMin.x = centroid.x; }
+			if (centroid.y < centroidMin.y) { centroidMin.y = centroid.y; }
+			if (centroid.z < centroidMin.z) { centroidMin.z = centroid.z; }
 
-			if (centroid.x > max.x) { max.x = centroid.x; }
-			if (centroid.y > max.y) { max.y = centroid.y; }
-			if (centroid.z > max.z) { max.z = centroid.z; }
+			if (centroid.x > centroidMax.x) { centroidMax.x = centroid.x; }
+			if (centroid.y > centroidMax.y) { centroidMax.y = centroid.y; }
+			if (centroid.z > centroidMax.z) { centroidMax.z = centroid.z; }
 		}
 
-		//node->assignBoundingBox(BoundingBox(min, max));
-
-		remapCoordinatesForMorton(objects, min, max);
-
 		return true;
 	}
 
 	return false;
 }
 
-// Merges the bounding boxes of the geometry objects in the specified range and assigns the merged bounding box to the given BVH node. Returns true if successful, false otherwise.
-bool BVH::mergeBoundingBoxes(std::vector<GeometryObject*>& objects, BVHNode* node, int32_t begin, int32_t end)
+// Merges the bounding boxes of the geometry objects in the specified range into the given BVH node. Returns true if successful, false otherwise.
+bool BVH::mergeBoundingBoxes(BVHNode* node, int32_t begin, int32_t end)
 {
-	if (!objects.empty())
+	if (begin < end)
 	{
-		node->assignBoundingBox(boundingBoxes[begin]);
+		if (begin == 0)
+		{
+			node->assignBoundingBox(boundingBoxes[0]);
+		}
 
-		for (int32_t i = begin + 1; i < end; ++i)
+		for (int32_t i = std::max(begin, 1); i < end; ++i)
 		{
 			node->addBoundingBox(boundingBoxes[i]);
 		}
@@ -132,20 +135,28 @@ bool BVH::mergeBoundingBoxes(std::vector<GeometryObject*>& objects, BVHNode* nod
 	return false;
 }
 
-// Builds the BVH tree by collecting bounding boxes, creating the root node, merging bounding boxes, and creating a bounding box from centroids. Returns true if successful, false otherwise.
-bool BVH::buildRoot(std::vector<GeometryObject*>& objects)
+// Adds a batch of geometry objects to the BVH: their bounding boxes are collected and merged into the root, and the centroid bounds
+// used for the Morton codes are grown. Batches can be added while the rest of the scene is still being parsed. Returns true if successful, false otherwise.
+bool BVH::addPrimitives(const std::vector<GeometryObject*>& objects)
 {
-	if (collectBoundingBoxes(objects))
+	if (root == nullptr)
 	{
 		BVHNode_memory = resource.allocate(sizeof(BVHNode), alignof(BVHNode));
 
 		root = new (BVHNode_memory) BVHNode();
 
 		root->setRoot(true);
+	}
 
-		if (mergeBoundingBoxes(objects, root, 0, static_cast<int32_t>(boundingBoxes.size())))
+	int32_t begin = static_cast<int32_t>(boundingBoxes.size());
+
+	if (collectBoundingBoxes(objects))
+	{
+		int32_t end = static_cast<int32_t>(boundingBoxes.size());
+
+		if (mergeBoundingBoxes(root, begin, end))
 		{
-			if (createBoundingBoxFromCentroids(objects, 0, boundingBoxes.size()))
+			if (createBoundingBoxFromCentroids(begin, end))
 			{
 				return true;
 			}
@@ -548,35 +559,112 @@ bool BVH::createNodes(std::vector<Treelet>& treelets)
 // Builds the BVH tree from the given geometry objects by performing several steps including building the root node, computing Morton codes, sorting Morton primitives, partitioning into treelets, creating nodes for each treelet, and connecting the nodes into a single BVH tree.
 void BVH::buildBVH(std::vector<GeometryObject*>& objects)
 {
-	if (buildRoot(objects))
+	if (addPrimitives(objects))
 	{
-		if (computeMorton(objects))
-		{
-			sortMortonPrimitive(mortonPrimitives);
+		finishBuild();
+	}
+}
 
-			if (treeletSearch(mortonPrimitives))
+// Runs the remaining build stages once every primitive has been added: Morton codes, radix sort, treelets, the upper SAH levels and flattening.
+void BVH::finishBuild()
+{
+	if (primitives.empty())
+	{
+		return;
+	}
+
+	remapCoordinatesForMorton(primitives, centroidMin, centroidMax);
+
+	if (computeMorton(primitives))
+	{
+		sortMortonPrimitive(mortonPrimitives);
+
+		if (treeletSearch(mortonPrimitives))
+		{
+			if (createNodes(treelets))
 			{
-				if (createNodes(treelets))
-				{
-					BVHNode* nodes = static_cast<BVHNode*>(resource.allocate(sizeof(BVHNode) * (treelets.size() - 1), alignof(BVHNode)));
+				BVHNode* nodes = static_cast<BVHNode*>(resource.allocate(sizeof(BVHNode) * (treelets.size() - 1), alignof(BVHNode)));
 
-					int32_t nodeIndex = 0;
+				int32_t nodeIndex = 0;
 
-					root = connectNodes(treelets, nodes, nodeIndex);
+				root = connectNodes(treelets, nodes, nodeIndex);
 
-					int32_t offset = 0;
+				int32_t offset = 0;
 
-					linearNodes.resize(totalNodes);
+				linearNodes.resize(totalNodes);
 
-					flattenBVH(root, offset);
-				}
+				flattenBVH(root, offset);
 			}
 		}
 	}
 }
 
+void BVH::setNodes(std::vector<linearBVH>&& nodes, std::vector<GeometryObject*>&& primitives)
+{
+	linearNodes = std::move(nodes);
+	orderedPrimitives = std::move(primitives);
+
+	totalNodes = static_cast<int32_t>(linearNodes.size());
+}
+
+void BVH::clear()
+{
+	root = nullptr;
+	BVHNode_memory = nullptr;
+
+	resource.release();
+
+	boundingBoxes.clear();
+	primitives.clear();
+	mortonPrimitives.clear();
+	treelets.clear();
+	orderedPrimitives.clear();
+	linearNodes.clear();
+
+	totalNodes = 0;
+}
+
+void BVH::refit(const std::unordered_map<GeometryObject*, GeometryObject*>& replacements)
+{
+	for (GeometryObject*& primitive : orderedPrimitives)
+	{
+		auto replacement = replacements.find(primitive);
+
+		if (replacement != replacements.end())
+		{
+			primitive = replacement->second;
+		}
+	}
+
+	// Flattening stores both children after their parent, so walking the array backwards updates the children first.
+	for (int32_t i = static_cast<int32_t>(linearNodes.size()) - 1; i >= 0; --i)
+	{
+		linearBVH& node = linearNodes[i];
+
+		BoundingBox bounds;
+
+		if (node.getNPrimitives() > 0)
+		{
+			bounds.assignBoundingBox(orderedPrimitives[node.getPrimitiveOffset()]->getBoundingBox());
+
+			for (int32_t j = 1; j < node.getNPrimitives(); ++j)
+			{
+				bounds += orderedPrimitives[node.getPrimitiveOffset() + j]->getBoundingBox();
+			}
+		}
+		else
+		{
+			bounds.assignBoundingBox(linearNodes[i + 1].getBoundingBox());
+			bounds += linearNodes[node.getSecondChildOffset()].getBoundingBox();
+		}
+
+		node.setBoundingBox(bounds);
+	}
+}
+
 // Traverses the BVH tree to find the closest intersection of a ray with the geometry objects. Returns a pointer to the closest hit object, or nullptr if no intersection is found.
-GeometryObject* BVH::traversal(Ray& ray, float tMin, float tMax)
+// The intersection itself is recorded in 'hit'.
+GeometryObject* BVH::traversal(Ray& ray, float tMin, float tMax, HitRecord& hit)
 {
 	GeometryObject* closestHit = nullptr;
 	float closestT = tMax;
@@ -597,9 +685,9 @@ GeometryObject* BVH::traversal(Ray& ray, float tMin, float tMax)
 				{
 					GeometryObject* obj = orderedPrimitives[node.getPrimitiveOffset() + i];
 
-					if (obj->rayIntersection(ray, tMin, closestT))
+					if (obj->rayIntersection(ray, tMin, closestT, hit))
 					{
-						closestT = obj->hitRecord.t;
+						closestT = hit.t;
 						closestHit = obj;
 					}
 				}
@@ -621,4 +709,199 @@ GeometryObject* BVH::traversal(Ray& ray, float tMin, float tMax)
 	}
 
 	return closestHit;
+}
+
+// Returns the bounding box enclosing every primitive of the BVH.
+BoundingBox PrimitiveBVH::getBounds() const
+{
+	if (nodes.empty())
+	{
+		return BoundingBox();
+	}
+
+	const CompactBVHNode& root = nodes[0];
+
+	return BoundingBox(Vector3D<float>(root.min[0], root.min[1], root.min[2]), Vector3D<float>(root.max[0], root.max[1], root.max[2]));
+}
+
+// Builds the BVH over the given primitive bounding boxes. The primitive index stored in the leaves is the position of its box in 'bounds'.
+void PrimitiveBVH::build(const std::vector<BoundingBox>& bounds, int32_t maxLeafSize)
+{
+	clear();
+
+	if (bounds.empty())
+	{
+		return;
+	}
+
+	std::vector<Vector3D<float>> centroids(bounds.size());
+
+	indices.resize(bounds.size());
+
+	for (size_t i = 0; i < bounds.size(); ++i)
+	{
+		centroids[i] = (bounds[i].getMin() * 0.5f) + (bounds[i].getMax() * 0.5f);
+		indices[i] = static_cast<uint32_t>(i);
+	}
+
+	nodes.reserve(2 * (bounds.size() / std::max(1, maxLeafSize)) + 1);
+
+	buildRecursive(bounds, centroids, 0, static_cast<int32_t>(bounds.size()), std::max(1, maxLeafSize), 0);
+
+	nodes.shrink_to_fit();
+}
+
+// Builds the subtree over indices[begin, end) using a binned surface area heuristic. Returns the index of the subtree root.
+int32_t PrimitiveBVH::buildRecursive(const std::vector<BoundingBox>& bounds, std::vector<Vector3D<float>>& centroids, int32_t begin, int32_t end, int32_t maxLeafSize, int32_t depth)
+{
+	int32_t nodeIndex = static_cast<int32_t>(nodes.size());
+	nodes.emplace_back();
+
+	BoundingBox nodeBounds = bounds[indices[begin]];
+
+	Vector3D<float> centroidMin = centroids[indices[begin]];
+	Vector3D<float> centroidMax = centroidMin;
+
+	for (int32_t i = begin + 1; i < end; ++i)
+	{
+		nodeBounds += bounds[indices[i]];
+
+		const Vector3D<float>& c = centroids[indices[i]];
+
+		if (c.x < centroidMin.x) { centroidMin.x = c.x; }
+		if (c.y < centroidMin.y) { centroidMin.y = c.y; }
+		if (c.z < centroidMin.z) { centroidMin.z = c.z; }
+
+		if (c.x > centroidMax.x) { centroidMax.x = c.x; }
+		if (c.y > centroidMax.y) { centroidMax.y = c.y; }
+		if (c.z > centroidMax.z) { centroidMax.z = c.z; }
+	}
+
+	CompactBVHNode& node = nodes[nodeIndex];
+
+	for (int32_t i = 0; i < 3; ++i)
+	{
+		node.min[i] = nodeBounds.getMin()[i];
+		node.max[i] = nodeBounds.getMax()[i];
+	}
+
+	int32_t count = end - begin;
+
+	if (count <= maxLeafSize)
+	{
+		node.offset = begin;
+		node.count = static_cast<uint16_t>(count);
+		node.axis = 0;
+
+		return nodeIndex;
+	}
+
+	Vector3D<float> extent = centroidMax - centroidMin;
+
+	uint8_t axis = 0;
+
+	if (extent.y > extent.x) { axis = 1; }
+	if (extent.z > extent[axis]) { axis = 2; }
+
+	float axisMin = centroidMin[axis];
+	float axisRange = extent[axis];
+
+	int32_t mid = begin + count / 2;
+
+	// Beyond this depth (or when all centroids coincide) split at the object median so the traversal stack cannot overflow.
+	if (axisRange > 0.0f && depth < 32)
+	{
+		const int32_t nBuckets = 12;
+
+		Bucket buckets[nBuckets];
+
+		for (int32_t i = begin; i < end; ++i)
+		{
+			int32_t bucketIndex = static_cast<int32_t>(nBuckets * ((centroids[indices[i]][axis] - axisMin) / axisRange));
+
+			if (bucketIndex >= nBuckets) { bucketIndex = nBuckets - 1; }
+
+			if (buckets[bucketIndex].getCount() == 0)
+			{
+				buckets[bucketIndex].setBoundingBox(bounds[indices[i]]);
+			}
+			else
+			{
+				buckets[bucketIndex].getBoundingBox() += bounds[indices[i]];
+			}
+
+			buckets[bucketIndex].incCount();
+		}
+
+		float minCost = 0.0f;
+		int32_t minCostSplit = -1;
+
+		for (int32_t split = 0; split < nBuckets - 1; ++split)
+		{
+			int32_t leftCount = 0;
+			int32_t rightCount = 0;
+
+			BoundingBox leftBoundingBox;
+			BoundingBox rightBoundingBox;
+
+			for (int32_t i = 0; i <= split; ++i)
+			{
+				if (buckets[i].getCount() == 0) { continue; }
+
+				leftBoundingBox = (leftCount == 0) ? buckets[i].getBoundingBox() : leftBoundingBox + buckets[i].getBoundingBox();
+				leftCount += buckets[i].getCount();
+			}
+
+			for (int32_t i = split + 1; i < nBuckets; ++i)
+			{
+				if (buckets[i].getCount() == 0) { continue; }
+
+				rightBoundingBox = (rightCount == 0) ? buckets[i].getBoundingBox() : rightBoundingBox + buckets[i].getBoundingBox();
+				rightCount += buckets[i].getCount();
+			}
+
+			if (leftCount == 0 || rightCount == 0) { continue; }
+
+			float cost = (leftCount * leftBoundingBox.getSurfaceArea()) + (rightCount * rightBoundingBox.getSurfaceArea());
+
+			if (minCostSplit < 0 || cost < minCost)
+			{
+				minCost = cost;
+				minCostSplit = split;
+			}
+		}
+
+		if (minCostSplit >= 0)
+		{
+			uint32_t* split = std::partition(indices.data() + begin, indices.data() + end, [&](uint32_t index)
+			{
+				int32_t bucketIndex = static_cast<int32_t>(nBuckets * ((centroids[index][axis] - axisMin) / axisRange));
+
+				if (bucketIndex >= nBuckets) { bucketIndex = nBuckets - 1; }
+
+				return bucketIndex <= minCostSplit;
+			});
+
+			mid = static_cast<int32_t>(split - indices.data());
+		}
+	}
+
+	if (mid == begin || mid == end || axisRange <= 0.0f || depth >= 32)
+	{
+		mid = begin + count / 2;
+
+		std::nth_element(indices.data() + begin, indices.data() + mid, indices.data() + end, [&](uint32_t a, uint32_t b)
+		{
+			return centroids[a][axis] < centroids[b][axis];
+		});
+	}
+
+	buildRecursive(bounds, centroids, begin, mid, maxLeafSize, depth + 1);
+	int32_t secondChild = buildRecursive(bounds, centroids, mid, end, maxLeafSize, depth + 1);
+
+	nodes[nodeIndex].offset = secondChild;
+	nodes[nodeIndex].count = 0;
+	nodes[nodeIndex].axis = axis;
+
+	return nodeIndex;
 }
\ No newline at end of file
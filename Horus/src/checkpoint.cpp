@@ -0,0 +1,149 @@
+#include "checkpoint.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+static const char checkpointMagic[4] = { 'H', 'R', 'C', 'P' };
+static const uint32_t checkpointVersion = 1;
+
+bool writeCheckpoint(const std::string& filePath, const Checkpoint& checkpoint)
+{
+	std::string partialPath = filePath + ".part";
+
+	{
+		std::ofstream file(partialPath, std::ios::binary | std::ios::trunc);
+
+		if (!file)
+		{
+			std::cout << "Could not open " << partialPath << " for writing" << std::endl;
+			return false;
+		}
+
+		CheckpointHeader header = checkpoint.header;
+		std::memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+		header.version = checkpointVersion;
+		header.bufferCount = static_cast<uint32_t>(checkpoint.buffers.size());
+		header.samplerStateSize = static_cast<uint32_t>(checkpoint.samplerState.size());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(checkpoint.samplerState.data(), checkpoint.samplerState.size());
+
+		for (const Framebuffer& buffer : checkpoint.buffers)
+		{
+			buffer.write(file);
+		}
+
+		if (!file.flush())
+		{
+			std::cout << "Failed writing " << partialPath << std::endl;
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(partialPath, filePath, error);
+
+	if (error)
+	{
+		std::cout << "Could not write checkpoint " << filePath << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool readCheckpointHeader(std::istream& stream, Checkpoint& checkpoint)
+{
+	stream.read(reinterpret_cast<char*>(&checkpoint.header), sizeof(CheckpointHeader));
+
+	if (!stream || std::memcmp(checkpoint.header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0 || checkpoint.header.version != checkpointVersion)
+	{
+		std::cout << "Not a checkpoint file, or one of another version" << std::endl;
+		return false;
+	}
+
+	checkpoint.samplerState.resize(checkpoint.header.samplerStateSize);
+	stream.read(checkpoint.samplerState.data(), checkpoint.samplerState.size());
+
+	return static_cast<bool>(stream);
+}
+
+void CheckpointWriter::start(std::chrono::milliseconds interval)
+{
+	this->interval = interval;
+
+	thread = std::thread(&CheckpointWriter::run, this);
+}
+
+void CheckpointWriter::stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	thread.join();
+}
+
+void CheckpointWriter::submit(Checkpoint&& checkpoint)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		this->checkpoint = std::move(checkpoint);
+		submitted = true;
+		requested = false;
+	}
+
+	wake.notify_all();
+}
+
+void CheckpointWriter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		wake.wait_for(lock, interval, [&]() { return stopping || submitted; });
+
+		if (!submitted)
+		{
+			if (stopping)
+			{
+				break;
+			}
+
+			requested = true;
+
+			wake.wait(lock, [&]() { return submitted || stopping; });
+
+			if (!submitted)
+			{
+				break;
+			}
+		}
+
+		submitted = false;
+
+		// Moved out of the shared slot, so the render can submit its last checkpoint while this one is written.
+		Checkpoint pending = std::move(checkpoint);
+
+		lock.unlock();
+
+		if (writeCheckpoint(filePath, pending))
+		{
+			++checkpointCount;
+		}
+
+		lock.lock();
+	}
+
+	requested = false;
+}
\ No newline at end of file
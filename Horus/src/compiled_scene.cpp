@@ -0,0 +1,612 @@
+#include "compiled_scene.h"
+#include "mesh.h"
+#include "particles.h"
+#include "paged_mesh.h"
+#include "displaced.h"
+#include "reference.h"
+#include "mapped_file.h"
+#include <fstream>
+#include <cstring>
+
+static const char compiledSceneMagic[4] = { 'H', 'R', 'S', 'B' };
+static const uint32_t compiledSceneVersion = 2;
+
+static const uint32_t positionUpdatedFlag = 1;
+static const uint32_t rotationUpdatedFlag = 2;
+static const uint32_t widthUpdatedFlag = 4;
+static const uint32_t heightUpdatedFlag = 8;
+static const uint32_t proxyBoundsFlag = 16;
+
+static void storeVector(float* out, const Vector3D<float>& v)
+{
+	out[0] = v.x;
+	out[1] = v.y;
+	out[2] = v.z;
+}
+
+static Vector3D<float> loadVector(const float* in)
+{
+	return Vector3D<float>(in[0], in[1], in[2]);
+}
+
+// Returns true if 'filePath' has the .hrsb extension of compiled scenes.
+bool isCompiledScene(const std::string& filePath)
+{
+	return filePath.size() > 5 && filePath.compare(filePath.size() - 5, 5, ".hrsb") == 0;
+}
+
+bool compileScene(const std::string& scenePath, const std::string& outputPath, bool includeBVH)
+{
+	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+
+	if (!SceneBuilder(scenePath, sceneObjects))
+	{
+		std::cout << "Failed to parse scene file: " << scenePath << std::endl;
+		return false;
+	}
+
+	Scene scene;
+
+	if (!scene.getScene(sceneObjects))
+	{
+		return false;
+	}
+
+	if (includeBVH)
+	{
+		scene.buildAccelerator();
+	}
+
+	if (!writeCompiledScene(outputPath, scene, includeBVH))
+	{
+		return false;
+	}
+
+	std::cout << "Compiled " << scenePath << " to " << outputPath << " (" << scene.getGeometries().size() << " geometries, "
+	          << scene.getBVH().getNodes().size() << " BVH nodes)" << std::endl;
+
+	return true;
+}
+
+static MaterialRecord toMaterialRecord(Material& material)
+{
+	MaterialRecord record = {};
+
+	record.type = static_cast<uint32_t>(material.index());
+
+	if (auto* p = std::get_if<Constant>(&material))
+	{
+		storeVector(record.color, p->getColor());
+	}
+	else if (auto* p = std::get_if<Surface>(&material))
+	{
+		record.diffuseGain = p->getDiffuseGain();
+		storeVector(record.diffuseColor, p->getDiffuseColor());
+		record.roughness = p->getRoughness();
+	}
+	else if (auto* p = std::get_if<Shader>(&material))
+	{
+		storeVector(record.color, p->getColor());
+	}
+
+	return record;
+}
+
+static Material fromMaterialRecord(const MaterialRecord& record)
+{
+	switch (record.type)
+	{
+		case 1:
+		{
+			Constant constant;
+			constant.setColor(loadVector(record.color));
+			return constant;
+		}
+
+		case 2:
+			return Depth();
+
+		case 3:
+		{
+			Surface surface;
+			surface.setDiffuseGain(record.diffuseGain);
+			surface.setDiffuseColor(loadVector(record.diffuseColor));
+			surface.setRoughness(record.roughness);
+			return surface;
+		}
+
+		default:
+		{
+			Shader shader;
+			shader.setColor(loadVector(record.color));
+			return shader;
+		}
+	}
+}
+
+static GeometryRecord toGeometryRecord(GeometryObject& geometry, std::string& strings)
+{
+	GeometryRecord record = {};
+
+	record.type = static_cast<uint32_t>(geometry.getGeometryType());
+	record.material = geometry.getMaterial();
+
+	record.flags = (geometry.getPositionUpdated() ? positionUpdatedFlag : 0) | (geometry.getRotationUpdated() ? rotationUpdatedFlag : 0) |
+	               (geometry.getWidthUpdated() ? widthUpdatedFlag : 0) | (geometry.getHeightUpdated() ? heightUpdatedFlag : 0);
+
+	storeVector(record.position, geometry.position);
+	storeVector(record.rotation, geometry.rotation);
+	record.size = geometry.size;
+	record.cache = geometry.getCacheSize();
+
+	if (PlaneObject* plane = dynamic_cast<PlaneObject*>(&geometry))
+	{
+		record.width = plane->getWidth();
+		record.height = plane->getHeight();
+	}
+
+	if (DisplacedSurfaceObject* displaced = dynamic_cast<DisplacedSurfaceObject*>(&geometry))
+	{
+		record.displacement = displaced->getDisplacement();
+		record.frequency = displaced->getFrequency();
+		record.resolution = displaced->getResolution();
+	}
+
+	BoundingBox proxyBounds;
+
+	if (ReferenceObject* reference = dynamic_cast<ReferenceObject*>(&geometry); reference && reference->getProxyBounds(proxyBounds))
+	{
+		record.flags |= proxyBoundsFlag;
+		storeVector(record.bounds, proxyBounds.getMin());
+		storeVector(record.bounds + 3, proxyBounds.getMax());
+	}
+
+	std::string_view filePath = geometry.getFilePath();
+
+	record.fileOffset = static_cast<uint32_t>(strings.size());
+	record.fileLength = static_cast<uint32_t>(filePath.size());
+	strings.append(filePath);
+
+	return record;
+}
+
+// Appends 'bytes' bytes to 'file', padded to a multiple of 8, and returns the offset they were written at.
+static uint64_t writeSection(std::ofstream& file, const void* data, size_t bytes)
+{
+	uint64_t offset = static_cast<uint64_t>(file.tellp());
+
+	file.write(static_cast<const char*>(data), bytes);
+
+	static const char padding[8] = {};
+	file.write(padding, (8 - bytes % 8) % 8);
+
+	return offset;
+}
+
+bool writeCompiledScene(const std::string& filePath, Scene& scene, bool includeBVH)
+{
+	MaterialLibrary& library = MaterialLibrary::getInstance();
+
+	std::vector<MaterialRecord> materials;
+	std::vector<CameraRecord> cameras;
+	std::vector<LightRecord> lights;
+	std::vector<GeometryRecord> geometries;
+	std::vector<BVHNodeRecord> bvhNodes;
+	std::vector<uint32_t> bvhPrimitives;
+	std::string strings;
+
+	for (uint32_t i = 0; i < library.getMaterialCount(); ++i)
+	{
+		materials.push_back(toMaterialRecord(library.get(i)));
+	}
+
+	std::unordered_map<GeometryObject*, uint32_t> geometryIndices;
+
+	for (SceneObject* object : scene.getObjects())
+	{
+		switch (object->getType())
+		{
+			case SceneObjectType::CAMERA:
+			{
+				CameraObject* camera = static_cast<CameraObject*>(object);
+
+				CameraRecord record = {};
+				record.type = static_cast<uint32_t>(camera->getCameraType());
+				storeVector(record.position, camera->position);
+				storeVector(record.rotation, camera->rotation);
+				storeVector(record.lookAt, camera->lookAt);
+				record.width = camera->getWidth();
+				record.height = camera->getHeight();
+
+				cameras.push_back(record);
+				break;
+			}
+
+			case SceneObjectType::LIGHT:
+			{
+				LightObject* light = static_cast<LightObject*>(object);
+
+				LightRecord record = {};
+				record.type = static_cast<uint32_t>(light->getLightType());
+				storeVector(record.position, light->position);
+				storeVector(record.rotation, light->rotation);
+				storeVector(record.color, light->getColor());
+				record.size = light->getSize();
+				record.intensity = light->getIntensity();
+
+				lights.push_back(record);
+				break;
+			}
+
+			case SceneObjectType::GEOMETRY:
+			{
+				GeometryObject* geometry = static_cast<GeometryObject*>(object);
+
+				geometryIndices[geometry] = static_cast<uint32_t>(geometries.size());
+				geometries.push_back(toGeometryRecord(*geometry, strings));
+				break;
+			}
+		}
+	}
+
+	if (includeBVH && scene.getBVH().isBuilt())
+	{
+		for (const linearBVH& node : scene.getBVH().getNodes())
+		{
+			BVHNodeRecord record = {};
+			storeVector(record.min, node.getBoundingBox().getMin());
+			storeVector(record.max, node.getBoundingBox().getMax());
+			record.primitiveOffset = node.getPrimitiveOffset();
+			record.nPrimitives = node.getNPrimitives();
+			record.secondChildOffset = node.getSecondChildOffset();
+
+			bvhNodes.push_back(record);
+		}
+
+		for (GeometryObject* primitive : scene.getBVH().getOrderedPrimitives())
+		{
+			bvhPrimitives.push_back(geometryIndices[primitive]);
+		}
+	}
+
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file.is_open())
+	{
+		std::cout << "Failed to open compiled scene for writing: " << filePath << std::endl;
+		return false;
+	}
+
+	CompiledSceneHeader header = {};
+	std::memcpy(header.magic, compiledSceneMagic, 4);
+	header.version = compiledSceneVersion;
+	header.materialCount = static_cast<uint32_t>(materials.size());
+	header.cameraCount = static_cast<uint32_t>(cameras.size());
+	header.lightCount = static_cast<uint32_t>(lights.size());
+	header.geometryCount = static_cast<uint32_t>(geometries.size());
+	header.bvhNodeCount = static_cast<uint32_t>(bvhNodes.size());
+	header.bvhPrimitiveCount = static_cast<uint32_t>(bvhPrimitives.size());
+	header.stringSize = strings.size();
+
+	// The header is written twice: once to reserve its space, and again once the section offsets are known.
+	writeSection(file, &header, sizeof(header));
+
+	header.materialOffset = writeSection(file, materials.data(), materials.size() * sizeof(MaterialRecord));
+	header.cameraOffset = writeSection(file, cameras.data(), cameras.size() * sizeof(CameraRecord));
+	header.lightOffset = writeSection(file, lights.data(), lights.size() * sizeof(LightRecord));
+	header.geometryOffset = writeSection(file, geometries.data(), geometries.size() * sizeof(GeometryRecord));
+	header.bvhNodeOffset = writeSection(file, bvhNodes.data(), bvhNodes.size() * sizeof(BVHNodeRecord));
+	header.bvhPrimitiveOffset = writeSection(file, bvhPrimitives.data(), bvhPrimitives.size() * sizeof(uint32_t));
+	header.stringOffset = writeSection(file, strings.data(), strings.size());
+
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (!file.good())
+	{
+		std::cout << "Failed to write compiled scene: " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// Returns true if the 'count' records of 'recordSize' bytes at 'offset' lie inside the mapped file.
+static bool sectionInFile(const MappedFile& file, uint64_t offset, uint64_t count, uint64_t recordSize)
+{
+	return offset <= file.getSize() && count * recordSize <= file.getSize() - offset;
+}
+
+// Restores one geometry in the same order the parser applies its parameters, so bounds and normals come out identical.
+static void restoreGeometry(GeometryObject& geometry, const GeometryRecord& record, std::string_view filePath, const std::vector<uint32_t>& materialIndices)
+{
+	geometry.setMaterial(record.material < materialIndices.size() ? materialIndices[record.material] : 0);
+
+	geometry.position = loadVector(record.position);
+	geometry.rotation = loadVector(record.rotation);
+	geometry.size = record.size;
+
+	geometry.setPositionUpdated((record.flags & positionUpdatedFlag) != 0);
+	geometry.setRotationUpdated((record.flags & rotationUpdatedFlag) != 0);
+	geometry.setWidthUpdated((record.flags & widthUpdatedFlag) != 0);
+	geometry.setHeightUpdated((record.flags & heightUpdatedFlag) != 0);
+
+	switch (geometry.getGeometryType())
+	{
+		case GeometryType::PLANE:
+		{
+			PlaneObject& plane = static_cast<PlaneObject&>(geometry);
+			plane.setWidth(record.width);
+			plane.setHeight(record.height);
+
+			if (plane.checkPositionRotationWidthHeightUpdated())
+			{
+				plane.computeNormal();
+			}
+			break;
+		}
+
+		case GeometryType::PARTICLES:
+			static_cast<ParticleSetObject&>(geometry).setRadius(record.size);
+			break;
+
+		case GeometryType::DISPLACED:
+		{
+			DisplacedSurfaceObject& displaced = static_cast<DisplacedSurfaceObject&>(geometry);
+			displaced.setRadius(record.size);
+			displaced.setDisplacement(record.displacement);
+			displaced.setFrequency(record.frequency);
+			displaced.setResolution(record.resolution);
+			break;
+		}
+
+		case GeometryType::REFERENCE:
+			if (record.flags & proxyBoundsFlag)
+			{
+				static_cast<ReferenceObject&>(geometry).setProxyBounds(BoundingBox(loadVector(record.bounds), loadVector(record.bounds + 3)));
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	if (record.cache > 0.0f)
+	{
+		geometry.setCacheSize(record.cache);
+	}
+
+	if (!filePath.empty())
+	{
+		geometry.loadFile(std::string(filePath));
+	}
+
+	geometry.endParameters();
+
+	geometry.setBoundingBox();
+	geometry.createMorton();
+}
+
+bool loadCompiledScene(const std::string& filePath, Scene& scene)
+{
+	MappedFile file(filePath);
+
+	CompiledSceneHeader header;
+
+	if (!file.isOpen() || file.getSize() < sizeof(header))
+	{
+		std::cout << "Failed to open compiled scene: " << filePath << std::endl;
+		return false;
+	}
+
+	std::memcpy(&header, file.getData(), sizeof(header));
+
+	if (std::memcmp(header.magic, compiledSceneMagic, 4) != 0 || header.version != compiledSceneVersion ||
+		!sectionInFile(file, header.materialOffset, header.materialCount, sizeof(MaterialRecord)) ||
+		!sectionInFile(file, header.cameraOffset, header.cameraCount, sizeof(CameraRecord)) ||
+		!sectionInFile(file, header.lightOffset, header.lightCount, sizeof(LightRecord)) ||
+		!sectionInFile(file, header.geometryOffset, header.geometryCount, sizeof(GeometryRecord)) ||
+		!sectionInFile(file, header.bvhNodeOffset, header.bvhNodeCount, sizeof(BVHNodeRecord)) ||
+		!sectionInFile(file, header.bvhPrimitiveOffset, header.bvhPrimitiveCount, sizeof(uint32_t)) ||
+		!sectionInFile(file, header.stringOffset, header.stringSize, 1))
+	{
+		std::cout << "Invalid compiled scene: " << filePath << std::endl;
+		return false;
+	}
+
+	const char* data = file.getData();
+	std::string_view strings(data + header.stringOffset, header.stringSize);
+
+	// Materials of the file are appended to the library; record indices are remapped, index 0 stays the default material.
+	MaterialLibrary& library = MaterialLibrary::getInstance();
+	std::vector<uint32_t> materialIndices(header.materialCount, 0);
+
+	for (uint32_t i = 1; i < header.materialCount; ++i)
+	{
+		MaterialRecord record;
+		std::memcpy(&record, data + header.materialOffset + i * sizeof(MaterialRecord), sizeof(record));
+
+		materialIndices[i] = library.add(fromMaterialRecord(record));
+	}
+
+	// Count the objects of each type first, so every array of the arena is allocated exactly once.
+	SceneArena arena;
+
+	size_t sphereCount = 0;
+	size_t planeCount = 0;
+	size_t pointLightCount = 0;
+	size_t domeLightCount = 0;
+
+	for (uint32_t i = 0; i < header.geometryCount; ++i)
+	{
+		uint32_t type;
+		std::memcpy(&type, data + header.geometryOffset + i * sizeof(GeometryRecord), sizeof(type));
+
+		sphereCount += (type == static_cast<uint32_t>(GeometryType::SPHERE));
+		planeCount += (type == static_cast<uint32_t>(GeometryType::PLANE));
+	}
+
+	for (uint32_t i = 0; i < header.lightCount; ++i)
+	{
+		uint32_t type;
+		std::memcpy(&type, data + header.lightOffset + i * sizeof(LightRecord), sizeof(type));
+
+		pointLightCount += (type == static_cast<uint32_t>(LightType::POINT));
+		domeLightCount += (type == static_cast<uint32_t>(LightType::DOME));
+	}
+
+	arena.spheres.reserve(sphereCount);
+	arena.planes.reserve(planeCount);
+	arena.cameras.reserve(header.cameraCount);
+	arena.pointLights.reserve(pointLightCount);
+	arena.domeLights.reserve(domeLightCount);
+	arena.objects.reserve(header.cameraCount + header.lightCount + header.geometryCount);
+
+	for (uint32_t i = 0; i < header.cameraCount; ++i)
+	{
+		CameraRecord record;
+		std::memcpy(&record, data + header.cameraOffset + i * sizeof(CameraRecord), sizeof(record));
+
+		PerspectiveCameraObject& camera = arena.cameras.emplace_back(45.0f);
+		camera.position = loadVector(record.position);
+		camera.rotation = loadVector(record.rotation);
+		camera.lookAt = loadVector(record.lookAt);
+		camera.setWindow(record.width, record.height);
+
+		arena.objects.push_back(&camera);
+	}
+
+	for (uint32_t i = 0; i < header.lightCount; ++i)
+	{
+		LightRecord record;
+		std::memcpy(&record, data + header.lightOffset + i * sizeof(LightRecord), sizeof(record));
+
+		LightObject* light = nullptr;
+
+		switch (static_cast<LightType>(record.type))
+		{
+			case LightType::POINT:
+				light = &arena.pointLights.emplace_back(1.0f);
+				break;
+
+			case LightType::DOME:
+				light = &arena.domeLights.emplace_back();
+				break;
+
+			default:
+				continue;
+		}
+
+		light->position = loadVector(record.position);
+		light->rotation = loadVector(record.rotation);
+		light->setColor(loadVector(record.color));
+		light->setSize(record.size);
+		light->setIntensity(record.intensity);
+
+		arena.objects.push_back(light);
+	}
+
+	std::vector<GeometryObject*> geometries(header.geometryCount, nullptr);
+
+	for (uint32_t i = 0; i < header.geometryCount; ++i)
+	{
+		GeometryRecord record;
+		std::memcpy(&record, data + header.geometryOffset + i * sizeof(GeometryRecord), sizeof(record));
+
+		GeometryObject* geometry = nullptr;
+
+		switch (static_cast<GeometryType>(record.type))
+		{
+			case GeometryType::SPHERE:
+				geometry = &arena.spheres.emplace_back(1.0f);
+				break;
+
+			case GeometryType::PLANE:
+				geometry = &arena.planes.emplace_back();
+				break;
+
+			case GeometryType::MESH:
+				arena.aggregates.emplace_back(std::make_unique<MeshObject>());
+				break;
+
+			case GeometryType::PARTICLES:
+				arena.aggregates.emplace_back(std::make_unique<ParticleSetObject>());
+				break;
+
+			case GeometryType::PAGED_MESH:
+				arena.aggregates.emplace_back(std::make_unique<PagedMeshObject>());
+				break;
+
+			case GeometryType::DISPLACED:
+				arena.aggregates.emplace_back(std::make_unique<DisplacedSurfaceObject>());
+				break;
+
+			case GeometryType::REFERENCE:
+				arena.aggregates.emplace_back(std::make_unique<ReferenceObject>());
+				break;
+
+			default:
+				std::cout << "Unknown geometry type in compiled scene: " << record.type << std::endl;
+				return false;
+		}
+
+		if (geometry == nullptr)
+		{
+			geometry = static_cast<GeometryObject*>(arena.aggregates.back().get());
+		}
+
+		std::string_view path = (static_cast<uint64_t>(record.fileOffset) + record.fileLength <= strings.size()) ? strings.substr(record.fileOffset, record.fileLength) : std::string_view();
+
+		restoreGeometry(*geometry, record, path, materialIndices);
+
+		geometries[i] = geometry;
+		arena.objects.push_back(geometry);
+	}
+
+	if (!scene.getScene(arena))
+	{
+		return false;
+	}
+
+	if (header.bvhNodeCount > 0)
+	{
+		std::vector<linearBVH> nodes(header.bvhNodeCount);
+		std::vector<GeometryObject*> primitives(header.bvhPrimitiveCount);
+
+		for (uint32_t i = 0; i < header.bvhNodeCount; ++i)
+		{
+			BVHNodeRecord record;
+			std::memcpy(&record, data + header.bvhNodeOffset + i * sizeof(BVHNodeRecord), sizeof(record));
+
+			if (record.primitiveOffset < 0 || record.nPrimitives < 0 || static_cast<uint64_t>(record.primitiveOffset) + record.nPrimitives > header.bvhPrimitiveCount ||
+				record.secondChildOffset < 0 || static_cast<uint32_t>(record.secondChildOffset) >= header.bvhNodeCount)
+			{
+				std::cout << "Invalid BVH node in compiled scene, rebuilding the BVH" << std::endl;
+				return true;
+			}
+
+			nodes[i].setBoundingBox(BoundingBox(loadVector(record.min), loadVector(record.max)));
+			nodes[i].setPrimitiveOffset(record.primitiveOffset);
+			nodes[i].setNPrimitives(record.nPrimitives);
+			nodes[i].setSecondChildOffset(record.secondChildOffset);
+		}
+
+		for (uint32_t i = 0; i < header.bvhPrimitiveCount; ++i)
+		{
+			uint32_t index;
+			std::memcpy(&index, data + header.bvhPrimitiveOffset + i * sizeof(uint32_t), sizeof(index));
+
+			if (index >= geometries.size())
+			{
+				std::cout << "Invalid BVH primitive in compiled scene, rebuilding the BVH" << std::endl;
+				return true;
+			}
+
+			primitives[i] = geometries[index];
+		}
+
+		scene.getBVH().setNodes(std::move(nodes), std::move(primitives));
+	}
+
+	return true;
+}
\ No newline at end of file
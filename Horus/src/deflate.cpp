@@ -0,0 +1,493 @@
+#include "deflate.h"
+#include <queue>
+#include <algorithm>
+
+static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Order in which the code length code lengths are stored.
+static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+const int32_t windowSize = 32768;
+const int32_t hashBits = 15;
+const int32_t maxChain = 32;
+const int32_t minMatch = 3;
+const int32_t maxMatch = 258;
+const size_t tokensPerBlock = 32768;
+
+// Literal (distance 0) or match of 'length' bytes at 'distance'.
+struct DeflateToken
+{
+	uint16_t length;
+	uint16_t distance;
+};
+
+// Writes bits least significant first, as deflate expects.
+class BitWriter
+{
+	public:
+		BitWriter(std::vector<uint8_t>& out) : out(out) {}
+
+		void put(uint32_t value, int32_t count)
+		{
+			bits |= static_cast<uint64_t>(value) << bitCount;
+			bitCount += count;
+
+			while (bitCount >= 8)
+			{
+				out.push_back(static_cast<uint8_t>(bits));
+				bits >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		void align()
+		{
+			if (bitCount > 0)
+			{
+				put(0, 8 - bitCount);
+			}
+		}
+
+	private:
+		std::vector<uint8_t>& out;
+		uint64_t bits = 0;
+		int32_t bitCount = 0;
+};
+
+static int32_t lengthSymbol(int32_t length)
+{
+	return static_cast<int32_t>(std::upper_bound(lengthBase, lengthBase + 29, length) - lengthBase) - 1;
+}
+
+static int32_t distanceSymbol(int32_t distance)
+{
+	return static_cast<int32_t>(std::upper_bound(distanceBase, distanceBase + 30, distance) - distanceBase) - 1;
+}
+
+// Huffman code lengths for 'frequencies', limited to 'maxBits'. When the tree is too deep the frequencies are halved, which
+// flattens the distribution, and the tree is built again.
+static void buildLengths(const uint32_t* frequencies, int32_t count, int32_t maxBits, uint8_t* lengths)
+{
+	std::vector<uint32_t> weights(frequencies, frequencies + count);
+
+	while (true)
+	{
+		std::fill(lengths, lengths + count, 0);
+
+		struct Node
+		{
+			int32_t left;
+			int32_t right;
+			int32_t symbol;
+		};
+
+		std::vector<Node> nodes;
+		std::priority_queue<std::pair<uint64_t, int32_t>, std::vector<std::pair<uint64_t, int32_t>>, std::greater<std::pair<uint64_t, int32_t>>> queue;
+
+		for (int32_t i = 0; i < count; ++i)
+		{
+			if (weights[i] > 0)
+			{
+				queue.emplace(weights[i], static_cast<int32_t>(nodes.size()));
+				nodes.push_back({ -1, -1, i });
+			}
+		}
+
+		if (nodes.size() == 1)
+		{
+			lengths[nodes[0].symbol] = 1;
+			return;
+		}
+
+		while (queue.size() > 1)
+		{
+			std::pair<uint64_t, int32_t> a = queue.top();
+			queue.pop();
+			std::pair<uint64_t, int32_t> b = queue.top();
+			queue.pop();
+
+			queue.emplace(a.first + b.first, static_cast<int32_t>(nodes.size()));
+			nodes.push_back({ a.second, b.second, -1 });
+		}
+
+		int32_t maxDepth = 0;
+		std::vector<std::pair<int32_t, int32_t>> stack = { { static_cast<int32_t>(nodes.size()) - 1, 0 } };
+
+		while (!stack.empty())
+		{
+			std::pair<int32_t, int32_t> entry = stack.back();
+			stack.pop_back();
+
+			const Node& node = nodes[entry.first];
+
+			if (node.symbol >= 0)
+			{
+				lengths[node.symbol] = static_cast<uint8_t>(std::min(entry.second, 255));
+				maxDepth = std::max(maxDepth, entry.second);
+			}
+			else
+			{
+				stack.emplace_back(node.left, entry.second + 1);
+				stack.emplace_back(node.right, entry.second + 1);
+			}
+		}
+
+		if (maxDepth <= maxBits)
+		{
+			return;
+		}
+
+		for (uint32_t& weight : weights)
+		{
+			if (weight > 0)
+			{
+				weight = (weight + 1) / 2;
+			}
+		}
+	}
+}
+
+// Canonical codes for the lengths, bit reversed so they can be written least significant bit first.
+static void buildCodes(const uint8_t* lengths, int32_t count, uint16_t* codes)
+{
+	uint16_t lengthCount[16] = {};
+	uint16_t nextCode[16] = {};
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		++lengthCount[lengths[i]];
+	}
+
+	lengthCount[0] = 0;
+
+	uint16_t code = 0;
+
+	for (int32_t bits = 1; bits < 16; ++bits)
+	{
+		code = static_cast<uint16_t>((code + lengthCount[bits - 1]) << 1);
+		nextCode[bits] = code;
+	}
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		int32_t length = lengths[i];
+
+		if (length == 0)
+		{
+			codes[i] = 0;
+			continue;
+		}
+
+		uint16_t value = nextCode[length]++;
+		uint16_t reversed = 0;
+
+		for (int32_t bit = 0; bit < length; ++bit)
+		{
+			reversed = static_cast<uint16_t>((reversed << 1) | ((value >> bit) & 1));
+		}
+
+		codes[i] = reversed;
+	}
+}
+
+// A complete code needs at least two symbols; a block with fewer gets placeholder symbols that are never written.
+static void ensureTwoSymbols(uint32_t* frequencies, int32_t count)
+{
+	int32_t used = 0;
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		used += (frequencies[i] > 0) ? 1 : 0;
+	}
+
+	for (int32_t i = 0; i < count && used < 2; ++i)
+	{
+		if (frequencies[i] == 0)
+		{
+			frequencies[i] = 1;
+			++used;
+		}
+	}
+}
+
+static void writeBlock(BitWriter& writer, const std::vector<DeflateToken>& tokens, bool final)
+{
+	uint32_t literalFrequencies[286] = {};
+	uint32_t distanceFrequencies[30] = {};
+
+	for (const DeflateToken& token : tokens)
+	{
+		if (token.distance == 0)
+		{
+			++literalFrequencies[token.length];
+		}
+		else
+		{
+			++literalFrequencies[257 + lengthSymbol(token.length)];
+			++distanceFrequencies[distanceSymbol(token.distance)];
+		}
+	}
+
+	literalFrequencies[256] = 1;
+
+	ensureTwoSymbols(literalFrequencies, 286);
+	ensureTwoSymbols(distanceFrequencies, 30);
+
+	uint8_t literalLengths[286];
+	uint8_t distanceLengths[30];
+	uint16_t literalCodes[286];
+	uint16_t distanceCodes[30];
+
+	buildLengths(literalFrequencies, 286, 15, literalLengths);
+	buildLengths(distanceFrequencies, 30, 15, distanceLengths);
+	buildCodes(literalLengths, 286, literalCodes);
+	buildCodes(distanceLengths, 30, distanceCodes);
+
+	int32_t literalCount = 286;
+	while (literalCount > 257 && literalLengths[literalCount - 1] == 0) { --literalCount; }
+
+	int32_t distanceCount = 30;
+	while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) { --distanceCount; }
+
+	// Both length tables are sent as one sequence, run length encoded with the symbols 16 (repeat previous), 17 and 18 (zeros).
+	std::vector<uint8_t> lengths(literalLengths, literalLengths + literalCount);
+	lengths.insert(lengths.end(), distanceLengths, distanceLengths + distanceCount);
+
+	std::vector<std::pair<uint8_t, uint8_t>> symbols;
+
+	for (size_t i = 0; i < lengths.size();)
+	{
+		uint8_t length = lengths[i];
+		size_t run = 1;
+
+		while (i + run < lengths.size() && lengths[i + run] == length) { ++run; }
+
+		i += run;
+
+		if (length == 0)
+		{
+			while (run >= 11)
+			{
+				size_t count = std::min<size_t>(run, 138);
+				symbols.emplace_back(18, static_cast<uint8_t>(count - 11));
+				run -= count;
+			}
+
+			if (run >= 3)
+			{
+				symbols.emplace_back(17, static_cast<uint8_t>(run - 3));
+				run = 0;
+			}
+		}
+		else
+		{
+			symbols.emplace_back(length, 0);
+			--run;
+
+			while (run >= 3)
+			{
+				size_t count = std::min<size_t>(run, 6);
+				symbols.emplace_back(16, static_cast<uint8_t>(count - 3));
+				run -= count;
+			}
+		}
+
+		for (; run > 0; --run)
+		{
+			symbols.emplace_back(length, 0);
+		}
+	}
+
+	uint32_t codeLengthFrequencies[19] = {};
+
+	for (const std::pair<uint8_t, uint8_t>& symbol : symbols)
+	{
+		++codeLengthFrequencies[symbol.first];
+	}
+
+	ensureTwoSymbols(codeLengthFrequencies, 19);
+
+	uint8_t codeLengthLengths[19];
+	uint16_t codeLengthCodes[19];
+
+	buildLengths(codeLengthFrequencies, 19, 7, codeLengthLengths);
+	buildCodes(codeLengthLengths, 19, codeLengthCodes);
+
+	int32_t codeLengthCount = 19;
+	while (codeLengthCount > 4 && codeLengthLengths[codeLengthOrder[codeLengthCount - 1]] == 0) { --codeLengthCount; }
+
+	writer.put(final ? 1 : 0, 1);
+	writer.put(2, 2);
+	writer.put(literalCount - 257, 5);
+	writer.put(distanceCount - 1, 5);
+	writer.put(codeLengthCount - 4, 4);
+
+	for (int32_t i = 0; i < codeLengthCount; ++i)
+	{
+		writer.put(codeLengthLengths[codeLengthOrder[i]], 3);
+	}
+
+	for (const std::pair<uint8_t, uint8_t>& symbol : symbols)
+	{
+		writer.put(codeLengthCodes[symbol.first], codeLengthLengths[symbol.first]);
+
+		if (symbol.first == 16) { writer.put(symbol.second, 2); }
+		else if (symbol.first == 17) { writer.put(symbol.second, 3); }
+		else if (symbol.first == 18) { writer.put(symbol.second, 7); }
+	}
+
+	for (const DeflateToken& token : tokens)
+	{
+		if (token.distance == 0)
+		{
+			writer.put(literalCodes[token.length], literalLengths[token.length]);
+		}
+		else
+		{
+			int32_t length = lengthSymbol(token.length);
+			int32_t distance = distanceSymbol(token.distance);
+
+			writer.put(literalCodes[257 + length], literalLengths[257 + length]);
+			writer.put(token.length - lengthBase[length], lengthExtra[length]);
+			writer.put(distanceCodes[distance], distanceLengths[distance]);
+			writer.put(token.distance - distanceBase[distance], distanceExtra[distance]);
+		}
+	}
+
+	writer.put(literalCodes[256], literalLengths[256]);
+}
+
+void deflateCompress(const uint8_t* data, size_t size, bool final, std::vector<uint8_t>& out)
+{
+	BitWriter writer(out);
+
+	std::vector<int32_t> head(size_t(1) << hashBits, -1);
+	std::vector<int32_t> previous(windowSize, -1);
+
+	auto hash = [&](size_t p)
+	{
+		uint32_t value = data[p] | (data[p + 1] << 8) | (data[p + 2] << 16);
+
+		return (value * 2654435761u) >> (32 - hashBits);
+	};
+
+	auto insert = [&](size_t p)
+	{
+		if (p + minMatch <= size)
+		{
+			uint32_t h = hash(p);
+
+			previous[p & (windowSize - 1)] = head[h];
+			head[h] = static_cast<int32_t>(p);
+		}
+	};
+
+	std::vector<DeflateToken> tokens;
+	tokens.reserve(tokensPerBlock);
+
+	for (size_t p = 0; p < size;)
+	{
+		int32_t bestLength = 0;
+		int32_t bestDistance = 0;
+
+		if (p + minMatch <= size)
+		{
+			int32_t limit = static_cast<int32_t>(std::min<size_t>(maxMatch, size - p));
+			int32_t candidate = head[hash(p)];
+
+			for (int32_t chain = 0; chain < maxChain && candidate >= 0 && static_cast<int32_t>(p) - candidate <= windowSize; ++chain)
+			{
+				const uint8_t* a = data + candidate;
+				const uint8_t* b = data + p;
+
+				if (a[bestLength] == b[bestLength])
+				{
+					int32_t length = 0;
+
+					while (length < limit && a[length] == b[length]) { ++length; }
+
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = static_cast<int32_t>(p) - candidate;
+
+						if (length == limit) { break; }
+					}
+				}
+
+				int32_t next = previous[candidate & (windowSize - 1)];
+
+				if (next >= candidate) { break; }
+
+				candidate = next;
+			}
+		}
+
+		if (bestLength >= minMatch)
+		{
+			tokens.push_back({ static_cast<uint16_t>(bestLength), static_cast<uint16_t>(bestDistance) });
+
+			for (int32_t i = 0; i < bestLength; ++i)
+			{
+				insert(p + i);
+			}
+
+			p += bestLength;
+		}
+		else
+		{
+			tokens.push_back({ data[p], 0 });
+			insert(p);
+			++p;
+		}
+
+		if (tokens.size() == tokensPerBlock && p < size)
+		{
+			writeBlock(writer, tokens, false);
+			tokens.clear();
+		}
+	}
+
+	writeBlock(writer, tokens, final);
+
+	if (!final)
+	{
+		// Empty stored block: pads to a byte boundary so the next chunk can follow directly.
+		writer.put(0, 3);
+		writer.align();
+		writer.put(0x0000, 16);
+		writer.put(0xFFFF, 16);
+	}
+
+	writer.align();
+}
+
+uint32_t adler32(const uint8_t* data, size_t size, uint32_t adler)
+{
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+
+	// 5552 bytes is the largest run whose sums cannot overflow before the modulo.
+	while (size > 0)
+	{
+		size_t count = std::min<size_t>(size, 5552);
+
+		for (size_t i = 0; i < count; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+
+		a %= 65521;
+		b %= 65521;
+
+		data += count;
+		size -= count;
+	}
+
+	return (b << 16) | a;
+}
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "denoise.h"
+#include <cmath>
+#include <thread>
+#include <algorithm>
+
+static float luminance(const Vector3D<float>& color)
+{
+	return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+}
+
+// Runs 'rowFunction' over the rows [0, height) on 'threads' threads.
+template <typename Function>
+static void parallelRows(int32_t height, int32_t threads, Function rowFunction)
+{
+	int32_t rowsPerThread = (height + threads - 1) / threads;
+
+	std::vector<std::thread> workers;
+
+	for (int32_t begin = rowsPerThread; begin < height; begin += rowsPerThread)
+	{
+		int32_t end = std::min(height, begin + rowsPerThread);
+
+		workers.emplace_back([=]() { for (int32_t y = begin; y < end; ++y) { rowFunction(y); } });
+	}
+
+	for (int32_t y = 0; y < std::min(height, rowsPerThread); ++y)
+	{
+		rowFunction(y);
+	}
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void Denoiser::resize(int32_t width, int32_t height, bool weighted)
+{
+	normal.resize(width, height, weighted);
+	albedo.resize(width, height, weighted);
+	moments.resize(width, height, weighted);
+}
+
+void Denoiser::addSample(int32_t x, int32_t y, const AOVSample& aov, int32_t samples)
+{
+	float n = static_cast<float>(samples);
+
+	Vector3D<float> featureMoments(aov.depth / n, aov.luminanceSquared / n, 0.0f);
+
+	if (normal.isWeighted())
+	{
+		normal.accumulate(x, y, aov.normal / n, n);
+		albedo.accumulate(x, y, aov.albedo / n, n);
+		moments.accumulate(x, y, featureMoments, n);
+	}
+	else
+	{
+		normal.set(x, y, aov.normal / n);
+		albedo.set(x, y, aov.albedo / n);
+		moments.set(x, y, featureMoments);
+	}
+}
+
+void Denoiser::apply(Framebuffer& color, int32_t samples, int32_t threads) const
+{
+	const int32_t width = color.getWidth();
+	const int32_t height = color.getHeight();
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+
+	// Edge stopping parameters: normal cosine exponent, relative depth change per pixel, albedo distance, luminance in standard deviations.
+	const float sigmaDepth = 0.05f;
+	const float sigmaAlbedo = 0.1f;
+	const float sigmaLuminance = 8.0f;
+
+	const float kernel[5] = { 1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f };
+
+	if (threads <= 0)
+	{
+		threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
+
+	// The filter reads neighbors in every direction, so the tiled buffers are copied into scanline order first.
+	std::vector<Vector3D<float>> illumination(pixelCount);
+	std::vector<Vector3D<float>> normals(pixelCount);
+	std::vector<Vector3D<float>> albedos(pixelCount);
+	std::vector<Vector3D<float>> features(pixelCount);
+	std::vector<float> variance(pixelCount);
+
+	parallelRows(height, threads, [&](int32_t y)
+	{
+		size_t row = static_cast<size_t>(y) * width;
+
+		color.getRow(y, &illumination[row]);
+		normal.getRow(y, &normals[row]);
+		albedo.getRow(y, &albedos[row]);
+		moments.getRow(y, &features[row]);
+
+		for (int32_t x = 0; x < width; ++x)
+		{
+			size_t p = row + x;
+
+			// Variance of the pixel mean from the two luminance moments.
+			float mean = luminance(illumination[p]);
+			variance[p] = std::max(0.0f, features[p].y - mean * mean) / static_cast<float>(std::max(samples - 1, 1));
+
+			// Albedo is taken out of the color and put back after filtering; channels without albedo stay as they are.
+			Vector3D<float>& a = albedos[p];
+
+			illumination[p].x /= (a.x > 0.01f) ? a.x : 1.0f;
+			illumination[p].y /= (a.y > 0.01f) ? a.y : 1.0f;
+			illumination[p].z /= (a.z > 0.01f) ? a.z : 1.0f;
+		}
+	});
+
+	std::vector<Vector3D<float>> filtered(pixelCount);
+	std::vector<float> filteredVariance(pixelCount);
+	std::vector<float> smoothVariance(pixelCount);
+
+	for (int32_t pass = 0; pass < 5; ++pass)
+	{
+		const int32_t step = 1 << pass;
+
+		// The variance of a single pixel is itself noisy: the luminance tolerance uses a 3x3 Gaussian blur of it.
+		parallelRows(height, threads, [&](int32_t y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				float sum = 0.0f;
+				float weightSum = 0.0f;
+
+				for (int32_t dy = -1; dy <= 1; ++dy)
+				{
+					for (int32_t dx = -1; dx <= 1; ++dx)
+					{
+						int32_t qx = x + dx;
+						int32_t qy = y + dy;
+
+						if (qx < 0 || qx >= width || qy < 0 || qy >= height) { continue; }
+
+						float weight = kernel[dx + 2] * kernel[dy + 2];
+
+						sum += variance[static_cast<size_t>(qy) * width + qx] * weight;
+						weightSum += weight;
+					}
+				}
+
+				smoothVariance[static_cast<size_t>(y) * width + x] = sum / weightSum;
+			}
+		});
+
+		parallelRows(height, threads, [&](int32_t y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				size_t p = static_cast<size_t>(y) * width + x;
+
+				const Vector3D<float>& np = normals[p];
+				const Vector3D<float>& ap = albedos[p];
+				float zp = features[p].x;
+				float lp = luminance(illumination[p]);
+
+				float luminanceScale = 1.0f / (sigmaLuminance * std::sqrt(smoothVariance[p]) + 1e-4f);
+
+				Vector3D<float> sum;
+				float weightSum = 0.0f;
+				float varianceSum = 0.0f;
+
+				for (int32_t dy = -2; dy <= 2; ++dy)
+				{
+					int32_t qy = y + dy * step;
+
+					if (qy < 0 || qy >= height) { continue; }
+
+					for (int32_t dx = -2; dx <= 2; ++dx)
+					{
+						int32_t qx = x + dx * step;
+
+						if (qx < 0 || qx >= width) { continue; }
+
+						size_t q = static_cast<size_t>(qy) * width + qx;
+
+						float weight = kernel[dx + 2] * kernel[dy + 2];
+
+						if (q != p)
+						{
+							const Vector3D<float>& nq = normals[q];
+
+							// cos^128 by repeated squaring; two escaped rays (no normal) count as alike.
+							float normalWeight = 1.0f;
+
+							if (np * np > 1e-4f || nq * nq > 1e-4f)
+							{
+								normalWeight = std::max(0.0f, np * nq);
+
+								for (int32_t k = 0; k < 7; ++k) { normalWeight *= normalWeight; }
+							}
+
+							Vector3D<float> albedoDifference = ap - albedos[q];
+
+							float distance = step * std::sqrt(static_cast<float>(dx * dx + dy * dy));
+
+							float exponent = std::abs(zp - features[q].x) / (sigmaDepth * zp * distance + 1e-4f)
+								+ (albedoDifference * albedoDifference) / (sigmaAlbedo * sigmaAlbedo)
+								+ std::abs(lp - luminance(illumination[q])) * luminanceScale;
+
+							weight *= normalWeight * std::exp(-exponent);
+						}
+
+						sum += illumination[q] * weight;
+						weightSum += weight;
+						varianceSum += weight * weight * variance[q];
+					}
+				}
+
+				// The center tap always contributes, so the sum of weights is positive.
+				filtered[p] = sum / weightSum;
+				filteredVariance[p] = varianceSum / (weightSum * weightSum);
+			}
+		});
+
+		illumination.swap(filtered);
+		variance.swap(filteredVariance);
+	}
+
+	parallelRows(height, threads, [&](int32_t y)
+	{
+		size_t row = static_cast<size_t>(y) * width;
+
+		for (int32_t x = 0; x < width; ++x)
+		{
+			size_t p = row + x;
+			const Vector3D<float>& a = albedos[p];
+
+			illumination[p].x *= (a.x > 0.01f) ? a.x : 1.0f;
+			illumination[p].y *= (a.y > 0.01f) ? a.y : 1.0f;
+			illumination[p].z *= (a.z > 0.01f) ? a.z : 1.0f;
+		}
+
+		color.setRow(y, &illumination[row]);
+	});
+}
\ No newline at end of file
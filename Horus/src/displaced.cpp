@@ -0,0 +1,210 @@
+#include "displaced.h"
+
+DisplacedSurfaceObject::DisplacedSurfaceObject() : GeometryObject(GeometryType::DISPLACED), cache(64 * 1024 * 1024)
+{
+	position = Vector3D<float>(0.0f, 0.0f, 0.0f);
+	rotation = Vector3D<float>(0.0f, 0.0f, 0.0f);
+
+	size = 1.0f;
+
+	updatePatches();
+}
+
+// Returns the object space point of the displaced surface at (u, v) in [0, 1]^2.
+Vector3D<float> DisplacedSurfaceObject::evaluate(float u, float v) const
+{
+	float phi = 2.0f * PI * u;
+	float theta = PI * v;
+
+	Vector3D<float> n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+	float height = std::sin(frequency * n.x) * std::sin(frequency * n.y) * std::sin(frequency * n.z);
+
+	return n * (size + displacement * height);
+}
+
+// Recomputes the coarse patch bounds. Each bound encloses the patch swept between the lowest and highest possible displacement,
+// padded by the chord sag between the samples, so it is conservative without tessellating anything.
+void DisplacedSurfaceObject::updatePatches()
+{
+	cache.clear();
+
+	patchBounds.resize(patchesU * patchesV);
+
+	const int32_t samples = 8;
+
+	float innerRadius = std::max(0.0f, size - std::fabs(displacement));
+	float outerRadius = size + std::fabs(displacement);
+
+	float step = std::max(2.0f * PI / (patchesU * samples), PI / (patchesV * samples));
+	float sag = outerRadius * (1.0f - std::cos(step * 0.5f)) + 1e-4f;
+
+	for (int32_t pv = 0; pv < patchesV; ++pv)
+	{
+		for (int32_t pu = 0; pu < patchesU; ++pu)
+		{
+			BoundingBox bounds;
+			bool first = true;
+
+			for (int32_t j = 0; j <= samples; ++j)
+			{
+				for (int32_t i = 0; i <= samples; ++i)
+				{
+					float phi = 2.0f * PI * (pu + static_cast<float>(i) / samples) / patchesU;
+					float theta = PI * (pv + static_cast<float>(j) / samples) / patchesV;
+
+					Vector3D<float> n(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+					BoundingBox b(n * innerRadius, n * outerRadius);
+					b = BoundingBox(Vector3D<float>(std::min(b.getMin().x, b.getMax().x), std::min(b.getMin().y, b.getMax().y), std::min(b.getMin().z, b.getMax().z)),
+					                Vector3D<float>(std::max(b.getMin().x, b.getMax().x), std::max(b.getMin().y, b.getMax().y), std::max(b.getMin().z, b.getMax().z)));
+
+					bounds = first ? b : bounds + b;
+					first = false;
+				}
+			}
+
+			bounds.setMin(bounds.getMin() - Vector3D<float>(sag, sag, sag));
+			bounds.setMax(bounds.getMax() + Vector3D<float>(sag, sag, sag));
+
+			patchBounds[pv * patchesU + pu] = bounds;
+		}
+	}
+
+	patchBVH.build(patchBounds, 1);
+
+	setBoundingBox();
+}
+
+// Tessellates one patch into a (resolution x resolution) grid of quads and builds its micro BVH. Called by the cache on a miss.
+std::shared_ptr<TessellatedPatch> DisplacedSurfaceObject::tessellate(uint32_t patch) const
+{
+	int32_t pu = patch % patchesU;
+	int32_t pv = patch / patchesU;
+
+	std::shared_ptr<TessellatedPatch> tessellated = std::make_shared<TessellatedPatch>();
+
+	int32_t n = resolution;
+
+	tessellated->vertices.reserve((n + 1) * (n + 1));
+	tessellated->indices.reserve(6 * n * n);
+
+	for (int32_t j = 0; j <= n; ++j)
+	{
+		for (int32_t i = 0; i <= n; ++i)
+		{
+			float u = (pu + static_cast<float>(i) / n) / patchesU;
+			float v = (pv + static_cast<float>(j) / n) / patchesV;
+
+			tessellated->vertices.push_back(evaluate(u, v));
+		}
+	}
+
+	std::vector<BoundingBox> triangleBounds;
+	triangleBounds.reserve(2 * n * n);
+
+	for (int32_t j = 0; j < n; ++j)
+	{
+		for (int32_t i = 0; i < n; ++i)
+		{
+			uint32_t a = j * (n + 1) + i;
+			uint32_t b = a + 1;
+			uint32_t c = a + (n + 1);
+			uint32_t d = c + 1;
+
+			uint32_t quad[6] = { a, c, b, b, c, d };
+
+			for (int32_t t = 0; t < 2; ++t)
+			{
+				const Vector3D<float>& v0 = tessellated->vertices[quad[3 * t]];
+				const Vector3D<float>& v1 = tessellated->vertices[quad[3 * t + 1]];
+				const Vector3D<float>& v2 = tessellated->vertices[quad[3 * t + 2]];
+
+				tessellated->indices.insert(tessellated->indices.end(), quad + 3 * t, quad + 3 * t + 3);
+
+				triangleBounds.emplace_back(Vector3D<float>(std::min({ v0.x, v1.x, v2.x }), std::min({ v0.y, v1.y, v2.y }), std::min({ v0.z, v1.z, v2.z })),
+				                            Vector3D<float>(std::max({ v0.x, v1.x, v2.x }), std::max({ v0.y, v1.y, v2.y }), std::max({ v0.z, v1.z, v2.z })));
+			}
+		}
+	}
+
+	tessellated->bvh.build(triangleBounds);
+
+	return tessellated;
+}
+
+void DisplacedSurfaceObject::setBoundingBox()
+{
+	BoundingBox local = patchBVH.getBounds();
+
+	boundingBox.setMin(local.getMin() + position);
+	boundingBox.setMax(local.getMax() + position);
+
+	boundingBox.computeCentroid();
+}
+
+// Walks the BVH over the patch bounds and traces the micro BVH of every patch the ray enters, tessellating it on first use.
+bool DisplacedSurfaceObject::rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit)
+{
+	Ray localRay(ray.origin - position, ray.direction);
+
+	float closestT = tMax;
+	Vector3D<float> localNormal;
+	uint32_t closestPatch = 0;
+
+	bool found = patchBVH.traversal(localRay, tMin, closestT, [&](uint32_t patch, float t0, float t1)
+	{
+		std::shared_ptr<const TessellatedPatch> tessellated = cache.get(patch, [&]() { return tessellate(patch); });
+
+		const std::vector<Vector3D<float>>& v = tessellated->vertices;
+		const std::vector<uint32_t>& idx = tessellated->indices;
+
+		float patchT = t1;
+
+		bool patchHit = tessellated->bvh.traversal(localRay, t0, patchT, [&](uint32_t triangle, float u0, float u1)
+		{
+			const Vector3D<float>& v0 = v[idx[3 * triangle]];
+			const Vector3D<float>& v1 = v[idx[3 * triangle + 1]];
+			const Vector3D<float>& v2 = v[idx[3 * triangle + 2]];
+
+			float t = intersectTriangle(localRay.origin, localRay.direction, v0, v1, v2, u0, u1);
+
+			if (t >= 0.0f)
+			{
+				localNormal = (v1 - v0) | (v2 - v0);
+				closestPatch = patch;
+			}
+
+			return t;
+		});
+
+		return patchHit ? patchT : -1.0f;
+	});
+
+	if (!found)
+	{
+		return false;
+	}
+
+	hit.front = (localNormal * localRay.direction) < 0.0f;
+	hit.back = !hit.front;
+
+	hit.normal = hit.front ? localNormal : -localNormal;
+	hit.normal.normalize();
+
+	hit.hitPoint = ray.getPointat(closestT);
+	hit.t = closestT;
+	hit.primitive = closestPatch;
+
+	return true;
+}
+
+// Reports how many patches were tessellated and how often they were reused.
+void DisplacedSurfaceObject::printStatistics()
+{
+	std::cout << getObjectName() << " tessellation cache: "
+	          << cache.getMisses() << " patches tessellated, " << cache.getHits() << " reuses, "
+	          << cache.getEvictions() << " evictions, "
+	          << cache.getEntryCount() << " of " << patchBounds.size() << " patches resident ("
+	          << cache.getMemoryUsage() / 1024 << " / " << cache.getCapacity() / 1024 << " KB)" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "film.h"
+#include <cmath>
+#include <iostream>
+#include <algorithm>
+
+static const float gaussianAlpha = 2.0f;
+
+Filter::Filter(FilterType type, float radius) : type(type), radius(radius)
+{
+	if (this->radius <= 0.0f)
+	{
+		switch (type)
+		{
+			case FilterType::TENT: this->radius = 1.0f; break;
+			case FilterType::GAUSSIAN: this->radius = 1.5f; break;
+			case FilterType::MITCHELL: this->radius = 2.0f; break;
+			default: this->radius = 0.5f; break;
+		}
+	}
+
+	gaussianEdge = std::exp(-gaussianAlpha * this->radius * this->radius);
+}
+
+float Filter::evaluate1D(float x) const
+{
+	x = std::abs(x);
+
+	// The box keeps its edge, so a sample on the border of two pixels is not lost; the other filters are 0 there.
+	if (x > radius)
+	{
+		return 0.0f;
+	}
+
+	switch (type)
+	{
+		case FilterType::TENT:
+			return radius - x;
+
+		case FilterType::GAUSSIAN:
+			return std::exp(-gaussianAlpha * x * x) - gaussianEdge;
+
+		case FilterType::MITCHELL:
+		{
+			// The cubic spans [-2, 2], stretched over the radius.
+			const float B = 1.0f / 3.0f;
+			const float C = 1.0f / 3.0f;
+
+			x = 2.0f * x / radius;
+
+			if (x > 1.0f)
+			{
+				return ((-B - 6.0f * C) * x * x * x + (6.0f * B + 30.0f * C) * x * x + (-12.0f * B - 48.0f * C) * x + (8.0f * B + 24.0f * C)) / 6.0f;
+			}
+
+			return ((12.0f - 9.0f * B - 6.0f * C) * x * x * x + (-18.0f + 12.0f * B + 6.0f * C) * x * x + (6.0f - 2.0f * B)) / 6.0f;
+		}
+
+		default:
+			return 1.0f;
+	}
+}
+
+bool stringToFilterType(std::string_view name, FilterType& type)
+{
+	if (name == "box") { type = FilterType::BOX; return true; }
+	if (name == "tent") { type = FilterType::TENT; return true; }
+	if (name == "gaussian") { type = FilterType::GAUSSIAN; return true; }
+	if (name == "mitchell") { type = FilterType::MITCHELL; return true; }
+
+	std::cout << "Unknown filter: " << name << " (box, tent, gaussian or mitchell)" << std::endl;
+
+	return false;
+}
+
+void Film::resize(int32_t width, int32_t height)
+{
+	framebuffer.resize(width, height, true);
+	tileLocks = std::make_unique<std::mutex[]>(static_cast<size_t>(framebuffer.getTilesX()) * framebuffer.getTilesY());
+}
+
+void Film::addSample(float x, float y, const Vector3D<float>& radiance)
+{
+	// Pixels whose center (i + 0.5) is within the radius.
+	const float radius = filter.getRadius();
+
+	int32_t x0 = std::max(0, static_cast<int32_t>(std::ceil(x - 0.5f - radius)));
+	int32_t y0 = std::max(0, static_cast<int32_t>(std::ceil(y - 0.5f - radius)));
+	int32_t x1 = std::min(framebuffer.getWidth() - 1, static_cast<int32_t>(std::floor(x - 0.5f + radius)));
+	int32_t y1 = std::min(framebuffer.getHeight() - 1, static_cast<int32_t>(std::floor(y - 0.5f + radius)));
+
+	if (x0 > x1 || y0 > y1)
+	{
+		return;
+	}
+
+	// The footprint is at most 2 * radius + 1 pixels wide; the weights along each axis are evaluated once.
+	const int32_t maxFootprint = 16;
+
+	float weightsX[maxFootprint];
+	float weightsY[maxFootprint];
+
+	x1 = std::min(x1, x0 + maxFootprint - 1);
+	y1 = std::min(y1, y0 + maxFootprint - 1);
+
+	for (int32_t i = x0; i <= x1; ++i)
+	{
+		weightsX[i - x0] = filter.evaluate1D(i + 0.5f - x);
+	}
+
+	for (int32_t j = y0; j <= y1; ++j)
+	{
+		weightsY[j - y0] = filter.evaluate1D(j + 0.5f - y);
+	}
+
+	const int32_t tileSize = Framebuffer::tileSize;
+
+	for (int32_t tileY = y0 / tileSize; tileY <= y1 / tileSize; ++tileY)
+	{
+		for (int32_t tileX = x0 / tileSize; tileX <= x1 / tileSize; ++tileX)
+		{
+			std::lock_guard<std::mutex> lock(tileLocks[static_cast<size_t>(tileY) * framebuffer.getTilesX() + tileX]);
+
+			for (int32_t j = std::max(y0, tileY * tileSize); j <= std::min(y1, tileY * tileSize + tileSize - 1); ++j)
+			{
+				for (int32_t i = std::max(x0, tileX * tileSize); i <= std::min(x1, tileX * tileSize + tileSize - 1); ++i)
+				{
+					float weight = weightsX[i - x0] * weightsY[j - y0];
+
+					if (weight != 0.0f)
+					{
+						framebuffer.accumulate(i, j, radiance, weight);
+					}
+				}
+			}
+		}
+	}
+}
\ No newline at end of file
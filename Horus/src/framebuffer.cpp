@@ -0,0 +1,135 @@
+#include "framebuffer.h"
+#include <algorithm>
+#include <istream>
+#include <ostream>
+
+void Framebuffer::resize(int32_t width, int32_t height, bool weighted)
+{
+	this->width = width;
+	this->height = height;
+
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+
+	// Edge tiles are allocated whole, so every tile has the same size and offset computation.
+	size_t size = static_cast<size_t>(tilesX) * tilesY * tileSize * tileSize;
+
+	// Only one of the two color buffers is allocated; shrink_to_fit releases the other after a change of storage.
+	pixels.assign(halfPrecision ? 0 : size, Vector3D<float>());
+	halfPixels.assign(halfPrecision ? size * 3 : 0, 0);
+	pixels.shrink_to_fit();
+	halfPixels.shrink_to_fit();
+
+	weights.assign(weighted ? size : 0, 0.0f);
+}
+
+void Framebuffer::clear()
+{
+	std::fill(pixels.begin(), pixels.end(), Vector3D<float>());
+	std::fill(halfPixels.begin(), halfPixels.end(), 0);
+	std::fill(weights.begin(), weights.end(), 0.0f);
+}
+
+size_t Framebuffer::getMemorySize() const
+{
+	return pixels.size() * sizeof(Vector3D<float>) + halfPixels.size() * sizeof(uint16_t) + weights.size() * sizeof(float);
+}
+
+Vector3D<float> Framebuffer::get(int32_t x, int32_t y) const
+{
+	size_t i = index(x, y);
+
+	if (halfPrecision)
+	{
+		Vector3D<float> color;
+		halvesToFloats(&halfPixels[i * 3], &color.x, 3);
+
+		// The weighted half storage already holds the mean.
+		return color;
+	}
+
+	if (weights.empty())
+	{
+		return pixels[i];
+	}
+
+	return (weights[i] > 0.0f) ? pixels[i] / weights[i] : Vector3D<float>();
+}
+
+void Framebuffer::getRow(int32_t y, Vector3D<float>* row) const
+{
+	// A row crosses tilesX tiles and is contiguous within each of them.
+	for (int32_t tx = 0; tx < tilesX; ++tx)
+	{
+		int32_t x0 = tx * tileSize;
+		int32_t count = std::min(tileSize, width - x0);
+
+		size_t i = index(x0, y);
+
+		if (halfPrecision)
+		{
+			halvesToFloats(&halfPixels[i * 3], &row[x0].x, static_cast<size_t>(count) * 3);
+		}
+		else if (weights.empty())
+		{
+			std::copy(pixels.begin() + i, pixels.begin() + i + count, row + x0);
+		}
+		else
+		{
+			for (int32_t x = 0; x < count; ++x)
+			{
+				row[x0 + x] = (weights[i + x] > 0.0f) ? pixels[i + x] / weights[i + x] : Vector3D<float>();
+			}
+		}
+	}
+}
+
+void Framebuffer::setRow(int32_t y, const Vector3D<float>* row)
+{
+	for (int32_t tx = 0; tx < tilesX; ++tx)
+	{
+		int32_t x0 = tx * tileSize;
+		int32_t count = std::min(tileSize, width - x0);
+
+		size_t i = index(x0, y);
+
+		if (halfPrecision)
+		{
+			floatsToHalves(&row[x0].x, &halfPixels[i * 3], static_cast<size_t>(count) * 3);
+		}
+		else
+		{
+			std::copy(row + x0, row + x0 + count, pixels.begin() + i);
+		}
+	}
+}
+
+bool Framebuffer::write(std::ostream& stream) const
+{
+	int32_t layout[4] = { width, height, halfPrecision ? 1 : 0, isWeighted() ? 1 : 0 };
+
+	stream.write(reinterpret_cast<const char*>(layout), sizeof(layout));
+	stream.write(reinterpret_cast<const char*>(pixels.data()), pixels.size() * sizeof(Vector3D<float>));
+	stream.write(reinterpret_cast<const char*>(halfPixels.data()), halfPixels.size() * sizeof(uint16_t));
+	stream.write(reinterpret_cast<const char*>(weights.data()), weights.size() * sizeof(float));
+
+	return static_cast<bool>(stream);
+}
+
+bool Framebuffer::read(std::istream& stream)
+{
+	int32_t layout[4] = {};
+
+	stream.read(reinterpret_cast<char*>(layout), sizeof(layout));
+
+	if (!stream || layout[0] != width || layout[1] != height || layout[2] != (halfPrecision ? 1 : 0) || layout[3] != (isWeighted() ? 1 : 0))
+	{
+		return false;
+	}
+
+	stream.read(reinterpret_cast<char*>(pixels.data()), pixels.size() * sizeof(Vector3D<float>));
+	stream.read(reinterpret_cast<char*>(halfPixels.data()), halfPixels.size() * sizeof(uint16_t));
+	stream.read(reinterpret_cast<char*>(weights.data()), weights.size() * sizeof(float));
+
+	return static_cast<bool>(stream);
+}
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "generator.h"
+#include "hrs.h"
+#include "scene.h"
+#include <cmath>
+#include <chrono>
+#include <charconv>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+
+// PCG32 (O'Neill); used instead of <random> because the standard distributions are not required to give the same values on every library.
+class GeneratorRandom
+{
+	public:
+		GeneratorRandom(uint64_t seed) : state(0), increment((seed << 1u) | 1u)
+		{
+			next();
+			state += seed;
+			next();
+		}
+
+		uint32_t next()
+		{
+			uint64_t old = state;
+			state = old * 6364136223846793005ULL + increment;
+
+			uint32_t shifted = static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+			uint32_t rotation = static_cast<uint32_t>(old >> 59u);
+
+			return (shifted >> rotation) | (shifted << ((~rotation + 1u) & 31));
+		}
+
+		// Uniform in [0, 1).
+		float unit() { return static_cast<float>(next() >> 8) * (1.0f / 16777216.0f); }
+
+		float range(float min, float max) { return min + (max - min) * unit(); }
+
+		// Standard normal sample (Box-Muller).
+		float normal()
+		{
+			float u1 = std::max(unit(), 1e-7f);
+			float u2 = unit();
+
+			return std::sqrt(-2.0f * std::log(u1)) * std::cos(6.2831853f * u2);
+		}
+
+	private:
+		uint64_t state;
+		uint64_t increment;
+};
+
+// Appends the shortest text that reads back as 'value'.
+static void appendFloat(std::string& text, float value)
+{
+	char buffer[32];
+	std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+
+	text.append(buffer, result.ptr - buffer);
+}
+
+static void appendVector(std::string& text, const char* parameter, float x, float y, float z)
+{
+	text += '-';
+	text += parameter;
+	text += "- /";
+	appendFloat(text, x);
+	text += ',';
+	appendFloat(text, y);
+	text += ',';
+	appendFloat(text, z);
+	text += "/\n";
+}
+
+static void appendValue(std::string& text, const char* parameter, float value)
+{
+	text += '-';
+	text += parameter;
+	text += "- /";
+	appendFloat(text, value);
+	text += "/\n";
+}
+
+bool stringToDistribution(std::string_view name, SceneDistribution& distribution)
+{
+	if (name == "uniform") { distribution = SceneDistribution::UNIFORM; return true; }
+	if (name == "clustered") { distribution = SceneDistribution::CLUSTERED; return true; }
+	if (name == "coincident") { distribution = SceneDistribution::COINCIDENT; return true; }
+
+	std::cout << "Unknown scene distribution: " << name << " (uniform, clustered or coincident)" << std::endl;
+
+	return false;
+}
+
+const char* distributionToString(SceneDistribution distribution)
+{
+	switch (distribution)
+	{
+		case SceneDistribution::UNIFORM: return "uniform";
+		case SceneDistribution::CLUSTERED: return "clustered";
+		case SceneDistribution::COINCIDENT: return "coincident";
+		default: return "unknown";
+	}
+}
+
+bool generateScene(const std::string& filePath, const GeneratorSettings& settings)
+{
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "Could not open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	GeneratorRandom random(settings.seed);
+
+	// The scene occupies a cube of side 'extent' in front of the camera; the side grows with the cube root of the count so the
+	// uniform distribution keeps about one geometry per 8 units of volume at every size.
+	float extent = 2.0f * std::cbrt(static_cast<float>(std::max<uint64_t>(settings.count, 1)));
+	float center = -0.5f * extent;
+
+	std::string text;
+	text.reserve(1 << 20);
+
+	text += "(perspective)\n";
+	appendVector(text, "pos", 0.0f, 0.0f, 0.75f * extent);
+	appendVector(text, "rot", 0.0f, 0.0f, 0.0f);
+	text += "-window- /" + std::to_string(settings.width) + "," + std::to_string(settings.height) + "/\n;\n";
+
+	text += "(dome)\n";
+	appendVector(text, "color", 0.7f, 0.8f, 1.0f);
+	appendValue(text, "intensity", 1.0f);
+	text += ";\n";
+
+	// Cluster centers, and a spread that keeps the clusters well apart from each other.
+	std::vector<Vector3D<float>> clusters;
+	float clusterSpread = 0.0f;
+
+	if (settings.distribution == SceneDistribution::CLUSTERED)
+	{
+		uint32_t clusterCount = std::max<uint32_t>(1, static_cast<uint32_t>(std::cbrt(static_cast<float>(settings.count)) * 0.5f));
+
+		for (uint32_t i = 0; i < clusterCount; ++i)
+		{
+			clusters.emplace_back(random.range(-0.5f, 0.5f) * extent, random.range(-0.5f, 0.5f) * extent, center + random.range(-0.5f, 0.5f) * extent);
+		}
+
+		clusterSpread = 0.1f * extent / std::cbrt(static_cast<float>(clusterCount));
+	}
+
+	for (uint64_t i = 0; i < settings.count; ++i)
+	{
+		Vector3D<float> position(0.0f, 0.0f, center);
+
+		switch (settings.distribution)
+		{
+			case SceneDistribution::UNIFORM:
+				position = Vector3D<float>(random.range(-0.5f, 0.5f) * extent, random.range(-0.5f, 0.5f) * extent, center + random.range(-0.5f, 0.5f) * extent);
+				break;
+
+			case SceneDistribution::CLUSTERED:
+			{
+				const Vector3D<float>& cluster = clusters[random.next() % clusters.size()];
+
+				position = Vector3D<float>(cluster.x + random.normal() * clusterSpread, cluster.y + random.normal() * clusterSpread, cluster.z + random.normal() * clusterSpread);
+				break;
+			}
+
+			case SceneDistribution::COINCIDENT:
+			default:
+				break;
+		}
+
+		bool plane = settings.planeInterval != 0 && (i % settings.planeInterval) == settings.planeInterval - 1;
+
+		if (plane)
+		{
+			text += "(plane)\n";
+			appendVector(text, "pos", position.x, position.y, position.z);
+			appendVector(text, "rot", random.range(-180.0f, 180.0f), random.range(-180.0f, 180.0f), 0.0f);
+			appendValue(text, "width", random.range(0.5f, 1.5f));
+			appendValue(text, "height", random.range(0.5f, 1.5f));
+		}
+		else
+		{
+			// Coincident spheres are nested, so their radii spread over the whole scene instead of the usual small range.
+			float radius = (settings.distribution == SceneDistribution::COINCIDENT) ? random.range(0.25f, 0.5f * extent) : random.range(0.25f, 0.5f);
+
+			text += "(sphere)\n";
+			appendVector(text, "pos", position.x, position.y, position.z);
+			appendValue(text, "radius", radius);
+		}
+
+		text += ";\n";
+
+		if (text.size() > (1 << 20) - 256)
+		{
+			file.write(text.data(), text.size());
+			text.clear();
+		}
+	}
+
+	file.write(text.data(), text.size());
+
+	if (!file)
+	{
+		std::cout << "Failed writing " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool runScalingBenchmark(SceneDistribution distribution, uint64_t maxCount, const std::string& resultsPath)
+{
+	std::ofstream results;
+
+	if (!resultsPath.empty())
+	{
+		bool newFile = !std::filesystem::exists(resultsPath);
+
+		results.open(resultsPath, std::ios::app);
+
+		if (!results)
+		{
+			std::cout << "Could not open " << resultsPath << " for writing" << std::endl;
+			return false;
+		}
+
+		if (newFile)
+		{
+			results << "distribution,geometries,file_mb,parse_ms,bvh_ms,bvh_nodes,render_ms" << std::endl;
+		}
+	}
+
+	std::filesystem::path directory = std::filesystem::temp_directory_path();
+
+	std::cout << "Scaling benchmark (" << distributionToString(distribution) << ")" << std::endl;
+
+	for (uint64_t count = 1000; count <= maxCount; count *= 10)
+	{
+		GeneratorSettings settings;
+		settings.count = count;
+		settings.distribution = distribution;
+		settings.width = 64;
+		settings.height = 36;
+
+		std::string name = std::string("horus_benchmark_") + distributionToString(distribution) + "_" + std::to_string(count);
+		std::string scenePath = (directory / (name + ".hrs")).string();
+		std::string imagePath = (directory / (name + ".ppm")).string();
+
+		if (!generateScene(scenePath, settings))
+		{
+			return false;
+		}
+
+		double fileSize = static_cast<double>(std::filesystem::file_size(scenePath)) / (1024.0 * 1024.0);
+
+		double parseTime = 0.0;
+		double bvhTime = 0.0;
+		double renderTime = 0.0;
+		size_t nodes = 0;
+
+		{
+			auto t0 = std::chrono::steady_clock::now();
+
+			std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+
+			if (!SceneBuilder(scenePath, sceneObjects))
+			{
+				return false;
+			}
+
+			auto t1 = std::chrono::steady_clock::now();
+
+			Scene scene;
+			scene.setFilePathWrite(imagePath);
+			scene.getScene(sceneObjects);
+			scene.buildAccelerator();
+
+			auto t2 = std::chrono::steady_clock::now();
+
+			scene.render();
+
+			auto t3 = std::chrono::steady_clock::now();
+
+			parseTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+			bvhTime = std::chrono::duration<double, std::milli>(t2 - t1).count();
+			renderTime = std::chrono::duration<double, std::milli>(t3 - t2).count();
+			nodes = scene.getBVH().getNodes().size();
+		}
+
+		std::filesystem::remove(scenePath);
+		std::filesystem::remove(imagePath);
+
+		std::cout << count << " geometries (" << fileSize << " MB): parse " << parseTime << " ms, BVH " << bvhTime << " ms (" << nodes << " nodes), render " << renderTime << " ms" << std::endl;
+
+		if (results.is_open())
+		{
+			results << distributionToString(distribution) << "," << count << "," << fileSize << "," << parseTime << "," << bvhTime << "," << nodes << "," << renderTime << std::endl;
+		}
+	}
+
+	return true;
+}
\ No newline at end of file
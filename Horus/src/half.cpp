@@ -0,0 +1,172 @@
+#include "half.h"
+#include <cstring>
+
+// The F16C kernels are compiled for F16C whatever the target flags of the build, and only called once CPUID reports it:
+// MSVC accepts the intrinsics without /arch, GCC and Clang get a per function target attribute.
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define HORUS_F16C
+#define F16C_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define HORUS_F16C
+#define F16C_TARGET __attribute__((target("f16c")))
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+static uint32_t floatBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+static float bitsToFloat(uint32_t bits)
+{
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits = floatBits(value);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	// 65536 and up, infinity, NaN (kept quiet).
+	if (magnitude >= (127u + 16) << 23)
+	{
+		return static_cast<uint16_t>(sign | ((magnitude > 0x7F800000) ? 0x7E00 : 0x7C00));
+	}
+
+	// Below the smallest normal half: adding 0.5 lines the half subnormal step up with the last float mantissa bit, and the
+	// float addition does the rounding.
+	if (magnitude < (127u - 14) << 23)
+	{
+		const uint32_t magic = (127u - 1) << 23;
+
+		return static_cast<uint16_t>(sign | (floatBits(bitsToFloat(magnitude) + bitsToFloat(magic)) - magic));
+	}
+
+	// Rebias the exponent and round the 13 dropped bits to nearest even; a carry into the exponent is the correct result,
+	// up to infinity for values from 65520.
+	magnitude += ((15u - 127) << 23) + 0xFFF + ((magnitude >> 13) & 1);
+
+	return static_cast<uint16_t>(sign | (magnitude >> 13));
+}
+
+float halfToFloat(uint16_t value)
+{
+	const uint32_t exponentMask = 0x7C00u << 13;
+
+	uint32_t bits = (value & 0x7FFFu) << 13;
+	uint32_t exponent = bits & exponentMask;
+
+	bits += (127u - 15) << 23;
+
+	if (exponent == exponentMask)
+	{
+		// Infinity or NaN.
+		bits += (128u - 16) << 23;
+	}
+	else if (exponent == 0)
+	{
+		// Zero or subnormal: renormalized by a float subtraction.
+		bits += 1u << 23;
+		bits = floatBits(bitsToFloat(bits) - bitsToFloat(113u << 23));
+	}
+
+	return bitsToFloat(bits | ((value & 0x8000u) << 16));
+}
+
+#ifdef HORUS_F16C
+// F16C instructions are VEX encoded, so the OS has to save the AVX state as well.
+static bool detectF16C()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+
+	const int required = (1 << 27) | (1 << 28) | (1 << 29);	// OSXSAVE, AVX, F16C
+
+	return (info[2] & required) == required && (_xgetbv(0) & 6) == 6;
+#else
+	unsigned int eax, ebx, ecx, edx;
+
+	return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_F16C) && __builtin_cpu_supports("avx");
+#endif
+}
+
+static const bool f16cSupported = detectF16C();
+
+F16C_TARGET static size_t floatsToHalvesF16C(const float* values, uint16_t* halves, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(halves + i), _mm_cvtps_ph(_mm_loadu_ps(values + i), _MM_FROUND_TO_NEAREST_INT));
+	}
+
+	return i;
+}
+
+F16C_TARGET static size_t halvesToFloatsF16C(const uint16_t* halves, float* values, size_t count)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_storeu_ps(values + i, _mm_cvtph_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(halves + i))));
+	}
+
+	return i;
+}
+#endif
+
+void floatsToHalves(const float* values, uint16_t* halves, size_t count)
+{
+	size_t i = 0;
+
+#ifdef HORUS_F16C
+	if (f16cSupported)
+	{
+		i = floatsToHalvesF16C(values, halves, count);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		halves[i] = floatToHalf(values[i]);
+	}
+}
+
+void halvesToFloats(const uint16_t* halves, float* values, size_t count)
+{
+	size_t i = 0;
+
+#ifdef HORUS_F16C
+	if (f16cSupported)
+	{
+		i = halvesToFloatsF16C(halves, values, count);
+	}
+#endif
+
+	for (; i < count; ++i)
+	{
+		values[i] = halfToFloat(halves[i]);
+	}
+}
+
+bool hasF16C()
+{
+#ifdef HORUS_F16C
+	return f16cSupported;
+#else
+	return false;
+#endif
+}
\ No newline at end of file
@@ -1,8 +1,13 @@
 #include "hrs.h"
-#include <fstream>
-#include <sstream>
-
-std::unordered_map<std::string, ParameterType> parameterMap = {
+#include "mesh.h"
+#include "particles.h"
+#include "paged_mesh.h"
+#include "displaced.h"
+#include "reference.h"
+#include "mapped_file.h"
+#include <thread>
+
+std::unordered_map<std::string_view, ParameterType> parameterMap = {
 	{"pos", ParameterType::POSITION},
 	{"rot", ParameterType::ROTATION},
 	{"size", ParameterType::SIZE},
@@ -16,20 +21,35 @@ std::unordered_map<std::string, ParameterType> parameterMap = {
 	{"roughness", ParameterType::ROUGHNESS},
 	{"lat", ParameterType::LAT},
 	{"window", ParameterType::WINDOW},
-	{"shader", ParameterType::SHADER}
+	{"shader", ParameterType::SHADER},
+	{"file", ParameterType::FILE},
+	{"cache", ParameterType::CACHE},
+	{"displacement", ParameterType::DISPLACEMENT},
+	{"frequency", ParameterType::FREQUENCY},
+	{"resolution", ParameterType::RESOLUTION},
+	{"bounds", ParameterType::BOUNDS}
+};
+
+const std::unordered_map<std::string_view, GeometryType> GeometryObjectsMap = 
+{
+	{ "sphere", GeometryType::SPHERE },
+	{ "plane", GeometryType::PLANE },
+	{ "mesh", GeometryType::MESH },
+	{ "particles", GeometryType::PARTICLES },
+	{ "pagedmesh", GeometryType::PAGED_MESH },
+	{ "displaced", GeometryType::DISPLACED },
+	{ "reference", GeometryType::REFERENCE }
 };
 
-std::unordered_map<std::string_view, ShaderType> shaderTypeMap = {
-	{"constant", ShaderType::CONSTANT},
-	{"depth", ShaderType::DEPTH},
-	{"surface", ShaderType::SURFACE},
+const std::unordered_map<std::string_view, LightType> LightObjectsMap =
+{
+	{ "point", LightType::POINT },
+	{ "dome", LightType::DOME }
 };
 
-std::unordered_map<std::string_view, ShaderParameterType> shaderParameterMap = {
-	{"color", ShaderParameterType::COLOR},
-	{"diffuse_gain", ShaderParameterType::DIFFUSE_GAIN},
-	{"diffuse_color", ShaderParameterType::DIFFUSE_COLOR},
-	{"roughness", ShaderParameterType::ROUGHNESS}
+const std::unordered_map<std::string_view, CameraType> CameraObjectsMap =
+{
+	{ "perspective", CameraType::PERSPECTIVE }
 };
 
 Ray CameraObject::genRay(float u, float v)
@@ -40,40 +60,69 @@ Ray CameraObject::genRay(float u, float v)
 	return Ray(position, direction);
 }
 
-// Reads characters from the file until it finds the specified character 'c', storing the characters in the 'token' string.
-void charSearch(std::ifstream& file, char c, std::string& token)
+// Tests the box against the four side planes of the frustum and the plane through the camera facing forward.
+// The box is outside if, for one of the planes, even its corner furthest along the plane normal is behind the plane.
+bool CameraObject::isInFrustum(const BoundingBox& box)
 {
-	file.get();
+	Vector3D<float> corners[4] = {
+		lower_left_corner - position,
+		lower_left_corner + horizontal - position,
+		lower_left_corner + horizontal + vertical - position,
+		lower_left_corner + vertical - position
+	};
+
+	Vector3D<float> center = lower_left_corner + (horizontal * 0.5f) + (vertical * 0.5f) - position;
+
+	Vector3D<float> normals[5];
+
+	for (int32_t i = 0; i < 4; ++i)
+	{
+		normals[i] = corners[i] | corners[(i + 1) % 4];
+
+		if (normals[i] * center < 0.0f)
+		{
+			normals[i] = -normals[i];
+		}
+	}
+
+	normals[4] = center;
 
-	while (!file.eof() && file.peek() != c)
+	for (const Vector3D<float>& n : normals)
 	{
-		token += file.get();
+		Vector3D<float> farthest(n.x >= 0.0f ? box.getMax().x : box.getMin().x,
+		                         n.y >= 0.0f ? box.getMax().y : box.getMin().y,
+		                         n.z >= 0.0f ? box.getMax().z : box.getMin().z);
+
+		if ((farthest - position) * n < 0.0f)
+		{
+			return false;
+		}
 	}
 
+	return true;
+}
+
+// Reads characters from the file until it finds the specified character 'c', storing the characters in the 'token' string.
+void charSearch(Tokenizer& file, char c, std::string_view& token)
+{
 	file.get();
+
+	token = file.readUntil(c);
 }
 
 // Reads characters from the file, skipping whitespace, until it finds the specified character 'c', storing the characters in the 'token' string.
-void tokenSearch(std::ifstream& file, char c, std::string& token)
+void tokenSearch(Tokenizer& file, char c, std::string_view& token)
 {
-	token.clear();
+	token = std::string_view();
 
-	while (!file.eof() && std::isspace(file.peek()))
-	{
-		file.get();
-	}
+	file.skipWhitespace();
 
-	if (file.peek() == c) // What if this is different from '-'? It should keep searching for it ????????
+	if (file.peek() == c)
 	{
 		file.get();
 
-		while (!file.eof() && file.peek() != c)
-		{
-			token += file.get();
-		}
-
-		file.get();
-		}
+		token = file.readUntil(c);
+	}
 }
 
 // Checks if the position, rotation, width, and height parameters of a plane object have been updated, and if so, computes the normal vector for the plane.
@@ -86,15 +135,17 @@ void computePlaneNormalCheck(GeometryObject& geometryObject)
 }
 
 // Sets the parameters of the last created scene object based on the tokens read from the file.
-void setObjectParameters(std::ifstream& file, std::string& token, std::vector<std::unique_ptr<SceneObject>>& sceneObjects)
+void setObjectParameters(Tokenizer& file, std::string_view& token, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, std::vector<ShaderLink>* shaderLinks)
 {
 	while (!file.eof() && file.peek() != ';')
 	{
 		tokenSearch(file, '-', token);
 
-		if (parameterMap.find(token) != parameterMap.end())
+		auto parameter = parameterMap.find(token);
+
+		if (parameter != parameterMap.end())
 		{
-			ParameterType pType = parameterMap[token];
+			ParameterType pType = parameter->second;
 
 			switch (pType)
 			{
@@ -104,12 +155,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 					if (!token.empty())
 					{
-						std::stringstream s(token);
-
 						float x, y, z;
-						char comma;
 
-						s >> x >> comma >> y >> comma >> z;
+						if (!parseVector3(token, x, y, z)) { break; }
 						sceneObjects.back().get()->position = Vector3D<float>(x, y, z);
 						//sceneObjects.back().get()->setI
 
@@ -132,12 +180,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 					if (!token.empty())
 					{
-						std::stringstream s(token);
-
 						float x, y, z;
-						char comma;
 
-						s >> x >> comma >> y >> comma >> z;
+						if (!parseVector3(token, x, y, z)) { break; }
 
 						sceneObjects.back().get()->rotation = Vector3D<float>(x, y, z);
 
@@ -148,6 +193,10 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 							static_cast<GeometryObject*>(sceneObjects.back().get())->setRotationUpdated(true);
 
 							computePlaneNormalCheck(*static_cast<GeometryObject*>(sceneObjects.back().get()));
+
+							// Any geometry may already hold data by now (a -file- before -rot-), so it is bounded again like for -pos-.
+							static_cast<GeometryObject*>(sceneObjects.back().get())->setBoundingBox();
+							static_cast<GeometryObject*>(sceneObjects.back().get())->createMorton();
 						}
 					}
 					break;
@@ -162,7 +211,7 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 						
 						if (geometryObject)
 						{
-							geometryObject->size = std::stof(token);
+							geometryObject->size = tokenToFloat(token);
 						}
 					}
 					break;
@@ -177,9 +226,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 						if (geometryObject && geometryObject->getGeometryType() == GeometryType::PLANE)
 						{
-							//geometryObject->size = std::stof(token);
+							//geometryObject->size = tokenToFloat(token);
 							PlaneObject* planeObject = dynamic_cast<PlaneObject*>(geometryObject);
-							planeObject->setWidth(std::stof(token));
+							planeObject->setWidth(tokenToFloat(token));
 							planeObject->setWidthUpdated(true);
 
 							planeObject->setBoundingBox();
@@ -203,7 +252,7 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 						if (geometryObject && geometryObject->getGeometryType() == GeometryType::PLANE)
 						{
 							PlaneObject* planeObject = dynamic_cast<PlaneObject*>(geometryObject);
-							planeObject->setHeight(std::stof(token));
+							planeObject->setHeight(tokenToFloat(token));
 							planeObject->setHeightUpdated(true);
 
 							planeObject->setBoundingBox();
@@ -226,7 +275,7 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 						
 						if (lightObject)
 						{
-							lightObject->intensity = std::stof(token);
+							lightObject->intensity = tokenToFloat(token);
 						}
 					}
 					break;
@@ -241,12 +290,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 						if (lightObject)
 						{
-							std::stringstream s(token);
-
 							float x, y, z;
-							char comma;
 
-							s >> x >> comma >> y >> comma >> z;
+							if (!parseVector3(token, x, y, z)) { break; }
 
 							lightObject->setColor(Vector3D<float>(x, y, z));
 						}
@@ -264,9 +310,23 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 							if (sphereObject)
 							{
-								sphereObject->size = std::stof(token);
+								sphereObject->size = tokenToFloat(token);
 								sphereObject->setBoundingBox();
 							}
+
+							ParticleSetObject* particleSetObject = dynamic_cast<ParticleSetObject*>(sceneObjects.back().get());
+
+							if (particleSetObject)
+							{
+								particleSetObject->setRadius(tokenToFloat(token));
+							}
+
+							DisplacedSurfaceObject* displacedSurfaceObject = dynamic_cast<DisplacedSurfaceObject*>(sceneObjects.back().get());
+
+							if (displacedSurfaceObject)
+							{
+								displacedSurfaceObject->setRadius(tokenToFloat(token));
+							}
 						}
 						break;
 
@@ -276,12 +336,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 					if (!token.empty())
 					{
-						std::stringstream s(token);
-
 						float x, y, z;
-						char comma;
 
-						s >> x >> comma >> y >> comma >> z;
+						if (!parseVector3(token, x, y, z)) { break; }
 
 						CameraObject* cameraObject = dynamic_cast<CameraObject*>(sceneObjects.back().get());
 
@@ -302,12 +359,9 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 
 						if (cameraObject)
 						{
-							std::stringstream s(token);
-
 							float width, height;
-							char comma;
 
-							s >> width >> comma >> height;
+							if (!parseVector2(token, width, height)) { break; }
 
 							cameraObject->setWindow(width, height);
 						}
@@ -322,328 +376,410 @@ void setObjectParameters(std::ifstream& file, std::string& token, std::vector<st
 					{
 						GeometryObject* geometryObject = dynamic_cast<GeometryObject*>(sceneObjects.back().get());
 
-						if (geometryObject)
+						if (geometryObject && shaderLinks)
+						{
+							shaderLinks->push_back({ geometryObject, std::string(token) });
+						}
+						else if (geometryObject)
 						{
 							geometryObject->linkShader(token);
 						}
 					}
 					break;
+
+				case ParameterType::FILE:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						GeometryObject* geometryObject = dynamic_cast<GeometryObject*>(sceneObjects.back().get());
+
+						if (geometryObject && geometryObject->loadFile(std::string(token)))
+						{
+							geometryObject->createMorton();
+						}
+					}
+					break;
+
+				case ParameterType::CACHE:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						GeometryObject* geometryObject = dynamic_cast<GeometryObject*>(sceneObjects.back().get());
+
+						if (geometryObject)
+						{
+							geometryObject->setCacheSize(tokenToFloat(token));
+						}
+					}
+					break;
+
+				case ParameterType::DISPLACEMENT:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						DisplacedSurfaceObject* displacedSurfaceObject = dynamic_cast<DisplacedSurfaceObject*>(sceneObjects.back().get());
+
+						if (displacedSurfaceObject)
+						{
+							displacedSurfaceObject->setDisplacement(tokenToFloat(token));
+						}
+					}
+					break;
+
+				case ParameterType::FREQUENCY:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						DisplacedSurfaceObject* displacedSurfaceObject = dynamic_cast<DisplacedSurfaceObject*>(sceneObjects.back().get());
+
+						if (displacedSurfaceObject)
+						{
+							displacedSurfaceObject->setFrequency(tokenToFloat(token));
+						}
+					}
+					break;
+
+				case ParameterType::RESOLUTION:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						DisplacedSurfaceObject* displacedSurfaceObject = dynamic_cast<DisplacedSurfaceObject*>(sceneObjects.back().get());
+
+						if (displacedSurfaceObject)
+						{
+							displacedSurfaceObject->setResolution(tokenToInt(token));
+						}
+					}
+					break;
+
+				case ParameterType::BOUNDS:
+
+					tokenSearch(file, '/', token);
+
+					if (!token.empty())
+					{
+						ReferenceObject* referenceObject = dynamic_cast<ReferenceObject*>(sceneObjects.back().get());
+
+						if (referenceObject)
+						{
+							float b[6];
+
+							if (!parseFloats(token, b, 6)) { break; }
+
+							referenceObject->setProxyBounds(BoundingBox(Vector3D<float>(b[0], b[1], b[2]), Vector3D<float>(b[3], b[4], b[5])));
+						}
+					}
+					break;
 				}
 		}
 		else if (!token.empty())
 		{
 			tokenSearch(file, '/', token);
 		}
+		else if (file.peek() != ';')
+		{
+			// Skip stray characters between parameters instead of stalling on them
+			file.get();
+		}
+	}
+
+	if (sceneObjects.back()->getType() == SceneObjectType::GEOMETRY)
+	{
+		static_cast<GeometryObject*>(sceneObjects.back().get())->endParameters();
 	}
 }
 
-// Builds the scene by reading the specified file and creating scene objects based on the tokens found in the file. The created objects are stored in the 'sceneObjects' vector.
-bool SceneBuilder(const std::string& filePath, std::vector<std::unique_ptr<SceneObject>>& sceneObjects)
+// Reads the parameters of an (include) directive and parses the named file in place, as if its objects were written here.
+// Nesting is limited so that a file including itself is reported instead of recursing forever.
+static void includeFile(Tokenizer& file, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, std::vector<ShaderLink>* shaderLinks)
 {
+	static thread_local int32_t includeDepth = 0;
+	const int32_t maxIncludeDepth = 16;
 
-	std::ifstream file(filePath);
+	std::string_view token;
+	std::string includePath;
 
-	std::unordered_map<std::string, GeometryType> GeometryObjectsMap = 
+	while (!file.eof() && file.peek() != ';')
 	{
-		{ "sphere", GeometryType::SPHERE },
-		{ "plane", GeometryType::PLANE }
-	};
+		tokenSearch(file, '-', token);
+
+		if (token == "file")
+		{
+			tokenSearch(file, '/', token);
+			includePath = std::string(token);
+		}
+		else if (!token.empty())
+		{
+			tokenSearch(file, '/', token);
+		}
+		else if (file.peek() != ';')
+		{
+			file.get();
+		}
+	}
 
-	std::unordered_map<std::string, LightType> LightObjectsMap =
+	if (includePath.empty())
 	{
-		{ "point", LightType::POINT },
-		{ "dome", LightType::DOME }
-	};
+		std::cout << "Include directive without a file" << std::endl;
+		return;
+	}
 
-	std::unordered_map<std::string, CameraType> CameraObjectsMap =
+	if (includeDepth >= maxIncludeDepth)
 	{
-		{ "perspective", CameraType::PERSPECTIVE }
-	};
+		std::cout << "Includes nested too deeply, skipping: " << includePath << std::endl;
+		return;
+	}
 
-	if (!file.is_open())
+	MappedFile mappedFile(includePath);
+
+	if (!mappedFile.isOpen())
 	{
-		return false;
+		std::cout << "Failed to open include file: " << includePath << std::endl;
+		return;
 	}
 
+	Tokenizer included(mappedFile.begin(), mappedFile.end());
+
+	++includeDepth;
+	parseObjects(included, sceneObjects, shaderLinks);
+	--includeDepth;
+}
+
+// Creates the scene objects found between the current position of 'file' and its end, appending them to 'sceneObjects' in file order.
+// With 'shaderLinks' the -shader- parameters are collected there instead of being linked, see linkShaders.
+void parseObjects(Tokenizer& file, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, std::vector<ShaderLink>* shaderLinks)
+{
 	while (!file.eof())
 	{
-		std::string token;
-		token.clear();
+		std::string_view token;
 
 		if (file.peek() == '(')
 		{
 			charSearch(file, ')', token);
 
-			if (GeometryObjectsMap.find(token) != GeometryObjectsMap.end())
+			auto geometry = GeometryObjectsMap.find(token);
+
+			if (geometry != GeometryObjectsMap.end())
 			{
-				GeometryType gType = GeometryObjectsMap[token];
+				GeometryType gType = geometry->second;
 
 				switch (gType)
 				{
 					case GeometryType::SPHERE:
 						// Create a sphere object
 						sceneObjects.emplace_back(std::make_unique<SphereObject>(1.0f));
-						setObjectParameters(file, token, sceneObjects);
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
 						break;
 
 					case GeometryType::PLANE:
 						// Create a plane object
 						//PlaneObject* planeObject = new PlaneObject();
 						sceneObjects.emplace_back(std::make_unique<PlaneObject>());
-						setObjectParameters(file, token, sceneObjects);
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
+						break;
+
+					case GeometryType::MESH:
+						// Create a mesh object, its buffers are loaded by the -file- parameter
+						sceneObjects.emplace_back(std::make_unique<MeshObject>());
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
+						break;
+
+					case GeometryType::PARTICLES:
+						// Create a particle set, its points are loaded by the -file- parameter
+						sceneObjects.emplace_back(std::make_unique<ParticleSetObject>());
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
+						break;
+
+					case GeometryType::PAGED_MESH:
+						// Create an out-of-core mesh, its page file is opened by the -file- parameter
+						sceneObjects.emplace_back(std::make_unique<PagedMeshObject>());
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
+						break;
+
+					case GeometryType::DISPLACED:
+						// Create a displaced surface, patches are tessellated lazily during rendering
+						sceneObjects.emplace_back(std::make_unique<DisplacedSurfaceObject>());
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
+						break;
+
+					case GeometryType::REFERENCE:
+						// Create a reference to a shared asset file, loaded now or on first use depending on its bounds
+						sceneObjects.emplace_back(std::make_unique<ReferenceObject>());
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
 						break;
 				}
 			}
 
-			if (LightObjectsMap.find(token) != LightObjectsMap.end())
+			auto light = LightObjectsMap.find(token);
+
+			if (light != LightObjectsMap.end())
 			{
-				LightType lType = LightObjectsMap[token];
+				LightType lType = light->second;
 
 				switch (lType)
 				{
 					case LightType::POINT:
 						// Create a point light object
 						sceneObjects.emplace_back(std::make_unique<PointLightObject>(1.0f));
-						setObjectParameters(file, token, sceneObjects);
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
 						break;
 
 					case LightType::DOME:
 						// Create a dome light object
 						sceneObjects.emplace_back(std::make_unique<DomeLightObject>());
-						setObjectParameters(file, token, sceneObjects);
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
 						break;
 				}
 			}
 
-			if (CameraObjectsMap.find(token) != CameraObjectsMap.end())
+			auto camera = CameraObjectsMap.find(token);
+
+			if (camera != CameraObjectsMap.end())
 			{
-				CameraType cType = CameraObjectsMap[token];
+				CameraType cType = camera->second;
 
 				switch (cType)
 				{
 					case CameraType::PERSPECTIVE:
 						// Create a perspective camera object
 						sceneObjects.emplace_back(std::make_unique<PerspectiveCameraObject>(45.0f));
-						setObjectParameters(file, token, sceneObjects);
+						setObjectParameters(file, token, sceneObjects, shaderLinks);
 						break;
 				}
 			}
+
+			if (token == "include")
+			{
+				includeFile(file, sceneObjects, shaderLinks);
+			}
 		}
 		else
 		{
 			file.get();
 		}
 	}
+}
 
-	if (sceneObjects.empty())
+// Links collected shaders in the order given. Parallel parses link each chunk's shaders in chunk order once the workers are done, so
+// the material library registers new shader files in file order and material indices match a serial parse.
+void linkShaders(const std::vector<ShaderLink>& shaderLinks)
+{
+	for (const ShaderLink& link : shaderLinks)
 	{
-		return false;
+		link.object->linkShader(link.shaderFilePath);
 	}
-
-	return true;
 }
 
-// Links a shader to the geometry object by reading the shader file specified by 'shaderFilePath' and parsing its contents to set the shader properties.
-bool GeometryObject::linkShader(std::string& shaderFilePath)
+// Returns the start of the next top level object at or after 'p': the position right after the next ';' that ends an object.
+const char* nextObjectBoundary(const char* p, const char* end)
 {
-	shaderFile.open(shaderFilePath);
-
-	if (!shaderFile.is_open())
+	while (p < end && *p != ';')
 	{
-		std::cout << "Failed to open shader file: " << shaderFilePath << std::endl;
-		return false;
+		++p;
 	}
 
-	parse();
-
-	return true;
+	return (p < end) ? p + 1 : end;
 }
 
-// Assigns a shader to the geometry object based on the specified shader type. Returns true if the shader was successfully assigned, false otherwise.
-bool GeometryObject::assignShader(ShaderType sType)
+// Builds the scene by reading the specified file and creating scene objects based on the tokens found in the file. The created objects are stored in the 'sceneObjects' vector.
+// Large files are split at object boundaries and the chunks are parsed on 'threads' worker threads (0 = one per core), each into its own
+// object list; the lists are then concatenated and their shaders linked in chunk order, so objects, ids and material indices are the same
+// as in a serial parse. Objects stay individually allocated: the parameter code works on each object as it is created, and the per
+// thread heaps of the allocator already keep the workers from contending.
+bool SceneBuilder(const std::string& filePath, std::vector<std::unique_ptr<SceneObject>>& sceneObjects, int32_t threads)
 {
-	switch(sType)
-	{
-		case ShaderType::CONSTANT:
-			shader = Constant();
-			return true;
 
-		case ShaderType::DEPTH:
-			shader = Depth();
-			return true;
+	MappedFile mappedFile(filePath);
 
-			case ShaderType::SURFACE:
-			shader = Surface();
-			return true;
-
-		default:
-			break;
+	if (!mappedFile.isOpen())
+	{
+		return false;
 	}
-	return false;
-}
-
-// Parses the shader file to extract shader properties and assign them to the geometry object. Returns true if parsing was successful, false otherwise.
-bool GeometryObject::parse()
-{
-	token.clear();
 
-	while (!shaderFile.eof() && shaderFile.peek() != ';')
+	if (threads <= 0)
 	{
-		if (shaderFile.peek() == '(')
-		{
-			charSearch(shaderFile, ')', token);
-
-			if (shaderTypeMap.find(token) != shaderTypeMap.end())
-			{
-				ShaderType sType = shaderTypeMap[token];
-
-				switch (sType)
-				{
-					case ShaderType::CONSTANT:
-						if (assignShader(sType))
-						{
-							token.clear(); 
-
-							tokenSearch(shaderFile, '-', token);
-
-							ShaderParameterType spType;
-
-							if (shaderParameterMap.find(token) != shaderParameterMap.end())
-							{
-								spType = shaderParameterMap[token];
-								
-								switch (spType)
-								{
-									case ShaderParameterType::COLOR:
-										token.clear();
-
-										tokenSearch(shaderFile, '/', token);
-
-										if (!token.empty())
-										{
-											if (auto* p = std::get_if<Constant>(&getShader()))
-											{
-												// repeated code
-												std::stringstream s(token);
-
-												float x, y, z;
-												char comma;
-
-												s >> x >> comma >> y >> comma >> z;
-
-												p->setColor(Vector3D<float>(x, y, z));
-											}
-										}
-
-										break;
-
-									default:
-										return false;
-								}
-							}
-
-							return true; 
-						}
-						return false;
-
-					case ShaderType::DEPTH:
-						if (assignShader(sType))
-						{
-							return true;
-						}
-						return false;
-
-					case ShaderType::SURFACE:
-						if (assignShader(sType))
-						{
-							token.clear();
-
-							while (!shaderFile.eof() && shaderFile.peek() != ';')
-							{
-								tokenSearch(shaderFile, '-', token);
-
-								ShaderParameterType spType;
-
-								if (shaderParameterMap.find(token) != shaderParameterMap.end())
-								{
-									spType = shaderParameterMap[token];
-
-									switch (spType)
-									{
-									case ShaderParameterType::DIFFUSE_GAIN:
-										token.clear();
-
-										tokenSearch(shaderFile, '/', token);
+		threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
 
-										if (!token.empty())
-										{
-											if (auto* p = std::get_if<Surface>(&getShader()))
-											{
-												p->setDiffuseGain(std::stof(token));
-											}
-										}
+	const size_t minChunkSize = 1024 * 1024;
 
-										break;
+	size_t chunkCount = std::min(static_cast<size_t>(threads), mappedFile.getSize() / minChunkSize);
 
-									case ShaderParameterType::DIFFUSE_COLOR:
-										token.clear();
+	if (chunkCount <= 1)
+	{
+		Tokenizer file(mappedFile.begin(), mappedFile.end());
 
-										tokenSearch(shaderFile, '/', token);
+		parseObjects(file, sceneObjects);
+	}
+	else
+	{
+		std::vector<const char*> boundaries(chunkCount + 1);
 
-										if (!token.empty())
-										{
-											if (auto* p = std::get_if<Surface>(&getShader()))
-											{
-												std::stringstream s(token);
+		boundaries[0] = mappedFile.begin();
+		boundaries[chunkCount] = mappedFile.end();
 
-												float x, y, z;
-												char comma;
+		for (size_t i = 1; i < chunkCount; ++i)
+		{
+			const char* guess = mappedFile.begin() + (mappedFile.getSize() * i) / chunkCount;
 
-												s >> x >> comma >> y >> comma >> z;
+			boundaries[i] = nextObjectBoundary(std::max(guess, boundaries[i - 1]), mappedFile.end());
+		}
 
-												p->setDiffuseColor(Vector3D<float>(x, y, z));
-											}
-										}
+		std::vector<std::vector<std::unique_ptr<SceneObject>>> chunkObjects(chunkCount);
+		std::vector<std::vector<ShaderLink>> chunkShaderLinks(chunkCount);
+		std::vector<std::thread> workers;
 
-										break;
+		for (size_t i = 0; i < chunkCount; ++i)
+		{
+			workers.emplace_back([&, i]()
+			{
+				Tokenizer file(boundaries[i], boundaries[i + 1]);
 
-									case ShaderParameterType::ROUGHNESS:
-										token.clear();
+				parseObjects(file, chunkObjects[i], &chunkShaderLinks[i]);
+			});
+		}
 
-										tokenSearch(shaderFile, '/', token);
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
 
-										if (!token.empty())
-										{
-											if (auto* p = std::get_if<Surface>(&getShader()))
-											{
-												p->setRoughness(std::stof(token));
-											}
-										}
+		for (const std::vector<ShaderLink>& shaderLinks : chunkShaderLinks)
+		{
+			linkShaders(shaderLinks);
+		}
 
-										break;
+		size_t total = sceneObjects.size();
 
-									default:
-										return false;
-									}
-								}
-							}
-
-							return true;
-						}
+		for (const auto& objects : chunkObjects)
+		{
+			total += objects.size();
+		}
 
-						return false;
+		sceneObjects.reserve(total);
 
-					default:
-						return false;
-				}
-			}
-		}
-		else
+		for (auto& objects : chunkObjects)
 		{
-			shaderFile.get();
+			std::move(objects.begin(), objects.end(), std::back_inserter(sceneObjects));
 		}
 	}
-	return false;
+
+	if (sceneObjects.empty())
+	{
+		return false;
+	}
+
+	return true;
 }
 
 PlaneObject::PlaneObject() : GeometryObject(GeometryType::PLANE)
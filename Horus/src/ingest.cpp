@@ -0,0 +1,126 @@
+#include "ingest.h"
+#include "mapped_file.h"
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// Range of the scene file parsed as one unit, and the objects parsed from it.
+struct IngestBatch
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	std::vector<std::unique_ptr<SceneObject>> objects;
+	std::vector<ShaderLink> shaderLinks;
+
+	bool ready = false;
+};
+
+bool ingestScene(const std::string& filePath, Scene& scene, int32_t threads)
+{
+	MappedFile mappedFile(filePath);
+
+	if (!mappedFile.isOpen())
+	{
+		return false;
+	}
+
+	if (threads <= 0)
+	{
+		threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
+
+	// Small batches keep the first ones flowing into the BVH early; large enough that the hand-off cost does not matter.
+	const size_t batchSize = 256 * 1024;
+
+	std::vector<IngestBatch> batches;
+
+	for (const char* p = mappedFile.begin(); p < mappedFile.end();)
+	{
+		IngestBatch& batch = batches.emplace_back();
+
+		batch.begin = p;
+		batch.end = nextObjectBoundary(p + std::min(batchSize, static_cast<size_t>(mappedFile.end() - p)) - 1, mappedFile.end());
+
+		p = batch.end;
+	}
+
+	std::mutex mutex;
+	std::condition_variable batchReady;
+	std::atomic<size_t> nextBatch{ 0 };
+
+	std::vector<std::thread> parsers;
+
+	for (int32_t t = 0; t < std::min(threads, static_cast<int32_t>(batches.size())); ++t)
+	{
+		parsers.emplace_back([&]()
+		{
+			for (size_t i = nextBatch++; i < batches.size(); i = nextBatch++)
+			{
+				Tokenizer file(batches[i].begin, batches[i].end);
+
+				std::vector<std::unique_ptr<SceneObject>> objects;
+				std::vector<ShaderLink> shaderLinks;
+				parseObjects(file, objects, &shaderLinks);
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+
+					batches[i].objects = std::move(objects);
+					batches[i].shaderLinks = std::move(shaderLinks);
+					batches[i].ready = true;
+				}
+
+				batchReady.notify_all();
+			}
+		});
+	}
+
+	// Consume the batches in file order, so object order, material indices and BVH input are the same as with a serial parse.
+	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+	std::vector<GeometryObject*> geometries;
+
+	BVH& bvh = scene.getBVH();
+
+	for (IngestBatch& batch : batches)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			batchReady.wait(lock, [&]() { return batch.ready; });
+		}
+
+		linkShaders(batch.shaderLinks);
+
+		geometries.clear();
+
+		for (std::unique_ptr<SceneObject>& object : batch.objects)
+		{
+			if (object->getType() == SceneObjectType::GEOMETRY)
+			{
+				geometries.push_back(static_cast<GeometryObject*>(object.get()));
+			}
+
+			sceneObjects.push_back(std::move(object));
+		}
+
+		if (!geometries.empty())
+		{
+			bvh.addPrimitives(geometries);
+		}
+	}
+
+	for (std::thread& parser : parsers)
+	{
+		parser.join();
+	}
+
+	if (!scene.getScene(sceneObjects))
+	{
+		return false;
+	}
+
+	bvh.finishBuild();
+
+	return true;
+}
\ No newline at end of file
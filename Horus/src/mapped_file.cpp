@@ -0,0 +1,122 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Maps the whole file read-only. Returns true if the file could be opened and mapped, false otherwise.
+bool MappedFile::open(const std::string& filePath)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	length = static_cast<size_t>(fileSize.QuadPart);
+	opened = true;
+
+	// Zero-length files cannot be mapped, but they are still valid (empty) files.
+	if (length == 0)
+	{
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping == nullptr)
+	{
+		close();
+		return false;
+	}
+
+	mappingHandle = mapping;
+
+	data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (data == nullptr)
+	{
+		close();
+		return false;
+	}
+#else
+	fileDescriptor = ::open(filePath.c_str(), O_RDONLY);
+
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+
+	if (fstat(fileDescriptor, &fileStat) != 0)
+	{
+		close();
+		return false;
+	}
+
+	length = static_cast<size_t>(fileStat.st_size);
+	opened = true;
+
+	if (length == 0)
+	{
+		return true;
+	}
+
+	void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+
+	if (view == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+
+	madvise(view, length, MADV_SEQUENTIAL);
+
+	data = static_cast<const char*>(view);
+#endif
+
+	return true;
+}
+
+// Unmaps the file and releases the underlying handles.
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data) { UnmapViewOfFile(data); }
+	if (mappingHandle) { CloseHandle(static_cast<HANDLE>(mappingHandle)); }
+	if (fileHandle) { CloseHandle(static_cast<HANDLE>(fileHandle)); }
+
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (data) { munmap(const_cast<char*>(data), length); }
+	if (fileDescriptor >= 0) { ::close(fileDescriptor); }
+
+	fileDescriptor = -1;
+#endif
+
+	data = nullptr;
+	length = 0;
+	opened = false;
+}
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include "material.h"
+#include "hrs.h"
+#include "mapped_file.h"
+#include <filesystem>
+#include <iostream>
+
+std::unordered_map<std::string_view, ShaderType> shaderTypeMap = {
+	{"constant", ShaderType::CONSTANT},
+	{"depth", ShaderType::DEPTH},
+	{"surface", ShaderType::SURFACE},
+};
+
+std::unordered_map<std::string_view, ShaderParameterType> shaderParameterMap = {
+	{"color", ShaderParameterType::COLOR},
+	{"diffuse_gain", ShaderParameterType::DIFFUSE_GAIN},
+	{"diffuse_color", ShaderParameterType::DIFFUSE_COLOR},
+	{"roughness", ShaderParameterType::ROUGHNESS}
+};
+
+MaterialLibrary& MaterialLibrary::getInstance()
+{
+	static MaterialLibrary library;
+	return library;
+}
+
+MaterialLibrary::MaterialLibrary()
+{
+	uint32_t index;
+	append(index);
+}
+
+bool MaterialLibrary::append(uint32_t& index)
+{
+	if (materialCount == blockSize * blockCount)
+	{
+		std::cout << "Too many materials, the default material is used instead" << std::endl;
+		return false;
+	}
+
+	if (materialCount % blockSize == 0)
+	{
+		blocks[materialCount / blockSize] = std::make_unique<Material[]>(blockSize);
+	}
+
+	index = materialCount++;
+
+	return true;
+}
+
+// Looks the shader file up by the path as written, then by its canonical path, and only maps and parses it when neither is known.
+// A file that cannot be opened is reported once and resolves to the default material.
+bool MaterialLibrary::load(std::string_view shaderFilePath, uint32_t& index)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::string path(shaderFilePath);
+
+	auto it = pathIndices.find(path);
+
+	if (it != pathIndices.end())
+	{
+		index = it->second;
+		return index != 0;
+	}
+
+	std::error_code error;
+
+	// Made absolute first: a relative path with no existing part is otherwise returned as written, so "a.hrs" and "./a.hrs" would differ.
+	std::filesystem::path absolutePath = std::filesystem::absolute(std::filesystem::path(path), error);
+	std::string canonicalPath = error ? path : std::filesystem::weakly_canonical(absolutePath, error).string();
+
+	if (error)
+	{
+		canonicalPath = path;
+	}
+
+	auto canonical = canonicalIndices.find(canonicalPath);
+
+	if (canonical != canonicalIndices.end())
+	{
+		index = canonical->second;
+		pathIndices[path] = index;
+		return index != 0;
+	}
+
+	MappedFile mappedFile{ path };
+
+	if (!mappedFile.isOpen())
+	{
+		std::cout << "Failed to open shader file: " << shaderFilePath << std::endl;
+
+		index = 0;
+		pathIndices[path] = index;
+		canonicalIndices[canonicalPath] = index;
+		return false;
+	}
+
+	Tokenizer shaderFile(mappedFile.begin(), mappedFile.end());
+
+	if (!append(index))
+	{
+		index = 0;
+		return false;
+	}
+
+	parse(shaderFile, get(index));
+
+	pathIndices[path] = index;
+	canonicalIndices[canonicalPath] = index;
+
+	return true;
+}
+
+uint32_t MaterialLibrary::add(const Material& material)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	uint32_t index = 0;
+
+	if (append(index))
+	{
+		get(index) = material;
+	}
+
+	return index;
+}
+
+// Resets 'material' to the shader of the specified type. Returns true if the type is known, false otherwise.
+static bool assignShader(ShaderType sType, Material& material)
+{
+	switch(sType)
+	{
+		case ShaderType::CONSTANT:
+			material = Constant();
+			return true;
+
+		case ShaderType::DEPTH:
+			material = Depth();
+			return true;
+
+		case ShaderType::SURFACE:
+			material = Surface();
+			return true;
+
+		default:
+			break;
+	}
+	return false;
+}
+
+// Parses the shader file to extract shader properties into 'material'. Returns true if parsing was successful, false otherwise.
+bool MaterialLibrary::parse(Tokenizer& shaderFile, Material& material)
+{
+	std::string_view token;
+
+	while (!shaderFile.eof() && shaderFile.peek() != ';')
+	{
+		if (shaderFile.peek() == '(')
+		{
+			charSearch(shaderFile, ')', token);
+
+			if (shaderTypeMap.find(token) != shaderTypeMap.end())
+			{
+				ShaderType sType = shaderTypeMap[token];
+
+				switch (sType)
+				{
+					case ShaderType::CONSTANT:
+						if (assignShader(sType, material))
+						{
+							token = std::string_view();
+
+							tokenSearch(shaderFile, '-', token);
+
+							ShaderParameterType spType;
+
+							if (shaderParameterMap.find(token) != shaderParameterMap.end())
+							{
+								spType = shaderParameterMap[token];
+								
+								switch (spType)
+								{
+									case ShaderParameterType::COLOR:
+										token = std::string_view();
+
+										tokenSearch(shaderFile, '/', token);
+
+										if (!token.empty())
+										{
+											if (auto* p = std::get_if<Constant>(&material))
+											{
+												float x, y, z;
+
+												if (!parseVector3(token, x, y, z)) { break; }
+
+												p->setColor(Vector3D<float>(x, y, z));
+											}
+										}
+
+										break;
+
+									default:
+										return false;
+								}
+							}
+
+							return true; 
+						}
+						return false;
+
+					case ShaderType::DEPTH:
+						if (assignShader(sType, material))
+						{
+							return true;
+						}
+						return false;
+
+					case ShaderType::SURFACE:
+						if (assignShader(sType, material))
+						{
+							token = std::string_view();
+
+							while (!shaderFile.eof() && shaderFile.peek() != ';')
+							{
+								tokenSearch(shaderFile, '-', token);
+
+								ShaderParameterType spType;
+
+								if (shaderParameterMap.find(token) != shaderParameterMap.end())
+								{
+									spType = shaderParameterMap[token];
+
+									switch (spType)
+									{
+									case ShaderParameterType::DIFFUSE_GAIN:
+										token = std::string_view();
+
+										tokenSearch(shaderFile, '/', token);
+
+										if (!token.empty())
+										{
+											if (auto* p = std::get_if<Surface>(&material))
+											{
+												p->setDiffuseGain(tokenToFloat(token));
+											}
+										}
+
+										break;
+
+									case ShaderParameterType::DIFFUSE_COLOR:
+										token = std::string_view();
+
+										tokenSearch(shaderFile, '/', token);
+
+										if (!token.empty())
+										{
+											if (auto* p = std::get_if<Surface>(&material))
+											{
+												float x, y, z;
+
+												if (!parseVector3(token, x, y, z)) { break; }
+
+												p->setDiffuseColor(Vector3D<float>(x, y, z));
+											}
+										}
+
+										break;
+
+									case ShaderParameterType::ROUGHNESS:
+										token = std::string_view();
+
+										tokenSearch(shaderFile, '/', token);
+
+										if (!token.empty())
+										{
+											if (auto* p = std::get_if<Surface>(&material))
+											{
+												p->setRoughness(tokenToFloat(token));
+											}
+										}
+
+										break;
+
+									default:
+										return false;
+									}
+								}
+								else if (token.empty() && shaderFile.peek() != ';')
+								{
+									// Skip stray characters between parameters instead of stalling on them
+									shaderFile.get();
+								}
+							}
+
+							return true;
+						}
+
+						return false;
+
+					default:
+						return false;
+				}
+			}
+		}
+		else
+		{
+			shaderFile.get();
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -0,0 +1,101 @@
+#include "mesh.h"
+#include "ply.h"
+
+MeshObject::MeshObject() : GeometryObject(GeometryType::MESH)
+{
+	position = Vector3D<float>(0.0f, 0.0f, 0.0f);
+	rotation = Vector3D<float>(0.0f, 0.0f, 0.0f);
+
+	size = 1.0f;
+}
+
+// Loads the mesh buffers from a PLY file and builds the triangle BVH. Returns true if successful, false otherwise.
+bool MeshObject::loadFile(const std::string& filePath)
+{
+	sourceFilePath = filePath;
+
+	if (!loadPLY(filePath, vertices, indices))
+	{
+		return false;
+	}
+
+	std::vector<BoundingBox> triangleBounds(getTriangleCount());
+
+	for (size_t i = 0; i < triangleBounds.size(); ++i)
+	{
+		const Vector3D<float>& v0 = vertices[indices[3 * i]];
+		const Vector3D<float>& v1 = vertices[indices[3 * i + 1]];
+		const Vector3D<float>& v2 = vertices[indices[3 * i + 2]];
+
+		Vector3D<float> mn(std::min({ v0.x, v1.x, v2.x }), std::min({ v0.y, v1.y, v2.y }), std::min({ v0.z, v1.z, v2.z }));
+		Vector3D<float> mx(std::max({ v0.x, v1.x, v2.x }), std::max({ v0.y, v1.y, v2.y }), std::max({ v0.z, v1.z, v2.z }));
+
+		triangleBounds[i] = BoundingBox(mn, mx);
+	}
+
+	bvh.build(triangleBounds);
+
+	setBoundingBox();
+
+	std::cout << "Loaded mesh " << filePath << ": " << getVertexCount() << " vertices, " << getTriangleCount() << " triangles" << std::endl;
+
+	return true;
+}
+
+// Transforms the corners of the object space bounds to world space.
+void MeshObject::setBoundingBox()
+{
+	R = rotationMatrix(rotation);
+
+	if (bvh.empty())
+	{
+		boundingBox.setMin(position);
+		boundingBox.setMax(position);
+	}
+	else
+	{
+		boundingBox.assignBoundingBox(toWorldBounds(bvh.getBounds(), position, R));
+	}
+
+	boundingBox.computeCentroid();
+}
+
+// Intersects the ray with the mesh triangles in object space. The normal of the closest hit is stored facing the incoming ray.
+bool MeshObject::rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit)
+{
+	Ray localRay = toObjectSpace(ray, position, R);
+
+	float closestT = tMax;
+	uint32_t closestTriangle = 0;
+
+	bool found = bvh.traversal(localRay, tMin, closestT, [&](uint32_t triangle, float t0, float t1)
+	{
+		float t = intersectTriangle(localRay.origin, localRay.direction, vertices[indices[3 * triangle]], vertices[indices[3 * triangle + 1]], vertices[indices[3 * triangle + 2]], t0, t1);
+
+		if (t >= 0.0f) { closestTriangle = triangle; }
+
+		return t;
+	});
+
+	if (!found)
+	{
+		return false;
+	}
+
+	const Vector3D<float>& v0 = vertices[indices[3 * closestTriangle]];
+	const Vector3D<float>& v1 = vertices[indices[3 * closestTriangle + 1]];
+	const Vector3D<float>& v2 = vertices[indices[3 * closestTriangle + 2]];
+
+	Vector3D<float> localNormal = (v1 - v0) | (v2 - v0);
+	hit.front = (localNormal * localRay.direction) < 0.0f;
+
+	hit.normal = R * (hit.front ? localNormal : -localNormal);
+	hit.normal.normalize();
+
+	hit.back = !hit.front;
+	hit.hitPoint = ray.getPointat(closestT);
+	hit.t = closestT;
+	hit.primitive = closestTriangle;
+
+	return true;
+}
\ No newline at end of file
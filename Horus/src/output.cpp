@@ -1,26 +1,285 @@
 #include "output.h"
+#include <cstring>
+#include <algorithm>
 
-void Output::writePPM()
+// Same quantization as the P3 writer, clamped to the 8 bit range.
+static uint8_t toByte(float value)
+{
+	return static_cast<uint8_t>(static_cast<int>(std::clamp(value, 0.0f, 1.0f) * 255));
+}
+
+void Output::writePPM(const Framebuffer& framebuffer)
 {
 	std::ofstream file(filePathWrite.data());
 
 	file << "P3\n" << (int)width << " " << (int)height << "\n255\n";
 
-	for (size_t i = 0; i < buffer.size(); ++i)
+	row.resize(framebuffer.getWidth());
+
+	for (int32_t y = 0; y < framebuffer.getHeight(); ++y)
+	{
+		framebuffer.getRow(y, row.data());
+
+		for (const Vector3D<float>& pixel : row)
+		{
+			file << (int)toByte(pixel.x) << " " << (int)toByte(pixel.y) << " " << (int)toByte(pixel.z) << "\n";
+		}
+	}
+}
+
+bool Output::open()
+{
+	if (!isStreamed())
+	{
+		return true;
+	}
+
+	int32_t w = static_cast<int32_t>(width);
+	int32_t h = static_cast<int32_t>(height);
+
+	switch (renderOutput)
+	{
+		case RenderOutput::PNG:
+			return pngWriter.open(std::string(filePathWrite), w, h);
+
+		case RenderOutput::QOI:
+			return qoiWriter.open(std::string(filePathWrite), w, h);
+
+		default:
+			break;
+	}
+
+	// P3 is text, written like writePPM does.
+	file.open(std::string(filePathWrite), (renderOutput == RenderOutput::PPM) ? std::ios::trunc : std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		std::cout << "Could not open " << filePathWrite << " for writing" << std::endl;
+		return false;
+	}
+
+	if (renderOutput == RenderOutput::PPM)
+	{
+		file << "P3\n" << w << " " << h << "\n255\n";
+		return true;
+	}
+
+	if (renderOutput == RenderOutput::P6)
+	{
+		file << "P6\n" << w << " " << h << "\n255\n";
+		rowSize = static_cast<size_t>(w) * 3;
+	}
+	else
+	{
+		// A negative scale marks little endian samples.
+		const uint16_t one = 1;
+		bool littleEndian = *reinterpret_cast<const uint8_t*>(&one) == 1;
+
+		file << "PF\n" << w << " " << h << "\n" << (littleEndian ? "-1.0" : "1.0") << "\n";
+		rowSize = static_cast<size_t>(w) * 3 * sizeof(float);
+	}
+
+	headerSize = file.tellp();
+
+	rowsPerBlock = std::max(1, static_cast<int32_t>((1 << 20) / std::max<size_t>(rowSize, 1)));
+	block.resize(rowSize * rowsPerBlock);
+
+	blockFirstRow = 0;
+	blockRows = 0;
+
+	return true;
+}
+
+void Output::writeRows(const Framebuffer& framebuffer, int32_t begin, int32_t end)
+{
+	if (!isStreamed())
+	{
+		return;
+	}
+
+	row.resize(framebuffer.getWidth());
+
+	for (int32_t y = begin; y < end; ++y)
+	{
+		framebuffer.getRow(y, row.data());
+		encodeRow(row.data());
+	}
+}
+
+void Output::encodeRow(const Vector3D<float>* pixels)
+{
+	int32_t w = static_cast<int32_t>(width);
+
+	switch (renderOutput)
+	{
+		case RenderOutput::PPM:
+		{
+			std::string text;
+
+			for (int32_t x = 0; x < w; ++x)
+			{
+				text += std::to_string(toByte(pixels[x].x)) + " " + std::to_string(toByte(pixels[x].y)) + " " + std::to_string(toByte(pixels[x].z)) + "\n";
+			}
+
+			file << text;
+			return;
+		}
+
+		case RenderOutput::PNG:
+		case RenderOutput::QOI:
+		{
+			rowBytes.resize(static_cast<size_t>(w) * 3);
+
+			for (int32_t x = 0; x < w; ++x)
+			{
+				rowBytes[x * 3 + 0] = toByte(pixels[x].x);
+				rowBytes[x * 3 + 1] = toByte(pixels[x].y);
+				rowBytes[x * 3 + 2] = toByte(pixels[x].z);
+			}
+
+			if (renderOutput == RenderOutput::PNG)
+			{
+				pngWriter.writeRow(rowBytes.data());
+			}
+			else
+			{
+				qoiWriter.writeRow(rowBytes.data());
+			}
+			return;
+		}
+
+		default:
+			break;
+	}
+
+	char* data = block.data() + blockRows * rowSize;
+
+	if (renderOutput == RenderOutput::P6)
+	{
+		for (int32_t x = 0; x < w; ++x)
+		{
+			data[x * 3 + 0] = static_cast<char>(toByte(pixels[x].x));
+			data[x * 3 + 1] = static_cast<char>(toByte(pixels[x].y));
+			data[x * 3 + 2] = static_cast<char>(toByte(pixels[x].z));
+		}
+	}
+	else
 	{
-		file << (int)(buffer[i].x * 255) << " " << (int)(buffer[i].y * 255) << " " << (int)(buffer[i].z * 255) << "\n";
+		for (int32_t x = 0; x < w; ++x)
+		{
+			float rgb[3] = { pixels[x].x, pixels[x].y, pixels[x].z };
+
+			std::memcpy(data + x * sizeof(rgb), rgb, sizeof(rgb));
+		}
 	}
 
-	buffer.clear();
+	if (++blockRows == rowsPerBlock)
+	{
+		writeBlock();
+	}
 }
 
-void Output::write()
+// Writes the finished rows of the block. PFM stores the bottom row first, so its rows are reversed and placed from the end of the file.
+void Output::writeBlock()
 {
+	if (blockRows == 0)
+	{
+		return;
+	}
+
+	std::streamoff row = blockFirstRow;
+
+	if (renderOutput == RenderOutput::PFM)
+	{
+		for (int32_t i = 0, j = blockRows - 1; i < j; ++i, --j)
+		{
+			std::swap_ranges(block.data() + i * rowSize, block.data() + (i + 1) * rowSize, block.data() + j * rowSize);
+		}
+
+		row = static_cast<int32_t>(height) - blockFirstRow - blockRows;
+	}
+
+	file.seekp(headerSize + row * static_cast<std::streamoff>(rowSize));
+	file.write(block.data(), blockRows * rowSize);
+
+	blockFirstRow += blockRows;
+	blockRows = 0;
+}
+
+void Output::quantize(const Framebuffer& framebuffer, std::vector<uint8_t>& rgb)
+{
+	int32_t w = framebuffer.getWidth();
+
+	rgb.resize(static_cast<size_t>(w) * framebuffer.getHeight() * 3);
+	row.resize(w);
+
+	for (int32_t y = 0; y < framebuffer.getHeight(); ++y)
+	{
+		framebuffer.getRow(y, row.data());
+
+		uint8_t* data = rgb.data() + static_cast<size_t>(y) * w * 3;
+
+		for (int32_t x = 0; x < w; ++x)
+		{
+			data[x * 3 + 0] = toByte(row[x].x);
+			data[x * 3 + 1] = toByte(row[x].y);
+			data[x * 3 + 2] = toByte(row[x].z);
+		}
+	}
+}
+
+void Output::write(const Framebuffer& framebuffer)
+{
+	if (streaming)
+	{
+		switch (renderOutput)
+		{
+			case RenderOutput::PNG:
+				pngWriter.close();
+				return;
+
+			case RenderOutput::QOI:
+				qoiWriter.close();
+				return;
+
+			case RenderOutput::PPM:
+				file.close();
+				return;
+
+			default:
+				break;
+		}
+	}
+
 	switch (renderOutput)
 	{
 		case RenderOutput::PPM:
-			writePPM();
+			writePPM(framebuffer);
+			break;
+
+		case RenderOutput::P6:
+		case RenderOutput::PFM:
+			writeRows(framebuffer, blockFirstRow + blockRows, framebuffer.getHeight());
+			writeBlock();
+			file.close();
+			break;
+
+		case RenderOutput::PNG:
+		case RenderOutput::QOI:
+		{
+			std::vector<uint8_t> rgb;
+			quantize(framebuffer, rgb);
+
+			if (renderOutput == RenderOutput::PNG)
+			{
+				writePNG(std::string(filePathWrite), rgb, framebuffer.getWidth(), framebuffer.getHeight());
+			}
+			else
+			{
+				writeQOI(std::string(filePathWrite), rgb, framebuffer.getWidth(), framebuffer.getHeight());
+			}
 			break;
+		}
 			
 		default:
 			break;
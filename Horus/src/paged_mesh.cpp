@@ -0,0 +1,370 @@
+#include "paged_mesh.h"
+#include "ply.h"
+#include <filesystem>
+#include <cstring>
+
+static const char pageFileMagic[4] = { 'H', 'R', 'S', 'P' };
+// Version 2 stores the source index of every triangle after the vertices of its page.
+static const uint32_t pageFileVersion = 2;
+
+struct GeometryPageFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t pageCount;
+	uint32_t trianglesPerPage;
+	uint64_t triangleCount;
+};
+
+PagedMeshObject::PagedMeshObject() : GeometryObject(GeometryType::PAGED_MESH), cache(256 * 1024 * 1024)
+{
+	position = Vector3D<float>(0.0f, 0.0f, 0.0f);
+	rotation = Vector3D<float>(0.0f, 0.0f, 0.0f);
+
+	size = 1.0f;
+}
+
+// Converts a PLY mesh into a page file. Triangles are grouped in BVH leaf order so every page covers a compact region of space.
+// The whole mesh is loaded once for the conversion; this can be done ahead of time on a machine with enough memory.
+bool PagedMeshObject::buildPageFile(const std::string& plyFilePath, const std::string& pageFilePath, uint32_t trianglesPerPage)
+{
+	std::vector<Vector3D<float>> vertices;
+	std::vector<uint32_t> indices;
+
+	if (!loadPLY(plyFilePath, vertices, indices))
+	{
+		return false;
+	}
+
+	size_t triangleCount = indices.size() / 3;
+
+	std::vector<BoundingBox> triangleBounds(triangleCount);
+
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		const Vector3D<float>& v0 = vertices[indices[3 * i]];
+		const Vector3D<float>& v1 = vertices[indices[3 * i + 1]];
+		const Vector3D<float>& v2 = vertices[indices[3 * i + 2]];
+
+		triangleBounds[i] = BoundingBox(Vector3D<float>(std::min({ v0.x, v1.x, v2.x }), std::min({ v0.y, v1.y, v2.y }), std::min({ v0.z, v1.z, v2.z })),
+		                                Vector3D<float>(std::max({ v0.x, v1.x, v2.x }), std::max({ v0.y, v1.y, v2.y }), std::max({ v0.z, v1.z, v2.z })));
+	}
+
+	PrimitiveBVH bvh;
+	bvh.build(triangleBounds);
+
+	const std::vector<uint32_t>& order = bvh.getIndices();
+
+	GeometryPageFileHeader header;
+	std::memcpy(header.magic, pageFileMagic, 4);
+	header.version = pageFileVersion;
+	header.trianglesPerPage = trianglesPerPage;
+	header.triangleCount = triangleCount;
+	header.pageCount = static_cast<uint32_t>((triangleCount + trianglesPerPage - 1) / trianglesPerPage);
+
+	std::vector<GeometryPageInfo> pageTable(header.pageCount);
+
+	uint64_t offset = sizeof(GeometryPageFileHeader) + pageTable.size() * sizeof(GeometryPageInfo);
+
+	for (uint32_t page = 0; page < header.pageCount; ++page)
+	{
+		size_t begin = static_cast<size_t>(page) * trianglesPerPage;
+		size_t end = std::min(begin + trianglesPerPage, triangleCount);
+
+		BoundingBox pageBounds = triangleBounds[order[begin]];
+
+		for (size_t i = begin + 1; i < end; ++i)
+		{
+			pageBounds += triangleBounds[order[i]];
+		}
+
+		GeometryPageInfo& info = pageTable[page];
+		info.offset = offset;
+		info.triangleCount = static_cast<uint32_t>(end - begin);
+		info.pad = 0;
+
+		for (int32_t a = 0; a < 3; ++a)
+		{
+			info.min[a] = pageBounds.getMin()[a];
+			info.max[a] = pageBounds.getMax()[a];
+		}
+
+		offset += static_cast<uint64_t>(info.triangleCount) * (3 * sizeof(Vector3D<float>) + sizeof(uint32_t));
+	}
+
+	std::ofstream file(pageFilePath, std::ios::binary);
+
+	if (!file.is_open())
+	{
+		std::cout << "Failed to create page file: " << pageFilePath << std::endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(pageTable.data()), pageTable.size() * sizeof(GeometryPageInfo));
+
+	std::vector<Vector3D<float>> pageVertices;
+	pageVertices.reserve(static_cast<size_t>(trianglesPerPage) * 3);
+
+	for (uint32_t page = 0; page < header.pageCount; ++page)
+	{
+		size_t begin = static_cast<size_t>(page) * trianglesPerPage;
+		size_t end = std::min(begin + trianglesPerPage, triangleCount);
+
+		pageVertices.clear();
+
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t triangle = order[i];
+
+			pageVertices.push_back(vertices[indices[3 * triangle]]);
+			pageVertices.push_back(vertices[indices[3 * triangle + 1]]);
+			pageVertices.push_back(vertices[indices[3 * triangle + 2]]);
+		}
+
+		file.write(reinterpret_cast<const char*>(pageVertices.data()), pageVertices.size() * sizeof(Vector3D<float>));
+		file.write(reinterpret_cast<const char*>(order.data() + begin), (end - begin) * sizeof(uint32_t));
+	}
+
+	if (!file.good())
+	{
+		std::cout << "Failed to write page file: " << pageFilePath << std::endl;
+		return false;
+	}
+
+	std::cout << "Wrote page file " << pageFilePath << ": " << header.pageCount << " pages of " << trianglesPerPage << " triangles" << std::endl;
+
+	return true;
+}
+
+// Page files written by an older version are converted again.
+static bool isCurrentPageFile(const std::string& pageFilePath)
+{
+	std::ifstream file(pageFilePath, std::ios::binary);
+
+	GeometryPageFileHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	return file.good() && std::memcmp(header.magic, pageFileMagic, 4) == 0 && header.version == pageFileVersion;
+}
+
+// Opens the page file and keeps its page table in memory. Returns true if successful, false otherwise.
+bool PagedMeshObject::loadFile(const std::string& filePath)
+{
+	namespace fs = std::filesystem;
+
+	std::error_code error;
+
+	sourceFilePath = filePath;
+
+	if (fs::path(filePath).extension() == ".hrsp")
+	{
+		pageFilePath = filePath;
+	}
+	else
+	{
+		pageFilePath = filePath + ".hrsp";
+
+		// Scene chunks are parsed in parallel, so two objects may ask for the same conversion at once.
+		static std::mutex conversionMutex;
+		std::lock_guard<std::mutex> lock(conversionMutex);
+
+		if (!fs::exists(pageFilePath, error) || fs::last_write_time(filePath, error) > fs::last_write_time(pageFilePath, error) || !isCurrentPageFile(pageFilePath))
+		{
+			if (!buildPageFile(filePath, pageFilePath))
+			{
+				return false;
+			}
+		}
+	}
+
+	pageFile.open(pageFilePath, std::ios::binary);
+
+	if (!pageFile.is_open())
+	{
+		std::cout << "Failed to open page file: " << pageFilePath << std::endl;
+		return false;
+	}
+
+	GeometryPageFileHeader header;
+	pageFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+	if (!pageFile.good() || std::memcmp(header.magic, pageFileMagic, 4) != 0 || header.version != pageFileVersion)
+	{
+		std::cout << "Invalid page file: " << pageFilePath << std::endl;
+		pageFile.close();
+		return false;
+	}
+
+	trianglesPerPage = header.trianglesPerPage;
+
+	// The page table and every page it points at must lie within the file, so a corrupt header cannot size the allocations.
+	uint64_t fileSize = fs::file_size(pageFilePath, error);
+
+	if (error || header.pageCount > (fileSize - sizeof(header)) / sizeof(GeometryPageInfo))
+	{
+		std::cout << "Truncated page table: " << pageFilePath << std::endl;
+		pageFile.close();
+		return false;
+	}
+
+	pages.resize(header.pageCount);
+	pageFile.read(reinterpret_cast<char*>(pages.data()), pages.size() * sizeof(GeometryPageInfo));
+
+	bool pagesInFile = pageFile.good();
+
+	for (size_t i = 0; i < pages.size() && pagesInFile; ++i)
+	{
+		uint64_t pageSize = static_cast<uint64_t>(pages[i].triangleCount) * (3 * sizeof(Vector3D<float>) + sizeof(uint32_t));
+
+		pagesInFile = pages[i].offset <= fileSize && pageSize <= fileSize - pages[i].offset;
+	}
+
+	if (!pagesInFile)
+	{
+		std::cout << "Truncated page table: " << pageFilePath << std::endl;
+		pages.clear();
+		pageFile.close();
+		return false;
+	}
+
+	std::vector<BoundingBox> pageBounds(pages.size());
+
+	for (size_t i = 0; i < pages.size(); ++i)
+	{
+		pageBounds[i] = BoundingBox(Vector3D<float>(pages[i].min[0], pages[i].min[1], pages[i].min[2]), Vector3D<float>(pages[i].max[0], pages[i].max[1], pages[i].max[2]));
+	}
+
+	pageBVH.build(pageBounds, 1);
+
+	cache.clear();
+
+	setBoundingBox();
+
+	std::cout << "Opened page file " << pageFilePath << ": " << header.triangleCount << " triangles in " << pages.size() << " pages" << std::endl;
+
+	return true;
+}
+
+// Reads one page from disk and builds its triangle BVH. Called by the cache on a miss.
+std::shared_ptr<GeometryPage> PagedMeshObject::loadPage(uint32_t page)
+{
+	const GeometryPageInfo& info = pages[page];
+
+	std::shared_ptr<GeometryPage> geometryPage = std::make_shared<GeometryPage>();
+	geometryPage->vertices.resize(static_cast<size_t>(info.triangleCount) * 3);
+	geometryPage->triangleIds.resize(info.triangleCount);
+
+	{
+		std::lock_guard<std::mutex> lock(pageFileMutex);
+
+		pageFile.seekg(static_cast<std::streamoff>(info.offset));
+		pageFile.read(reinterpret_cast<char*>(geometryPage->vertices.data()), geometryPage->vertices.size() * sizeof(Vector3D<float>));
+		pageFile.read(reinterpret_cast<char*>(geometryPage->triangleIds.data()), geometryPage->triangleIds.size() * sizeof(uint32_t));
+
+		if (!pageFile.good())
+		{
+			pageFile.clear();
+			std::cout << "Failed to read page " << page << " of " << pageFilePath << std::endl;
+			return nullptr;
+		}
+	}
+
+	std::vector<BoundingBox> triangleBounds(info.triangleCount);
+
+	for (size_t i = 0; i < triangleBounds.size(); ++i)
+	{
+		const Vector3D<float>& v0 = geometryPage->vertices[3 * i];
+		const Vector3D<float>& v1 = geometryPage->vertices[3 * i + 1];
+		const Vector3D<float>& v2 = geometryPage->vertices[3 * i + 2];
+
+		triangleBounds[i] = BoundingBox(Vector3D<float>(std::min({ v0.x, v1.x, v2.x }), std::min({ v0.y, v1.y, v2.y }), std::min({ v0.z, v1.z, v2.z })),
+		                                Vector3D<float>(std::max({ v0.x, v1.x, v2.x }), std::max({ v0.y, v1.y, v2.y }), std::max({ v0.z, v1.z, v2.z })));
+	}
+
+	geometryPage->bvh.build(triangleBounds);
+
+	return geometryPage;
+}
+
+void PagedMeshObject::setBoundingBox()
+{
+	R = rotationMatrix(rotation);
+
+	if (pageBVH.empty())
+	{
+		boundingBox.setMin(position);
+		boundingBox.setMax(position);
+	}
+	else
+	{
+		boundingBox.assignBoundingBox(toWorldBounds(pageBVH.getBounds(), position, R));
+	}
+
+	boundingBox.computeCentroid();
+}
+
+// Walks the BVH over page bounds; every page reached by the ray is fetched through the cache and traced with its own BVH.
+bool PagedMeshObject::rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit)
+{
+	Ray localRay = toObjectSpace(ray, position, R);
+
+	float closestT = tMax;
+	Vector3D<float> localNormal;
+	uint32_t closestTriangle = 0;
+
+	bool found = pageBVH.traversal(localRay, tMin, closestT, [&](uint32_t page, float t0, float t1)
+	{
+		std::shared_ptr<const GeometryPage> geometryPage = cache.get(page, [&]() { return loadPage(page); });
+
+		if (!geometryPage) { return -1.0f; }
+
+		const std::vector<Vector3D<float>>& v = geometryPage->vertices;
+
+		float pageT = t1;
+
+		bool pageHit = geometryPage->bvh.traversal(localRay, t0, pageT, [&](uint32_t triangle, float u0, float u1)
+		{
+			float t = intersectTriangle(localRay.origin, localRay.direction, v[3 * triangle], v[3 * triangle + 1], v[3 * triangle + 2], u0, u1);
+
+			if (t >= 0.0f)
+			{
+				localNormal = (v[3 * triangle + 1] - v[3 * triangle]) | (v[3 * triangle + 2] - v[3 * triangle]);
+				closestTriangle = geometryPage->triangleIds[triangle];
+			}
+
+			return t;
+		});
+
+		return pageHit ? pageT : -1.0f;
+	});
+
+	if (!found)
+	{
+		return false;
+	}
+
+	hit.front = (localNormal * localRay.direction) < 0.0f;
+	hit.back = !hit.front;
+
+	hit.normal = R * (hit.front ? localNormal : -localNormal);
+	hit.normal.normalize();
+
+	hit.hitPoint = ray.getPointat(closestT);
+	hit.t = closestT;
+	hit.primitive = closestTriangle;
+
+	return true;
+}
+
+// Reports how well the page cache served the render.
+void PagedMeshObject::printStatistics()
+{
+	uint64_t lookups = cache.getHits() + cache.getMisses();
+	double hitRate = (lookups > 0) ? 100.0 * static_cast<double>(cache.getHits()) / static_cast<double>(lookups) : 0.0;
+
+	std::cout << getObjectName() << " cache (" << pageFilePath << "): "
+	          << cache.getHits() << " hits, " << cache.getMisses() << " misses (" << hitRate << "% hit rate), "
+	          << cache.getEvictions() << " evictions, "
+	          << cache.getMemoryUsage() / (1024 * 1024) << " / " << cache.getCapacity() / (1024 * 1024) << " MB resident" << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "particles.h"
+#include "mapped_file.h"
+#include <charconv>
+#include <cstring>
+
+ParticleSetObject::ParticleSetObject() : GeometryObject(GeometryType::PARTICLES)
+{
+	position = Vector3D<float>(0.0f, 0.0f, 0.0f);
+	rotation = Vector3D<float>(0.0f, 0.0f, 0.0f);
+
+	size = 1.0f;
+}
+
+// Loads the particles from a CSV or binary point file and builds the BVH. Returns true if successful, false otherwise.
+bool ParticleSetObject::loadFile(const std::string& filePath)
+{
+	sourceFilePath = filePath;
+
+	std::string_view extension = std::string_view(filePath).substr(filePath.find_last_of('.') == std::string::npos ? filePath.size() : filePath.find_last_of('.'));
+
+	bool result = (extension == ".csv" || extension == ".txt") ? loadCSV(filePath) : loadBinary(filePath);
+
+	if (!result)
+	{
+		centers.clear();
+		radii.clear();
+		return false;
+	}
+
+	// A set where every particle uses the default radius does not need the radius array.
+	if (std::all_of(radii.begin(), radii.end(), [](float r) { return r <= 0.0f; }))
+	{
+		radii.clear();
+		radii.shrink_to_fit();
+	}
+	else
+	{
+		for (float& r : radii)
+		{
+			if (r <= 0.0f) { r = size; }
+		}
+	}
+
+	centers.shrink_to_fit();
+
+	buildBVH();
+
+	std::cout << "Loaded particles " << filePath << ": " << getParticleCount() << " particles" << std::endl;
+
+	return true;
+}
+
+// Reads x,y,z[,r] lines. Blank lines, '#' comments and a non numeric header line are skipped.
+bool ParticleSetObject::loadCSV(const std::string& filePath)
+{
+	MappedFile file(filePath);
+
+	if (!file.isOpen())
+	{
+		std::cout << "Failed to open particle file: " << filePath << std::endl;
+		return false;
+	}
+
+	const char* p = file.begin();
+	const char* end = file.end();
+
+	size_t lineNumber = 0;
+
+	while (p < end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+
+		if (lineEnd == nullptr) { lineEnd = end; }
+
+		++lineNumber;
+
+		float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		int32_t count = 0;
+
+		const char* c = p;
+
+		while (c < lineEnd && count < 4)
+		{
+			while (c < lineEnd && (*c == ' ' || *c == '\t' || *c == ',' || *c == '\r')) { ++c; }
+
+			if (c == lineEnd || *c == '#') { break; }
+
+			std::from_chars_result result = std::from_chars(c, lineEnd, values[count]);
+
+			if (result.ec != std::errc()) { break; }
+
+			c = result.ptr;
+			++count;
+		}
+
+		if (count >= 3)
+		{
+			centers.emplace_back(values[0], values[1], values[2]);
+			radii.push_back(count == 4 ? values[3] : 0.0f);
+		}
+		else if (count != 0 && !(lineNumber == 1 && centers.empty()))
+		{
+			std::cout << "Invalid particle on line " << lineNumber << " of " << filePath << std::endl;
+			return false;
+		}
+
+		p = lineEnd + 1;
+	}
+
+	return true;
+}
+
+// Reads packed float32 x,y,z,r records straight out of the mapped file.
+bool ParticleSetObject::loadBinary(const std::string& filePath)
+{
+	MappedFile file(filePath);
+
+	if (!file.isOpen())
+	{
+		std::cout << "Failed to open particle file: " << filePath << std::endl;
+		return false;
+	}
+
+	const size_t recordSize = 4 * sizeof(float);
+
+	if (file.getSize() % recordSize != 0)
+	{
+		std::cout << "Particle file size is not a multiple of " << recordSize << " bytes: " << filePath << std::endl;
+		return false;
+	}
+
+	size_t count = file.getSize() / recordSize;
+
+	centers.resize(count);
+	radii.resize(count);
+
+	const char* src = file.getData();
+
+	for (size_t i = 0; i < count; ++i, src += recordSize)
+	{
+		std::memcpy(&centers[i], src, 3 * sizeof(float));
+		std::memcpy(&radii[i], src + 3 * sizeof(float), sizeof(float));
+	}
+
+	return true;
+}
+
+// Sets the default radius. Rebuilds the BVH if the particles are already loaded and rely on it.
+void ParticleSetObject::setRadius(float r)
+{
+	size = r;
+
+	if (!centers.empty() && radii.empty())
+	{
+		buildBVH();
+	}
+}
+
+void ParticleSetObject::buildBVH()
+{
+	std::vector<BoundingBox> particleBounds(centers.size());
+
+	for (size_t i = 0; i < centers.size(); ++i)
+	{
+		float r = getRadius(static_cast<uint32_t>(i));
+
+		particleBounds[i] = BoundingBox(centers[i] - Vector3D<float>(r, r, r), centers[i] + Vector3D<float>(r, r, r));
+	}
+
+	bvh.build(particleBounds);
+
+	setBoundingBox();
+}
+
+void ParticleSetObject::setBoundingBox()
+{
+	if (bvh.empty())
+	{
+		boundingBox.setMin(position);
+		boundingBox.setMax(position);
+	}
+	else
+	{
+		BoundingBox local = bvh.getBounds();
+
+		boundingBox.setMin(local.getMin() + position);
+		boundingBox.setMax(local.getMax() + position);
+	}
+
+	boundingBox.computeCentroid();
+}
+
+// Intersects the ray with the particles, using the same quadratic as SphereObject.
+bool ParticleSetObject::rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit)
+{
+	Ray localRay(ray.origin - position, ray.direction);
+
+	float a = localRay.direction * localRay.direction;
+
+	float closestT = tMax;
+	uint32_t closestParticle = 0;
+	bool closestFront = true;
+
+	bool found = bvh.traversal(localRay, tMin, closestT, [&](uint32_t particle, float t0, float t1)
+	{
+		float r = getRadius(particle);
+
+		Vector3D<float> oc = localRay.origin - centers[particle];
+
+		float b = (localRay.direction * oc) * 2.0f;
+		float c = (oc * oc) - (r * r);
+
+		float discriminant = (b * b) - (4 * a * c);
+
+		if (discriminant < 0) { return -1.0f; }
+
+		float sqr = std::sqrt(discriminant);
+
+		float tNear = (-b - sqr) / (2.0f * a);
+		float tFar = (-b + sqr) / (2.0f * a);
+
+		if (tNear > t0 && tNear < t1)
+		{
+			closestParticle = particle;
+			closestFront = true;
+			return tNear;
+		}
+
+		if (tFar > t0 && tFar < t1)
+		{
+			closestParticle = particle;
+			closestFront = false;
+			return tFar;
+		}
+
+		return -1.0f;
+	});
+
+	if (!found)
+	{
+		return false;
+	}
+
+	hit.front = closestFront;
+	hit.hitPoint = ray.getPointat(closestT);
+	hit.t = closestT;
+	hit.primitive = closestParticle;
+
+	return true;
+}
\ No newline at end of file
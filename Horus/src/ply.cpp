@@ -0,0 +1,577 @@
+#include "ply.h"
+#include "mapped_file.h"
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+enum class PlyFormat {
+	ASCII,
+	BINARY_LITTLE_ENDIAN,
+	BINARY_BIG_ENDIAN
+};
+
+enum class PlyScalar {
+	INT8,
+	UINT8,
+	INT16,
+	UINT16,
+	INT32,
+	UINT32,
+	FLOAT32,
+	FLOAT64,
+	INVALID
+};
+
+struct PlyProperty
+{
+	std::string name;
+	PlyScalar type = PlyScalar::INVALID;
+
+	bool isList = false;
+	PlyScalar countType = PlyScalar::INVALID;
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count = 0;
+
+	std::vector<PlyProperty> properties;
+};
+
+static_assert(sizeof(Vector3D<float>) == 3 * sizeof(float), "Vector3D<float> must be tightly packed for the PLY fast path");
+
+static PlyScalar StringToPlyScalar(std::string_view s)
+{
+	if (s == "char" || s == "int8") return PlyScalar::INT8;
+	if (s == "uchar" || s == "uint8") return PlyScalar::UINT8;
+	if (s == "short" || s == "int16") return PlyScalar::INT16;
+	if (s == "ushort" || s == "uint16") return PlyScalar::UINT16;
+	if (s == "int" || s == "int32") return PlyScalar::INT32;
+	if (s == "uint" || s == "uint32") return PlyScalar::UINT32;
+	if (s == "float" || s == "float32") return PlyScalar::FLOAT32;
+	if (s == "double" || s == "float64") return PlyScalar::FLOAT64;
+
+	return PlyScalar::INVALID;
+}
+
+static size_t PlyScalarSize(PlyScalar type)
+{
+	switch (type)
+	{
+		case PlyScalar::INT8:
+		case PlyScalar::UINT8:
+			return 1;
+
+		case PlyScalar::INT16:
+		case PlyScalar::UINT16:
+			return 2;
+
+		case PlyScalar::INT32:
+		case PlyScalar::UINT32:
+		case PlyScalar::FLOAT32:
+			return 4;
+
+		case PlyScalar::FLOAT64:
+			return 8;
+
+		default:
+			return 0;
+	}
+}
+
+static bool HostIsLittleEndian()
+{
+	const uint16_t probe = 1;
+	uint8_t firstByte;
+	std::memcpy(&firstByte, &probe, 1);
+
+	return firstByte == 1;
+}
+
+// Splits the next whitespace separated word off the front of 'line'.
+static std::string_view NextWord(std::string_view& line)
+{
+	size_t begin = line.find_first_not_of(" \t\r");
+
+	if (begin == std::string_view::npos)
+	{
+		line = std::string_view();
+		return std::string_view();
+	}
+
+	size_t end = line.find_first_of(" \t\r", begin);
+
+	std::string_view word = line.substr(begin, end - begin);
+	line = (end == std::string_view::npos) ? std::string_view() : line.substr(end);
+
+	return word;
+}
+
+// Parses the PLY header. On success 'body' points to the first byte after "end_header".
+static bool ParsePlyHeader(const char* begin, const char* end, PlyFormat& format, std::vector<PlyElement>& elements, const char*& body)
+{
+	const char* p = begin;
+	bool magic = false;
+	bool formatFound = false;
+
+	while (p < end)
+	{
+		const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', end - p));
+
+		if (lineEnd == nullptr)
+		{
+			return false;
+		}
+
+		std::string_view line(p, lineEnd - p);
+		p = lineEnd + 1;
+
+		std::string_view keyword = NextWord(line);
+
+		if (!magic)
+		{
+			if (keyword != "ply") { return false; }
+			magic = true;
+		}
+		else if (keyword == "format")
+		{
+			std::string_view f = NextWord(line);
+
+			if (f == "ascii") { format = PlyFormat::ASCII; }
+			else if (f == "binary_little_endian") { format = PlyFormat::BINARY_LITTLE_ENDIAN; }
+			else if (f == "binary_big_endian") { format = PlyFormat::BINARY_BIG_ENDIAN; }
+			else { return false; }
+
+			formatFound = true;
+		}
+		else if (keyword == "element")
+		{
+			PlyElement element;
+			element.name = std::string(NextWord(line));
+
+			std::string_view count = NextWord(line);
+
+			if (std::from_chars(count.data(), count.data() + count.size(), element.count).ec != std::errc())
+			{
+				return false;
+			}
+
+			elements.push_back(element);
+		}
+		else if (keyword == "property")
+		{
+			if (elements.empty()) { return false; }
+
+			PlyProperty property;
+			std::string_view type = NextWord(line);
+
+			if (type == "list")
+			{
+				property.isList = true;
+				property.countType = StringToPlyScalar(NextWord(line));
+				property.type = StringToPlyScalar(NextWord(line));
+
+				if (property.countType == PlyScalar::INVALID) { return false; }
+			}
+			else
+			{
+				property.type = StringToPlyScalar(type);
+			}
+
+			if (property.type == PlyScalar::INVALID) { return false; }
+
+			property.name = std::string(NextWord(line));
+			elements.back().properties.push_back(property);
+		}
+		else if (keyword == "end_header")
+		{
+			body = p;
+			return formatFound;
+		}
+
+		// "comment", "obj_info" and unknown keywords are ignored
+	}
+
+	return false;
+}
+
+// Reads sequential values from the binary body of a PLY file, swapping bytes when the file endianness differs from the host.
+class PlyBinaryReader
+{
+	public:
+		PlyBinaryReader(const char* begin, const char* end, bool swap) : p(begin), end(end), swap(swap) {}
+
+		bool skip(size_t bytes)
+		{
+			if (static_cast<size_t>(end - p) < bytes) { return false; }
+
+			p += bytes;
+			return true;
+		}
+
+		bool read(PlyScalar type, double& value)
+		{
+			size_t size = PlyScalarSize(type);
+
+			if (static_cast<size_t>(end - p) < size) { return false; }
+
+			unsigned char bytes[8];
+			std::memcpy(bytes, p, size);
+			p += size;
+
+			if (swap)
+			{
+				for (size_t i = 0; i < size / 2; ++i)
+				{
+					std::swap(bytes[i], bytes[size - 1 - i]);
+				}
+			}
+
+			switch (type)
+			{
+				case PlyScalar::INT8: { int8_t v; std::memcpy(&v, bytes, 1); value = v; break; }
+				case PlyScalar::UINT8: { uint8_t v; std::memcpy(&v, bytes, 1); value = v; break; }
+				case PlyScalar::INT16: { int16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+				case PlyScalar::UINT16: { uint16_t v; std::memcpy(&v, bytes, 2); value = v; break; }
+				case PlyScalar::INT32: { int32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+				case PlyScalar::UINT32: { uint32_t v; std::memcpy(&v, bytes, 4); value = v; break; }
+				case PlyScalar::FLOAT32: { float v; std::memcpy(&v, bytes, 4); value = v; break; }
+				case PlyScalar::FLOAT64: { double v; std::memcpy(&v, bytes, 8); value = v; break; }
+				default: return false;
+			}
+
+			return true;
+		}
+
+		const char* p;
+		const char* end;
+
+	private:
+		bool swap;
+};
+
+// Reads sequential whitespace separated values from the body of an ASCII PLY file.
+class PlyAsciiReader
+{
+	public:
+		PlyAsciiReader(const char* begin, const char* end) : p(begin), end(end) {}
+
+		bool read(PlyScalar, double& value)
+		{
+			while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+			{
+				++p;
+			}
+
+			std::from_chars_result result = std::from_chars(p, end, value);
+
+			if (result.ec != std::errc())
+			{
+				return false;
+			}
+
+			p = result.ptr;
+			return true;
+		}
+
+		const char* p;
+		const char* end;
+};
+
+// Fans a polygon into triangles and appends them to 'indices'. Returns false if an index is out of range.
+static bool AppendPolygon(const uint32_t* polygon, size_t n, size_t vertexCount, std::vector<uint32_t>& indices)
+{
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (polygon[i] >= vertexCount) { return false; }
+	}
+
+	for (size_t i = 2; i < n; ++i)
+	{
+		indices.push_back(polygon[0]);
+		indices.push_back(polygon[i - 1]);
+		indices.push_back(polygon[i]);
+	}
+
+	return true;
+}
+
+// Reads every element of the body one value at a time. Used for ASCII and big-endian files and for unusual binary layouts.
+template <typename Reader>
+static bool ReadElementGeneric(Reader& reader, const PlyElement& element, std::vector<Vector3D<float>>& vertices, std::vector<uint32_t>& indices)
+{
+	bool isVertex = element.name == "vertex";
+	bool isFace = element.name == "face";
+
+	std::vector<uint32_t> polygon;
+	double value;
+
+	for (size_t e = 0; e < element.count; ++e)
+	{
+		Vector3D<float> vertex;
+
+		for (const PlyProperty& property : element.properties)
+		{
+			if (property.isList)
+			{
+				// Values are read as doubles; out of range ones would make the casts below undefined.
+				if (!reader.read(property.countType, value) || !(value >= 0.0 && value <= UINT32_MAX)) { return false; }
+
+				size_t n = static_cast<size_t>(value);
+				bool isIndexList = isFace && (property.name == "vertex_indices" || property.name == "vertex_index");
+
+				polygon.clear();
+
+				for (size_t i = 0; i < n; ++i)
+				{
+					if (!reader.read(property.type, value)) { return false; }
+
+					if (isIndexList)
+					{
+						if (!(value >= 0.0 && value <= UINT32_MAX)) { return false; }
+
+						polygon.push_back(static_cast<uint32_t>(value));
+					}
+				}
+
+				if (isIndexList && !AppendPolygon(polygon.data(), polygon.size(), vertices.size(), indices))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (!reader.read(property.type, value)) { return false; }
+
+				if (isVertex)
+				{
+					if (property.name == "x") { vertex.x = static_cast<float>(value); }
+					else if (property.name == "y") { vertex.y = static_cast<float>(value); }
+					else if (property.name == "z") { vertex.z = static_cast<float>(value); }
+				}
+			}
+		}
+
+		if (isVertex)
+		{
+			vertices[e] = vertex;
+		}
+	}
+
+	return true;
+}
+
+// Copies the vertex positions straight out of the mapped file. Only valid for little-endian files whose vertices have a fixed size
+// and float x, y, z properties. Returns false if the layout does not qualify.
+static bool ReadVerticesFast(PlyBinaryReader& reader, const PlyElement& element, std::vector<Vector3D<float>>& vertices)
+{
+	size_t stride = 0;
+	size_t offsets[3] = { SIZE_MAX, SIZE_MAX, SIZE_MAX };
+
+	for (const PlyProperty& property : element.properties)
+	{
+		if (property.isList) { return false; }
+
+		int32_t axis = (property.name == "x") ? 0 : (property.name == "y") ? 1 : (property.name == "z") ? 2 : -1;
+
+		if (axis >= 0)
+		{
+			if (property.type != PlyScalar::FLOAT32) { return false; }
+			offsets[axis] = stride;
+		}
+
+		stride += PlyScalarSize(property.type);
+	}
+
+	if (offsets[0] == SIZE_MAX || offsets[1] == SIZE_MAX || offsets[2] == SIZE_MAX)
+	{
+		return false;
+	}
+
+	if (static_cast<size_t>(reader.end - reader.p) / stride < element.count)
+	{
+		return false;
+	}
+
+	const char* src = reader.p;
+
+	if (stride == sizeof(Vector3D<float>) && offsets[0] == 0 && offsets[1] == 4 && offsets[2] == 8)
+	{
+		// Layout matches Vector3D<float> exactly, so the whole array is one copy.
+		std::memcpy(vertices.data(), src, element.count * stride);
+	}
+	else
+	{
+		for (size_t i = 0; i < element.count; ++i, src += stride)
+		{
+			std::memcpy(&vertices[i].x, src + offsets[0], sizeof(float));
+			std::memcpy(&vertices[i].y, src + offsets[1], sizeof(float));
+			std::memcpy(&vertices[i].z, src + offsets[2], sizeof(float));
+		}
+	}
+
+	reader.p += element.count * stride;
+
+	return true;
+}
+
+// Copies the face indices of a little-endian file whose only face property is a uchar-counted list of 32-bit indices.
+// Returns 0 if the layout does not qualify, -1 on malformed data and 1 on success.
+static int32_t ReadFacesFast(PlyBinaryReader& reader, const PlyElement& element, size_t vertexCount, std::vector<uint32_t>& indices)
+{
+	if (element.properties.size() != 1) { return 0; }
+
+	const PlyProperty& property = element.properties[0];
+
+	if (!property.isList || property.countType != PlyScalar::UINT8) { return 0; }
+	if (property.type != PlyScalar::INT32 && property.type != PlyScalar::UINT32) { return 0; }
+
+	const char* p = reader.p;
+	const char* end = reader.end;
+
+	uint32_t polygon[256];
+
+	for (size_t e = 0; e < element.count; ++e)
+	{
+		if (p >= end) { return -1; }
+
+		size_t n = static_cast<uint8_t>(*p++);
+
+		if (static_cast<size_t>(end - p) < n * sizeof(uint32_t)) { return -1; }
+
+		std::memcpy(polygon, p, n * sizeof(uint32_t));
+		p += n * sizeof(uint32_t);
+
+		if (n == 3 && polygon[0] < vertexCount && polygon[1] < vertexCount && polygon[2] < vertexCount)
+		{
+			indices.insert(indices.end(), polygon, polygon + 3);
+		}
+		else if (!AppendPolygon(polygon, n, vertexCount, indices))
+		{
+			return -1;
+		}
+	}
+
+	reader.p = p;
+
+	return 1;
+}
+
+// Fewest bytes one instance of 'element' can take in the body: binary scalars take their size and lists at least their count, ASCII
+// values at least one character and a separator. At least 1, so that the element count is bounded by the body size.
+static size_t MinimumElementSize(const PlyElement& element, PlyFormat format)
+{
+	size_t size = 0;
+
+	for (const PlyProperty& property : element.properties)
+	{
+		if (format == PlyFormat::ASCII)
+		{
+			size += 2;
+		}
+		else
+		{
+			size += PlyScalarSize(property.isList ? property.countType : property.type);
+		}
+	}
+
+	return std::max<size_t>(size, 1);
+}
+
+bool loadPLY(const std::string& filePath, std::vector<Vector3D<float>>& vertices, std::vector<uint32_t>& indices)
+{
+	MappedFile file(filePath);
+
+	if (!file.isOpen())
+	{
+		std::cout << "Failed to open PLY file: " << filePath << std::endl;
+		return false;
+	}
+
+	PlyFormat format = PlyFormat::ASCII;
+	std::vector<PlyElement> elements;
+	const char* body = nullptr;
+
+	if (!ParsePlyHeader(file.begin(), file.end(), format, elements, body))
+	{
+		std::cout << "Invalid PLY header: " << filePath << std::endl;
+		return false;
+	}
+
+	vertices.clear();
+	indices.clear();
+
+	// The counts of the header size the buffers below, so a corrupt or truncated file must not get to ask for more than its body can hold.
+	size_t remaining = static_cast<size_t>(file.end() - body);
+
+	for (const PlyElement& element : elements)
+	{
+		size_t elementSize = MinimumElementSize(element, format);
+
+		if (element.count > remaining / elementSize)
+		{
+			std::cout << "PLY header declares more " << element.name << " elements than the file holds: " << filePath << std::endl;
+			return false;
+		}
+
+		remaining -= element.count * elementSize;
+	}
+
+	for (const PlyElement& element : elements)
+	{
+		if (element.name == "vertex") { vertices.resize(element.count); }
+		if (element.name == "face") { indices.reserve(element.count * 3); }
+	}
+
+	bool result = true;
+
+	if (format == PlyFormat::ASCII)
+	{
+		PlyAsciiReader reader(body, file.end());
+
+		for (const PlyElement& element : elements)
+		{
+			if (!(result = ReadElementGeneric(reader, element, vertices, indices))) { break; }
+		}
+	}
+	else
+	{
+		bool littleEndian = HostIsLittleEndian();
+		bool swap = (format == PlyFormat::BINARY_LITTLE_ENDIAN) != littleEndian;
+
+		PlyBinaryReader reader(body, file.end(), swap);
+
+		for (const PlyElement& element : elements)
+		{
+			if (!swap && element.name == "vertex" && ReadVerticesFast(reader, element, vertices))
+			{
+				continue;
+			}
+
+			if (!swap && element.name == "face")
+			{
+				int32_t fast = ReadFacesFast(reader, element, vertices.size(), indices);
+
+				if (fast < 0) { result = false; break; }
+				if (fast > 0) { continue; }
+			}
+
+			if (!(result = ReadElementGeneric(reader, element, vertices, indices))) { break; }
+		}
+	}
+
+	if (!result)
+	{
+		std::cout << "Malformed or truncated PLY file: " << filePath << std::endl;
+
+		vertices.clear();
+		indices.clear();
+
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "png.h"
+#include "deflate.h"
+#include <array>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+{
+	static const std::array<uint32_t, 256> table = []()
+	{
+		std::array<uint32_t, 256> values;
+
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			uint32_t c = i;
+
+			for (int32_t k = 0; k < 8; ++k)
+			{
+				c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			}
+
+			values[i] = c;
+		}
+
+		return values;
+	}();
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value)
+{
+	out.push_back(static_cast<uint8_t>(value >> 24));
+	out.push_back(static_cast<uint8_t>(value >> 16));
+	out.push_back(static_cast<uint8_t>(value >> 8));
+	out.push_back(static_cast<uint8_t>(value));
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const uint8_t* data, size_t size)
+{
+	std::vector<uint8_t> header;
+	appendBigEndian(header, static_cast<uint32_t>(size));
+	header.insert(header.end(), type, type + 4);
+
+	uint32_t crc = crc32(header.data() + 4, 4);
+	crc = crc32(data, size, crc);
+
+	std::vector<uint8_t> trailer;
+	appendBigEndian(trailer, crc);
+
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	file.write(reinterpret_cast<const char*>(data), size);
+	file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+}
+
+static uint8_t paeth(int32_t a, int32_t b, int32_t c)
+{
+	int32_t p = a + b - c;
+	int32_t pa = std::abs(p - a);
+	int32_t pb = std::abs(p - b);
+	int32_t pc = std::abs(p - c);
+
+	if (pa <= pb && pa <= pc) { return static_cast<uint8_t>(a); }
+	if (pb <= pc) { return static_cast<uint8_t>(b); }
+
+	return static_cast<uint8_t>(c);
+}
+
+// Filters 'row' into 'out' (filter type byte + filtered bytes), trying the five filters and keeping the one whose output has the
+// smallest sum of absolute values, the usual predictor of how well a row compresses. 'above' is the previous row, null for the first one.
+static void filterRow(const uint8_t* row, const uint8_t* above, size_t rowSize, uint8_t* out, std::vector<uint8_t>& scratch)
+{
+	const int32_t bpp = 3;
+
+	scratch.resize(rowSize);
+
+	uint64_t bestSum = UINT64_MAX;
+
+	for (uint8_t type = 0; type < 5; ++type)
+	{
+		uint64_t sum = 0;
+
+		for (size_t i = 0; i < rowSize; ++i)
+		{
+			int32_t a = (i >= bpp) ? row[i - bpp] : 0;
+			int32_t b = above ? above[i] : 0;
+			int32_t c = (above && i >= bpp) ? above[i - bpp] : 0;
+
+			uint8_t value = row[i];
+
+			switch (type)
+			{
+				case 1: value = static_cast<uint8_t>(value - a); break;
+				case 2: value = static_cast<uint8_t>(value - b); break;
+				case 3: value = static_cast<uint8_t>(value - ((a + b) >> 1)); break;
+				case 4: value = static_cast<uint8_t>(value - paeth(a, b, c)); break;
+				default: break;
+			}
+
+			scratch[i] = value;
+			sum += static_cast<uint64_t>(std::abs(static_cast<int8_t>(value)));
+		}
+
+		if (sum < bestSum)
+		{
+			bestSum = sum;
+			out[0] = type;
+			std::copy(scratch.begin(), scratch.end(), out + 1);
+		}
+	}
+}
+
+// Signature, IHDR, and the first IDAT holding the zlib header; the deflate stream follows in further IDAT chunks.
+static void writeHeader(std::ofstream& file, int32_t width, int32_t height)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+	std::vector<uint8_t> header;
+	appendBigEndian(header, static_cast<uint32_t>(width));
+	appendBigEndian(header, static_cast<uint32_t>(height));
+	header.push_back(8);	// bit depth
+	header.push_back(2);	// color type: RGB
+	header.push_back(0);	// compression
+	header.push_back(0);	// filter method
+	header.push_back(0);	// no interlace
+
+	writeChunk(file, "IHDR", header.data(), header.size());
+
+	static const uint8_t zlibHeader[2] = { 0x78, 0x01 };
+	writeChunk(file, "IDAT", zlibHeader, sizeof(zlibHeader));
+}
+
+// The Adler-32 checksum of the zlib stream goes after the last deflate chunk.
+static void writeTrailer(std::ofstream& file, uint32_t adler)
+{
+	std::vector<uint8_t> checksum;
+	appendBigEndian(checksum, adler);
+
+	writeChunk(file, "IDAT", checksum.data(), checksum.size());
+	writeChunk(file, "IEND", nullptr, 0);
+}
+
+bool writePNG(const std::string& filePath, const std::vector<uint8_t>& rgb, int32_t width, int32_t height, int32_t threads)
+{
+	std::ofstream file(filePath, std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "Could not open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	if (threads <= 0)
+	{
+		threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
+
+	const size_t rowSize = static_cast<size_t>(width) * 3;
+	const size_t filteredRowSize = rowSize + 1;
+
+	// Stripes of at least 256 KB of pixel data: enough for the 32 KB window not to matter, and several stripes per thread on large frames.
+	const int32_t rowsPerStripe = std::max(1, static_cast<int32_t>((256 * 1024) / std::max<size_t>(rowSize, 1)));
+	const int32_t stripeCount = std::max(1, (height + rowsPerStripe - 1) / rowsPerStripe);
+
+	std::vector<uint8_t> filtered(filteredRowSize * height);
+	std::vector<std::vector<uint8_t>> stripes(stripeCount);
+
+	std::atomic<int32_t> nextStripe{ 0 };
+
+	auto compressStripes = [&]()
+	{
+		std::vector<uint8_t> scratch;
+
+		for (int32_t s = nextStripe++; s < stripeCount; s = nextStripe++)
+		{
+			int32_t begin = s * rowsPerStripe;
+			int32_t end = std::min(height, begin + rowsPerStripe);
+
+			// Filters only read the unfiltered rows, so stripes are filtered independently as well.
+			for (int32_t y = begin; y < end; ++y)
+			{
+				const uint8_t* row = rgb.data() + y * rowSize;
+
+				filterRow(row, (y > 0) ? row - rowSize : nullptr, rowSize, filtered.data() + y * filteredRowSize, scratch);
+			}
+
+			deflateCompress(filtered.data() + begin * filteredRowSize, (end - begin) * filteredRowSize, s == stripeCount - 1, stripes[s]);
+		}
+	};
+
+	std::vector<std::thread> workers;
+
+	for (int32_t t = 1; t < std::min(threads, stripeCount); ++t)
+	{
+		workers.emplace_back(compressStripes);
+	}
+
+	compressStripes();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	writeHeader(file, width, height);
+
+	// One IDAT per stripe.
+	for (const std::vector<uint8_t>& stripe : stripes)
+	{
+		writeChunk(file, "IDAT", stripe.data(), stripe.size());
+	}
+
+	writeTrailer(file, adler32(filtered.data(), filtered.size()));
+
+	if (!file)
+	{
+		std::cout << "Failed writing " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool PNGStreamWriter::open(const std::string& filePath, int32_t width, int32_t height)
+{
+	file.open(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		std::cout << "Could not open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	this->filePath = filePath;
+	rowSize = static_cast<size_t>(width) * 3;
+	previous.assign(rowSize, 0);
+	filtered.clear();
+	adler = 1;
+	rows = 0;
+
+	writeHeader(file, width, height);
+
+	return true;
+}
+
+void PNGStreamWriter::writeRow(const uint8_t* rgb)
+{
+	size_t offset = filtered.size();
+	filtered.resize(offset + rowSize + 1);
+
+	filterRow(rgb, (rows > 0) ? previous.data() : nullptr, rowSize, filtered.data() + offset, scratch);
+	std::copy(rgb, rgb + rowSize, previous.begin());
+
+	++rows;
+
+	// Same chunk size as the stripes of writePNG.
+	if (filtered.size() >= 256 * 1024)
+	{
+		flush(false);
+	}
+}
+
+void PNGStreamWriter::flush(bool final)
+{
+	compressed.clear();
+	deflateCompress(filtered.data(), filtered.size(), final, compressed);
+
+	adler = adler32(filtered.data(), filtered.size(), adler);
+
+	writeChunk(file, "IDAT", compressed.data(), compressed.size());
+	filtered.clear();
+}
+
+bool PNGStreamWriter::close()
+{
+	flush(true);
+	writeTrailer(file, adler);
+
+	file.close();
+
+	if (!file)
+	{
+		std::cout << "Failed writing " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
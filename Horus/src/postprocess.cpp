@@ -0,0 +1,277 @@
+#include "postprocess.h"
+#include "half.h"
+#include <array>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HORUS_SSE2
+#include <emmintrin.h>
+#endif
+
+const int32_t tileFloats = Framebuffer::tileSize * Framebuffer::tileSize * 3;
+
+bool stringToToneMapping(std::string_view name, ToneMapping& toneMapping)
+{
+	if (name == "none") { toneMapping = ToneMapping::NONE; return true; }
+	if (name == "reinhard") { toneMapping = ToneMapping::REINHARD; return true; }
+	if (name == "aces") { toneMapping = ToneMapping::ACES; return true; }
+
+	std::cout << "Unknown tone mapping: " << name << " (none, reinhard or aces)" << std::endl;
+
+	return false;
+}
+
+// 16x16 Bayer matrix, built by interleaving the bits of x ^ y and y, lowest bits most significant.
+float PostProcess::getDither(int32_t x, int32_t y)
+{
+	int32_t value = 0;
+
+	for (int32_t bit = 0; bit < 4; ++bit)
+	{
+		int32_t xb = (x >> bit) & 1;
+		int32_t yb = (y >> bit) & 1;
+
+		value |= (2 * (xb ^ yb) + yb) << (2 * (3 - bit));
+	}
+
+	return ((value + 0.5f) / 256.0f - 0.5f) / 255.0f;
+}
+
+// Dither values in the order of the floats of a tile: three equal entries per pixel.
+static const std::array<float, tileFloats>& getDitherTable()
+{
+	static const std::array<float, tileFloats> table = []()
+	{
+		std::array<float, tileFloats> values;
+
+		for (int32_t i = 0; i < tileFloats; ++i)
+		{
+			int32_t pixel = i / 3;
+
+			values[i] = PostProcess::getDither(pixel % Framebuffer::tileSize, pixel / Framebuffer::tileSize);
+		}
+
+		return values;
+	}();
+
+	return table;
+}
+
+static float acesFilmic(float x)
+{
+	float value = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+
+	return std::min(std::max(value, 0.0f), 1.0f);
+}
+
+float PostProcess::applyScalar(float value, float ditherOffset) const
+{
+	// Negative radiance (the negative lobes of a Mitchell filter on a hard edge) and NaN go to 0 before the curves, whose roots
+	// are not defined below it; std::max returns its first argument when the comparison fails.
+	value = std::max(0.0f, value * std::exp2(settings.exposure));
+
+	switch (settings.toneMapping)
+	{
+		case ToneMapping::REINHARD: value = value / (1.0f + value); break;
+		case ToneMapping::ACES: value = acesFilmic(value); break;
+		default: break;
+	}
+
+	switch (settings.transferCurve)
+	{
+		case TransferCurve::GAMMA2: value = std::sqrt(value); break;
+		case TransferCurve::SRGB: value = (value <= 0.0031308f) ? 12.92f * value : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f; break;
+		default: break;
+	}
+
+	if (settings.dither)
+	{
+		value += ditherOffset;
+	}
+
+	return value;
+}
+
+#ifdef HORUS_SSE2
+
+// log2 of positive values: exponent from the bits, then log2 of the mantissa m in [sqrt(1/2), sqrt(2)) as
+// 2 / ln(2) * atanh(t), t = (m - 1) / (m + 1), |t| < 0.172, with the odd series up to t^9.
+static __m128 log2Positive(__m128 x)
+{
+	__m128i bits = _mm_castps_si128(x);
+
+	__m128 exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+	__m128 mantissa = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+	__m128 large = _mm_cmpgt_ps(mantissa, _mm_set1_ps(1.41421356f));
+	mantissa = _mm_or_ps(_mm_and_ps(large, _mm_mul_ps(mantissa, _mm_set1_ps(0.5f))), _mm_andnot_ps(large, mantissa));
+	exponent = _mm_add_ps(exponent, _mm_and_ps(large, _mm_set1_ps(1.0f)));
+
+	__m128 one = _mm_set1_ps(1.0f);
+	__m128 t = _mm_div_ps(_mm_sub_ps(mantissa, one), _mm_add_ps(mantissa, one));
+	__m128 t2 = _mm_mul_ps(t, t);
+
+	__m128 series = _mm_set1_ps(1.0f / 9.0f);
+	series = _mm_add_ps(_mm_mul_ps(series, t2), _mm_set1_ps(1.0f / 7.0f));
+	series = _mm_add_ps(_mm_mul_ps(series, t2), _mm_set1_ps(1.0f / 5.0f));
+	series = _mm_add_ps(_mm_mul_ps(series, t2), _mm_set1_ps(1.0f / 3.0f));
+	series = _mm_add_ps(_mm_mul_ps(series, t2), one);
+
+	return _mm_add_ps(exponent, _mm_mul_ps(_mm_mul_ps(series, t), _mm_set1_ps(2.88539008f)));
+}
+
+// exp2 for arguments within the float exponent range: 2^n from the bits, n = round(x), times e^(f ln 2), |f| <= 0.5, as a degree 7 Taylor polynomial.
+static __m128 exp2Approximate(__m128 x)
+{
+	__m128i n = _mm_cvtps_epi32(x);
+	__m128 f = _mm_mul_ps(_mm_sub_ps(x, _mm_cvtepi32_ps(n)), _mm_set1_ps(0.69314718f));
+
+	__m128 p = _mm_set1_ps(1.0f / 5040.0f);
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 720.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 120.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 24.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 6.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.5f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+	p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+	__m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23));
+
+	return _mm_mul_ps(p, scale);
+}
+
+void PostProcess::processRange(float* values, size_t count) const
+{
+	const std::array<float, tileFloats>& ditherTable = getDitherTable();
+
+	const __m128 exposure = _mm_set1_ps(std::exp2(settings.exposure));
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+
+	// Ranges start on a tile boundary and tiles hold a multiple of 4 floats, so count is a multiple of 4 as well and the dither
+	// table lines up with the tile pattern.
+	for (size_t i = 0; i < count; i += 4)
+	{
+		// Same clamp as applyScalar: maxps returns its second operand for NaN.
+		__m128 x = _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(values + i), exposure), zero);
+
+		switch (settings.toneMapping)
+		{
+			case ToneMapping::REINHARD:
+				x = _mm_div_ps(x, _mm_add_ps(one, x));
+				break;
+
+			case ToneMapping::ACES:
+			{
+				__m128 numerator = _mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.51f)), _mm_set1_ps(0.03f)));
+				__m128 denominator = _mm_add_ps(_mm_mul_ps(x, _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(2.43f)), _mm_set1_ps(0.59f))), _mm_set1_ps(0.14f));
+
+				x = _mm_min_ps(_mm_max_ps(_mm_div_ps(numerator, denominator), zero), one);
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		switch (settings.transferCurve)
+		{
+			case TransferCurve::GAMMA2:
+				x = _mm_sqrt_ps(x);
+				break;
+
+			case TransferCurve::SRGB:
+			{
+				__m128 linear = _mm_mul_ps(x, _mm_set1_ps(12.92f));
+				__m128 curve = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(1.055f), exp2Approximate(_mm_mul_ps(log2Positive(_mm_max_ps(x, _mm_set1_ps(1e-30f))), _mm_set1_ps(1.0f / 2.4f)))), _mm_set1_ps(0.055f));
+				__m128 small = _mm_cmple_ps(x, _mm_set1_ps(0.0031308f));
+
+				x = _mm_or_ps(_mm_and_ps(small, linear), _mm_andnot_ps(small, curve));
+				break;
+			}
+
+			default:
+				break;
+		}
+
+		if (settings.dither)
+		{
+			x = _mm_add_ps(x, _mm_loadu_ps(ditherTable.data() + i % tileFloats));
+		}
+
+		_mm_storeu_ps(values + i, x);
+	}
+}
+
+#else
+
+void PostProcess::processRange(float* values, size_t count) const
+{
+	const std::array<float, tileFloats>& ditherTable = getDitherTable();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		values[i] = applyScalar(values[i], ditherTable[i % tileFloats]);
+	}
+}
+
+#endif
+
+void PostProcess::apply(Framebuffer& framebuffer, int32_t tileRowBegin, int32_t tileRowEnd, int32_t threads) const
+{
+	if (isIdentity() || tileRowBegin >= tileRowEnd)
+	{
+		return;
+	}
+
+	size_t count = framebuffer.getTileRowFloats() * (tileRowEnd - tileRowBegin);
+
+	// Half storage is converted in bulk one tile at a time, so the kernels always run on floats.
+	float* values = framebuffer.isHalfPrecision() ? nullptr : framebuffer.getTileRowData(tileRowBegin);
+	uint16_t* halves = framebuffer.isHalfPrecision() ? framebuffer.getTileRowHalfData(tileRowBegin) : nullptr;
+
+	auto processTiles = [this, values, halves](size_t begin, size_t end)
+	{
+		if (values)
+		{
+			processRange(values + begin * tileFloats, (end - begin) * tileFloats);
+			return;
+		}
+
+		std::array<float, tileFloats> tile;
+
+		for (size_t t = begin; t < end; ++t)
+		{
+			halvesToFloats(halves + t * tileFloats, tile.data(), tileFloats);
+			processRange(tile.data(), tileFloats);
+			floatsToHalves(tile.data(), halves + t * tileFloats, tileFloats);
+		}
+	};
+
+	if (threads <= 0)
+	{
+		threads = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+	}
+
+	// Below about 256K channels the pass takes less time than starting threads.
+	size_t tiles = count / tileFloats;
+	size_t tilesPerThread = std::max<size_t>((tiles + threads - 1) / threads, (256 * 1024) / tileFloats);
+
+	std::vector<std::thread> workers;
+
+	for (size_t tile = tilesPerThread; tile < tiles; tile += tilesPerThread)
+	{
+		workers.emplace_back(processTiles, tile, std::min(tiles, tile + tilesPerThread));
+	}
+
+	processTiles(0, std::min(tiles, tilesPerThread));
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
\ No newline at end of file
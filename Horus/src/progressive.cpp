@@ -0,0 +1,100 @@
+#include "progressive.h"
+#include <filesystem>
+#include <iostream>
+
+void ProgressiveWriter::start(std::chrono::milliseconds interval)
+{
+	this->interval = interval;
+
+	thread = std::thread(&ProgressiveWriter::run, this);
+}
+
+void ProgressiveWriter::stop()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	wake.notify_all();
+	thread.join();
+}
+
+void ProgressiveWriter::submit(const Framebuffer& accumulation)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		snapshot = accumulation;
+		submitted = true;
+		requested = false;
+	}
+
+	wake.notify_all();
+}
+
+void ProgressiveWriter::run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (!stopping)
+	{
+		if (wake.wait_for(lock, interval, [&]() { return stopping; }))
+		{
+			break;
+		}
+
+		requested = true;
+
+		wake.wait(lock, [&]() { return submitted || stopping; });
+
+		if (!submitted)
+		{
+			break;
+		}
+
+		submitted = false;
+
+		// No new snapshot can arrive until the next request, so the snapshot is read without holding the lock.
+		lock.unlock();
+		writePreview();
+		lock.lock();
+	}
+
+	requested = false;
+}
+
+void ProgressiveWriter::writePreview()
+{
+	resolve(snapshot, image);
+
+	std::string partialPath = filePath + ".part";
+
+	Output output(renderOutput);
+	output.setFilePathWrite(partialPath);
+	output.setWidth(static_cast<float>(image.getWidth()));
+	output.setHeight(static_cast<float>(image.getHeight()));
+
+	if (!output.open())
+	{
+		return;
+	}
+
+	output.write(image);
+
+	std::error_code error;
+	std::filesystem::rename(partialPath, filePath, error);
+
+	if (error)
+	{
+		std::cout << "Could not write preview " << filePath << ": " << error.message() << std::endl;
+		return;
+	}
+
+	++previewCount;
+}
\ No newline at end of file
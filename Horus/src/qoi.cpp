@@ -0,0 +1,150 @@
+#include "qoi.h"
+#include <iostream>
+#include <algorithm>
+
+bool writeQOI(const std::string& filePath, const std::vector<uint8_t>& rgb, int32_t width, int32_t height)
+{
+	QOIStreamWriter writer;
+
+	if (!writer.open(filePath, width, height))
+	{
+		return false;
+	}
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		writer.writeRow(rgb.data() + static_cast<size_t>(y) * width * 3);
+	}
+
+	return writer.close();
+}
+
+bool QOIStreamWriter::open(const std::string& filePath, int32_t width, int32_t height)
+{
+	file.open(filePath, std::ios::binary | std::ios::trunc);
+
+	if (!file)
+	{
+		std::cout << "Could not open " << filePath << " for writing" << std::endl;
+		return false;
+	}
+
+	this->filePath = filePath;
+	this->width = width;
+	pixelsLeft = static_cast<size_t>(width) * height;
+
+	std::fill(index, index + 64, QOIPixel());
+	previous = QOIPixel();
+	run = 0;
+
+	out.clear();
+	out.reserve(1 << 16);
+
+	auto appendBigEndian = [&](uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	};
+
+	out.insert(out.end(), { 'q', 'o', 'i', 'f' });
+	appendBigEndian(static_cast<uint32_t>(width));
+	appendBigEndian(static_cast<uint32_t>(height));
+	out.push_back(3);	// channels: RGB
+	out.push_back(0);	// sRGB
+
+	return true;
+}
+
+void QOIStreamWriter::writeRow(const uint8_t* rgb)
+{
+	for (int32_t x = 0; x < width; ++x)
+	{
+		QOIPixel pixel;
+		pixel.r = rgb[x * 3 + 0];
+		pixel.g = rgb[x * 3 + 1];
+		pixel.b = rgb[x * 3 + 2];
+
+		--pixelsLeft;
+
+		if (pixel == previous)
+		{
+			if (++run == 62 || pixelsLeft == 0)
+			{
+				out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			continue;
+		}
+
+		if (run > 0)
+		{
+			out.push_back(static_cast<uint8_t>(0xC0 | (run - 1)));
+			run = 0;
+		}
+
+		int32_t slot = (pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64;
+
+		if (index[slot] == pixel)
+		{
+			out.push_back(static_cast<uint8_t>(slot));
+		}
+		else
+		{
+			index[slot] = pixel;
+
+			// Differences wrap around like the 8 bit channels do.
+			int32_t dr = static_cast<int8_t>(pixel.r - previous.r);
+			int32_t dg = static_cast<int8_t>(pixel.g - previous.g);
+			int32_t db = static_cast<int8_t>(pixel.b - previous.b);
+
+			int32_t drg = dr - dg;
+			int32_t dbg = db - dg;
+
+			if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+			{
+				out.push_back(static_cast<uint8_t>(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+			}
+			else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7)
+			{
+				out.push_back(static_cast<uint8_t>(0x80 | (dg + 32)));
+				out.push_back(static_cast<uint8_t>(((drg + 8) << 4) | (dbg + 8)));
+			}
+			else
+			{
+				out.insert(out.end(), { 0xFE, pixel.r, pixel.g, pixel.b });
+			}
+		}
+
+		previous = pixel;
+	}
+
+	if (out.size() >= (1 << 16))
+	{
+		flush();
+	}
+}
+
+void QOIStreamWriter::flush()
+{
+	file.write(reinterpret_cast<const char*>(out.data()), out.size());
+	out.clear();
+}
+
+bool QOIStreamWriter::close()
+{
+	out.insert(out.end(), { 0, 0, 0, 0, 0, 0, 0, 1 });
+	flush();
+
+	file.close();
+
+	if (!file)
+	{
+		std::cout << "Failed writing " << filePath << std::endl;
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "reference.h"
+#include <filesystem>
+
+AssetLibrary& AssetLibrary::getInstance()
+{
+	static AssetLibrary library;
+	return library;
+}
+
+// Parses the asset file into its own object list and builds a BVH over its geometries. Cameras and lights in an asset are ignored.
+std::shared_ptr<SceneAsset> AssetLibrary::load(const std::string& filePath)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	std::error_code error;
+	std::string canonicalPath = std::filesystem::weakly_canonical(std::filesystem::path(filePath), error).string();
+
+	if (error)
+	{
+		canonicalPath = filePath;
+	}
+
+	auto it = assets.find(canonicalPath);
+
+	if (it != assets.end())
+	{
+		return it->second;
+	}
+
+	if (loading.count(canonicalPath) != 0)
+	{
+		std::cout << "Asset references itself: " << filePath << std::endl;
+		return nullptr;
+	}
+
+	loading.insert(canonicalPath);
+
+	std::shared_ptr<SceneAsset> asset = std::make_shared<SceneAsset>();
+
+	if (!SceneBuilder(filePath, asset->objects, 1))
+	{
+		std::cout << "Failed to load asset: " << filePath << std::endl;
+		asset = nullptr;
+	}
+	else
+	{
+		for (const auto& object : asset->objects)
+		{
+			if (object->getType() == SceneObjectType::GEOMETRY)
+			{
+				GeometryObject* geometry = static_cast<GeometryObject*>(object.get());
+
+				asset->bounds = asset->geometries.empty() ? geometry->getBoundingBox() : asset->bounds + geometry->getBoundingBox();
+				asset->geometries.push_back(geometry);
+			}
+		}
+
+		if (asset->geometries.empty())
+		{
+			std::cout << "Asset has no geometry: " << filePath << std::endl;
+			asset = nullptr;
+		}
+		else
+		{
+			asset->bvh.buildBVH(asset->geometries);
+		}
+	}
+
+	loading.erase(canonicalPath);
+
+	// Failed loads are cached too, so every reference to a broken asset reports it only once.
+	assets[canonicalPath] = asset;
+
+	return asset;
+}
+
+ReferenceObject::ReferenceObject() : GeometryObject(GeometryType::REFERENCE)
+{
+	position = Vector3D<float>(0.0f, 0.0f, 0.0f);
+	rotation = Vector3D<float>(0.0f, 0.0f, 0.0f);
+
+	size = 1.0f;
+}
+
+void ReferenceObject::ensureLoaded(bool onDemand)
+{
+	std::call_once(loadFlag, [&]()
+	{
+		asset = AssetLibrary::getInstance().load(assetPath);
+		loadedOnDemand = onDemand;
+	});
+}
+
+// Without proxy bounds the real bounds are needed for the scene BVH, so the asset is loaded right away.
+void ReferenceObject::endParameters()
+{
+	if (!hasProxyBounds && !assetPath.empty())
+	{
+		ensureLoaded(false);
+	}
+
+	setBoundingBox();
+}
+
+// Loads assets whose proxy bounds the camera can see, so only the ones hidden from the camera are left for rays to load.
+void ReferenceObject::prepare(CameraObject& camera)
+{
+	if (!assetPath.empty() && camera.isInFrustum(boundingBox))
+	{
+		ensureLoaded(false);
+	}
+}
+
+void ReferenceObject::setBoundingBox()
+{
+	BoundingBox local;
+
+	if (hasProxyBounds)
+	{
+		local = proxyBounds;
+	}
+	else if (asset)
+	{
+		local = asset->bounds;
+	}
+
+	boundingBox.setMin(local.getMin() + position);
+	boundingBox.setMax(local.getMax() + position);
+
+	boundingBox.computeCentroid();
+}
+
+// Traces the ray through the asset BVH in asset space. Normal and shader of the asset object are resolved into the hit right away, as
+// the caller only knows the reference.
+bool ReferenceObject::rayIntersection(Ray& ray, float tMin, float tMax, HitRecord& hit)
+{
+	if (assetPath.empty())
+	{
+		return false;
+	}
+
+	ensureLoaded(true);
+
+	if (!asset)
+	{
+		return false;
+	}
+
+	Ray localRay(ray.origin - position, ray.direction);
+
+	HitRecord localHit;
+	GeometryObject* object = asset->bvh.traversal(localRay, tMin, tMax, localHit);
+
+	if (object == nullptr)
+	{
+		return false;
+	}
+
+	hit = localHit;
+	hit.normal = object->getNormal(localHit);
+	hit.shader = &object->getShader(localHit);
+	hit.hitPoint = ray.getPointat(hit.t);
+
+	return true;
+}
+
+// Reports whether the asset was loaded up front, on demand by a ray, or never.
+void ReferenceObject::printStatistics()
+{
+	const char* state = !asset ? "not loaded" : (loadedOnDemand ? "loaded on demand" : "loaded before rendering");
+
+	std::cout << getObjectName() << " " << assetPath << ": " << state << " (" << AssetLibrary::getInstance().getAssetCount() << " assets cached)" << std::endl;
+}
\ No newline at end of file
@@ -1,4 +1,29 @@
 #include "render.h"
+#include <iostream>
+
+bool stringToAOVType(std::string_view name, AOVType& type)
+{
+	if (name == "depth") { type = AOVType::DEPTH; return true; }
+	if (name == "normal") { type = AOVType::NORMAL; return true; }
+	if (name == "albedo") { type = AOVType::ALBEDO; return true; }
+	if (name == "id") { type = AOVType::PRIMITIVE_ID; return true; }
+
+	std::cout << "Unknown AOV: " << name << " (depth, normal, albedo or id)" << std::endl;
+
+	return false;
+}
+
+const char* aovTypeToString(AOVType type)
+{
+	switch (type)
+	{
+		case AOVType::DEPTH: return "depth";
+		case AOVType::NORMAL: return "normal";
+		case AOVType::ALBEDO: return "albedo";
+		case AOVType::PRIMITIVE_ID: return "id";
+		default: return "unknown";
+	}
+}
 
 // Converts a vector from local space to world space based on the normal at the hit point and a reference vector.
 Vector3D<float> Integrator::toWorld(Vector3D<float> v, Vector3D<float> refVector)
@@ -24,16 +49,39 @@ Vector3D<float> Integrator::toWorld(Vector3D<float> v, Vector3D<float> refVector
 }
 
 // Traces the path of a ray through the scene, calculating the color contribution at each intersection point.
-Vector3D<float> Integrator::rayPath(Ray& ray, BVH& bvh, int nBounces)
+Vector3D<float> Integrator::rayPath(Ray& ray, BVH& bvh, int nBounces, AOVSample* aov)
 {
-	GeometryObject* closestHit = bvh.traversal(ray, ray.getTMin(), ray.getTMax());
+	++rayCount;
+
+	HitRecord hit;
+	GeometryObject* closestHit = bvh.traversal(ray, ray.getTMin(), ray.getTMax(), hit);
 	float closestT = ray.getTMax();
 
 	Vector3D<float> color(0.0f, 0.0f, 0.0f);
 
 	if (closestHit)
 	{
-		auto& shader = closestHit->getShader();
+		auto& shader = closestHit->getShader(hit);
+
+		if (aov)
+		{
+			aov->depth = hit.t;
+			aov->normal = closestHit->getNormal(hit);
+			aov->id = Vector3D<float>(static_cast<float>(closestHit->getObjectId()), static_cast<float>(hit.primitive), 0.0f);
+
+			if (auto surface = std::get_if<Surface>(&shader))
+			{
+				aov->albedo = surface->getDiffuseColor() * surface->getDiffuseGain();
+			}
+			else if (std::holds_alternative<Constant>(shader))
+			{
+				aov->albedo = std::visit([](auto& p) { return p.getColor(); }, shader);
+			}
+			else
+			{
+				aov->albedo = Vector3D<float>(1.0f, 1.0f, 1.0f);
+			}
+		}
 
 		if (std::holds_alternative<Constant>(shader))
 		{
@@ -43,7 +91,7 @@ Vector3D<float> Integrator::rayPath(Ray& ray, BVH& bvh, int nBounces)
 		}
 		else if (std::holds_alternative<Depth>(shader))
 		{
-			color = Vector3D<float>(1.0f / closestHit->hitRecord.t, 1.0f / closestHit->hitRecord.t, 1.0f / closestHit->hitRecord.t);
+			color = Vector3D<float>(1.0f / hit.t, 1.0f / hit.t, 1.0f / hit.t);
 
 			return color;
 		}
@@ -54,8 +102,7 @@ Vector3D<float> Integrator::rayPath(Ray& ray, BVH& bvh, int nBounces)
 		}
 		else
 		{
-			Vector3D<float> hitPoint = ray.getPointat(closestHit->hitRecord.t);
-			closestHit->computeNormal();
+			Vector3D<float> hitPoint = ray.getPointat(hit.t);
 
 			float diffuseGain = 1.0f;
 			Vector3D<float> diffuseColor(1.0f, 1.0f, 1.0f);
@@ -71,16 +118,16 @@ Vector3D<float> Integrator::rayPath(Ray& ray, BVH& bvh, int nBounces)
 			// create new ray from hit point
 
 			Ray reflected = ray;
-			Vector3D<float> normal = closestHit->getNormal();
+			Vector3D<float> normal = closestHit->getNormal(hit);
 			reflected.reflect(normal);
 			Vector3D<float> reflectedDir = reflected.getDirection();
 
-			float r1 = unitRandom.Generate();
-			float r2 = unitRandom.Generate();
+			float r1 = sampler.get1D();
+			float r2 = sampler.get1D();
 
 			Vector3D<float> rndDir = Sampler::cosineWeightSampleHemisphere(r1, r2);
 
-			Vector3D<float> diffuseScatter = toWorld(rndDir, closestHit->getNormal());
+			Vector3D<float> diffuseScatter = toWorld(rndDir, normal);
 
 			Vector3D<float> finalScatter = (reflectedDir * (1.0f - roughness)) + (diffuseScatter * roughness);
 			
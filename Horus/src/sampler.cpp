@@ -1,4 +1,9 @@
 #include "sampler.h"
+#include <array>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
 
 UnitRandom::UnitRandom() : dis(0.0f, 1.0f)
 {
@@ -10,11 +15,40 @@ float UnitRandom::Generate()
 	return dis(gen);
 }
 
+std::string UnitRandom::getState() const
+{
+	std::ostringstream stream;
+	stream << gen;
+
+	return stream.str();
+}
+
+bool UnitRandom::setState(const std::string& state)
+{
+	std::istringstream stream(state);
+	stream >> gen;
+
+	return static_cast<bool>(stream);
+}
+
 Sampler::Sampler()
 {
 
 }
 
+// The two engine states, one per line.
+std::string Sampler::getState() const
+{
+	return cameraRandom.getState() + "\n" + pathRandom.getState();
+}
+
+bool Sampler::setState(const std::string& state)
+{
+	size_t separator = state.find('\n');
+
+	return separator != std::string::npos && cameraRandom.setState(state.substr(0, separator)) && pathRandom.setState(state.substr(separator + 1));
+}
+
 // Generates a cosine-weighted random direction in the hemisphere defined by the normal vector.
 Vector3D<float> Sampler::cosineWeightSampleHemisphere(float r1, float r2)
 {
@@ -25,4 +59,382 @@ Vector3D<float> Sampler::cosineWeightSampleHemisphere(float r1, float r2)
 	float z = std::sqrt(1.0f - r2);
 
 	return Vector3D<float>(x, y, z);
+}
+
+// Integer hash with good avalanche (lowbias32).
+static uint32_t hash(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+
+	return x;
+}
+
+static uint32_t hashCombine(uint32_t seed, uint32_t value)
+{
+	return hash(seed ^ (value + 0x9E3779B9u + (seed << 6) + (seed >> 2)));
+}
+
+// The top 24 bits, so the result is exactly representable and below 1.
+static float toUnitFloat(uint32_t bits)
+{
+	return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+
+float Sampler::generate(int32_t dim)
+{
+	return (dim < cameraDimensions) ? cameraRandom.Generate() : pathRandom.Generate();
+}
+
+uint32_t Sampler::pixelSeed(int32_t dim) const
+{
+	return hashCombine(hashCombine(hash(static_cast<uint32_t>(pixelX)), static_cast<uint32_t>(pixelY)), static_cast<uint32_t>(dim));
+}
+
+void Sampler::seed(uint32_t value)
+{
+	cameraRandom.seed(hash(value));
+	pathRandom.seed(hashCombine(hash(value), 1));
+}
+
+// Random permutation of [0, length) indexed by 'seed' (Kensler 2013, "Correlated Multi-Jittered Sampling").
+static uint32_t permute(uint32_t i, uint32_t length, uint32_t seed)
+{
+	uint32_t w = length - 1;
+	w |= w >> 1;
+	w |= w >> 2;
+	w |= w >> 4;
+	w |= w >> 8;
+	w |= w >> 16;
+
+	do
+	{
+		i ^= seed;
+		i *= 0xE170893Du;
+		i ^= seed >> 16;
+		i ^= (i & w) >> 4;
+		i ^= seed >> 8;
+		i *= 0x0929EB3Fu;
+		i ^= seed >> 23;
+		i ^= (i & w) >> 1;
+		i *= 1 | seed >> 27;
+		i *= 0x6935FA69u;
+		i ^= (i & w) >> 11;
+		i *= 0x74DCB303u;
+		i ^= (i & w) >> 2;
+		i *= 0x9E501CC3u;
+		i ^= (i & w) >> 2;
+		i *= 0xC860A3DFu;
+		i &= w;
+		i ^= i >> 5;
+	} while (i >= length);
+
+	return (i + seed) % length;
+}
+
+float StratifiedSampler::generate(int32_t dim)
+{
+	uint32_t count = static_cast<uint32_t>(std::max(sampleCount, 1));
+	uint32_t index = static_cast<uint32_t>(sampleIndex) % count;
+
+	uint32_t seed = pixelSeed(dim);
+	uint32_t stratum = permute(index, count, seed);
+	float jitter = toUnitFloat(hashCombine(seed, index));
+
+	return std::min((stratum + jitter) / count, 0.99999994f);
+}
+
+// Direction numbers of the first four Sobol dimensions (Joe and Kuo), expanded to 32 bits.
+static const std::array<std::array<uint32_t, 32>, 4>& getSobolDirections()
+{
+	static const std::array<std::array<uint32_t, 32>, 4> directions = []()
+	{
+		std::array<std::array<uint32_t, 32>, 4> v;
+
+		// Degree s, coefficients a and initial numbers m of the primitive polynomials; dimension 0 is the van der Corput sequence.
+		const uint32_t degree[4] = { 0, 1, 2, 3 };
+		const uint32_t coefficients[4] = { 0, 0, 1, 1 };
+		const uint32_t initial[4][3] = { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 3, 0 }, { 1, 3, 1 } };
+
+		for (int32_t i = 0; i < 32; ++i)
+		{
+			v[0][i] = 1u << (31 - i);
+		}
+
+		for (int32_t d = 1; d < 4; ++d)
+		{
+			uint32_t s = degree[d];
+
+			for (uint32_t i = 0; i < 32; ++i)
+			{
+				if (i < s)
+				{
+					v[d][i] = initial[d][i] << (31 - i);
+					continue;
+				}
+
+				v[d][i] = v[d][i - s] ^ (v[d][i - s] >> s);
+
+				for (uint32_t k = 1; k < s; ++k)
+				{
+					v[d][i] ^= ((coefficients[d] >> (s - 1 - k)) & 1) * v[d][i - k];
+				}
+			}
+		}
+
+		return v;
+	}();
+
+	return directions;
+}
+
+// XOR of the direction numbers selected by each possible byte of the index, per byte position: the scrambled indices use all 32 bits,
+// at random, so four lookups replace a loop whose branches the processor cannot predict.
+static const std::array<std::array<std::array<uint32_t, 256>, 4>, 4>& getSobolTables()
+{
+	static const std::array<std::array<std::array<uint32_t, 256>, 4>, 4> tables = []()
+	{
+		std::array<std::array<std::array<uint32_t, 256>, 4>, 4> t;
+
+		for (int32_t d = 0; d < 4; ++d)
+		{
+			const std::array<uint32_t, 32>& v = getSobolDirections()[d];
+
+			for (int32_t position = 0; position < 4; ++position)
+			{
+				for (uint32_t byte = 0; byte < 256; ++byte)
+				{
+					uint32_t x = 0;
+
+					for (int32_t bit = 0; bit < 8; ++bit)
+					{
+						x ^= ((byte >> bit) & 1) ? v[position * 8 + bit] : 0;
+					}
+
+					t[d][position][byte] = x;
+				}
+			}
+		}
+
+		return t;
+	}();
+
+	return tables;
+}
+
+static uint32_t sobol(uint32_t index, int32_t dim)
+{
+	const std::array<std::array<uint32_t, 256>, 4>& t = getSobolTables()[dim];
+
+	return t[0][index & 0xFF] ^ t[1][(index >> 8) & 0xFF] ^ t[2][(index >> 16) & 0xFF] ^ t[3][index >> 24];
+}
+
+static uint32_t reverseBits(uint32_t x)
+{
+	x = (x << 16) | (x >> 16);
+	x = ((x & 0x00FF00FFu) << 8) | ((x & 0xFF00FF00u) >> 8);
+	x = ((x & 0x0F0F0F0Fu) << 4) | ((x & 0xF0F0F0F0u) >> 4);
+	x = ((x & 0x33333333u) << 2) | ((x & 0xCCCCCCCCu) >> 2);
+	x = ((x & 0x55555555u) << 1) | ((x & 0xAAAAAAAAu) >> 1);
+
+	return x;
+}
+
+// Owen scrambling of the bits of 'x': every bit is flipped depending on the bits above it. The Laine-Karras style hash acts
+// on the reversed bits, where each bit only depends on the bits below it (Burley 2020).
+static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed)
+{
+	x = reverseBits(x);
+
+	x += seed;
+	x ^= x * 0x6C50B47Cu;
+	x ^= x * 0xB82F1E52u;
+	x ^= x * 0xC7AFE638u;
+	x ^= x * 0x8D22F6E6u;
+
+	return reverseBits(x);
+}
+
+uint32_t sobolOwen(uint32_t index, int32_t dim, uint32_t seed)
+{
+	return nestedUniformScramble(sobol(nestedUniformScramble(index, seed), dim), hashCombine(seed, static_cast<uint32_t>(dim)));
+}
+
+float SobolSampler::generate(int32_t dim)
+{
+	// Sets of four dimensions, each with its own seed.
+	uint32_t seed = pixelSeed(dim / 4);
+
+	return toUnitFloat(sobolOwen(static_cast<uint32_t>(sampleIndex), dim % 4, seed));
+}
+
+// Ranks of a 64x64 void and cluster pattern (Ulichney 1993): the initial pattern comes from removing the tightest cluster and filling
+// the largest void until they meet, then ones are removed from the tightest cluster and added to the largest void, the rank being the
+// order in which a cell turns on. Energy is a toroidal Gaussian of sigma 1.5.
+static const std::vector<float>& getBlueNoiseMask()
+{
+	static const std::vector<float> mask = []()
+	{
+		const int32_t size = BlueNoiseSampler::maskSize;
+		const int32_t cells = size * size;
+
+		std::vector<float> kernel(cells);
+
+		for (int32_t y = 0; y < size; ++y)
+		{
+			for (int32_t x = 0; x < size; ++x)
+			{
+				float dx = static_cast<float>(std::min(x, size - x));
+				float dy = static_cast<float>(std::min(y, size - y));
+
+				kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.5f * 1.5f));
+			}
+		}
+
+		std::vector<uint8_t> pattern(cells, 0);
+		std::vector<float> energy(cells, 0.0f);
+
+		auto toggle = [&](int32_t cell, bool on)
+		{
+			pattern[cell] = on ? 1 : 0;
+
+			int32_t cx = cell % size;
+			int32_t cy = cell / size;
+			float sign = on ? 1.0f : -1.0f;
+
+			for (int32_t y = 0; y < size; ++y)
+			{
+				for (int32_t x = 0; x < size; ++x)
+				{
+					energy[y * size + x] += sign * kernel[((y - cy + size) % size) * size + (x - cx + size) % size];
+				}
+			}
+		};
+
+		// Tightest cluster: the one with the most energy. Largest void: the zero with the least.
+		auto find = [&](uint8_t value, bool highest)
+		{
+			int32_t best = -1;
+
+			for (int32_t cell = 0; cell < cells; ++cell)
+			{
+				if (pattern[cell] == value && (best < 0 || (highest ? energy[cell] > energy[best] : energy[cell] < energy[best])))
+				{
+					best = cell;
+				}
+			}
+
+			return best;
+		};
+
+		std::mt19937 random(1);
+		const int32_t initialCount = cells / 10;
+
+		for (int32_t placed = 0; placed < initialCount;)
+		{
+			int32_t cell = static_cast<int32_t>(random() % cells);
+
+			if (!pattern[cell])
+			{
+				toggle(cell, true);
+				++placed;
+			}
+		}
+
+		for (;;)
+		{
+			int32_t cluster = find(1, true);
+			toggle(cluster, false);
+
+			int32_t emptiest = find(0, false);
+			toggle(emptiest, true);
+
+			if (emptiest == cluster)
+			{
+				break;
+			}
+		}
+
+		std::vector<int32_t> rank(cells, 0);
+		std::vector<uint8_t> initialPattern = pattern;
+		std::vector<float> initialEnergy = energy;
+
+		for (int32_t r = initialCount - 1; r >= 0; --r)
+		{
+			int32_t cluster = find(1, true);
+			toggle(cluster, false);
+			rank[cluster] = r;
+		}
+
+		pattern = initialPattern;
+		energy = initialEnergy;
+
+		for (int32_t r = initialCount; r < cells; ++r)
+		{
+			int32_t emptiest = find(0, false);
+			toggle(emptiest, true);
+			rank[emptiest] = r;
+		}
+
+		std::vector<float> values(cells);
+
+		for (int32_t cell = 0; cell < cells; ++cell)
+		{
+			values[cell] = (rank[cell] + 0.5f) / cells;
+		}
+
+		return values;
+	}();
+
+	return mask;
+}
+
+float BlueNoiseSampler::getMask(int32_t x, int32_t y)
+{
+	x = ((x % maskSize) + maskSize) % maskSize;
+	y = ((y % maskSize) + maskSize) % maskSize;
+
+	return getBlueNoiseMask()[y * maskSize + x];
+}
+
+float BlueNoiseSampler::generate(int32_t dim)
+{
+	// The same sequence in every pixel; each dimension reads the mask at its own offset, so the dimensions are not correlated.
+	uint32_t dimensionSeed = hash(static_cast<uint32_t>(dim) + 1);
+
+	uint32_t set = hash(static_cast<uint32_t>(dim / 4));
+	uint32_t index = nestedUniformScramble(static_cast<uint32_t>(sampleIndex), set);
+
+	float value = toUnitFloat(sobol(index, dim % 4));
+	float offset = getMask(pixelX + static_cast<int32_t>(dimensionSeed & 63), pixelY + static_cast<int32_t>((dimensionSeed >> 6) & 63));
+
+	value += offset;
+
+	return (value >= 1.0f) ? value - 1.0f : value;
+}
+
+bool stringToSamplerType(std::string_view name, SamplerType& type)
+{
+	if (name == "random") { type = SamplerType::RANDOM; return true; }
+	if (name == "stratified") { type = SamplerType::STRATIFIED; return true; }
+	if (name == "sobol") { type = SamplerType::SOBOL; return true; }
+	if (name == "bluenoise") { type = SamplerType::BLUE_NOISE; return true; }
+
+	std::cout << "Unknown sampler: " << name << " (random, stratified, sobol or bluenoise)" << std::endl;
+
+	return false;
+}
+
+std::unique_ptr<Sampler> createSampler(SamplerType type)
+{
+	switch (type)
+	{
+		case SamplerType::STRATIFIED: return std::make_unique<StratifiedSampler>();
+		case SamplerType::SOBOL: return std::make_unique<SobolSampler>();
+		case SamplerType::BLUE_NOISE: return std::make_unique<BlueNoiseSampler>();
+		default: return std::make_unique<Sampler>();
+	}
 }
\ No newline at end of file
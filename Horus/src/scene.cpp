@@ -1,11 +1,22 @@
 #include "scene.h"
+#include "progressive.h"
+#include "checkpoint.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <atomic>
 
 std::unordered_map<std::string_view, RenderOutput> renderOutputMap = {
-	{ "ppm", RenderOutput::PPM }
+	{ "ppm", RenderOutput::PPM },
+	{ "p6", RenderOutput::P6 },
+	{ "pfm", RenderOutput::PFM },
+	{ "png", RenderOutput::PNG },
+	{ "qoi", RenderOutput::QOI }
 };
 
 std::unordered_map<std::string_view, GammaCorrection> gammaCorrectionMap = {
-	{"gamma2", GammaCorrection::GAMMA2}
+	{"gamma2", GammaCorrection::GAMMA2},
+	{"srgb", GammaCorrection::SRGB}
 };
 
 Scene::Scene() : sceneObjects(), camera(nullptr), geometries(), lights(), renderOutput(RenderOutput::PPM), output(), filePathWrite()
@@ -24,6 +35,42 @@ bool Scene::getScene(std::vector<std::unique_ptr<SceneObject>>& scene)
 	//sceneObjects = scene;
 	sceneObjects = std::move(scene);
 
+	objects.clear();
+	objects.reserve(sceneObjects.size());
+
+	for (const auto& obj : sceneObjects)
+	{
+		objects.push_back(obj.get());
+	}
+
+	return objectsCheck();
+}
+
+// Takes over the objects of a scene stored in per type arrays, e.g. one loaded from a compiled scene file.
+bool Scene::getScene(SceneArena& scene)
+{
+	if (scene.objects.empty())
+	{
+		return false;
+	}
+
+	sceneArena = std::move(scene);
+	objects = sceneArena.objects;
+
+	return objectsCheck();
+}
+
+bool Scene::setObjects(const std::vector<SceneObject*>& sceneObjects)
+{
+	objects = sceneObjects;
+	camera = nullptr;
+
+	return objectsCheck();
+}
+
+// Sorts the scene objects into camera, geometries and lights. Returns false if the scene has no camera.
+bool Scene::objectsCheck()
+{
 	if (!cameraCheck())
 	{
 		return false;
@@ -38,11 +85,11 @@ bool Scene::getScene(std::vector<std::unique_ptr<SceneObject>>& scene)
 // Checks for the presence of a camera.
 bool Scene::cameraCheck()
 {
-	for (const auto& obj : sceneObjects)
+	for (SceneObject* obj : objects)
 	{
 		if (obj->getType() == SceneObjectType::CAMERA)
 		{
-			camera = static_cast<CameraObject*>(obj.get());
+			camera = static_cast<CameraObject*>(obj);
 			//camera->setPosition(camera->getPosition().x, camera->getPosition().y, camera->getPosition().z);
 			//camera->setWindow(camera->getWidth(), camera->getHeight());
 			//std::cout << "camera position : " << camera->getPosition().x << " " << camera->getPosition().y << " " << camera->getPosition().z << std::endl;
@@ -64,11 +111,11 @@ bool Scene::geometriesCheck()
 {
 	geometries.clear();
 
-	for (const auto& geo : sceneObjects)
+	for (SceneObject* geo : objects)
 	{
 		if (geo->getType() == SceneObjectType::GEOMETRY)
 		{
-			geometries.push_back(static_cast<GeometryObject*>(geo.get()));
+			geometries.push_back(static_cast<GeometryObject*>(geo));
 		}
 	}
 
@@ -85,11 +132,11 @@ bool Scene::lightCheck()
 {
 	lights.clear();
 
-	for (const auto& lgts : sceneObjects)
+	for (SceneObject* lgts : objects)
 	{
 		if (lgts->getType() == SceneObjectType::LIGHT)
 		{
-			lights.push_back(static_cast<LightObject*>(lgts.get()));
+			lights.push_back(static_cast<LightObject*>(lgts));
 		}
 	}
 
@@ -132,6 +179,335 @@ bool Scene::setGammaCorrection(const std::string_view gc)
 	return true;
 }
 
+bool Scene::setPostProcessOption(const std::string_view option)
+{
+	std::string_view par = (option.front() == '-') ? option.substr(1) : option;
+
+	if (par == "dither")
+	{
+		postProcessSettings.dither = true;
+		return true;
+	}
+
+	if (par == "denoise")
+	{
+		denoise = true;
+		return true;
+	}
+
+	if (par.substr(0, 9) == "exposure:")
+	{
+		if (!parseFloat(par.substr(9), postProcessSettings.exposure))
+		{
+			std::cout << "Invalid exposure: " << par << std::endl;
+		}
+
+		return true;
+	}
+
+	if (par.substr(0, 8) == "tonemap:")
+	{
+		stringToToneMapping(par.substr(8), postProcessSettings.toneMapping);
+		return true;
+	}
+
+	return false;
+}
+
+bool Scene::setFramebufferOption(const std::string_view option)
+{
+	std::string_view par = (option.front() == '-') ? option.substr(1) : option;
+
+	if (par == "half")
+	{
+		halfFramebuffer = true;
+		return true;
+	}
+
+	if (par == "stream")
+	{
+		streamOutput = true;
+		return true;
+	}
+
+	return false;
+}
+
+bool Scene::setSamples(const std::string_view option)
+{
+	std::string_view par = (option.front() == '-') ? option.substr(1) : option;
+
+	if (par.substr(0, 8) == "sampler:")
+	{
+		stringToSamplerType(par.substr(8), samplerType);
+		return true;
+	}
+
+	if (par.substr(0, 7) == "filter:")
+	{
+		std::string_view name = par.substr(7);
+		float radius = 0.0f;
+
+		size_t colon = name.find(':');
+
+		// The splat footprint is at most 16 pixels wide.
+		if (colon != std::string_view::npos && (!parseFloat(name.substr(colon + 1), radius) || radius <= 0.0f || radius > 7.5f))
+		{
+			std::cout << "Invalid filter radius: " << par << std::endl;
+			return false;
+		}
+
+		FilterType type;
+
+		if (!stringToFilterType(name.substr(0, colon), type))
+		{
+			return false;
+		}
+
+		film.setFilter(Filter(type, radius));
+		filtered = true;
+
+		return true;
+	}
+
+	if (par.substr(0, 4) != "spp:")
+	{
+		return false;
+	}
+
+	float samples = 0.0f;
+
+	if (!parseFloat(par.substr(4), samples) || samples < 1.0f)
+	{
+		std::cout << "Invalid samples per pixel: " << par << std::endl;
+		return true;
+	}
+
+	numberOfSamples = static_cast<int32_t>(samples);
+	samplesSet = true;
+
+	return true;
+}
+
+bool Scene::setAOVOption(const std::string_view option)
+{
+	std::string_view par = (option.front() == '-') ? option.substr(1) : option;
+
+	if (par == "aov")
+	{
+		aovTypes = { AOVType::DEPTH, AOVType::NORMAL, AOVType::ALBEDO, AOVType::PRIMITIVE_ID };
+		return true;
+	}
+
+	if (par.substr(0, 4) != "aov:")
+	{
+		return false;
+	}
+
+	aovTypes.clear();
+
+	for (std::string_view names = par.substr(4); !names.empty();)
+	{
+		size_t comma = names.find(',');
+		std::string_view name = names.substr(0, comma);
+
+		AOVType type;
+
+		if (stringToAOVType(name, type) && std::find(aovTypes.begin(), aovTypes.end(), type) == aovTypes.end())
+		{
+			aovTypes.push_back(type);
+		}
+
+		names = (comma == std::string_view::npos) ? std::string_view() : names.substr(comma + 1);
+	}
+
+	return true;
+}
+
+// AOV files are named after the beauty image: "render.png" gives "render.depth.pfm", "render.normal.pfm", ...
+bool Scene::openAOVPasses(int32_t width, int32_t height, bool weighted)
+{
+	std::string base(filePathWrite);
+	size_t dot = base.find_last_of('.');
+
+	if (dot != std::string::npos && dot > base.find_last_of("/\\") + 1)
+	{
+		base.resize(dot);
+	}
+
+	aovPasses.clear();
+	aovPasses.reserve(aovTypes.size());
+
+	for (AOVType type : aovTypes)
+	{
+		aovPasses.emplace_back(type, base + "." + aovTypeToString(type) + ".pfm");
+	}
+
+	// Views into the paths are taken once the vector no longer moves.
+	for (AOVPass& pass : aovPasses)
+	{
+		// Ids above 2048 are not exact in half precision.
+		pass.framebuffer.setHalfPrecision(halfFramebuffer && pass.type != AOVType::PRIMITIVE_ID);
+		pass.framebuffer.resize(width, height, weighted);
+
+		pass.output.setRenderOutput(RenderOutput::PFM);
+		pass.output.setFilePathWrite(pass.filePath);
+		pass.output.setWidth(camera->getWidth());
+		pass.output.setHeight(camera->getHeight());
+
+		if (!weighted && !pass.output.open())
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Stores the AOV sums of a pixel as means. In a weighted (progressive) framebuffer they are accumulated over the passes, apart
+// from the id, which cannot be averaged and is taken from the first pass.
+void Scene::storeAOVs(int32_t x, int32_t y, const AOVSample& aov, int32_t samples, bool firstPass)
+{
+	for (AOVPass& pass : aovPasses)
+	{
+		Vector3D<float> value;
+
+		switch (pass.type)
+		{
+			case AOVType::DEPTH: value = Vector3D<float>(aov.depth, aov.depth, aov.depth) / (float)samples; break;
+			case AOVType::NORMAL: value = aov.normal / (float)samples; break;
+			case AOVType::ALBEDO: value = aov.albedo / (float)samples; break;
+			case AOVType::PRIMITIVE_ID: value = aov.id; break;
+			default: break;
+		}
+
+		if (!pass.framebuffer.isWeighted())
+		{
+			pass.framebuffer.set(x, y, value);
+		}
+		else if (pass.type != AOVType::PRIMITIVE_ID)
+		{
+			pass.framebuffer.accumulate(x, y, value, (float)samples);
+		}
+		else if (firstPass)
+		{
+			pass.framebuffer.accumulate(x, y, value);
+		}
+	}
+}
+
+size_t Scene::getFramebufferMemory() const
+{
+	size_t size = framebuffer.getMemorySize() + (denoise ? denoiser.getMemorySize() : 0) + (filtered ? film.getMemorySize() : 0);
+
+	for (const AOVPass& pass : aovPasses)
+	{
+		size += pass.framebuffer.getMemorySize();
+	}
+
+	return size;
+}
+
+// The gamma option picks the transfer curve; dithering only makes sense for outputs quantized to 8 bits.
+void Scene::updatePostProcess()
+{
+	PostProcessSettings settings = postProcessSettings;
+
+	settings.transferCurve = TransferCurve::LINEAR;
+
+	if (gammaCorrectionSet)
+	{
+		settings.transferCurve = (gammaCorrection == GammaCorrection::SRGB) ? TransferCurve::SRGB : TransferCurve::GAMMA2;
+	}
+
+	if (renderOutput == RenderOutput::PFM)
+	{
+		settings.dither = false;
+	}
+
+	postProcess.setSettings(settings);
+}
+
+bool Scene::setProgressive(const std::string_view option)
+{
+	std::string_view par = (option.front() == '-') ? option.substr(1) : option;
+
+	if (par.substr(0, 11) != "progressive")
+	{
+		return false;
+	}
+
+	if (par.size() > 11)
+	{
+		if (par[11] != ':' || !parseFloat(par.substr(12), previewInterval) || previewInterval <= 0.0f)
+		{
+			std::cout << "Invalid preview interval: " << par << std::endl;
+			return false;
+		}
+	}
+
+	progressive = true;
+
+	return true;
+}
+
+bool Scene::setTimeBudget(const std::string_view option)
+{
+	std::string_view par = option.substr(std::min(option.find_first_not_of('-'), option.size()));
+
+	if (par.substr(0, 12) != "time-budget:")
+	{
+		return false;
+	}
+
+	if (!parseFloat(par.substr(12), timeBudget) || timeBudget <= 0.0f)
+	{
+		std::cout << "Invalid time budget: " << par << std::endl;
+		timeBudget = 0.0f;
+		return true;
+	}
+
+	// Loading the scene and building the BVH count against the budget as well.
+	budgetStart = std::chrono::steady_clock::now();
+
+	return true;
+}
+
+bool Scene::setCheckpointOption(const std::string_view option)
+{
+	std::string_view par = option.substr(std::min(option.find_first_not_of('-'), option.size()));
+
+	if (par == "resume")
+	{
+		resume = true;
+		checkpointInterval = (checkpointInterval > 0.0f) ? checkpointInterval : defaultCheckpointInterval;
+		return true;
+	}
+
+	if (par == "checkpoint")
+	{
+		checkpointInterval = defaultCheckpointInterval;
+		return true;
+	}
+
+	if (par.substr(0, 11) != "checkpoint:")
+	{
+		return false;
+	}
+
+	float interval = 0.0f;
+
+	if (!parseFloat(par.substr(11), interval) || interval <= 0.0f)
+	{
+		std::cout << "Invalid checkpoint interval: " << par << std::endl;
+		return true;
+	}
+
+	checkpointInterval = interval;
+
+	return true;
+}
+
 // Sets the file path for writing the rendered output.
 bool Scene::setFilePathWrite(const std::string_view& path)
 {
@@ -148,6 +524,15 @@ bool Scene::setFilePathWrite(const std::string_view& path)
 	return true;
 }
 
+// Builds the top level BVH over the geometries, unless a prebuilt one came with the scene.
+void Scene::buildAccelerator()
+{
+	if (!bvh.isBuilt())
+	{
+		bvh.buildBVH(geometries);
+	}
+}
+
 // Renders the scene.
 void Scene::render()
 {
@@ -156,7 +541,31 @@ void Scene::render()
 	output.setWidth(getCamera()->getWidth());
 	output.setHeight(getCamera()->getHeight());
 
+	// A time budget is spent in progressive passes, so the image is in its best state whenever the deadline comes. Checkpoints save
+	// the accumulation of the passes as well.
+	bool budgeted = timeBudget > 0.0f;
+	bool passes = progressive || budgeted || checkpointInterval > 0.0f;
+
+	// Without -spp the budget alone decides when to stop.
+	plannedSamples = (budgeted && !samplesSet) ? maxBudgetSamples : numberOfSamples;
+
+	// Progressive passes revisit every pixel, and the denoiser and the film filter reach across tile rows, so they need the image in memory.
+	if (streamOutput && (passes || denoise || filtered))
+	{
+		std::cout << "Streaming is not available with progressive rendering, denoising or a film filter, the image is kept in memory" << std::endl;
+	}
+
+	output.setStreaming(streamOutput && !passes && !denoise && !filtered);
+
+	// Progressive renders open the output at the end, the previews are written to the same path until then.
+	if (!passes && !output.open()) { return; }
+
 	camera->setWindow(camera->getWidth(), camera->getHeight());
+
+	for (GeometryObject* geometry : geometries)
+	{
+		geometry->prepare(*camera);
+	}
 	std::cout << "camera position : " << camera->getPosition().x << " " << camera->getPosition().y << " " << camera->getPosition().z << std::endl;
 
 	std::cout << camera->getWidth() << " " << camera->getHeight() << std::endl;
@@ -164,54 +573,623 @@ void Scene::render()
 	float width = camera->getWidth();
 	float height = camera->getHeight();
 
-	Integrator integrator(lights);
+	// Every render starts from the same random sequence, so re-rendering a modified scene only changes the pixels the edit affects.
+	sampler = createSampler(samplerType);
+
+	Integrator integrator(lights, *sampler);
+
+	updatePostProcess();
 
-	BVH bvh;
-	bvh.buildBVH(geometries);
+	buildAccelerator();
 
-	for (int i = height - 1; i >= 0; --i)
+	for (size_t g = 0; g < geometries.size(); ++g)
 	{
-		for (int j = 0; j < width; ++j)
+		geometries[g]->setObjectId(static_cast<uint32_t>(g + 1));
+	}
+
+	if (passes)
+	{
+		renderProgressive();
+	}
+	else
+	{
+		// When streaming the framebuffer holds one band of tile rows, reused for every band; otherwise the whole image.
+		int32_t bandHeight = output.isStreaming() ? std::min(Framebuffer::tileSize, static_cast<int32_t>(height)) : static_cast<int32_t>(height);
+
+		framebuffer.setHalfPrecision(halfFramebuffer);
+		framebuffer.resize(static_cast<int32_t>(width), bandHeight);
+
+		if (!openAOVPasses(static_cast<int32_t>(width), bandHeight, false)) { return; }
+
+		if (denoise)
 		{
-			float u = (float)j / (width - 1);
-			float v = (float)i / (height - 1);
+			denoiser.resize(static_cast<int32_t>(width), bandHeight);
+		}
+
+		if (filtered)
+		{
+			film.resize(static_cast<int32_t>(width), bandHeight);
+		}
 
-			Vector3D<float> color(0.0f, 0.0f, 0.0f);
+		std::cout << "Framebuffer: " << getFramebufferMemory() / (1024 * 1024) << " MB" << std::endl;
 
-			Ray ray(camera->genRay(u, v));
+		bool recordFeatures = denoise || !aovPasses.empty();
 
-			Ray originalRay = ray;
+		for (int i = height - 1; i >= 0; --i)
+		{
+			int32_t row = static_cast<int32_t>(height) - 1 - i;
+			int32_t bandRow = row % bandHeight;
 
-			for (size_t k = 0; k < numberOfSamples; ++k)
+			for (int j = 0; j < width; ++j)
 			{
-				float x = (originalRay.getDirection().x + (unitRandom.Generate() - 0.5f) / width);
-				float y = (originalRay.getDirection().y + (unitRandom.Generate() - 0.5f) / height);
-				float z = (originalRay.getDirection().z + (unitRandom.Generate() - 0.5f) / width);
+				AOVSample aov;
+
+				Vector3D<float> color = samplePixel(integrator, i, j, 0, numberOfSamples, recordFeatures ? &aov : nullptr);
 
-				ray.setDirection(Vector3D<float>(x, y, z));
+				color /= (float)numberOfSamples;
 
-				color += integrator.rayPath(ray, bvh, 2);
+				if (!filtered)
+				{
+					framebuffer.set(j, bandRow, color);
+				}
+
+				if (!aovPasses.empty())
+				{
+					storeAOVs(j, bandRow, aov, numberOfSamples, true);
+				}
+
+				if (denoise)
+				{
+					denoiser.addSample(j, bandRow, aov, numberOfSamples);
+				}
 			}
 
-			color /= (float)numberOfSamples;
+			// Once a band of tile rows is complete it is post-processed in one pass and handed to the output; denoising and film filters,
+			// which reach into the next band, wait for the whole image.
+			if ((row + 1) % Framebuffer::tileSize == 0 || i == 0)
+			{
+				int32_t tileRow = bandRow / Framebuffer::tileSize;
 
-			if (gammaCorrectionSet)
+				if (!denoise && !filtered)
+				{
+					postProcess.apply(framebuffer, tileRow, tileRow + 1);
+					output.writeRows(framebuffer, tileRow * Framebuffer::tileSize, bandRow + 1);
+				}
+
+				// AOVs hold data rather than colors and skip the post-process.
+				for (AOVPass& pass : aovPasses)
+				{
+					pass.output.writeRows(pass.framebuffer, tileRow * Framebuffer::tileSize, bandRow + 1);
+				}
+			}
+		}
+		if (filtered)
+		{
+			resolveFilm(film.getFramebuffer(), framebuffer);
+		}
+
+		if (denoise)
+		{
+			denoiser.apply(framebuffer, numberOfSamples);
+		}
+
+		if (denoise || filtered)
+		{
+			postProcess.apply(framebuffer);
+		}
+
+		output.write(framebuffer);
+
+		for (AOVPass& pass : aovPasses)
+		{
+			pass.output.write(pass.framebuffer);
+		}
+	}
+
+	for (GeometryObject* geometry : geometries)
+	{
+		geometry->printStatistics();
+	}
+}
+
+// Traces 'samples' jittered camera rays through pixel (j, i), i counting from the bottom row, and returns the sum of their radiance.
+// With a film filter each ray goes through its own position in the pixel area and its radiance is splatted into the film as well.
+Vector3D<float> Scene::samplePixel(Integrator& integrator, int32_t i, int32_t j, int32_t firstSample, int32_t samples, AOVSample* aov)
+{
+	float width = camera->getWidth();
+	float height = camera->getHeight();
+
+	float u = (float)j / (width - 1);
+	float v = (float)i / (height - 1);
+
+	Vector3D<float> color(0.0f, 0.0f, 0.0f);
+
+	Ray ray(camera->genRay(u, v));
+
+	Ray originalRay = ray;
+
+	Sampler& pixelSampler = integrator.getSampler();
+
+	for (int32_t k = 0; k < samples; ++k)
+	{
+		pixelSampler.startSample(j, i, firstSample + k, plannedSamples);
+
+		float filmX = 0.0f;
+		float filmY = 0.0f;
+
+		if (filtered)
+		{
+			// Film position from the top left corner; the third camera dimension is not used by the pinhole camera.
+			filmX = j + pixelSampler.get1D();
+			filmY = (height - 1 - i) + pixelSampler.get1D();
+			pixelSampler.get1D();
+
+			ray = camera->genRay(filmX / width, 1.0f - filmY / height);
+		}
+		else
+		{
+			float x = (originalRay.getDirection().x + (pixelSampler.get1D() - 0.5f) / width);
+			float y = (originalRay.getDirection().y + (pixelSampler.get1D() - 0.5f) / height);
+			float z = (originalRay.getDirection().z + (pixelSampler.get1D() - 0.5f) / width);
+
+			ray.setDirection(Vector3D<float>(x, y, z));
+		}
+
+		if (!aov)
+		{
+			Vector3D<float> radiance = integrator.rayPath(ray, bvh, 2);
+
+			if (filtered)
+			{
+				film.addSample(filmX, filmY, radiance);
+			}
+
+			color += radiance;
+			continue;
+		}
+
+		AOVSample sample;
+
+		Vector3D<float> radiance = integrator.rayPath(ray, bvh, 2, &sample);
+
+		if (filtered)
+		{
+			film.addSample(filmX, filmY, radiance);
+		}
+
+		float luminance = 0.2126f * radiance.x + 0.7152f * radiance.y + 0.0722f * radiance.z;
+
+		color += radiance;
+
+		aov->luminanceSquared += luminance * luminance;
+		aov->depth += sample.depth;
+		aov->normal += sample.normal;
+		aov->albedo += sample.albedo;
+
+		if (k == 0)
+		{
+			aov->id = sample.id;
+		}
+	}
+
+	return color;
+}
+
+// Renders in passes over the whole image that double the sample count so far (1, 1, 2, 4, ...), accumulating into a weighted
+// framebuffer. A background writer writes the current state as a preview while the passes run.
+// The rows of a pass are shared out to the render threads through a row counter. Snapshots need rows [0, nextRow) done and the rest
+// untouched, so when one is requested, or the deadline passes, the threads stop taking rows; once they are done with the rows they
+// have, every row taken is complete, and the render goes on with new threads from there.
+void Scene::renderProgressive()
+{
+	int32_t width = static_cast<int32_t>(camera->getWidth());
+	int32_t height = static_cast<int32_t>(camera->getHeight());
+
+	framebuffer.setHalfPrecision(halfFramebuffer);
+
+	// With a film filter the samples are splatted into the film, which replaces the weighted framebuffer.
+	if (filtered)
+	{
+		film.resize(width, height);
+	}
+	else
+	{
+		framebuffer.resize(width, height, true);
+	}
+
+	Framebuffer& accumulation = filtered ? film.getFramebuffer() : framebuffer;
+
+	openAOVPasses(width, height, true);
+
+	if (denoise)
+	{
+		denoiser.resize(width, height, true);
+	}
+
+	bool recordFeatures = denoise || !aovPasses.empty();
+
+	std::cout << "Framebuffer: " << getFramebufferMemory() / (1024 * 1024) << " MB" << std::endl;
+
+	// Previews are not denoised: the features keep changing while the writer thread resolves them.
+	auto resolve = [this](const Framebuffer& accumulation, Framebuffer& image)
+	{
+		image.setHalfPrecision(halfFramebuffer);
+		resolveFilm(accumulation, image);
+		postProcess.apply(image);
+	};
+
+	ProgressiveWriter writer(renderOutput, filePathWrite, resolve);
+	writer.start(std::chrono::milliseconds(static_cast<int64_t>(previewInterval * 1000.0f)));
+
+	// With a time budget every pass is sized from the cost per sample of the previous one, so that it ends before the deadline, and
+	// the render stops at the last pass that fits. Part of the budget is kept for resolving, denoising and writing the image.
+	bool budgeted = timeBudget > 0.0f;
+	auto deadline = budgetStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(timeBudget * 0.95));
+	auto renderStart = std::chrono::steady_clock::now();
+
+	double secondsPerSample = 0.0;
+	std::atomic<bool> deadlineReached{ false };
+
+	// Rows [0, nextRow) of the current pass, which adds 'samples' to 'total', are done; 'samples' is 0 between passes.
+	int32_t total = 0;
+	int32_t pass = 1;
+	int32_t samples = 0;
+	int32_t nextRow = 0;
+
+	std::vector<Framebuffer*> buffers = getCheckpointBuffers(accumulation);
+
+	if (resume)
+	{
+		CheckpointHeader header = {};
+
+		if (loadCheckpoint(buffers, header))
+		{
+			total = header.total;
+			pass = header.pass;
+			samples = header.passSamples;
+			nextRow = header.nextRow;
+
+			std::cout << "Resumed at pass " << pass << ", " << total << " samples per pixel, row " << nextRow << std::endl;
+		}
+	}
+
+	// The render thread only copies the buffers; the checkpoint is written in the background.
+	CheckpointWriter checkpointWriter(getCheckpointPath());
+
+	auto submitCheckpoint = [&]()
+	{
+		Checkpoint checkpoint;
+		checkpoint.header = getCheckpointHeader();
+		checkpoint.header.pass = pass;
+		checkpoint.header.total = total;
+		checkpoint.header.passSamples = samples;
+		checkpoint.header.nextRow = nextRow;
+		checkpoint.samplerState = sampler->getState();
+
+		for (const Framebuffer* buffer : buffers)
+		{
+			checkpoint.buffers.push_back(*buffer);
+		}
+
+		checkpointWriter.submit(std::move(checkpoint));
+	};
+
+	if (checkpointInterval > 0.0f)
+	{
+		checkpointWriter.start(std::chrono::milliseconds(static_cast<int64_t>(checkpointInterval * 1000.0f)));
+	}
+
+	// Every render thread draws from its own sampler and counts its own rays.
+	int32_t threads = (renderThreads > 0) ? renderThreads : std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+
+	std::vector<std::unique_ptr<Sampler>> samplers;
+	std::vector<std::unique_ptr<Integrator>> integrators;
+
+	for (int32_t t = 0; t < threads; ++t)
+	{
+		samplers.push_back(createSampler(samplerType));
+		integrators.push_back(std::make_unique<Integrator>(lights, *samplers.back()));
+	}
+
+	while (total < plannedSamples && !deadlineReached)
+	{
+		if (samples == 0)
+		{
+			samples = std::min(std::max(total, 1), plannedSamples - total);
+
+			if (budgeted && secondsPerSample > 0.0)
 			{
-				switch (gammaCorrection)
+				double remaining = std::chrono::duration<double>(deadline - std::chrono::steady_clock::now()).count();
+				double fit = remaining / secondsPerSample;
+
+				if (fit < 1.0)
 				{
-					case GammaCorrection::GAMMA2:
-						color.x = std::sqrt(color.x);
-						color.y = std::sqrt(color.y);
-						color.z = std::sqrt(color.z);
-						break;
-
-					default:
-						break;
+					samples = 0;
+					break;
 				}
+
+				samples = static_cast<int32_t>(std::min<double>(samples, fit));
+			}
+		}
+
+		auto passStart = std::chrono::steady_clock::now();
+		int32_t firstRow = nextRow;
+
+		while (nextRow < height && !deadlineReached)
+		{
+			std::atomic<int32_t> rowCounter{ nextRow };
+			std::atomic<bool> snapshot{ false };
+
+			auto work = [&](Integrator& integrator)
+			{
+				while (!snapshot.load(std::memory_order_relaxed) && !deadlineReached.load(std::memory_order_relaxed))
+				{
+					int32_t row = rowCounter.fetch_add(1);
+
+					if (row >= height) { break; }
+
+					renderRow(integrator, row, total, samples, recordFeatures);
+
+					if (writer.snapshotRequested() || checkpointWriter.snapshotRequested())
+					{
+						snapshot = true;
+					}
+
+					// Should the estimate be off, the pass stops at the deadline, and the same goes for the rows it did render.
+					if (budgeted && std::chrono::steady_clock::now() >= deadline)
+					{
+						deadlineReached = true;
+					}
+				}
+			};
+
+			std::vector<std::thread> workers;
+
+			for (size_t t = 1; t < integrators.size(); ++t)
+			{
+				workers.emplace_back(work, std::ref(*integrators[t]));
+			}
+
+			work(*integrators[0]);
+
+			for (std::thread& worker : workers)
+			{
+				worker.join();
+			}
+
+			nextRow = std::min(rowCounter.load(), height);
+
+			// Pixels of a snapshot taken mid pass just carry one pass more than the others; the weights keep the image consistent.
+			if (writer.snapshotRequested())
+			{
+				writer.submit(accumulation);
+			}
+
+			if (checkpointWriter.snapshotRequested())
+			{
+				submitCheckpoint();
 			}
+		}
+
+		if (nextRow < height)
+		{
+			std::cout << "Pass " << pass << ": stopped at the deadline" << std::endl;
+			break;
+		}
+
+		secondsPerSample = std::chrono::duration<double>(std::chrono::steady_clock::now() - passStart).count() * height / (static_cast<double>(samples) * (height - firstRow));
+
+		total += samples;
+		samples = 0;
+		nextRow = 0;
+
+		std::cout << "Pass " << pass << ": " << total << " samples per pixel" << std::endl;
+
+		++pass;
+	}
+
+	double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+	double samplesPerPixel = total + static_cast<double>(samples) * nextRow / height;
+
+	if (budgeted)
+	{
+		uint64_t rays = 0;
+
+		for (const std::unique_ptr<Integrator>& integrator : integrators)
+		{
+			rays += integrator->getRayCount();
+		}
+
+		std::cout << "Time budget: " << timeBudget << " s, rendered " << renderSeconds << " s, " << samplesPerPixel << " samples per pixel, "
+			<< rays / std::max(renderSeconds, 1e-6) << " rays per second" << std::endl;
+	}
+
+	// A render that stopped at its deadline leaves a checkpoint for the next slot to go on from; a finished one has no use for it.
+	if (checkpointInterval > 0.0f)
+	{
+		if (total < plannedSamples)
+		{
+			submitCheckpoint();
+		}
+
+		checkpointWriter.stop();
+
+		std::cout << "Checkpoints written: " << checkpointWriter.getCheckpointCount() << std::endl;
+
+		if (total >= plannedSamples)
+		{
+			std::error_code error;
+			std::filesystem::remove(getCheckpointPath(), error);
+		}
+	}
+
+	writer.stop();
+
+	std::cout << "Previews written: " << writer.getPreviewCount() << std::endl;
+
+	Framebuffer image;
+	image.setHalfPrecision(halfFramebuffer);
+	resolveFilm(accumulation, image);
+
+	if (denoise)
+	{
+		denoiser.apply(image, std::max(1, static_cast<int32_t>(samplesPerPixel)));
+	}
+
+	postProcess.apply(image);
+
+	if (output.open())
+	{
+		output.write(image);
+	}
+
+	// AOVs are written once, at the end.
+	for (AOVPass& pass : aovPasses)
+	{
+		if (pass.output.open())
+		{
+			pass.output.write(pass.framebuffer);
+		}
+	}
+}
+
+// Adds samples [firstSample, firstSample + samples) to every pixel of row 'row' of a progressive render, counted from the top.
+void Scene::renderRow(Integrator& integrator, int32_t row, int32_t firstSample, int32_t samples, bool recordFeatures)
+{
+	int32_t width = static_cast<int32_t>(camera->getWidth());
+	int32_t height = static_cast<int32_t>(camera->getHeight());
+
+	int32_t i = height - 1 - row;
+
+	integrator.getSampler().seed(static_cast<uint32_t>(firstSample) * static_cast<uint32_t>(height) + static_cast<uint32_t>(row));
+
+	for (int32_t j = 0; j < width; ++j)
+	{
+		AOVSample aov;
+
+		Vector3D<float> color = samplePixel(integrator, i, j, firstSample, samples, recordFeatures ? &aov : nullptr);
+
+		if (!filtered)
+		{
+			framebuffer.accumulate(j, row, color / (float)samples, (float)samples);
+		}
+
+		if (!aovPasses.empty())
+		{
+			storeAOVs(j, row, aov, samples, firstSample == 0);
+		}
+
+		if (denoise)
+		{
+			denoiser.addSample(j, row, aov, samples);
+		}
+	}
+}
+
+// Stores the resolved colors of a weighted framebuffer in 'image', which is resized to match and keeps its precision.
+void Scene::resolveFilm(const Framebuffer& accumulation, Framebuffer& image)
+{
+	std::vector<Vector3D<float>> row(accumulation.getWidth());
+
+	image.resize(accumulation.getWidth(), accumulation.getHeight());
+
+	for (int32_t y = 0; y < accumulation.getHeight(); ++y)
+	{
+		accumulation.getRow(y, row.data());
+		image.setRow(y, row.data());
+	}
+}
+
+std::string Scene::getCheckpointPath() const
+{
+	return std::string(filePathWrite) + ".checkpoint";
+}
+
+// Color accumulation, AOVs and denoiser features, in the order checkpoints store them.
+std::vector<Framebuffer*> Scene::getCheckpointBuffers(Framebuffer& accumulation)
+{
+	std::vector<Framebuffer*> buffers = { &accumulation };
+
+	for (AOVPass& pass : aovPasses)
+	{
+		buffers.push_back(&pass.framebuffer);
+	}
+
+	if (denoise)
+	{
+		for (Framebuffer* feature : denoiser.getFeatureBuffers())
+		{
+			buffers.push_back(feature);
+		}
+	}
+
+	return buffers;
+}
 
-			output.writeBuffer(color);
+// Settings part of the header, which a checkpoint has to match to be resumed.
+CheckpointHeader Scene::getCheckpointHeader() const
+{
+	CheckpointHeader header = {};
+
+	header.width = static_cast<int32_t>(camera->getWidth());
+	header.height = static_cast<int32_t>(camera->getHeight());
+	header.samplerType = static_cast<uint32_t>(samplerType);
+	header.plannedSamples = plannedSamples;
+	header.filterType = filtered ? static_cast<uint32_t>(film.getFilter().getType()) + 1 : 0;
+	header.filterRadius = filtered ? film.getFilter().getRadius() : 0.0f;
+	header.bufferCount = static_cast<uint32_t>(1 + aovPasses.size() + (denoise ? 3 : 0));
+
+	for (const AOVPass& pass : aovPasses)
+	{
+		header.aovMask |= 1u << static_cast<uint32_t>(pass.type);
+	}
+
+	return header;
+}
+
+// Reads the checkpoint of the output into 'buffers'. A missing checkpoint or one of a different render leaves the buffers cleared,
+// and the render starts over.
+bool Scene::loadCheckpoint(const std::vector<Framebuffer*>& buffers, CheckpointHeader& header)
+{
+	std::ifstream file(getCheckpointPath(), std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "No checkpoint at " << getCheckpointPath() << ", starting from the beginning" << std::endl;
+		return false;
+	}
+
+	Checkpoint checkpoint;
+
+	if (!readCheckpointHeader(file, checkpoint))
+	{
+		return false;
+	}
+
+	CheckpointHeader expected = getCheckpointHeader();
+	header = checkpoint.header;
+
+	bool matches = header.width == expected.width && header.height == expected.height && header.samplerType == expected.samplerType
+		&& header.plannedSamples == expected.plannedSamples && header.filterType == expected.filterType && header.filterRadius == expected.filterRadius
+		&& header.aovMask == expected.aovMask && header.bufferCount == expected.bufferCount
+		&& header.nextRow >= 0 && header.nextRow <= expected.height && header.total >= 0 && header.passSamples >= 0;
+
+	for (size_t b = 0; matches && b < buffers.size(); ++b)
+	{
+		matches = buffers[b]->read(file);
+	}
+
+	if (!matches || !sampler->setState(checkpoint.samplerState))
+	{
+		std::cout << "The checkpoint does not match this render, starting from the beginning" << std::endl;
+
+		for (Framebuffer* buffer : buffers)
+		{
+			buffer->clear();
 		}
+
+		return false;
 	}
-	output.write();
+
+	return true;
 }
\ No newline at end of file
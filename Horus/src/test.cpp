@@ -1,7 +1,36 @@
 #include "test.h"
 #include "hrs.h"
 #include "util.h"
+#include "ply.h"
+#include "mesh.h"
+#include "paged_mesh.h"
+#include "particles.h"
+#include "displaced.h"
+#include "reference.h"
+#include "compiled_scene.h"
+#include "framebuffer.h"
+#include "postprocess.h"
+#include "half.h"
+#include "denoise.h"
+#include "sampler.h"
+#include "film.h"
+#include "checkpoint.h"
+#include "deflate.h"
+#include "png.h"
+#include "qoi.h"
+#include "output.h"
+#include "scene.h"
+#include "watch.h"
 #include <iostream>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
 
 // Helper function to convert SceneObjectType to string
 const char* SceneObjectTypeToString(SceneObjectType type)
@@ -31,6 +60,29 @@ int32_t Testing(int& argc, char* argv[])
 			std::cout << "Available Tests:" << std::endl;
 			std::cout << "  MAIN_LINE_ARGS" << std::endl;
 			std::cout << "  SCENE_BUILDER" << std::endl;
+			std::cout << "  PLY_LOADER" << std::endl;
+			std::cout << "  PAGED_MESH" << std::endl;
+			std::cout << "  COMPILED_SCENE" << std::endl;
+			std::cout << "  PARALLEL_PARSE" << std::endl;
+			std::cout << "  FRAMEBUFFER" << std::endl;
+			std::cout << "  DEFLATE" << std::endl;
+			std::cout << "  QOI" << std::endl;
+			std::cout << "  POST_PROCESS" << std::endl;
+			std::cout << "  HALF_FLOAT" << std::endl;
+			std::cout << "  DENOISE" << std::endl;
+			std::cout << "  SAMPLER" << std::endl;
+			std::cout << "  FILM_FILTER" << std::endl;
+			std::cout << "  CHECKPOINT" << std::endl;
+			std::cout << "  PROGRESSIVE" << std::endl;
+			std::cout << "  TIME_BUDGET" << std::endl;
+			std::cout << "  IMAGE_OUTPUT" << std::endl;
+			std::cout << "  TOKENIZER" << std::endl;
+			std::cout << "  REFERENCE" << std::endl;
+			std::cout << "  PARTICLES" << std::endl;
+			std::cout << "  DISPLACED" << std::endl;
+			std::cout << "  MATERIAL_LIBRARY" << std::endl;
+			std::cout << "  WATCH" << std::endl;
+			std::cout << "  AOV" << std::endl;
 			return 1;
 		 }
 
@@ -61,6 +113,29 @@ TestSelection StringToTestSelection(std::string_view testName)
 {
 	if (testName == "MAIN_LINE_ARGS") return TestSelection::MAIN_LINE_ARGS;
 	if (testName == "SCENE_BUILDER") return TestSelection::SCENE_BUILDER;
+	if (testName == "PLY_LOADER") return TestSelection::PLY_LOADER;
+	if (testName == "PAGED_MESH") return TestSelection::PAGED_MESH;
+	if (testName == "COMPILED_SCENE") return TestSelection::COMPILED_SCENE;
+	if (testName == "PARALLEL_PARSE") return TestSelection::PARALLEL_PARSE;
+	if (testName == "FRAMEBUFFER") return TestSelection::FRAMEBUFFER;
+	if (testName == "DEFLATE") return TestSelection::DEFLATE;
+	if (testName == "QOI") return TestSelection::QOI;
+	if (testName == "POST_PROCESS") return TestSelection::POST_PROCESS;
+	if (testName == "HALF_FLOAT") return TestSelection::HALF_FLOAT;
+	if (testName == "DENOISE") return TestSelection::DENOISE;
+	if (testName == "SAMPLER") return TestSelection::SAMPLER;
+	if (testName == "FILM_FILTER") return TestSelection::FILM_FILTER;
+	if (testName == "CHECKPOINT") return TestSelection::CHECKPOINT;
+	if (testName == "PROGRESSIVE") return TestSelection::PROGRESSIVE;
+	if (testName == "TIME_BUDGET") return TestSelection::TIME_BUDGET;
+	if (testName == "IMAGE_OUTPUT") return TestSelection::IMAGE_OUTPUT;
+	if (testName == "TOKENIZER") return TestSelection::TOKENIZER;
+	if (testName == "REFERENCE") return TestSelection::REFERENCE;
+	if (testName == "PARTICLES") return TestSelection::PARTICLES;
+	if (testName == "DISPLACED") return TestSelection::DISPLACED;
+	if (testName == "MATERIAL_LIBRARY") return TestSelection::MATERIAL_LIBRARY;
+	if (testName == "WATCH") return TestSelection::WATCH;
+	if (testName == "AOV") return TestSelection::AOV;
 
 	return TestSelection::DEFAULT;
 }
@@ -132,6 +207,7 @@ void T_SCENE_BUILDER(const std::vector<std::string>& args)
 		{
 			std::cout << "SceneBuilder successfully parsed the scene file." << std::endl;
 			std::cout << "Number of scene objects created: " << sceneObjects.size() << std::endl;
+			std::cout << "Number of shared materials: " << MaterialLibrary::getInstance().getMaterialCount() - 1 << std::endl;
 
 			for (size_t i = 0; i < sceneObjects.size(); ++i)
 			{
@@ -147,6 +223,3086 @@ void T_SCENE_BUILDER(const std::vector<std::string>& args)
 	}
 }	
 
+// Test: loadPLY
+void T_PLY_LOADER(const std::vector<std::string>& args)
+{
+	std::cout << "PLY Loader Test Running" << std::endl;
+
+	// A header whose counts the body cannot hold is rejected before any buffer is sized from it.
+	{
+		const std::string corruptPath = "test_corrupt.ply";
+
+		std::ofstream corrupt(corruptPath, std::ios::binary);
+		corrupt << "ply\nformat binary_little_endian 1.0\nelement vertex 4000000000\nproperty float x\nproperty float y\nproperty float z\n"
+			<< "element face 4000000000\nproperty list uchar int vertex_indices\nend_header\n" << std::string(64, '\0');
+		corrupt.close();
+
+		std::vector<Vector3D<float>> vertices;
+		std::vector<uint32_t> indices;
+
+		bool rejected = !loadPLY(corruptPath, vertices, indices) && vertices.empty() && indices.empty();
+		std::filesystem::remove(corruptPath);
+
+		if (rejected)
+		{
+			std::cout << "[PASS] Header counts larger than the file are rejected" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] loadPLY accepted a header with counts larger than the file" << std::endl;
+		}
+
+		// Float typed indices and counts that no uint32_t can hold; the first face is valid.
+		const char* faces[] = { "3 0 1 2", "3 0 1 -1", "3 0 1 1e20", "-3 0 1 2", "3 0 1 nan" };
+		rejected = true;
+
+		for (const char* face : faces)
+		{
+			bool valid = face == faces[0];
+
+			corrupt.open(corruptPath, std::ios::binary);
+			corrupt << "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\nproperty float y\nproperty float z\n"
+				<< "element face 1\nproperty list float float vertex_indices\nend_header\n0 0 0\n1 0 0\n0 1 0\n" << face << "\n";
+			corrupt.close();
+
+			rejected = rejected && loadPLY(corruptPath, vertices, indices) == valid;
+		}
+
+		std::filesystem::remove(corruptPath);
+
+		if (rejected)
+		{
+			std::cout << "[PASS] Negative and out of range list values are rejected" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] loadPLY accepted a negative or out of range list value" << std::endl;
+		}
+	}
+
+	if (args.empty())
+	{
+		std::cout << "Not enough arguments provided for test." << std::endl;
+		return;
+	}
+
+	std::vector<Vector3D<float>> vertices;
+	std::vector<uint32_t> indices;
+
+	if (!loadPLY(args[0], vertices, indices))
+	{
+		std::cout << "[FAIL] loadPLY failed to read " << args[0] << std::endl;
+		return;
+	}
+
+	std::cout << "Vertices: " << vertices.size() << std::endl;
+	std::cout << "Triangles: " << indices.size() / 3 << std::endl;
+
+	// Verify correctness
+	if (indices.size() % 3 == 0)
+	{
+		std::cout << "[PASS] Faces are triangulated" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Index count " << indices.size() << " is not a multiple of 3" << std::endl;
+	}
+
+	bool inRange = true;
+
+	for (uint32_t index : indices)
+	{
+		if (index >= vertices.size())
+		{
+			inRange = false;
+			break;
+		}
+	}
+
+	if (inRange)
+	{
+		std::cout << "[PASS] All indices reference existing vertices" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Found an index outside the vertex buffer" << std::endl;
+	}
+}
+
+// Test: out-of-core paged mesh against the in-memory mesh of the same PLY file
+void T_PAGED_MESH(const std::vector<std::string>& args)
+{
+	std::cout << "Paged Mesh Test Running" << std::endl;
+
+	if (args.empty())
+	{
+		std::cout << "Not enough arguments provided for test." << std::endl;
+		return;
+	}
+
+	const std::string pageFilePath = "test_paged_mesh.hrsp";
+
+	// Small pages and a cache that holds only a few of them, so the rays below keep loading and evicting pages.
+	if (!PagedMeshObject::buildPageFile(args[0], pageFilePath, 256))
+	{
+		std::cout << "[FAIL] buildPageFile failed to convert " << args[0] << std::endl;
+		return;
+	}
+
+	MeshObject mesh;
+	PagedMeshObject paged;
+
+	bool loaded = mesh.loadFile(args[0]) && paged.loadFile(pageFilePath);
+
+	paged.setCacheSize(0.1f);
+
+	if (!loaded)
+	{
+		std::cout << "[FAIL] Could not load " << args[0] << " or its page file" << std::endl;
+		std::filesystem::remove(pageFilePath);
+		return;
+	}
+
+	// A grid of rays down the y axis and one along the z axis, over the bounds of the mesh. The odd cell offsets keep rays
+	// off shared triangle edges, where both meshes may legitimately report either neighbour.
+	BoundingBox bounds = mesh.getBoundingBox();
+	Vector3D<float> extent = bounds.getMax() - bounds.getMin();
+
+	const int32_t grid = 48;
+	int32_t hits = 0;
+	int32_t mismatches = 0;
+	bool withinBudget = true;
+
+	for (int32_t axis = 0; axis < 2; ++axis)
+	{
+		for (int32_t a = 0; a < grid; ++a)
+		{
+			for (int32_t b = 0; b < grid; ++b)
+			{
+				float u = (a + 0.3183f) / grid;
+				float v = (b + 0.7071f) / grid;
+
+				Vector3D<float> origin = (axis == 0)
+					? Vector3D<float>(bounds.getMin().x + u * extent.x, bounds.getMax().y + 1.0f, bounds.getMin().z + v * extent.z)
+					: Vector3D<float>(bounds.getMin().x + u * extent.x, bounds.getMin().y + v * extent.y, bounds.getMax().z + 1.0f);
+				Vector3D<float> direction = (axis == 0) ? Vector3D<float>(0.0f, -1.0f, 0.0f) : Vector3D<float>(0.0f, 0.0f, -1.0f);
+
+				Ray meshRay(origin, direction);
+				Ray pagedRay(origin, direction);
+
+				HitRecord meshRecord;
+				HitRecord pagedRecord;
+
+				bool meshHit = mesh.rayIntersection(meshRay, 0.0f, 1e30f, meshRecord);
+				bool pagedHit = paged.rayIntersection(pagedRay, 0.0f, 1e30f, pagedRecord);
+
+				if (meshHit != pagedHit || (meshHit && (meshRecord.t != pagedRecord.t || meshRecord.primitive != pagedRecord.primitive)))
+				{
+					++mismatches;
+				}
+
+				hits += meshHit ? 1 : 0;
+				withinBudget = withinBudget && paged.getCache().getMemoryUsage() <= paged.getCache().getCapacity();
+			}
+		}
+	}
+
+	// A -rot- after -file- has to bound the paged mesh again, the same as it does the in-memory mesh.
+	{
+		const std::string scenePath = "test_paged_mesh.hrs";
+
+		std::ofstream scene(scenePath);
+		scene << "(mesh)\n-file- /" << args[0] << "/\n-rot- /0,0,45/\n;\n(pagedmesh)\n-file- /" << pageFilePath << "/\n-rot- /0,0,45/\n;\n";
+		scene.close();
+
+		std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+		bool parsed = SceneBuilder(scenePath, sceneObjects) && sceneObjects.size() == 2;
+
+		std::filesystem::remove(scenePath);
+
+		if (parsed)
+		{
+			BoundingBox meshBounds = static_cast<GeometryObject*>(sceneObjects[0].get())->getBoundingBox();
+			BoundingBox pagedBounds = static_cast<GeometryObject*>(sceneObjects[1].get())->getBoundingBox();
+
+			Vector3D<float> minError = meshBounds.getMin() - pagedBounds.getMin();
+			Vector3D<float> maxError = meshBounds.getMax() - pagedBounds.getMax();
+
+			parsed = std::abs(minError.x) + std::abs(minError.y) + std::abs(minError.z) + std::abs(maxError.x) + std::abs(maxError.y) + std::abs(maxError.z) < 1e-4f
+				&& meshBounds.getMax().y - meshBounds.getMin().y != bounds.getMax().y - bounds.getMin().y;
+		}
+
+		if (parsed)
+		{
+			std::cout << "[PASS] A rotation after the file bounds the paged mesh like the in-memory one" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] The paged mesh kept its bounds from before the rotation" << std::endl;
+		}
+	}
+
+	// A page count far beyond the file and a file cut short must both be rejected before anything is sized from them.
+	bool corruptRejected = true;
+
+	{
+		std::fstream corrupt(pageFilePath, std::ios::binary | std::ios::in | std::ios::out);
+		uint32_t pageCount = 0xFFFFFFF0u;
+
+		corrupt.seekp(8);
+		corrupt.write(reinterpret_cast<const char*>(&pageCount), sizeof(pageCount));
+	}
+
+	PagedMeshObject corruptCount;
+	corruptRejected = corruptRejected && !corruptCount.loadFile(pageFilePath) && corruptCount.getPageCount() == 0;
+
+	PagedMeshObject::buildPageFile(args[0], pageFilePath, 256);
+	std::filesystem::resize_file(pageFilePath, std::filesystem::file_size(pageFilePath) / 2);
+
+	PagedMeshObject truncated;
+	corruptRejected = corruptRejected && !truncated.loadFile(pageFilePath) && truncated.getPageCount() == 0;
+
+	std::filesystem::remove(pageFilePath);
+
+	if (corruptRejected)
+	{
+		std::cout << "[PASS] Corrupt and truncated page files are rejected" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] A corrupt or truncated page file was accepted" << std::endl;
+	}
+
+	std::cout << "Rays: " << 2 * grid * grid << ", hits: " << hits << ", pages: " << paged.getPageCount() << ", cache hits: " << paged.getCache().getHits()
+		<< ", misses: " << paged.getCache().getMisses() << ", evictions: " << paged.getCache().getEvictions() << std::endl;
+
+	if (hits > 0 && mismatches == 0)
+	{
+		std::cout << "[PASS] Paged mesh hits match the in-memory mesh, primitive ids included" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] " << mismatches << " rays differ between the paged and the in-memory mesh" << std::endl;
+	}
+
+	if (paged.getCache().getMisses() > 0 && paged.getCache().getEvictions() > 0 && withinBudget)
+	{
+		std::cout << "[PASS] Pages were loaded on demand and the resident pages stayed within the cache budget" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Cache misses " << paged.getCache().getMisses() << ", evictions " << paged.getCache().getEvictions() << ", within budget " << withinBudget << std::endl;
+	}
+}
+
+// Test: compileScene / loadCompiledScene round trip
+void T_COMPILED_SCENE(const std::vector<std::string>& args)
+{
+	std::cout << "Compiled Scene Test Running" << std::endl;
+
+	if (args.size() < 2)
+	{
+		std::cout << "Not enough arguments provided for test." << std::endl;
+		return;
+	}
+
+	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+
+	if (!SceneBuilder(args[0], sceneObjects))
+	{
+		std::cout << "[FAIL] SceneBuilder failed to parse " << args[0] << std::endl;
+		return;
+	}
+
+	Scene parsed;
+	parsed.getScene(sceneObjects);
+	parsed.buildAccelerator();
+
+	if (!writeCompiledScene(args[1], parsed, true))
+	{
+		std::cout << "[FAIL] writeCompiledScene failed to write " << args[1] << std::endl;
+		return;
+	}
+
+	Scene loaded;
+
+	if (!loadCompiledScene(args[1], loaded))
+	{
+		std::cout << "[FAIL] loadCompiledScene failed to read " << args[1] << std::endl;
+		return;
+	}
+
+	std::cout << "Geometries: " << parsed.getGeometries().size() << " parsed, " << loaded.getGeometries().size() << " loaded" << std::endl;
+	std::cout << "BVH nodes: " << parsed.getBVH().getNodes().size() << " built, " << loaded.getBVH().getNodes().size() << " loaded" << std::endl;
+
+	// Verify correctness
+	if (parsed.getObjects().size() == loaded.getObjects().size() && parsed.getGeometries().size() == loaded.getGeometries().size() && parsed.getLights().size() == loaded.getLights().size())
+	{
+		std::cout << "[PASS] Object counts match" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Loaded " << loaded.getObjects().size() << " objects, expected " << parsed.getObjects().size() << std::endl;
+	}
+
+	bool boundsMatch = true;
+
+	for (size_t i = 0; i < parsed.getGeometries().size() && i < loaded.getGeometries().size(); ++i)
+	{
+		BoundingBox& a = parsed.getGeometries()[i]->getBoundingBox();
+		BoundingBox& b = loaded.getGeometries()[i]->getBoundingBox();
+
+		if (a.getMin().x != b.getMin().x || a.getMin().y != b.getMin().y || a.getMin().z != b.getMin().z ||
+			a.getMax().x != b.getMax().x || a.getMax().y != b.getMax().y || a.getMax().z != b.getMax().z)
+		{
+			boundsMatch = false;
+			break;
+		}
+	}
+
+	if (boundsMatch && parsed.getBVH().getNodes().size() == loaded.getBVH().getNodes().size())
+	{
+		std::cout << "[PASS] Geometry bounds and BVH match" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Loaded geometry bounds or BVH differ from the parsed scene" << std::endl;
+	}
+}
+
+// Test: SceneBuilder with parallel chunks against a serial parse
+void T_PARALLEL_PARSE(const std::vector<std::string>& args)
+{
+	std::cout << "Parallel Parse Test Running" << std::endl;
+
+	// A generated scene of four 1 MB chunks that names four new shader files, the first one in the first chunk and the last one in the last chunk.
+	// Parsed in parallel first, while the material library does not know them yet: materials must still be numbered in file order.
+	{
+		const int32_t shaderCount = 4;
+		const int32_t sphereCount = 80000;
+		const std::string scenePath = "test_parallel_materials.hrs";
+
+		for (int32_t k = 0; k < shaderCount; ++k)
+		{
+			std::ofstream shader("test_parallel_shader_" + std::to_string(k) + ".hrs");
+			shader << "(surface)\n-diffuse_color- /" << k / 8.0f << ",0.5,0.5/\n;\n";
+		}
+
+		std::ofstream scene(scenePath);
+		scene << "(perspective)\n-pos- /0,1,3/\n-window- /160,90/\n;\n";
+
+		for (int32_t i = 0; i < sphereCount; ++i)
+		{
+			scene << "(sphere)\n-pos- /" << i << ",0,-5/\n-radius- /0.5/\n";
+
+			// The first chunk parses for a while before it names its shader, which gives the later chunks every chance to get in first.
+			if (i >= sphereCount / (2 * shaderCount))
+			{
+				scene << "-shader- /test_parallel_shader_" << (i * shaderCount) / sphereCount << ".hrs/\n";
+			}
+
+			scene << ";\n";
+		}
+
+		scene.close();
+
+		std::vector<std::unique_ptr<SceneObject>> parallel;
+		std::vector<std::unique_ptr<SceneObject>> serial;
+
+		bool parsed = SceneBuilder(scenePath, parallel, shaderCount) && SceneBuilder(scenePath, serial, 1) && parallel.size() == serial.size();
+		bool fileOrder = parsed;
+		uint32_t largest = 0;
+		uint32_t first = 0;
+
+		for (size_t i = 0; parsed && i < parallel.size(); ++i)
+		{
+			if (parallel[i]->getType() != SceneObjectType::GEOMETRY) { continue; }
+
+			uint32_t material = static_cast<GeometryObject*>(parallel[i].get())->getMaterial();
+
+			fileOrder = fileOrder && material == static_cast<GeometryObject*>(serial[i].get())->getMaterial();
+
+			if (material == 0) { continue; }
+
+			// Every index is one seen before or the next one to be registered.
+			fileOrder = fileOrder && (largest == 0 || material <= largest + 1);
+
+			first = (largest == 0) ? material : first;
+			largest = std::max(largest, material);
+		}
+
+		fileOrder = fileOrder && largest - first + 1 == shaderCount;
+
+		std::filesystem::remove(scenePath);
+
+		for (int32_t k = 0; k < shaderCount; ++k)
+		{
+			std::filesystem::remove("test_parallel_shader_" + std::to_string(k) + ".hrs");
+		}
+
+		if (fileOrder)
+		{
+			std::cout << "[PASS] Parallel parse numbers new materials in file order" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] Parallel parse registered materials out of file order" << std::endl;
+		}
+	}
+
+	if (args.empty())
+	{
+		std::cout << "Not enough arguments provided for test." << std::endl;
+		return;
+	}
+
+	int32_t threads = (args.size() > 1) ? std::stoi(args[1]) : 8;
+
+	std::vector<std::unique_ptr<SceneObject>> serial;
+	std::vector<std::unique_ptr<SceneObject>> parallel;
+
+	auto t0 = std::chrono::steady_clock::now();
+	bool serialResult = SceneBuilder(args[0], serial, 1);
+	auto t1 = std::chrono::steady_clock::now();
+	bool parallelResult = SceneBuilder(args[0], parallel, threads);
+	auto t2 = std::chrono::steady_clock::now();
+
+	std::cout << "Serial: " << serial.size() << " objects in " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms" << std::endl;
+	std::cout << "Parallel (" << threads << " threads): " << parallel.size() << " objects in " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms" << std::endl;
+
+	if (!serialResult || !parallelResult || serial.size() != parallel.size())
+	{
+		std::cout << "[FAIL] Object counts differ" << std::endl;
+		return;
+	}
+
+	// Verify correctness
+	for (size_t i = 0; i < serial.size(); ++i)
+	{
+		if (serial[i]->getObjectName() != parallel[i]->getObjectName() ||
+			serial[i]->position.x != parallel[i]->position.x || serial[i]->position.y != parallel[i]->position.y || serial[i]->position.z != parallel[i]->position.z)
+		{
+			std::cout << "[FAIL] Object " << i << " differs between serial and parallel parse" << std::endl;
+			return;
+		}
+	}
+
+	std::cout << "[PASS] Parallel parse matches the serial order" << std::endl;
+}
+
+// Test: Framebuffer tiled addressing and weighted accumulation
+void T_FRAMEBUFFER(const std::vector<std::string>&)
+{
+	std::cout << "Framebuffer Test Running" << std::endl;
+
+	// A size that is not a multiple of the tile size, so the edge tiles are partly used.
+	const int32_t width = 37;
+	const int32_t height = 21;
+
+	Framebuffer framebuffer(width, height);
+
+	// Write column by column, bottom up, i.e. not in scanline order.
+	for (int32_t x = width - 1; x >= 0; --x)
+	{
+		for (int32_t y = height - 1; y >= 0; --y)
+		{
+			framebuffer.set(x, y, Vector3D<float>(static_cast<float>(x), static_cast<float>(y), 1.0f));
+		}
+	}
+
+	std::vector<Vector3D<float>> row(width);
+	bool rowsMatch = true;
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		framebuffer.getRow(y, row.data());
+
+		for (int32_t x = 0; x < width; ++x)
+		{
+			if (row[x].x != x || row[x].y != y || row[x].z != 1.0f)
+			{
+				rowsMatch = false;
+			}
+		}
+	}
+
+	// Verify correctness
+	if (rowsMatch)
+	{
+		std::cout << "[PASS] Pixels written in any order read back in scanline order" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] A pixel read back differs from the one written" << std::endl;
+	}
+
+	Framebuffer accumulation(width, height, true);
+
+	accumulation.accumulate(5, 7, Vector3D<float>(1.0f, 0.0f, 0.0f));
+	accumulation.accumulate(5, 7, Vector3D<float>(0.0f, 1.0f, 0.0f), 3.0f);
+
+	Vector3D<float> resolved = accumulation.get(5, 7);
+
+	if (resolved.x == 0.25f && resolved.y == 0.75f && accumulation.get(6, 7).x == 0.0f)
+	{
+		std::cout << "[PASS] Weighted samples resolve to their weighted mean" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Resolved " << resolved.x << " " << resolved.y << ", expected 0.25 0.75" << std::endl;
+	}
+}
+
+// Reads deflate bits least significant first; 'failed' is set when the data runs out.
+struct InflateReader
+{
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	size_t position = 0;
+	uint32_t bits = 0;
+	int32_t bitCount = 0;
+	bool failed = false;
+
+	uint32_t get(int32_t count)
+	{
+		while (bitCount < count)
+		{
+			if (position >= size)
+			{
+				failed = true;
+				return 0;
+			}
+
+			bits |= static_cast<uint32_t>(data[position++]) << bitCount;
+			bitCount += 8;
+		}
+
+		uint32_t value = bits & ((1u << count) - 1);
+		bits >>= count;
+		bitCount -= count;
+
+		return value;
+	}
+};
+
+// Canonical Huffman decoding table: code counts per length and the symbols in code order.
+struct InflateTable
+{
+	uint16_t count[16];
+	uint16_t symbol[288];
+};
+
+// Builds the table for 'lengths'. Only complete codes are accepted, which is what the encoder has to produce.
+static bool buildInflateTable(InflateTable& table, const uint8_t* lengths, int32_t count)
+{
+	std::fill(table.count, table.count + 16, 0);
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		++table.count[lengths[i]];
+	}
+
+	int32_t left = 1;
+
+	for (int32_t length = 1; length < 16; ++length)
+	{
+		left = 2 * left - table.count[length];
+
+		if (left < 0) { return false; }
+	}
+
+	uint16_t offsets[16] = {};
+
+	for (int32_t length = 1; length < 15; ++length)
+	{
+		offsets[length + 1] = offsets[length] + table.count[length];
+	}
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		if (lengths[i] != 0)
+		{
+			table.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+		}
+	}
+
+	return left == 0;
+}
+
+static int32_t decodeSymbol(InflateReader& reader, const InflateTable& table)
+{
+	int32_t code = 0;
+	int32_t first = 0;
+	int32_t index = 0;
+
+	for (int32_t length = 1; length < 16; ++length)
+	{
+		code |= reader.get(1);
+
+		if (code - table.count[length] < first)
+		{
+			return table.symbol[index + (code - first)];
+		}
+
+		index += table.count[length];
+		first = (first + table.count[length]) << 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+struct InflateStats
+{
+	int32_t dynamicBlocks = 0;
+	int32_t storedBlocks = 0;
+	int32_t longestMatch = 0;
+};
+
+// Minimal inflate (RFC 1951) for checking deflateCompress: stored and dynamic blocks only, since those are the two the encoder writes.
+// Returns true if the stream decoded to its final block without errors.
+static bool inflateStream(const uint8_t* data, size_t size, std::vector<uint8_t>& out, InflateStats& stats)
+{
+	static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	static const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	InflateReader reader;
+	reader.data = data;
+	reader.size = size;
+
+	bool final = false;
+
+	while (!final)
+	{
+		final = reader.get(1) == 1;
+		uint32_t type = reader.get(2);
+
+		if (type == 0)
+		{
+			reader.bits = 0;
+			reader.bitCount = 0;
+
+			uint32_t length = reader.get(16);
+			uint32_t complement = reader.get(16);
+
+			if (reader.failed || (length ^ 0xFFFF) != complement || reader.position + length > size) { return false; }
+
+			out.insert(out.end(), data + reader.position, data + reader.position + length);
+			reader.position += length;
+			++stats.storedBlocks;
+			continue;
+		}
+
+		if (type != 2) { return false; }
+
+		int32_t literalCount = reader.get(5) + 257;
+		int32_t distanceCount = reader.get(5) + 1;
+		int32_t codeLengthCount = reader.get(4) + 4;
+
+		uint8_t codeLengthLengths[19] = {};
+
+		for (int32_t i = 0; i < codeLengthCount; ++i)
+		{
+			codeLengthLengths[codeLengthOrder[i]] = static_cast<uint8_t>(reader.get(3));
+		}
+
+		InflateTable codeLengthTable;
+
+		if (!buildInflateTable(codeLengthTable, codeLengthLengths, 19)) { return false; }
+
+		std::vector<uint8_t> lengths;
+
+		while (static_cast<int32_t>(lengths.size()) < literalCount + distanceCount)
+		{
+			int32_t symbol = decodeSymbol(reader, codeLengthTable);
+
+			if (symbol < 0 || reader.failed) { return false; }
+
+			if (symbol < 16)
+			{
+				lengths.push_back(static_cast<uint8_t>(symbol));
+				continue;
+			}
+
+			if (symbol == 16 && lengths.empty()) { return false; }
+
+			uint8_t value = (symbol == 16) ? lengths.back() : 0;
+			uint32_t repeat = (symbol == 16) ? 3 + reader.get(2) : (symbol == 17) ? 3 + reader.get(3) : 11 + reader.get(7);
+
+			lengths.insert(lengths.end(), repeat, value);
+		}
+
+		if (static_cast<int32_t>(lengths.size()) != literalCount + distanceCount) { return false; }
+
+		InflateTable literalTable;
+		InflateTable distanceTable;
+
+		if (!buildInflateTable(literalTable, lengths.data(), literalCount) || !buildInflateTable(distanceTable, lengths.data() + literalCount, distanceCount))
+		{
+			return false;
+		}
+
+		while (true)
+		{
+			int32_t symbol = decodeSymbol(reader, literalTable);
+
+			if (symbol < 0 || reader.failed) { return false; }
+
+			if (symbol < 256)
+			{
+				out.push_back(static_cast<uint8_t>(symbol));
+				continue;
+			}
+
+			if (symbol == 256) { break; }
+
+			symbol -= 257;
+
+			if (symbol >= 29) { return false; }
+
+			int32_t length = lengthBase[symbol] + reader.get(lengthExtra[symbol]);
+			int32_t distanceSymbol = decodeSymbol(reader, distanceTable);
+
+			if (distanceSymbol < 0 || distanceSymbol >= 30 || reader.failed) { return false; }
+
+			size_t distance = distanceBase[distanceSymbol] + reader.get(distanceExtra[distanceSymbol]);
+
+			if (distance > out.size()) { return false; }
+
+			for (int32_t i = 0; i < length; ++i)
+			{
+				out.push_back(out[out.size() - distance]);
+			}
+
+			stats.longestMatch = std::max(stats.longestMatch, length);
+		}
+
+		++stats.dynamicBlocks;
+	}
+
+	return !reader.failed;
+}
+
+static uint32_t referenceCRC32(const uint8_t* data, size_t size)
+{
+	uint32_t crc = 0xFFFFFFFFu;
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		crc ^= data[i];
+
+		for (int32_t k = 0; k < 8; ++k)
+		{
+			crc = (crc & 1) ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+		}
+	}
+
+	return ~crc;
+}
+
+static std::vector<uint8_t> readWholeFile(const std::string& filePath)
+{
+	std::ifstream file(filePath, std::ios::binary);
+
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static uint32_t readBigEndian(const uint8_t* p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// Decodes an 8 bit RGB PNG as written by writePNG and PNGStreamWriter, checking every chunk CRC and the zlib checksum.
+static bool decodePNG(const std::string& filePath, std::vector<uint8_t>& rgb, int32_t& width, int32_t& height)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	std::vector<uint8_t> file = readWholeFile(filePath);
+
+	if (file.size() < 8 || !std::equal(signature, signature + 8, file.begin())) { return false; }
+
+	std::vector<uint8_t> zlib;
+	bool ended = false;
+
+	for (size_t p = 8; p < file.size() && !ended;)
+	{
+		if (p + 12 > file.size()) { return false; }
+
+		uint32_t length = readBigEndian(&file[p]);
+
+		if (p + 12 + length > file.size()) { return false; }
+
+		const uint8_t* type = &file[p + 4];
+		const uint8_t* body = &file[p + 8];
+
+		if (referenceCRC32(type, length + 4) != readBigEndian(body + length)) { return false; }
+
+		if (std::equal(type, type + 4, "IHDR"))
+		{
+			if (length != 13 || body[8] != 8 || body[9] != 2) { return false; }
+
+			width = static_cast<int32_t>(readBigEndian(body));
+			height = static_cast<int32_t>(readBigEndian(body + 4));
+		}
+		else if (std::equal(type, type + 4, "IDAT"))
+		{
+			zlib.insert(zlib.end(), body, body + length);
+		}
+		else if (std::equal(type, type + 4, "IEND"))
+		{
+			ended = true;
+		}
+
+		p += 12 + length;
+	}
+
+	if (!ended || zlib.size() < 6 || (zlib[0] & 0x0F) != 8 || ((zlib[0] << 8) | zlib[1]) % 31 != 0) { return false; }
+
+	std::vector<uint8_t> filtered;
+	InflateStats stats;
+
+	if (!inflateStream(zlib.data() + 2, zlib.size() - 6, filtered, stats)) { return false; }
+
+	if (adler32(filtered.data(), filtered.size()) != readBigEndian(&zlib[zlib.size() - 4])) { return false; }
+
+	const size_t rowSize = static_cast<size_t>(width) * 3;
+
+	if (filtered.size() != (rowSize + 1) * height) { return false; }
+
+	rgb.assign(rowSize * height, 0);
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* in = &filtered[y * (rowSize + 1)];
+		uint8_t* row = &rgb[y * rowSize];
+		const uint8_t* above = (y > 0) ? row - rowSize : nullptr;
+
+		for (size_t i = 0; i < rowSize; ++i)
+		{
+			int32_t a = (i >= 3) ? row[i - 3] : 0;
+			int32_t b = above ? above[i] : 0;
+			int32_t c = (above && i >= 3) ? above[i - 3] : 0;
+
+			int32_t predictor = 0;
+
+			switch (in[0])
+			{
+				case 0: predictor = 0; break;
+				case 1: predictor = a; break;
+				case 2: predictor = b; break;
+				case 3: predictor = (a + b) >> 1; break;
+				case 4:
+				{
+					int32_t pa = std::abs(b - c);
+					int32_t pb = std::abs(a - c);
+					int32_t pc = std::abs(a + b - 2 * c);
+
+					predictor = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+					break;
+				}
+				default: return false;
+			}
+
+			row[i] = static_cast<uint8_t>(in[1 + i] + predictor);
+		}
+	}
+
+	return true;
+}
+
+// Test: deflate round trips through a reference inflate, and PNG files decode to the pixels written
+void T_DEFLATE(const std::vector<std::string>&)
+{
+	std::cout << "Deflate Test Running" << std::endl;
+
+	uint32_t state = 12345;
+
+	auto nextRandom = [&]()
+	{
+		state = state * 1664525u + 1013904223u;
+
+		return state >> 24;
+	};
+
+	// Mostly short literal runs from a small alphabet: well over 32768 tokens, so the data spans several blocks.
+	std::vector<uint8_t> noise(300000);
+
+	for (uint8_t& value : noise)
+	{
+		value = static_cast<uint8_t>('a' + nextRandom() % 16);
+	}
+
+	struct DeflateCase
+	{
+		const char* name;
+		std::vector<uint8_t> data;
+		int32_t minimumBlocks;
+		int32_t minimumMatch;
+	};
+
+	std::vector<DeflateCase> cases;
+	cases.push_back({ "empty input", {}, 1, 0 });
+	cases.push_back({ "single byte", { 'x' }, 1, 0 });
+	cases.push_back({ "single symbol run", std::vector<uint8_t>(100000, 'A'), 1, 258 });
+	cases.push_back({ "more than 32768 tokens", noise, 2, 0 });
+
+	for (const DeflateCase& test : cases)
+	{
+		std::vector<uint8_t> compressed;
+		deflateCompress(test.data.data(), test.data.size(), true, compressed);
+
+		std::vector<uint8_t> decompressed;
+		InflateStats stats;
+
+		bool decoded = inflateStream(compressed.data(), compressed.size(), decompressed, stats);
+
+		if (decoded && decompressed == test.data && stats.dynamicBlocks >= test.minimumBlocks && stats.longestMatch >= test.minimumMatch)
+		{
+			std::cout << "[PASS] Deflate " << test.name << ": " << test.data.size() << " bytes in " << compressed.size() << ", " << stats.dynamicBlocks << " blocks" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] Deflate " << test.name << ": decoded " << decoded << ", " << decompressed.size() << " of " << test.data.size() << " bytes, "
+				<< stats.dynamicBlocks << " blocks, longest match " << stats.longestMatch << std::endl;
+		}
+	}
+
+	// Independent chunks concatenate into one stream, each non-final chunk ending on an empty stored block.
+	std::vector<uint8_t> chunked;
+	size_t split = noise.size() / 3;
+
+	deflateCompress(noise.data(), split, false, chunked);
+	deflateCompress(noise.data() + split, split, false, chunked);
+	deflateCompress(noise.data() + 2 * split, noise.size() - 2 * split, true, chunked);
+
+	std::vector<uint8_t> joined;
+	InflateStats chunkStats;
+
+	if (inflateStream(chunked.data(), chunked.size(), joined, chunkStats) && joined == noise && chunkStats.storedBlocks == 2)
+	{
+		std::cout << "[PASS] Concatenated chunks decode as one stream" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Concatenated chunks did not decode to the input" << std::endl;
+	}
+
+	const char* text = "Wikipedia";
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(text);
+
+	if (adler32(bytes, 9) == 0x11E60398u && adler32(bytes + 4, 5, adler32(bytes, 4)) == 0x11E60398u && adler32(noise.data() + split, noise.size() - split, adler32(noise.data(), split)) == adler32(noise.data(), noise.size()))
+	{
+		std::cout << "[PASS] Adler-32 matches the reference value and continues across calls" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Adler-32 of \"Wikipedia\" is " << adler32(bytes, 9) << ", expected 300286872" << std::endl;
+	}
+
+	// Wide enough for several stripes in writePNG and several IDAT flushes in the stream writer; smooth gradients with noise
+	// exercise every row filter.
+	const int32_t width = 700;
+	const int32_t height = 500;
+
+	std::vector<uint8_t> image(static_cast<size_t>(width) * height * 3);
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			uint8_t* pixel = &image[(static_cast<size_t>(y) * width + x) * 3];
+
+			pixel[0] = static_cast<uint8_t>(x / 3);
+			pixel[1] = static_cast<uint8_t>((x + y) / 5);
+			pixel[2] = static_cast<uint8_t>((y < height / 2) ? nextRandom() : y);
+		}
+	}
+
+	const std::string pngPath = "test_deflate.png";
+
+	for (int32_t streamed = 0; streamed < 2; ++streamed)
+	{
+		bool written = true;
+
+		if (streamed)
+		{
+			PNGStreamWriter writer;
+			written = writer.open(pngPath, width, height);
+
+			for (int32_t y = 0; written && y < height; ++y)
+			{
+				writer.writeRow(&image[static_cast<size_t>(y) * width * 3]);
+			}
+
+			written = written && writer.close();
+		}
+		else
+		{
+			written = writePNG(pngPath, image, width, height, 4);
+		}
+
+		std::vector<uint8_t> decoded;
+		int32_t decodedWidth = 0;
+		int32_t decodedHeight = 0;
+
+		bool valid = written && decodePNG(pngPath, decoded, decodedWidth, decodedHeight);
+
+		if (valid && decodedWidth == width && decodedHeight == height && decoded == image)
+		{
+			std::cout << "[PASS] " << (streamed ? "PNGStreamWriter" : "writePNG") << " output decodes to the pixels written" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] " << (streamed ? "PNGStreamWriter" : "writePNG") << " output is not a valid PNG of the pixels written" << std::endl;
+		}
+	}
+
+	std::filesystem::remove(pngPath);
+}
+
+// Op counts seen while decoding a QOI file.
+struct QOIStats
+{
+	int32_t rgb = 0;
+	int32_t index = 0;
+	int32_t diff = 0;
+	int32_t luma = 0;
+	int32_t run = 0;
+};
+
+// Decodes a 3 channel QOI file. Returns true if the header, the pixel count and the end marker are all valid.
+static bool decodeQOI(const std::string& filePath, std::vector<uint8_t>& rgb, int32_t& width, int32_t& height, QOIStats& stats)
+{
+	static const uint8_t endMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+
+	std::vector<uint8_t> file = readWholeFile(filePath);
+
+	if (file.size() < 14 + 8 || !std::equal(file.begin(), file.begin() + 4, "qoif") || file[12] != 3) { return false; }
+
+	width = static_cast<int32_t>(readBigEndian(&file[4]));
+	height = static_cast<int32_t>(readBigEndian(&file[8]));
+
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	const size_t end = file.size() - 8;
+
+	QOIPixel index[64];
+	QOIPixel pixel;
+
+	rgb.clear();
+	rgb.reserve(pixelCount * 3);
+
+	size_t p = 14;
+
+	while (rgb.size() < pixelCount * 3 && p < end)
+	{
+		uint8_t op = file[p++];
+		int32_t run = 1;
+
+		if (op == 0xFE)
+		{
+			if (p + 3 > end) { return false; }
+
+			pixel.r = file[p];
+			pixel.g = file[p + 1];
+			pixel.b = file[p + 2];
+			p += 3;
+			++stats.rgb;
+		}
+		else if ((op & 0xC0) == 0x00)
+		{
+			pixel = index[op];
+			++stats.index;
+		}
+		else if ((op & 0xC0) == 0x40)
+		{
+			pixel.r = static_cast<uint8_t>(pixel.r + ((op >> 4) & 3) - 2);
+			pixel.g = static_cast<uint8_t>(pixel.g + ((op >> 2) & 3) - 2);
+			pixel.b = static_cast<uint8_t>(pixel.b + (op & 3) - 2);
+			++stats.diff;
+		}
+		else if ((op & 0xC0) == 0x80)
+		{
+			if (p + 1 > end) { return false; }
+
+			int32_t dg = (op & 0x3F) - 32;
+			int32_t drg = (file[p] >> 4) - 8;
+			int32_t dbg = (file[p] & 0x0F) - 8;
+			++p;
+
+			pixel.r = static_cast<uint8_t>(pixel.r + dg + drg);
+			pixel.g = static_cast<uint8_t>(pixel.g + dg);
+			pixel.b = static_cast<uint8_t>(pixel.b + dg + dbg);
+			++stats.luma;
+		}
+		else
+		{
+			// 0xFF is RGBA, which a 3 channel file never holds.
+			if (op == 0xFF) { return false; }
+
+			run = (op & 0x3F) + 1;
+			++stats.run;
+		}
+
+		index[(pixel.r * 3 + pixel.g * 5 + pixel.b * 7 + pixel.a * 11) % 64] = pixel;
+
+		for (int32_t i = 0; i < run; ++i)
+		{
+			rgb.insert(rgb.end(), { pixel.r, pixel.g, pixel.b });
+		}
+	}
+
+	return rgb.size() == pixelCount * 3 && p == end && std::equal(endMarker, endMarker + 8, file.begin() + end);
+}
+
+// Test: QOI files decode to the pixels written, with every op the encoder has in use
+void T_QOI(const std::vector<std::string>&)
+{
+	std::cout << "QOI Test Running" << std::endl;
+
+	const int32_t width = 150;
+	const int32_t height = 60;
+
+	uint32_t state = 777;
+
+	auto nextRandom = [&]()
+	{
+		state = state * 1664525u + 1013904223u;
+
+		return static_cast<uint8_t>(state >> 24);
+	};
+
+	// Bands of rows, each aimed at one op: flat rows longer than the 62 pixel run limit, two alternating colours for the index,
+	// steps of +-1 for diff, steps of a few units for luma and noise for the plain RGB op. The image ends on a run.
+	std::vector<uint8_t> image(static_cast<size_t>(width) * height * 3);
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		int32_t band = (y / 4) % 5;
+
+		for (int32_t x = 0; x < width; ++x)
+		{
+			uint8_t* pixel = &image[(static_cast<size_t>(y) * width + x) * 3];
+
+			switch ((y >= height - 2) ? 0 : band)
+			{
+				case 0: pixel[0] = 40; pixel[1] = 80; pixel[2] = 120; break;
+				case 1: pixel[0] = (x % 2) ? 200 : 10; pixel[1] = (x % 2) ? 30 : 220; pixel[2] = 90; break;
+				case 2: pixel[0] = static_cast<uint8_t>(100 + x % 3); pixel[1] = static_cast<uint8_t>(100 - x % 2); pixel[2] = 100; break;
+				case 3: pixel[0] = static_cast<uint8_t>(x * 7); pixel[1] = static_cast<uint8_t>(x * 6); pixel[2] = static_cast<uint8_t>(x * 5); break;
+				default: pixel[0] = nextRandom(); pixel[1] = nextRandom(); pixel[2] = nextRandom(); break;
+			}
+		}
+	}
+
+	const std::string qoiPath = "test_qoi.qoi";
+
+	std::vector<uint8_t> decoded;
+	int32_t decodedWidth = 0;
+	int32_t decodedHeight = 0;
+	QOIStats stats;
+
+	bool valid = writeQOI(qoiPath, image, width, height) && decodeQOI(qoiPath, decoded, decodedWidth, decodedHeight, stats);
+
+	std::filesystem::remove(qoiPath);
+
+	std::cout << "Ops: rgb " << stats.rgb << ", index " << stats.index << ", diff " << stats.diff << ", luma " << stats.luma << ", run " << stats.run << std::endl;
+
+	if (valid && decodedWidth == width && decodedHeight == height && decoded == image)
+	{
+		std::cout << "[PASS] QOI output decodes to the pixels written" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] QOI output is not a valid QOI file of the pixels written" << std::endl;
+	}
+
+	if (stats.rgb > 0 && stats.index > 0 && stats.diff > 0 && stats.luma > 0 && stats.run > 0)
+	{
+		std::cout << "[PASS] Every QOI op is exercised" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Some QOI op was never written" << std::endl;
+	}
+}
+
+// Test: vectorized post-process against the scalar reference
+void T_POST_PROCESS(const std::vector<std::string>&)
+{
+	std::cout << "Post Process Test Running" << std::endl;
+
+	const int32_t width = 37;
+	const int32_t height = 21;
+
+	Framebuffer framebuffer(width, height);
+
+	// Radiance from 0 up to 8, covering the linear segment of the sRGB curve and values the tone mapping has to bring into range.
+	auto radiance = [](int32_t x, int32_t y, int32_t channel)
+	{
+		return static_cast<float>((x * 7 + y * 13 + channel * 3) % 101) * (static_cast<float>(y + 1) / height) * 0.08f;
+	};
+
+	const ToneMapping toneMappings[] = { ToneMapping::NONE, ToneMapping::REINHARD, ToneMapping::ACES };
+	const TransferCurve transferCurves[] = { TransferCurve::GAMMA2, TransferCurve::SRGB };
+
+	float maxError = 0.0f;
+
+	for (ToneMapping toneMapping : toneMappings)
+	{
+		for (TransferCurve transferCurve : transferCurves)
+		{
+			PostProcessSettings settings;
+			settings.exposure = -0.5f;
+			settings.toneMapping = toneMapping;
+			settings.transferCurve = transferCurve;
+			settings.dither = true;
+
+			PostProcess postProcess;
+			postProcess.setSettings(settings);
+
+			for (int32_t y = 0; y < height; ++y)
+			{
+				for (int32_t x = 0; x < width; ++x)
+				{
+					framebuffer.set(x, y, Vector3D<float>(radiance(x, y, 0), radiance(x, y, 1), radiance(x, y, 2)));
+				}
+			}
+
+			postProcess.apply(framebuffer);
+
+			for (int32_t y = 0; y < height; ++y)
+			{
+				for (int32_t x = 0; x < width; ++x)
+				{
+					Vector3D<float> value = framebuffer.get(x, y);
+					float dither = PostProcess::getDither(x % Framebuffer::tileSize, y % Framebuffer::tileSize);
+
+					maxError = std::max(maxError, std::abs(value.x - postProcess.applyScalar(radiance(x, y, 0), dither)));
+					maxError = std::max(maxError, std::abs(value.y - postProcess.applyScalar(radiance(x, y, 1), dither)));
+					maxError = std::max(maxError, std::abs(value.z - postProcess.applyScalar(radiance(x, y, 2), dither)));
+				}
+			}
+		}
+	}
+
+	// Far below the 1 / 255 step of an 8 bit output.
+	if (maxError < 1e-5f)
+	{
+		std::cout << "[PASS] Post process matches the scalar reference, max error " << maxError << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Post process differs from the scalar reference by " << maxError << std::endl;
+	}
+}
+
+// Test: half float conversions and the half precision framebuffer
+void T_HALF_FLOAT(const std::vector<std::string>&)
+{
+	std::cout << "Half Float Test Running" << std::endl;
+	std::cout << "F16C: " << (hasF16C() ? "yes" : "no") << std::endl;
+
+	// Every half value, NaNs excepted, converts to float and back unchanged, through both the scalar and the bulk path.
+	std::vector<uint16_t> halves;
+	for (uint32_t h = 0; h < 65536; ++h)
+	{
+		if ((h & 0x7C00) != 0x7C00 || (h & 0x03FF) == 0)
+		{
+			halves.push_back(static_cast<uint16_t>(h));
+		}
+	}
+
+	std::vector<float> values(halves.size());
+	std::vector<uint16_t> roundTrip(halves.size());
+
+	halvesToFloats(halves.data(), values.data(), halves.size());
+	floatsToHalves(values.data(), roundTrip.data(), values.size());
+
+	bool exact = true;
+
+	for (size_t i = 0; i < halves.size(); ++i)
+	{
+		if (roundTrip[i] != halves[i] || floatToHalf(halfToFloat(halves[i])) != halves[i] || halfToFloat(halves[i]) != values[i])
+		{
+			exact = false;
+		}
+	}
+
+	if (exact)
+	{
+		std::cout << "[PASS] All half values round trip exactly" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] A half value changed in a round trip" << std::endl;
+	}
+
+	// Floats in [0, 1] round to within 2^-11 relative, and both paths agree.
+	std::vector<float> samples;
+	for (uint32_t i = 0; i <= 1000000; ++i)
+	{
+		samples.push_back(static_cast<float>(i) / 1000000.0f);
+	}
+
+	std::vector<uint16_t> bulk(samples.size());
+	floatsToHalves(samples.data(), bulk.data(), samples.size());
+
+	float maxError = 0.0f;
+	bool pathsAgree = true;
+
+	for (size_t i = 0; i < samples.size(); ++i)
+	{
+		if (bulk[i] != floatToHalf(samples[i]))
+		{
+			pathsAgree = false;
+		}
+
+		if (samples[i] >= 6.103515625e-5f)
+		{
+			maxError = std::max(maxError, std::abs(halfToFloat(bulk[i]) - samples[i]) / samples[i]);
+		}
+	}
+
+	if (pathsAgree && maxError <= 1.0f / 2048.0f)
+	{
+		std::cout << "[PASS] Rounding error " << maxError << " within 2^-11" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Rounding error " << maxError << (pathsAgree ? "" : ", bulk and scalar results differ") << std::endl;
+	}
+
+	// Arbitrary float bit patterns, NaNs excepted (F16C keeps their payloads), through the F16C kernels when the CPU has them:
+	// overflow to infinity, float and half subnormals, and odd counts for the scalar tail.
+	if (hasF16C())
+	{
+		std::vector<float> patterns;
+		uint32_t state = 2024;
+
+		while (patterns.size() < 1000003)
+		{
+			state = state * 1664525u + 1013904223u;
+
+			uint32_t bits = state;
+
+			// Bias half of them to the exponents where halves are subnormal or overflow.
+			if (patterns.size() % 2)
+			{
+				bits = (bits & 0x807FFFFFu) | ((96u + (state >> 24) % 48) << 23);
+			}
+
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+
+			if (!std::isnan(value))
+			{
+				patterns.push_back(value);
+			}
+		}
+
+		std::vector<uint16_t> hardware(patterns.size());
+		std::vector<float> widened(halves.size());
+
+		floatsToHalves(patterns.data(), hardware.data(), patterns.size());
+		halvesToFloats(halves.data(), widened.data(), halves.size() - 1);
+
+		bool matches = true;
+
+		for (size_t i = 0; i < patterns.size(); ++i)
+		{
+			matches = matches && hardware[i] == floatToHalf(patterns[i]);
+		}
+
+		for (size_t i = 0; i + 1 < halves.size(); ++i)
+		{
+			float scalar = halfToFloat(halves[i]);
+
+			matches = matches && std::memcmp(&widened[i], &scalar, sizeof(float)) == 0;
+		}
+
+		if (matches)
+		{
+			std::cout << "[PASS] F16C conversions match the scalar ones bit for bit" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] F16C and scalar conversions differ" << std::endl;
+		}
+	}
+	else
+	{
+		std::cout << "F16C not available on this CPU, the bulk conversions ran the scalar path" << std::endl;
+	}
+
+	// A weighted half framebuffer resolves to the same mean as a float one, within the half rounding.
+	Framebuffer reference(37, 21, true);
+	Framebuffer half;
+	half.setHalfPrecision(true);
+	half.resize(37, 21, true);
+
+	for (int32_t pass = 0; pass < 10; ++pass)
+	{
+		float weight = static_cast<float>(1 << pass);
+
+		for (int32_t y = 0; y < 21; ++y)
+		{
+			for (int32_t x = 0; x < 37; ++x)
+			{
+				Vector3D<float> color(static_cast<float>((x + pass) % 7), static_cast<float>(y % 5) * 0.1f, 1000.0f);
+
+				reference.accumulate(x, y, color, weight);
+				half.accumulate(x, y, color, weight);
+			}
+		}
+	}
+
+	float meanError = 0.0f;
+
+	for (int32_t y = 0; y < 21; ++y)
+	{
+		for (int32_t x = 0; x < 37; ++x)
+		{
+			Vector3D<float> expected = reference.get(x, y);
+			Vector3D<float> value = half.get(x, y);
+
+			meanError = std::max(meanError, std::abs(value.x - expected.x) / std::max(expected.x, 1e-3f));
+			meanError = std::max(meanError, std::abs(value.y - expected.y) / std::max(expected.y, 1e-3f));
+			meanError = std::max(meanError, std::abs(value.z - expected.z) / expected.z);
+		}
+	}
+
+	if (meanError <= 1.0f / 1024.0f && half.getMemorySize() * 16 == reference.getMemorySize() * 10)
+	{
+		std::cout << "[PASS] Half accumulation within 2^-10 of the float one, " << half.getMemorySize() << " bytes instead of " << reference.getMemorySize() << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Half accumulation error " << meanError << std::endl;
+	}
+}
+
+// Test: denoiser on a noisy image of two facing planes
+void T_DENOISE(const std::vector<std::string>&)
+{
+	std::cout << "Denoise Test Running" << std::endl;
+
+	const int32_t width = 64;
+	const int32_t height = 48;
+	const int32_t samples = 16;
+
+	// Left half: gray plane facing the camera at radiance 0.2. Right half: white plane at a right angle to it, radiance 0.8.
+	// Every pixel averages 'samples' samples that are either 0 or twice the radiance.
+	Framebuffer color(width, height);
+	Denoiser denoiser;
+	denoiser.resize(width, height);
+
+	UnitRandom random;
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			bool left = x < width / 2;
+			float radiance = left ? 0.2f : 0.8f;
+
+			AOVSample aov;
+			float sum = 0.0f;
+
+			for (int32_t k = 0; k < samples; ++k)
+			{
+				float value = (random.Generate() < 0.5f) ? 2.0f * radiance : 0.0f;
+				// Gray, so the luminance is the value itself.
+				sum += value;
+				aov.luminanceSquared += value * value;
+			}
+
+			aov.depth = 5.0f * samples;
+			aov.normal = (left ? Vector3D<float>(0.0f, 0.0f, 1.0f) : Vector3D<float>(1.0f, 0.0f, 0.0f)) * (float)samples;
+			aov.albedo = Vector3D<float>(1.0f, 1.0f, 1.0f) * (float)samples;
+
+			float mean = sum / samples;
+
+			color.set(x, y, Vector3D<float>(mean, mean, mean));
+			denoiser.addSample(x, y, aov, samples);
+		}
+	}
+
+	// Error against the true radiance, on each side of the edge.
+	auto error = [&](int32_t x0, int32_t x1, float radiance)
+	{
+		float sum = 0.0f;
+
+		for (int32_t y = 0; y < height; ++y)
+		{
+			for (int32_t x = x0; x < x1; ++x)
+			{
+				float difference = color.get(x, y).x - radiance;
+
+				sum += difference * difference;
+			}
+		}
+
+		return std::sqrt(sum / ((x1 - x0) * height));
+	};
+
+	float noisyLeft = error(0, width / 2, 0.2f);
+	float noisyRight = error(width / 2, width, 0.8f);
+
+	denoiser.apply(color, samples);
+
+	float denoisedLeft = error(0, width / 2, 0.2f);
+	float denoisedRight = error(width / 2, width, 0.8f);
+
+	std::cout << "RMS error left " << noisyLeft << " -> " << denoisedLeft << ", right " << noisyRight << " -> " << denoisedRight << std::endl;
+
+	// Blurring across the edge would pull the columns next to it toward the other plane.
+	bool edgeKept = std::abs(color.get(width / 2 - 1, height / 2).x - 0.2f) < 0.1f && std::abs(color.get(width / 2, height / 2).x - 0.8f) < 0.2f;
+
+	if (denoisedLeft < noisyLeft * 0.5f && denoisedRight < noisyRight * 0.5f && edgeKept)
+	{
+		std::cout << "[PASS] Noise reduced on both planes and the edge between them kept" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Denoised error too high or edge blurred" << std::endl;
+	}
+}
+
+// Test: stratification of the samplers
+void T_SAMPLER(const std::vector<std::string>&)
+{
+	std::cout << "Sampler Test Running" << std::endl;
+
+	const int32_t count = 16;
+
+	// The first 16 Owen scrambled Sobol points of every pixel put one point in each cell of a 4x4 grid, in each aligned pair of dimensions.
+	std::unique_ptr<Sampler> sobol = createSampler(SamplerType::SOBOL);
+	bool sobolStratified = true;
+
+	for (int32_t pixel = 0; pixel < 8; ++pixel)
+	{
+		std::vector<int32_t> cameraCells(count, 0);
+		std::vector<int32_t> bounceCells(count, 0);
+
+		for (int32_t k = 0; k < count; ++k)
+		{
+			sobol->startSample(pixel, 3, k, count);
+
+			float u = sobol->get1D();
+			float v = sobol->get1D();
+			sobol->get1D();
+
+			float r1 = sobol->get1D();
+			float r2 = sobol->get1D();
+
+			++cameraCells[static_cast<int32_t>(u * 4) * 4 + static_cast<int32_t>(v * 4)];
+			++bounceCells[static_cast<int32_t>(r1 * 4) * 4 + static_cast<int32_t>(r2 * 4)];
+		}
+
+		for (int32_t cell = 0; cell < count; ++cell)
+		{
+			if (cameraCells[cell] != 1 || bounceCells[cell] != 1)
+			{
+				sobolStratified = false;
+			}
+		}
+	}
+
+	if (sobolStratified)
+	{
+		std::cout << "[PASS] Sobol samples fill every 4x4 cell once" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Sobol samples are not stratified" << std::endl;
+	}
+
+	// The stratified sampler puts one sample in each of the 16 strata of every dimension.
+	std::unique_ptr<Sampler> stratified = createSampler(SamplerType::STRATIFIED);
+	bool strataFilled = true;
+
+	std::vector<std::vector<int32_t>> strata(6, std::vector<int32_t>(count, 0));
+
+	for (int32_t k = 0; k < count; ++k)
+	{
+		stratified->startSample(5, 7, k, count);
+
+		for (std::vector<int32_t>& dimension : strata)
+		{
+			++dimension[static_cast<int32_t>(stratified->get1D() * count)];
+		}
+	}
+
+	for (const std::vector<int32_t>& dimension : strata)
+	{
+		strataFilled = strataFilled && std::count(dimension.begin(), dimension.end(), 1) == count;
+	}
+
+	if (strataFilled)
+	{
+		std::cout << "[PASS] Stratified samples fill every stratum once" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] A stratum holds more than one sample" << std::endl;
+	}
+
+	// The blue noise mask holds every rank once.
+	std::vector<float> mask;
+
+	for (int32_t y = 0; y < BlueNoiseSampler::maskSize; ++y)
+	{
+		for (int32_t x = 0; x < BlueNoiseSampler::maskSize; ++x)
+		{
+			mask.push_back(BlueNoiseSampler::getMask(x, y));
+		}
+	}
+
+	std::sort(mask.begin(), mask.end());
+
+	if (std::adjacent_find(mask.begin(), mask.end()) == mask.end() && mask.front() > 0.0f && mask.back() < 1.0f)
+	{
+		std::cout << "[PASS] Blue noise mask is a permutation of its ranks" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Blue noise mask repeats a value" << std::endl;
+	}
+}
+
+// Test: splatting into the film with every filter
+void T_FILM_FILTER(const std::vector<std::string>&)
+{
+	std::cout << "Film Filter Test Running" << std::endl;
+
+	const int32_t width = 40;
+	const int32_t height = 24;
+	const int32_t samples = 16;
+
+	const FilterType types[] = { FilterType::BOX, FilterType::TENT, FilterType::GAUSSIAN, FilterType::MITCHELL };
+	const char* names[] = { "box", "tent", "gaussian", "mitchell" };
+
+	for (int32_t t = 0; t < 4; ++t)
+	{
+		// A constant image resolves to the constant whatever the weights, negative lobes included.
+		Film film;
+		film.setFilter(Filter(types[t]));
+		film.resize(width, height);
+
+		UnitRandom random;
+
+		for (int32_t y = 0; y < height; ++y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				for (int32_t k = 0; k < samples; ++k)
+				{
+					film.addSample(x + random.Generate(), y + random.Generate(), Vector3D<float>(0.5f, 0.25f, 1.0f));
+				}
+			}
+		}
+
+		float constantError = 0.0f;
+
+		for (int32_t y = 0; y < height; ++y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				Vector3D<float> color = film.getFramebuffer().get(x, y);
+
+				constantError = std::max(constantError, std::abs(color.x - 0.5f) + std::abs(color.y - 0.25f) + std::abs(color.z - 1.0f));
+			}
+		}
+
+		// Four threads splatting every fourth sample at once, into the same pixels, sum to what one thread does. The sums are
+		// compared with a tolerance: the order of the additions differs.
+		std::vector<Vector3D<float>> positions;
+
+		for (int32_t i = 0; i < width * height * 4; ++i)
+		{
+			positions.emplace_back(random.Generate() * width, random.Generate() * height, random.Generate());
+		}
+
+		Film serial;
+		serial.setFilter(Filter(types[t]));
+		serial.resize(width, height);
+
+		Film parallel;
+		parallel.setFilter(Filter(types[t]));
+		parallel.resize(width, height);
+
+		auto splat = [&positions](Film& target, size_t begin, size_t step)
+		{
+			for (size_t i = begin; i < positions.size(); i += step)
+			{
+				target.addSample(positions[i].x, positions[i].y, Vector3D<float>(positions[i].z, 1.0f, 0.0f));
+			}
+		};
+
+		splat(serial, 0, 1);
+
+		std::vector<std::thread> workers;
+
+		for (size_t w = 0; w < 4; ++w)
+		{
+			workers.emplace_back(splat, std::ref(parallel), w, 4);
+		}
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		float parallelError = 0.0f;
+
+		for (int32_t y = 0; y < height; ++y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				parallelError = std::max(parallelError, std::abs(serial.getFramebuffer().get(x, y).x - parallel.getFramebuffer().get(x, y).x));
+			}
+		}
+
+		if (constantError < 1e-4f && parallelError < 1e-4f)
+		{
+			std::cout << "[PASS] " << names[t] << ": constant image kept, parallel splats match" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] " << names[t] << ": constant error " << constantError << ", parallel error " << parallelError << std::endl;
+		}
+	}
+
+	// A Mitchell filter across a hard edge rings below zero on the dark side; the transfer curves must turn that into 0, not NaN,
+	// in both the SSE and the scalar path.
+	Film edge;
+	edge.setFilter(Filter(FilterType::MITCHELL));
+	edge.resize(width, height);
+
+	UnitRandom random;
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			for (int32_t k = 0; k < samples; ++k)
+			{
+				float filmX = x + random.Generate();
+				float value = (filmX < width / 2) ? 0.0f : 4.0f;
+
+				edge.addSample(filmX, y + random.Generate(), Vector3D<float>(value, value, value));
+			}
+		}
+	}
+
+	float minimum = 0.0f;
+	Framebuffer resolved(width, height);
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			Vector3D<float> color = edge.getFramebuffer().get(x, y);
+
+			minimum = std::min(minimum, color.x);
+			resolved.set(x, y, color);
+		}
+	}
+
+	const TransferCurve transferCurves[] = { TransferCurve::GAMMA2, TransferCurve::SRGB };
+	bool finite = true;
+
+	for (TransferCurve transferCurve : transferCurves)
+	{
+		PostProcessSettings settings;
+		settings.transferCurve = transferCurve;
+
+		PostProcess postProcess;
+		postProcess.setSettings(settings);
+
+		Framebuffer image = resolved;
+		postProcess.apply(image);
+
+		for (int32_t y = 0; y < height; ++y)
+		{
+			for (int32_t x = 0; x < width; ++x)
+			{
+				float value = image.get(x, y).x;
+				float scalar = postProcess.applyScalar(resolved.get(x, y).x, 0.0f);
+
+				finite = finite && std::isfinite(value) && value >= 0.0f && std::isfinite(scalar) && scalar >= 0.0f;
+			}
+		}
+	}
+
+	if (minimum < 0.0f && finite)
+	{
+		std::cout << "[PASS] mitchell: edge ringing down to " << minimum << " comes out of the transfer curves as 0" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] mitchell: edge minimum " << minimum << (finite ? "" : ", transfer curves returned NaN or negative values") << std::endl;
+	}
+}
+
+// Test: checkpoint file round trip
+void T_CHECKPOINT(const std::vector<std::string>&)
+{
+	std::cout << "Checkpoint Test Running" << std::endl;
+
+	const std::string filePath = "test.checkpoint";
+
+	// A float and a half weighted buffer, with some samples in them, and a sampler part way through its streams.
+	Checkpoint checkpoint;
+	checkpoint.header.width = 37;
+	checkpoint.header.height = 21;
+	checkpoint.header.total = 4;
+	checkpoint.header.passSamples = 4;
+	checkpoint.header.nextRow = 9;
+
+	checkpoint.buffers.resize(2);
+	checkpoint.buffers[1].setHalfPrecision(true);
+
+	UnitRandom random;
+
+	for (Framebuffer& buffer : checkpoint.buffers)
+	{
+		buffer.resize(37, 21, true);
+
+		for (int32_t y = 0; y < 21; ++y)
+		{
+			for (int32_t x = 0; x < 37; ++x)
+			{
+				buffer.accumulate(x, y, Vector3D<float>(random.Generate(), random.Generate(), random.Generate()), 4.0f);
+			}
+		}
+	}
+
+	Sampler sampler;
+
+	for (int32_t i = 0; i < 1000; ++i)
+	{
+		sampler.startSample(i, 0, 0, 1);
+		sampler.get1D();
+		sampler.get1D();
+		sampler.get1D();
+		sampler.get1D();
+	}
+
+	checkpoint.samplerState = sampler.getState();
+
+	if (!writeCheckpoint(filePath, checkpoint))
+	{
+		std::cout << "[FAIL] Could not write " << filePath << std::endl;
+		return;
+	}
+
+	std::ifstream file(filePath, std::ios::binary);
+
+	Checkpoint loaded;
+	bool headerRead = readCheckpointHeader(file, loaded);
+
+	std::vector<Framebuffer> buffers(2);
+	buffers[1].setHalfPrecision(true);
+
+	bool buffersRead = headerRead;
+
+	for (Framebuffer& buffer : buffers)
+	{
+		buffer.resize(37, 21, true);
+		buffersRead = buffersRead && buffer.read(file);
+	}
+
+	file.close();
+	std::filesystem::remove(filePath);
+
+	bool same = buffersRead && loaded.header.nextRow == 9 && loaded.header.passSamples == 4;
+
+	for (int32_t b = 0; same && b < 2; ++b)
+	{
+		for (int32_t y = 0; y < 21; ++y)
+		{
+			for (int32_t x = 0; x < 37; ++x)
+			{
+				Vector3D<float> expected = checkpoint.buffers[b].get(x, y);
+				Vector3D<float> actual = buffers[b].get(x, y);
+
+				same = same && expected.x == actual.x && expected.y == actual.y && expected.z == actual.z;
+			}
+		}
+	}
+
+	// The restored sampler continues with the numbers the original one draws next.
+	Sampler restored;
+	bool streamsRestored = restored.setState(loaded.samplerState);
+
+	for (int32_t i = 0; streamsRestored && i < 100; ++i)
+	{
+		sampler.startSample(i, 0, 0, 1);
+		restored.startSample(i, 0, 0, 1);
+
+		for (int32_t d = 0; d < 6; ++d)
+		{
+			streamsRestored = streamsRestored && sampler.get1D() == restored.get1D();
+		}
+	}
+
+	// A buffer of another size does not take the data.
+	std::ostringstream stream;
+	checkpoint.buffers[0].write(stream);
+
+	std::istringstream input(stream.str());
+	Framebuffer other(36, 21, true);
+
+	bool mismatchRejected = !other.read(input);
+
+	if (headerRead && same && streamsRestored && mismatchRejected)
+	{
+		std::cout << "[PASS] Buffers and random streams restored exactly, mismatched buffer rejected" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Header " << headerRead << ", buffers " << same << ", streams " << streamsRestored << ", mismatch rejected " << mismatchRejected << std::endl;
+	}
+}
+
+void T_TOKENIZER(const std::vector<std::string>&)
+{
+	std::cout << "Tokenizer Test Running" << std::endl;
+
+	// Numbers: leading whitespace and '+' are accepted and text after the number is ignored, like the stream parser; anything that does
+	// not start with a number, a sign on its own and out of range integers are not.
+	struct FloatCase { const char* text; bool valid; float value; };
+
+	const FloatCase floats[] = {
+		{ "2.5", true, 2.5f }, { "  \t2.5", true, 2.5f }, { "+3", true, 3.0f }, { "-0.5", true, -0.5f }, { "1e3", true, 1000.0f },
+		{ ".25", true, 0.25f }, { "7/", true, 7.0f }, { "1.5abc", true, 1.5f },
+		{ "", false, 0.0f }, { "   ", false, 0.0f }, { "+", false, 0.0f }, { "+-1", false, 0.0f }, { "abc", false, 0.0f }, { "--1", false, 0.0f }
+	};
+
+	int32_t floatFailures = 0;
+
+	for (const FloatCase& test : floats)
+	{
+		float value = 0.0f;
+		bool valid = parseFloat(test.text, value);
+
+		if (valid != test.valid || (valid && value != test.value))
+		{
+			std::cout << "  parseFloat(\"" << test.text << "\") gave " << valid << " " << value << std::endl;
+			++floatFailures;
+		}
+	}
+
+	struct IntCase { const char* text; bool valid; int32_t value; };
+
+	const IntCase ints[] = {
+		{ "42", true, 42 }, { "+7", true, 7 }, { " -3", true, -3 }, { "2147483647", true, 2147483647 }, { "12.9", true, 12 },
+		{ "2147483648", false, 0 }, { "x", false, 0 }, { "", false, 0 }, { "+-2", false, 0 }
+	};
+
+	int32_t intFailures = 0;
+
+	for (const IntCase& test : ints)
+	{
+		int32_t value = 0;
+		bool valid = parseInt(test.text, value);
+
+		if (valid != test.valid || (valid && value != test.value))
+		{
+			std::cout << "  parseInt(\"" << test.text << "\") gave " << valid << " " << value << std::endl;
+			++intFailures;
+		}
+	}
+
+	// Components: blanks around the commas are fine, a missing component, a missing comma or another separator are not.
+	struct VectorCase { const char* text; bool valid; float x, y, z; };
+
+	const VectorCase vectors[] = {
+		{ "0.5, 1, -2", true, 0.5f, 1.0f, -2.0f }, { "1 ,2 ,3", true, 1.0f, 2.0f, 3.0f }, { "+1,+2,+3", true, 1.0f, 2.0f, 3.0f },
+		{ "\t1,\t2,\t3", true, 1.0f, 2.0f, 3.0f }, { "1,2", false, 0.0f, 0.0f, 0.0f }, { "1;2;3", false, 0.0f, 0.0f, 0.0f },
+		{ "1,,3", false, 0.0f, 0.0f, 0.0f }, { "1 2 3", false, 0.0f, 0.0f, 0.0f }, { "", false, 0.0f, 0.0f, 0.0f }
+	};
+
+	int32_t vectorFailures = 0;
+
+	for (const VectorCase& test : vectors)
+	{
+		float x = 0.0f;
+		float y = 0.0f;
+		float z = 0.0f;
+		bool valid = parseVector3(test.text, x, y, z);
+
+		if (valid != test.valid || (valid && (x != test.x || y != test.y || z != test.z)))
+		{
+			std::cout << "  parseVector3(\"" << test.text << "\") gave " << valid << " " << x << " " << y << " " << z << std::endl;
+			++vectorFailures;
+		}
+	}
+
+	// Cursor: readUntil() stops at the separator or at the end of the text, and nothing reads past the end.
+	Tokenizer tokenizer(std::string_view("  (sphere)\n-pos- /1,2,3/"));
+	tokenizer.skipWhitespace();
+
+	bool cursor = tokenizer.peek() == '(';
+	tokenizer.get();
+	cursor = cursor && tokenizer.readUntil(')') == "sphere";
+	tokenizer.skipWhitespace();
+	cursor = cursor && tokenizer.readUntil('/') == "-pos- " && tokenizer.readUntil('/') == "1,2,3" && tokenizer.eof();
+	cursor = cursor && tokenizer.peek() == EOF && tokenizer.readUntil('/').empty();
+	tokenizer.get();
+	cursor = cursor && tokenizer.eof() && tokenizer.getPosition() == tokenizer.getEnd();
+
+	Tokenizer unterminated(std::string_view("abc"));
+	cursor = cursor && unterminated.readUntil('/') == "abc" && unterminated.eof();
+
+	Tokenizer empty(std::string_view(""));
+	empty.skipWhitespace();
+	cursor = cursor && empty.eof() && empty.peek() == EOF;
+
+	// A scene saved with Windows line endings parses to the same objects.
+	const char* scene = "(perspective)\n-pos- /0,1,3/\n-window- /160,90/\n;\n(sphere)\n-pos- /1,2,-3/\n-radius- /0.5/\n;\n(dome)\n-intensity- /2/\n;\n";
+
+	std::string crlf;
+
+	for (const char* c = scene; *c; ++c)
+	{
+		if (*c == '\n') { crlf += '\r'; }
+		crlf += *c;
+	}
+
+	std::ofstream("test_tokenizer_lf.hrs") << scene;
+	std::ofstream("test_tokenizer_crlf.hrs", std::ios::binary) << crlf;
+
+	std::vector<std::unique_ptr<SceneObject>> lf;
+	std::vector<std::unique_ptr<SceneObject>> windows;
+
+	bool lineEndings = SceneBuilder("test_tokenizer_lf.hrs", lf, 1) && SceneBuilder("test_tokenizer_crlf.hrs", windows, 1) && lf.size() == 3 && windows.size() == 3;
+
+	for (size_t i = 0; lineEndings && i < lf.size(); ++i)
+	{
+		Vector3D<float> a = lf[i]->position;
+		Vector3D<float> b = windows[i]->position;
+
+		lineEndings = lf[i]->getType() == windows[i]->getType() && a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+
+	lineEndings = lineEndings && static_cast<GeometryObject*>(windows[1].get())->size == 0.5f;
+
+	std::filesystem::remove("test_tokenizer_lf.hrs");
+	std::filesystem::remove("test_tokenizer_crlf.hrs");
+
+	if (floatFailures == 0 && intFailures == 0 && vectorFailures == 0 && cursor && lineEndings)
+	{
+		std::cout << "[PASS] Numbers, vectors, cursor and CRLF scenes parse as expected" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] " << floatFailures << " float, " << intFailures << " integer and " << vectorFailures << " vector cases wrong, cursor "
+			<< cursor << ", CRLF " << lineEndings << std::endl;
+	}
+}
+
+void T_REFERENCE(const std::vector<std::string>&)
+{
+	std::cout << "Reference Test Running" << std::endl;
+
+	// Two assets that reference each other: loading the first one loads the second, whose reference back to the first is rejected
+	// instead of recursing; each asset keeps its own sphere.
+	std::ofstream("test_reference_a.hrs") << "(sphere)\n-pos- /0,0,0/\n-radius- /1/\n;\n(reference)\n-file- /test_reference_b.hrs/\n;\n";
+	std::ofstream("test_reference_b.hrs") << "(sphere)\n-pos- /5,0,0/\n-radius- /1/\n;\n(reference)\n-file- /test_reference_a.hrs/\n;\n";
+	std::ofstream("test_reference_scene.hrs") << "(reference)\n-pos- /0,2,0/\n-file- /test_reference_a.hrs/\n;\n";
+
+	std::vector<std::unique_ptr<SceneObject>> objects;
+	bool parsed = SceneBuilder("test_reference_scene.hrs", objects, 1) && objects.size() == 1;
+
+	std::shared_ptr<SceneAsset> a = AssetLibrary::getInstance().load("test_reference_a.hrs");
+	std::shared_ptr<SceneAsset> b = AssetLibrary::getInstance().load("test_reference_b.hrs");
+
+	bool cycleRejected = parsed && a && b && a->geometries.size() == 2 && b->geometries.size() == 2
+		&& a->bounds.getMin().x == -1.0f && a->bounds.getMax().x == 6.0f && b->bounds.getMax().x == 6.0f;
+
+	// A ray through the reference reaches the sphere of the second asset, placed by both positions.
+	bool traced = false;
+
+	if (parsed)
+	{
+		std::vector<GeometryObject*> geometries = { static_cast<GeometryObject*>(objects[0].get()) };
+
+		BVH bvh;
+		bvh.buildBVH(geometries);
+
+		Ray ray(Vector3D<float>(5.0f, 2.0f, 10.0f), Vector3D<float>(0.0f, 0.0f, -1.0f));
+		HitRecord hit;
+
+		GeometryObject* object = bvh.traversal(ray, 0.0f, 1e30f, hit);
+		Vector3D<float> normal = object ? object->getNormal(hit) : Vector3D<float>();
+
+		traced = object == geometries[0] && std::fabs(hit.t - 9.0f) < 1e-4f && std::fabs(normal.z - 1.0f) < 1e-4f;
+	}
+
+	// A file that includes itself stops at the nesting limit, one sphere per level.
+	std::ofstream("test_include_self.hrs") << "(sphere)\n-pos- /0,0,0/\n-radius- /1/\n;\n(include)\n-file- /test_include_self.hrs/\n;\n";
+
+	std::vector<std::unique_ptr<SceneObject>> included;
+	bool includeStopped = SceneBuilder("test_include_self.hrs", included, 1) && included.size() == 17;
+
+	std::filesystem::remove("test_reference_a.hrs");
+	std::filesystem::remove("test_reference_b.hrs");
+	std::filesystem::remove("test_reference_scene.hrs");
+	std::filesystem::remove("test_include_self.hrs");
+
+	if (cycleRejected && traced && includeStopped)
+	{
+		std::cout << "[PASS] Reference cycle rejected, ray traced through nested assets, self include stopped after " << included.size() << " objects" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Parsed " << parsed << ", cycle rejected " << cycleRejected << ", traced " << traced << ", include objects " << included.size() << std::endl;
+	}
+}
+
+void T_PARTICLES(const std::vector<std::string>&)
+{
+	std::cout << "Particles Test Running" << std::endl;
+
+	// Particles with and without their own radius, written as CSV (with a header, a comment, a blank line and CRLF endings) and as
+	// binary records, where a radius of 0 stands for the default one.
+	const int32_t count = 2000;
+	const float defaultRadius = 0.05f;
+
+	UnitRandom random;
+
+	std::vector<Vector3D<float>> centers(count);
+	std::vector<float> radii(count);
+
+	std::ofstream csv("test_particles.csv", std::ios::binary);
+	std::ofstream binary("test_particles.bin", std::ios::binary);
+
+	csv << "x,y,z,r\r\n# generated\r\n\r\n";
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		centers[i] = Vector3D<float>(random.Generate() * 4.0f - 2.0f, random.Generate() * 4.0f - 2.0f, random.Generate() * 4.0f - 2.0f);
+		radii[i] = (i % 3 == 0) ? 0.0f : 0.01f + random.Generate() * 0.1f;
+
+		csv << centers[i].x << "," << centers[i].y << "," << centers[i].z;
+
+		if (radii[i] > 0.0f) { csv << "," << radii[i]; }
+
+		csv << "\r\n";
+
+		float record[4] = { centers[i].x, centers[i].y, centers[i].z, radii[i] };
+		binary.write(reinterpret_cast<const char*>(record), sizeof(record));
+	}
+
+	csv.close();
+	binary.close();
+
+	// The binary set is loaded first, the CSV one (six digits per value) second; both are moved by the same position.
+	std::vector<std::unique_ptr<ParticleSetObject>> sets;
+	sets.push_back(std::make_unique<ParticleSetObject>());
+	sets.push_back(std::make_unique<ParticleSetObject>());
+
+	bool loaded = true;
+
+	for (size_t k = 0; k < sets.size(); ++k)
+	{
+		sets[k]->setRadius(defaultRadius);
+		sets[k]->position = Vector3D<float>(1.0f, 0.5f, -3.0f);
+		loaded = loaded && sets[k]->loadFile(k == 0 ? "test_particles.bin" : "test_particles.csv") && sets[k]->getParticleCount() == count;
+	}
+
+	// Every ray is checked against all particles one by one, in double precision. Rays that graze a particle are left out, as single
+	// precision may miss them, and near grazing hits are only a few thousandths off in the distance.
+	int32_t hits = 0;
+	int32_t checked = 0;
+	int32_t mismatches = 0;
+
+	for (int32_t r = 0; loaded && r < 4000; ++r)
+	{
+		Vector3D<float> origin(random.Generate() * 6.0f - 2.0f, random.Generate() * 6.0f - 2.5f, 3.0f);
+		Vector3D<float> target(random.Generate() * 4.0f - 1.0f, random.Generate() * 4.0f - 1.5f, -3.0f);
+		Vector3D<float> direction = target - origin;
+		direction.normalize();
+
+		double closestT = 1e30;
+		int32_t closest = -1;
+		bool grazing = false;
+
+		for (int32_t i = 0; i < count; ++i)
+		{
+			double radius = (radii[i] > 0.0f) ? radii[i] : defaultRadius;
+			Vector3D<float> center = centers[i] + sets[0]->position;
+
+			double ox = origin.x - center.x;
+			double oy = origin.y - center.y;
+			double oz = origin.z - center.z;
+
+			double b = direction.x * ox + direction.y * oy + direction.z * oz;
+			double c = ox * ox + oy * oy + oz * oz - radius * radius;
+			double discriminant = b * b - c;
+
+			if (std::fabs(discriminant) < 1e-2 * radius * radius) { grazing = true; }
+
+			if (discriminant < 0.0) { continue; }
+
+			double t = -b - std::sqrt(discriminant);
+
+			if (t > 0.0 && t < closestT)
+			{
+				closestT = t;
+				closest = i;
+			}
+		}
+
+		if (grazing) { continue; }
+
+		for (size_t k = 0; k < sets.size(); ++k)
+		{
+			Ray ray(origin, direction);
+			HitRecord hit;
+
+			bool found = sets[k]->rayIntersection(ray, 0.0f, 1e30f, hit);
+
+			if (found != (closest >= 0) || (found && (hit.primitive != static_cast<uint32_t>(closest) || std::fabs(hit.t - closestT) > 5e-3)))
+			{
+				++mismatches;
+			}
+		}
+
+		++checked;
+		hits += (closest >= 0) ? 1 : 0;
+	}
+
+	// A line that is not a particle, and a binary file cut in the middle of a record, are rejected.
+	std::ofstream("test_particles_bad.csv") << "x,y,z\n1,2,3\n4,five,6\n";
+	std::ofstream("test_particles_bad.bin", std::ios::binary) << std::string(4 * sizeof(float) + 6, '\0');
+
+	ParticleSetObject badCSV;
+	ParticleSetObject badBinary;
+
+	bool rejected = !badCSV.loadFile("test_particles_bad.csv") && badCSV.getParticleCount() == 0 && !badBinary.loadFile("test_particles_bad.bin");
+
+	std::filesystem::remove("test_particles.csv");
+	std::filesystem::remove("test_particles.bin");
+	std::filesystem::remove("test_particles_bad.csv");
+	std::filesystem::remove("test_particles_bad.bin");
+
+	if (loaded && mismatches == 0 && hits > 0 && checked > 3000 && rejected)
+	{
+		std::cout << "[PASS] CSV and binary particles match brute force on " << hits << " hits of " << checked << " rays, bad files rejected" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Loaded " << loaded << ", " << mismatches << " mismatches over " << checked << " rays, bad files rejected " << rejected << std::endl;
+	}
+}
+
+void T_DISPLACED(const std::vector<std::string>&)
+{
+	std::cout << "Displaced Surface Test Running" << std::endl;
+
+	// The same surface twice: one with a cache large enough for every patch, one with a cache that holds only a few of them.
+	std::vector<std::unique_ptr<DisplacedSurfaceObject>> surfaces;
+
+	for (int32_t k = 0; k < 2; ++k)
+	{
+		surfaces.push_back(std::make_unique<DisplacedSurfaceObject>());
+		surfaces[k]->position = Vector3D<float>(0.5f, -1.0f, 2.0f);
+		surfaces[k]->setRadius(1.5f);
+		surfaces[k]->setDisplacement(0.2f);
+		surfaces[k]->setFrequency(6.0f);
+		surfaces[k]->setResolution(12);
+	}
+
+	surfaces[1]->setCacheSize(0.1f);
+
+	const float radius = 1.5f;
+	const float displacement = 0.2f;
+	const float frequency = 6.0f;
+
+	// Rays from all around the surface, passing near its center, must hit it on the height field; rays that pass outside the largest
+	// possible radius must miss it.
+	UnitRandom random;
+
+	int32_t mismatches = 0;
+	int32_t offSurface = 0;
+	int32_t wrongMisses = 0;
+	bool withinBudget = true;
+
+	for (int32_t r = 0; r < 3000; ++r)
+	{
+		float z = random.Generate() * 2.0f - 1.0f;
+		float phi = 2.0f * PI * random.Generate();
+		float s = std::sqrt(1.0f - z * z);
+
+		Vector3D<float> outward(s * std::cos(phi), s * std::sin(phi), z);
+
+		Vector3D<float> side = (std::fabs(outward.y) < 0.9f) ? Vector3D<float>(0.0f, 1.0f, 0.0f) | outward : Vector3D<float>(1.0f, 0.0f, 0.0f) | outward;
+		side.normalize();
+
+		// Every third ray passes beside the surface, at more than its largest radius from the center.
+		bool aside = (r % 3 == 2);
+
+		Vector3D<float> origin = surfaces[0]->position + outward * 4.0f + side * (aside ? radius + displacement + 0.05f : 0.5f * random.Generate());
+		Vector3D<float> direction = -outward;
+
+		HitRecord records[2];
+		bool found[2];
+
+		for (int32_t k = 0; k < 2; ++k)
+		{
+			Ray ray(origin, direction);
+			found[k] = surfaces[k]->rayIntersection(ray, 0.0f, 1e30f, records[k]);
+		}
+
+		withinBudget = withinBudget && surfaces[1]->getCache().getMemoryUsage() <= surfaces[1]->getCache().getCapacity();
+
+		if (found[0] != found[1] || (found[0] && (records[0].t != records[1].t || records[0].primitive != records[1].primitive)))
+		{
+			++mismatches;
+		}
+
+		if (found[0] == aside)
+		{
+			++wrongMisses;
+			continue;
+		}
+
+		if (!found[0]) { continue; }
+
+		// The height field at the direction of the hit point; the micro-triangles stay within a small chord error of it.
+		Vector3D<float> local = records[0].hitPoint - surfaces[0]->position;
+		float distance = std::sqrt(local * local);
+		Vector3D<float> n = local / distance;
+
+		float expected = radius + displacement * std::sin(frequency * n.x) * std::sin(frequency * n.y) * std::sin(frequency * n.z);
+
+		if (std::fabs(distance - expected) > 0.01f || (records[0].normal * direction) > 0.0f)
+		{
+			++offSurface;
+		}
+	}
+
+	const LRUCache<uint32_t, TessellatedPatch>& full = surfaces[0]->getCache();
+	const LRUCache<uint32_t, TessellatedPatch>& small = surfaces[1]->getCache();
+
+	// The large cache tessellates each patch once and reuses it; the small one has to evict and tessellate patches again.
+	bool cached = full.getMisses() <= surfaces[0]->getPatchCount() && full.getHits() > 0 && full.getEvictions() == 0
+		&& small.getEvictions() > 0 && small.getMisses() > full.getMisses();
+
+	if (mismatches == 0 && offSurface == 0 && wrongMisses == 0 && withinBudget && cached)
+	{
+		std::cout << "[PASS] Hits lie on the height field and do not depend on the cache (" << full.getMisses() << " patches tessellated, "
+		          << small.getMisses() << " with " << small.getEvictions() << " evictions in the small cache)" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] " << mismatches << " hits depend on the cache, " << offSurface << " off the surface, " << wrongMisses
+		          << " wrong hits or misses, within budget " << withinBudget << ", cache counters " << cached << std::endl;
+	}
+}
+
+void T_MATERIAL_LIBRARY(const std::vector<std::string>&)
+{
+	std::cout << "Material Library Test Running" << std::endl;
+
+	MaterialLibrary& library = MaterialLibrary::getInstance();
+
+	std::ofstream("test_material_surface.hrs") << "(surface)\n-diffuse_color- /0.2,0.4,0.6/\n-diffuse_gain- /0.7/\n-roughness- /0.3/\n;\n";
+	std::ofstream("test_material_constant.hrs") << "(constant)\n-color- /1,0.5,0.25/\n;\n";
+
+	// Every spelling of the same file resolves to one material, parsed once.
+	size_t countBefore = library.getMaterialCount();
+
+	std::vector<std::string> spellings = {
+		"test_material_surface.hrs",
+		"./test_material_surface.hrs",
+		"././test_material_surface.hrs",
+		(std::filesystem::path("..") / std::filesystem::current_path().filename() / "test_material_surface.hrs").string(),
+		std::filesystem::absolute("test_material_surface.hrs").string()
+	};
+
+	uint32_t surfaceIndex = 0;
+	bool shared = library.load(spellings[0], surfaceIndex) && surfaceIndex != 0;
+
+	for (const std::string& spelling : spellings)
+	{
+		uint32_t index = 0;
+		shared = shared && library.load(spelling, index) && index == surfaceIndex;
+	}
+
+	shared = shared && library.getMaterialCount() == countBefore + 1;
+
+	Surface* surface = std::get_if<Surface>(&library.get(surfaceIndex));
+
+	bool parsed = surface && surface->getDiffuseGain() == 0.7f && surface->getRoughness() == 0.3f && surface->getDiffuseColor().y == 0.4f;
+
+	// Threads loading a file no one has loaded yet all get the same material.
+	std::vector<uint32_t> threadIndices(8, 0);
+	std::vector<std::thread> threads;
+
+	for (size_t t = 0; t < threadIndices.size(); ++t)
+	{
+		threads.emplace_back([&, t]() { library.load(t % 2 ? "test_material_constant.hrs" : "./test_material_constant.hrs", threadIndices[t]); });
+	}
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	bool concurrent = threadIndices[0] != 0 && threadIndices[0] != surfaceIndex && library.getMaterialCount() == countBefore + 2;
+
+	for (uint32_t index : threadIndices)
+	{
+		concurrent = concurrent && index == threadIndices[0];
+	}
+
+	Constant* constant = std::get_if<Constant>(&library.get(threadIndices[0]));
+	parsed = parsed && constant && constant->getColor().z == 0.25f;
+
+	// A missing file falls back to the default material, and so does every later reference to it.
+	uint32_t missingIndex = 1;
+	uint32_t missingAgain = 1;
+
+	bool missing = !library.load("test_material_missing.hrs", missingIndex) && missingIndex == 0
+		&& !library.load("./test_material_missing.hrs", missingAgain) && missingAgain == 0 && library.getMaterialCount() == countBefore + 2;
+
+	// Geometries of a scene that all name the same shader share its index instead of holding copies.
+	const std::string scenePath = "test_material_scene.hrs";
+
+	{
+		std::ofstream scene(scenePath);
+
+		for (int32_t i = 0; i < 200; ++i)
+		{
+			scene << "(sphere)\n-pos- /" << i << ",0,0/\n-radius- /0.5/\n-shader- /test_material_surface.hrs/\n;\n";
+		}
+	}
+
+	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+	bool linked = SceneBuilder(scenePath, sceneObjects) && sceneObjects.size() == 200 && library.getMaterialCount() == countBefore + 2;
+
+	for (size_t i = 0; linked && i < sceneObjects.size(); ++i)
+	{
+		linked = static_cast<GeometryObject*>(sceneObjects[i].get())->getMaterial() == surfaceIndex;
+	}
+
+	std::filesystem::remove(scenePath);
+	std::filesystem::remove("test_material_surface.hrs");
+	std::filesystem::remove("test_material_constant.hrs");
+
+	if (shared && parsed && concurrent && missing && linked)
+	{
+		std::cout << "[PASS] Shader files are parsed once per canonical path and shared by index" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Shared " << shared << ", parsed " << parsed << ", concurrent " << concurrent << ", missing " << missing
+		          << ", linked " << linked << std::endl;
+	}
+}
+
+// Writes the watched scene of the watch test: a camera (unless left out) and a grid of spheres, with 'edits' applied as
+// index -> replacement text, and 'extra' appended.
+static void writeWatchScene(const std::string& scenePath, const std::unordered_map<int32_t, std::string>& edits, const std::string& extra, bool camera = true)
+{
+	std::ofstream scene(scenePath);
+
+	if (camera)
+	{
+		scene << "(perspective)\n-pos- /0,10,0/\n-rot- /0,0,0/\n-window- /32,32/\n;\n";
+	}
+
+	for (int32_t i = 0; i < 64; ++i)
+	{
+		auto edit = edits.find(i);
+
+		if (edit != edits.end())
+		{
+			scene << edit->second;
+			continue;
+		}
+
+		scene << "(sphere)\n-pos- /" << (i % 8) * 2 - 7 << ",0," << (i / 8) * 2 - 7 << "/\n-radius- /0.6/\n;\n";
+	}
+
+	scene << extra;
+}
+
+// Traces a grid of rays down onto the watched scene and one from the side, and checks the hits against a scene built from scratch
+// from the same file. Returns the number of rays that differ.
+static int32_t compareWatchedScene(Scene& watched, const std::string& scenePath)
+{
+	std::vector<std::unique_ptr<SceneObject>> sceneObjects;
+	Scene fresh;
+
+	if (!SceneBuilder(scenePath, sceneObjects) || !fresh.getScene(sceneObjects))
+	{
+		return -1;
+	}
+
+	fresh.buildAccelerator();
+
+	int32_t mismatches = 0;
+
+	for (int32_t axis = 0; axis < 2; ++axis)
+	{
+		for (int32_t a = 0; a < 64; ++a)
+		{
+			for (int32_t b = 0; b < 64; ++b)
+			{
+				float u = (a + 0.37f) / 64.0f * 20.0f - 10.0f;
+				float v = (b + 0.61f) / 64.0f * 20.0f - 10.0f;
+
+				Vector3D<float> origin = (axis == 0) ? Vector3D<float>(u, 10.0f, v) : Vector3D<float>(u, v * 0.1f, 20.0f);
+				Vector3D<float> direction = (axis == 0) ? Vector3D<float>(0.0f, -1.0f, 0.0f) : Vector3D<float>(0.0f, 0.0f, -1.0f);
+
+				Ray watchedRay(origin, direction);
+				Ray freshRay(origin, direction);
+
+				HitRecord watchedRecord;
+				HitRecord freshRecord;
+
+				GeometryObject* watchedHit = watched.getBVH().traversal(watchedRay, 0.0f, 1e30f, watchedRecord);
+				GeometryObject* freshHit = fresh.getBVH().traversal(freshRay, 0.0f, 1e30f, freshRecord);
+
+				if ((watchedHit == nullptr) != (freshHit == nullptr)
+					|| (watchedHit && (watchedRecord.t != freshRecord.t || watchedHit->position.x != freshHit->position.x || watchedHit->position.z != freshHit->position.z)))
+				{
+					++mismatches;
+				}
+			}
+		}
+	}
+
+	return mismatches;
+}
+
+void T_WATCH(const std::vector<std::string>&)
+{
+	std::cout << "Watch Test Running" << std::endl;
+
+	const std::string scenePath = "test_watch.hrs";
+
+	Scene scene;
+	SceneWatcher watcher(scenePath, scene);
+
+	// The watcher reports what it did on the console; the steps below read that back.
+	std::stringstream log;
+	std::streambuf* console = std::cout.rdbuf(log.rdbuf());
+
+	auto step = [&](bool expectedResult, const char* expectedUpdate, const char* expectedParse)
+	{
+		log.str("");
+
+		bool result = watcher.update();
+		std::string message = log.str();
+
+		bool passed = result == expectedResult && (expectedUpdate == nullptr || message.find(expectedUpdate) != std::string::npos)
+			&& (expectedParse == nullptr || message.find(expectedParse) != std::string::npos);
+
+		if (passed && result)
+		{
+			std::cout.rdbuf(console);
+			passed = compareWatchedScene(scene, scenePath) == 0;
+			std::cout.rdbuf(log.rdbuf());
+		}
+
+		return passed;
+	};
+
+	// The first load parses everything; the line break after the last object counts as one more (empty) object.
+	writeWatchScene(scenePath, {}, "");
+	bool loaded = step(true, "BVH rebuilt", "parsed 66 of 66");
+
+	std::vector<GeometryObject*> before = scene.getGeometries();
+
+	// Moving and resizing one sphere parses that object only and refits it into the BVH; the other spheres are kept as they were.
+	writeWatchScene(scenePath, { { 9, "(sphere)\n-pos- /3,1.5,-2/\n-radius- /0.9/\n;\n" } }, "");
+	bool refit = step(true, "BVH refit", "parsed 1 of 66");
+
+	std::vector<GeometryObject*> after = scene.getGeometries();
+	bool kept = before.size() == after.size();
+
+	for (size_t i = 0; kept && i < before.size(); ++i)
+	{
+		kept = (i == 9) ? before[i] != after[i] : before[i] == after[i];
+	}
+
+	// Adding a sphere changes the primitive set, so the BVH is rebuilt; the existing spheres are still not parsed again.
+	writeWatchScene(scenePath, { { 9, "(sphere)\n-pos- /3,1.5,-2/\n-radius- /0.9/\n;\n" } }, "(sphere)\n-pos- /0,3,0/\n-radius- /0.5/\n;\n");
+	bool added = step(true, "BVH rebuilt", "parsed 1 of 67");
+
+	// Editing many spheres at once rebuilds the BVH instead of refitting it.
+	std::unordered_map<int32_t, std::string> edits;
+
+	for (int32_t i = 0; i < 32; ++i)
+	{
+		edits[i] = "(sphere)\n-pos- /" + std::to_string((i % 8) * 2 - 7) + ",0.5," + std::to_string((i / 8) * 2 - 7) + "/\n-radius- /0.4/\n;\n";
+	}
+
+	writeWatchScene(scenePath, edits, "");
+	bool manyEdits = step(true, "BVH rebuilt", "parsed 32 of 66");
+
+	// A file without a camera is rejected, and the scene recovers once the camera is back. The first sphere no longer follows the
+	// camera in the file without it, so its text, and with it the sphere, changes too.
+	writeWatchScene(scenePath, {}, "", false);
+	bool rejected = step(false, nullptr, nullptr);
+
+	writeWatchScene(scenePath, {}, "");
+	bool recovered = step(true, "BVH rebuilt", "parsed 2 of 66");
+
+	std::cout.rdbuf(console);
+
+	std::filesystem::remove(scenePath);
+
+	if (loaded && refit && kept && added && manyEdits && rejected && recovered)
+	{
+		std::cout << "[PASS] Edited scenes are refitted or rebuilt and trace the same as a scene built from scratch" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Loaded " << loaded << ", refit " << refit << ", kept " << kept << ", added " << added << ", many edits " << manyEdits
+		          << ", rejected " << rejected << ", recovered " << recovered << std::endl;
+	}
+}
+
+// Reads a PFM file into top-to-bottom rows of RGB floats.
+static bool readPFM(const std::string& filePath, std::vector<float>& pixels, int32_t& width, int32_t& height)
+{
+	std::ifstream file(filePath, std::ios::binary);
+
+	std::string magic;
+	float scale = 0.0f;
+
+	if (!(file >> magic >> width >> height >> scale) || magic != "PF" || width <= 0 || height <= 0 || scale >= 0.0f)
+	{
+		return false;
+	}
+
+	file.get();
+
+	std::vector<float> rows(static_cast<size_t>(width) * height * 3);
+
+	if (!file.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(float)))
+	{
+		return false;
+	}
+
+	// The file stores the bottom row first.
+	pixels.resize(rows.size());
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		std::copy_n(&rows[static_cast<size_t>(height - 1 - y) * width * 3], width * 3, &pixels[static_cast<size_t>(y) * width * 3]);
+	}
+
+	return true;
+}
+
+// Reads a binary PPM (P6) file into top-to-bottom rows of RGB bytes.
+static bool readP6(const std::string& filePath, std::vector<uint8_t>& rgb, int32_t& width, int32_t& height)
+{
+	std::ifstream file(filePath, std::ios::binary);
+
+	std::string magic;
+	int32_t maxValue = 0;
+
+	if (!(file >> magic >> width >> height >> maxValue) || magic != "P6" || width <= 0 || height <= 0 || maxValue != 255)
+	{
+		return false;
+	}
+
+	file.get();
+
+	rgb.resize(static_cast<size_t>(width) * height * 3);
+
+	return static_cast<bool>(file.read(reinterpret_cast<char*>(rgb.data()), rgb.size())) && file.peek() == EOF;
+}
+
+void T_IMAGE_OUTPUT(const std::vector<std::string>&)
+{
+	std::cout << "Image Output Test Running" << std::endl;
+
+	// Tall enough for several 1 MB blocks of PFM rows, so the reversed block order is covered, and with values outside [0, 1].
+	const int32_t width = 300;
+	const int32_t height = 1200;
+
+	Framebuffer framebuffer(width, height);
+	UnitRandom random;
+
+	for (int32_t y = 0; y < height; ++y)
+	{
+		for (int32_t x = 0; x < width; ++x)
+		{
+			framebuffer.set(x, y, Vector3D<float>(random.Generate() * 1.5f - 0.25f, random.Generate() * 1.5f - 0.25f, random.Generate() * 1.5f - 0.25f));
+		}
+	}
+
+	const RenderOutput formats[] = { RenderOutput::P6, RenderOutput::PFM };
+	const char* names[] = { "P6", "PFM" };
+
+	for (int32_t f = 0; f < 2; ++f)
+	{
+		// Rows handed over a tile row at a time while rendering, as a streamed render does, and the whole image at once at the end.
+		for (int32_t streamed = 0; streamed < 2; ++streamed)
+		{
+			const std::string filePath = "test_image_output";
+
+			Output output(formats[f]);
+			output.setFilePathWrite(filePath);
+			output.setWidth(static_cast<float>(width));
+			output.setHeight(static_cast<float>(height));
+
+			bool opened = output.open();
+
+			for (int32_t y = 0; opened && streamed && y < height; y += Framebuffer::tileSize)
+			{
+				output.writeRows(framebuffer, y, std::min(height, y + Framebuffer::tileSize));
+			}
+
+			output.write(framebuffer);
+
+			int32_t readWidth = 0;
+			int32_t readHeight = 0;
+			bool same = false;
+
+			if (formats[f] == RenderOutput::P6)
+			{
+				std::vector<uint8_t> rgb;
+				same = opened && readP6(filePath, rgb, readWidth, readHeight) && readWidth == width && readHeight == height;
+
+				for (int32_t y = 0; same && y < height; ++y)
+				{
+					for (int32_t x = 0; x < width; ++x)
+					{
+						Vector3D<float> pixel = framebuffer.get(x, y);
+						const uint8_t* stored = &rgb[(static_cast<size_t>(y) * width + x) * 3];
+
+						same = same && stored[0] == static_cast<int>(std::clamp(pixel.x, 0.0f, 1.0f) * 255) && stored[1] == static_cast<int>(std::clamp(pixel.y, 0.0f, 1.0f) * 255)
+							&& stored[2] == static_cast<int>(std::clamp(pixel.z, 0.0f, 1.0f) * 255);
+					}
+				}
+			}
+			else
+			{
+				std::vector<float> pixels;
+				same = opened && readPFM(filePath, pixels, readWidth, readHeight) && readWidth == width && readHeight == height
+					&& std::filesystem::file_size(filePath) == std::string("PF\n300 1200\n-1.0\n").size() + pixels.size() * sizeof(float);
+
+				for (int32_t y = 0; same && y < height; ++y)
+				{
+					for (int32_t x = 0; x < width; ++x)
+					{
+						Vector3D<float> pixel = framebuffer.get(x, y);
+						const float* stored = &pixels[(static_cast<size_t>(y) * width + x) * 3];
+
+						same = same && stored[0] == pixel.x && stored[1] == pixel.y && stored[2] == pixel.z;
+					}
+				}
+			}
+
+			std::filesystem::remove(filePath);
+
+			if (same)
+			{
+				std::cout << "[PASS] " << names[f] << (streamed ? " streamed" : " written at once") << ": every pixel read back" << std::endl;
+			}
+			else
+			{
+				std::cout << "[FAIL] " << names[f] << (streamed ? " streamed" : " written at once") << ": opened " << opened << ", read " << readWidth << "x" << readHeight << ", pixels differ" << std::endl;
+			}
+		}
+	}
+}
+
+// Writes a small scene of spheres on a plane under a dome, with a surface shader, for the render tests.
+static void writeTestScene(const std::string& scenePath)
+{
+	std::ofstream shader("test_render_surface.hrs");
+	shader << "(surface)\n-diffuse_color- /0.8,0.3,0.3/\n-diffuse_gain- /0.8/\n-roughness- /0.6/\n;\n";
+
+	std::ofstream scene(scenePath);
+	scene << "(perspective)\n-pos- /0,1,3/\n-rot- /0,0,0/\n-window- /64,36/\n;\n";
+	scene << "(sphere)\n-pos- /0,1,-1/\n-radius- /1/\n-shader- /test_render_surface.hrs/\n;\n";
+	scene << "(sphere)\n-pos- /2,0.5,-2/\n-radius- /0.5/\n-shader- /test_render_surface.hrs/\n;\n";
+	scene << "(plane)\n-pos- /0,0,0/\n-rot- /0,0,0/\n-width- /20/\n-height- /20/\n-shader- /test_render_surface.hrs/\n;\n";
+	scene << "(dome)\n-color- /0.7,0.8,1.0/\n-intensity- /1/\n;\n";
+}
+
+// Renders 'scenePath' to the PFM 'outputPath' with the given command line options, on 'threads' render threads.
+static bool renderTestScene(const std::string& scenePath, const std::string& outputPath, const std::vector<std::string>& options, int32_t threads)
+{
+	Scene scene;
+
+	if (!scene.setRenderOutput("pfm") || !scene.setFilePathWrite(outputPath)) { return false; }
+
+	for (const std::string& option : options)
+	{
+		if (!scene.setProgressive(option) && !scene.setSamples(option) && !scene.setTimeBudget(option) && !scene.setAOVOption(option)
+			&& !scene.setPostProcessOption(option) && !scene.setFramebufferOption(option) && !scene.setCheckpointOption(option))
+		{
+			return false;
+		}
+	}
+
+	scene.setRenderThreads(threads);
+
+	std::vector<std::unique_ptr<SceneObject>> objects;
+
+	if (!SceneBuilder(scenePath, objects, 1) || !scene.getScene(objects)) { return false; }
+
+	scene.render();
+
+	return true;
+}
+
+void T_PROGRESSIVE(const std::vector<std::string>&)
+{
+	std::cout << "Progressive Test Running" << std::endl;
+
+	const std::string scenePath = "test_progressive.hrs";
+	writeTestScene(scenePath);
+
+	// Every row is seeded from its pass and position, so the passes come out the same on any number of threads, AOVs included.
+	const char* aovs[] = { "", ".depth", ".normal", ".id" };
+	const char* samplers[] = { "-sampler:random", "-sampler:sobol" };
+
+	for (const char* sampler : samplers)
+	{
+		bool rendered = renderTestScene(scenePath, "test_progressive_1.pfm", { "-progressive", "-spp:8", sampler, "-aov:depth,normal,id" }, 1)
+			&& renderTestScene(scenePath, "test_progressive_4.pfm", { "-progressive", "-spp:8", sampler, "-aov:depth,normal,id" }, 4);
+
+		bool same = rendered;
+
+		for (const char* aov : aovs)
+		{
+			std::vector<uint8_t> one = readWholeFile(std::string("test_progressive_1") + aov + ".pfm");
+			std::vector<uint8_t> four = readWholeFile(std::string("test_progressive_4") + aov + ".pfm");
+
+			same = same && !one.empty() && one == four;
+
+			std::filesystem::remove(std::string("test_progressive_1") + aov + ".pfm");
+			std::filesystem::remove(std::string("test_progressive_4") + aov + ".pfm");
+		}
+
+		if (same)
+		{
+			std::cout << "[PASS] " << sampler << ": 1 and 4 threads render the same passes and AOVs" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] " << sampler << ": rendered " << rendered << ", images differ between 1 and 4 threads" << std::endl;
+		}
+	}
+
+	// Film splats from neighboring rows land in the same pixels in any order, so with a filter the sums only agree to rounding.
+	{
+		bool rendered = renderTestScene(scenePath, "test_progressive_1.pfm", { "-progressive", "-spp:8", "-filter:mitchell" }, 1)
+			&& renderTestScene(scenePath, "test_progressive_4.pfm", { "-progressive", "-spp:8", "-filter:mitchell" }, 4);
+
+		std::vector<float> one;
+		std::vector<float> four;
+		int32_t width = 0;
+		int32_t height = 0;
+
+		bool read = rendered && readPFM("test_progressive_1.pfm", one, width, height) && readPFM("test_progressive_4.pfm", four, width, height)
+			&& one.size() == four.size();
+
+		float largest = 0.0f;
+
+		for (size_t i = 0; read && i < one.size(); ++i)
+		{
+			largest = std::max(largest, std::fabs(one[i] - four[i]) / std::max(1.0f, std::fabs(one[i])));
+		}
+
+		std::filesystem::remove("test_progressive_1.pfm");
+		std::filesystem::remove("test_progressive_4.pfm");
+
+		if (read && largest < 1e-4f)
+		{
+			std::cout << "[PASS] Mitchell filter: 1 and 4 threads within " << largest << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] Mitchell filter: read " << read << ", largest relative difference " << largest << std::endl;
+		}
+	}
+
+	std::filesystem::remove(scenePath);
+	std::filesystem::remove("test_render_surface.hrs");
+}
+
+void T_TIME_BUDGET(const std::vector<std::string>&)
+{
+	std::cout << "Time Budget Test Running" << std::endl;
+
+	const std::string scenePath = "test_time_budget.hrs";
+	writeTestScene(scenePath);
+
+	// Without -spp the render would go on to 65536 samples per pixel; the four threads have to stop together at the deadline and leave
+	// an image and a checkpoint to resume from.
+	const float budget = 0.5f;
+
+	auto start = std::chrono::steady_clock::now();
+	bool rendered = renderTestScene(scenePath, "test_time_budget.pfm", { "--time-budget:0.5", "-checkpoint:60" }, 4);
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::vector<float> pixels;
+	int32_t width = 0;
+	int32_t height = 0;
+
+	bool read = rendered && readPFM("test_time_budget.pfm", pixels, width, height);
+	bool lit = read && std::all_of(pixels.begin(), pixels.end(), [](float value) { return std::isfinite(value) && value > 0.0f; });
+	bool checkpointLeft = std::filesystem::exists("test_time_budget.pfm.checkpoint");
+
+	std::filesystem::remove("test_time_budget.pfm");
+	std::filesystem::remove("test_time_budget.pfm.checkpoint");
+	std::filesystem::remove(scenePath);
+	std::filesystem::remove("test_render_surface.hrs");
+
+	if (lit && checkpointLeft && seconds < budget + 0.25)
+	{
+		std::cout << "[PASS] Stopped after " << seconds << " s of a " << budget << " s budget, image and checkpoint written" << std::endl;
+	}
+	else
+	{
+		std::cout << "[FAIL] Took " << seconds << " s of a " << budget << " s budget, image " << lit << ", checkpoint " << checkpointLeft << std::endl;
+	}
+}
+
+void T_AOV(const std::vector<std::string>&)
+{
+	std::cout << "AOV Test Running" << std::endl;
+
+	// Two spheres and a floor, each with its own material: ids 1, 2 and 3 in the order of the file.
+	std::ofstream("test_aov_red.hrs") << "(surface)\n-diffuse_color- /0.8,0.3,0.3/\n-diffuse_gain- /0.5/\n;\n";
+	std::ofstream("test_aov_green.hrs") << "(constant)\n-color- /0.1,0.9,0.2/\n;\n";
+	std::ofstream("test_aov_grey.hrs") << "(surface)\n-diffuse_color- /0.5,0.5,0.5/\n-diffuse_gain- /1/\n;\n";
+
+	const std::string scenePath = "test_aov.hrs";
+
+	{
+		std::ofstream scene(scenePath);
+		scene << "(perspective)\n-pos- /0,1,3/\n-rot- /0,0,0/\n-window- /128,72/\n;\n";
+		scene << "(sphere)\n-pos- /0,1,-1/\n-radius- /1/\n-shader- /test_aov_red.hrs/\n;\n";
+		scene << "(sphere)\n-pos- /1.5,0.6,-0.5/\n-radius- /0.6/\n-shader- /test_aov_green.hrs/\n;\n";
+		scene << "(plane)\n-pos- /0,0,0/\n-rot- /0,0,0/\n-width- /20/\n-height- /20/\n-shader- /test_aov_grey.hrs/\n;\n";
+		scene << "(dome)\n-color- /0.7,0.8,1.0/\n-intensity- /1/\n;\n";
+	}
+
+	const Vector3D<float> albedos[] = { Vector3D<float>(0.4f, 0.15f, 0.15f), Vector3D<float>(0.1f, 0.9f, 0.2f), Vector3D<float>(0.5f, 0.5f, 0.5f) };
+
+	// The same checks for a plain and a progressive render.
+	const char* modes[] = { "-spp:4", "-progressive" };
+
+	for (const char* mode : modes)
+	{
+		bool rendered = renderTestScene(scenePath, "test_aov.pfm", { mode, "-spp:4", "-aov" }, 0);
+
+		std::vector<float> depth;
+		std::vector<float> normal;
+		std::vector<float> albedo;
+		std::vector<float> id;
+		int32_t width = 0;
+		int32_t height = 0;
+
+		bool read = rendered && readPFM("test_aov.depth.pfm", depth, width, height) && readPFM("test_aov.normal.pfm", normal, width, height)
+			&& readPFM("test_aov.albedo.pfm", albedo, width, height) && readPFM("test_aov.id.pfm", id, width, height)
+			&& width == 128 && height == 72;
+
+		int32_t errors = 0;
+		int32_t counts[4] = { 0, 0, 0, 0 };
+		float nearestRed = 1e30f;
+
+		for (int32_t y = 1; read && y < height - 1; ++y)
+		{
+			for (int32_t x = 1; x < width - 1; ++x)
+			{
+				size_t i = 3 * (static_cast<size_t>(y) * width + x);
+				int32_t object = static_cast<int32_t>(id[i]);
+
+				// Only pixels whose neighbors see the same object, so every sample of the pixel hits it.
+				bool interior = object >= 0 && object <= 3;
+
+				for (int32_t dy = -1; interior && dy <= 1; ++dy)
+				{
+					for (int32_t dx = -1; dx <= 1; ++dx)
+					{
+						interior = interior && id[3 * (static_cast<size_t>(y + dy) * width + x + dx)] == id[i];
+					}
+				}
+
+				if (!interior) { continue; }
+
+				++counts[object];
+
+				Vector3D<float> n(normal[i], normal[i + 1], normal[i + 2]);
+				Vector3D<float> a(albedo[i], albedo[i + 1], albedo[i + 2]);
+
+				if (object == 0)
+				{
+					// Escaped rays leave everything at zero.
+					errors += (depth[i] != 0.0f || (n * n) != 0.0f || (a * a) != 0.0f || id[i + 1] != 0.0f) ? 1 : 0;
+					continue;
+				}
+
+				Vector3D<float> expected = albedos[object - 1];
+				Vector3D<float> difference = a - expected;
+
+				errors += ((difference * difference) > 1e-8f || depth[i] <= 0.0f || id[i + 1] != 0.0f) ? 1 : 0;
+
+				if (object == 3)
+				{
+					// The floor faces up.
+					errors += (std::fabs(n.y - 1.0f) > 1e-4f) ? 1 : 0;
+				}
+				else
+				{
+					// Averaged sphere normals stay close to unit length and face the camera.
+					errors += (std::fabs(std::sqrt(n * n) - 1.0f) > 0.02f || n.z <= 0.0f) ? 1 : 0;
+				}
+
+				if (object == 1)
+				{
+					nearestRed = std::min(nearestRed, depth[i]);
+				}
+			}
+		}
+
+		// The nearest point of the red sphere is 3 units in front of the camera.
+		bool nearest = std::fabs(nearestRed - 3.0f) < 0.05f;
+
+		std::filesystem::remove("test_aov.pfm");
+
+		for (const char* aov : { "depth", "normal", "albedo", "id" })
+		{
+			std::filesystem::remove(std::string("test_aov.") + aov + ".pfm");
+		}
+
+		if (read && errors == 0 && nearest && counts[0] > 0 && counts[1] > 0 && counts[2] > 0 && counts[3] > 0)
+		{
+			std::cout << "[PASS] " << mode << ": depth, normal, albedo and id match the scene" << std::endl;
+		}
+		else
+		{
+			std::cout << "[FAIL] " << mode << ": read " << read << ", " << errors << " wrong pixels, nearest depth " << nearestRed
+			          << ", pixels per id " << counts[0] << " " << counts[1] << " " << counts[2] << " " << counts[3] << std::endl;
+		}
+	}
+
+	std::filesystem::remove(scenePath);
+	std::filesystem::remove("test_aov_red.hrs");
+	std::filesystem::remove("test_aov_green.hrs");
+	std::filesystem::remove("test_aov_grey.hrs");
+}
+
 // Run specified tests
 void RunTests(TestSelection Test, const std::vector<std::string>& args)
 {
@@ -163,6 +3319,98 @@ void RunTests(TestSelection Test, const std::vector<std::string>& args)
 		 T_SCENE_BUILDER(args);
 		 break;
 
+	case TestSelection::PLY_LOADER:
+		 T_PLY_LOADER(args);
+		 break;
+
+	case TestSelection::PAGED_MESH:
+		 T_PAGED_MESH(args);
+		 break;
+
+	case TestSelection::COMPILED_SCENE:
+		 T_COMPILED_SCENE(args);
+		 break;
+
+	case TestSelection::PARALLEL_PARSE:
+		 T_PARALLEL_PARSE(args);
+		 break;
+
+	case TestSelection::FRAMEBUFFER:
+		 T_FRAMEBUFFER(args);
+		 break;
+
+	case TestSelection::DEFLATE:
+		 T_DEFLATE(args);
+		 break;
+
+	case TestSelection::QOI:
+		 T_QOI(args);
+		 break;
+
+	case TestSelection::POST_PROCESS:
+		 T_POST_PROCESS(args);
+		 break;
+
+	case TestSelection::HALF_FLOAT:
+		 T_HALF_FLOAT(args);
+		 break;
+
+	case TestSelection::DENOISE:
+		 T_DENOISE(args);
+		 break;
+
+	case TestSelection::SAMPLER:
+		 T_SAMPLER(args);
+		 break;
+
+	case TestSelection::FILM_FILTER:
+		 T_FILM_FILTER(args);
+		 break;
+
+	case TestSelection::CHECKPOINT:
+		 T_CHECKPOINT(args);
+		 break;
+
+	case TestSelection::PROGRESSIVE:
+		 T_PROGRESSIVE(args);
+		 break;
+
+	case TestSelection::TIME_BUDGET:
+		 T_TIME_BUDGET(args);
+		 break;
+
+	case TestSelection::IMAGE_OUTPUT:
+		 T_IMAGE_OUTPUT(args);
+		 break;
+
+	case TestSelection::TOKENIZER:
+		 T_TOKENIZER(args);
+		 break;
+
+	case TestSelection::REFERENCE:
+		 T_REFERENCE(args);
+		 break;
+
+	case TestSelection::PARTICLES:
+		 T_PARTICLES(args);
+		 break;
+
+	case TestSelection::DISPLACED:
+		 T_DISPLACED(args);
+		 break;
+
+	case TestSelection::MATERIAL_LIBRARY:
+		 T_MATERIAL_LIBRARY(args);
+		 break;
+
+	case TestSelection::WATCH:
+		 T_WATCH(args);
+		 break;
+
+	case TestSelection::AOV:
+		 T_AOV(args);
+		 break;
+
 	default:
 		break;
 
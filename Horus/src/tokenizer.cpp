@@ -0,0 +1,116 @@
+#include "tokenizer.h"
+#include <charconv>
+#include <iostream>
+
+// Moves 'begin' past whitespace and a leading '+', which std::from_chars does not accept.
+static const char* skipNumberPrefix(const char* begin, const char* end)
+{
+	while (begin < end && (*begin == ' ' || *begin == '\t' || *begin == '\n' || *begin == '\r'))
+	{
+		++begin;
+	}
+
+	if (begin < end && *begin == '+' && begin + 1 < end && *(begin + 1) != '-')
+	{
+		++begin;
+	}
+
+	return begin;
+}
+
+bool parseFloat(std::string_view token, float& value)
+{
+	const char* end = token.data() + token.size();
+	const char* begin = skipNumberPrefix(token.data(), end);
+
+	return std::from_chars(begin, end, value).ec == std::errc();
+}
+
+bool parseInt(std::string_view token, int32_t& value)
+{
+	const char* end = token.data() + token.size();
+	const char* begin = skipNumberPrefix(token.data(), end);
+
+	return std::from_chars(begin, end, value).ec == std::errc();
+}
+
+// Parses 'count' comma separated floats. Returns true only if all of them were read.
+bool parseFloats(std::string_view token, float* values, int32_t count)
+{
+	const char* p = token.data();
+	const char* end = token.data() + token.size();
+
+	for (int32_t i = 0; i < count; ++i)
+	{
+		p = skipNumberPrefix(p, end);
+
+		std::from_chars_result result = std::from_chars(p, end, values[i]);
+
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		p = result.ptr;
+
+		if (i + 1 < count)
+		{
+			while (p < end && (*p == ' ' || *p == '\t')) { ++p; }
+
+			if (p == end || *p != ',') { return false; }
+
+			++p;
+		}
+	}
+
+	return true;
+}
+
+bool parseVector3(std::string_view token, float& x, float& y, float& z)
+{
+	float values[3] = { 0.0f, 0.0f, 0.0f };
+
+	bool result = parseFloats(token, values, 3);
+
+	x = values[0];
+	y = values[1];
+	z = values[2];
+
+	return result;
+}
+
+bool parseVector2(std::string_view token, float& x, float& y)
+{
+	float values[2] = { 0.0f, 0.0f };
+
+	bool result = parseFloats(token, values, 2);
+
+	x = values[0];
+	y = values[1];
+
+	return result;
+}
+
+float tokenToFloat(std::string_view token)
+{
+	float value = 0.0f;
+
+	if (!parseFloat(token, value))
+	{
+		std::cout << "Invalid number: " << token << std::endl;
+	}
+
+	return value;
+}
+
+int32_t tokenToInt(std::string_view token)
+{
+	int32_t value = 0;
+
+	if (!parseInt(token, value))
+	{
+		std::cout << "Invalid integer: " << token << std::endl;
+	}
+
+	return value;
+}
\ No newline at end of file
@@ -0,0 +1,221 @@
+#include "watch.h"
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+// FNV-1a over the object text.
+static uint64_t hashText(const char* begin, const char* end)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (const char* p = begin; p < end; ++p)
+	{
+		hash ^= static_cast<unsigned char>(*p);
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+size_t WatchedObject::getGeometryCount() const
+{
+	size_t count = 0;
+
+	for (const std::unique_ptr<SceneObject>& object : objects)
+	{
+		if (object->getType() == SceneObjectType::GEOMETRY)
+		{
+			++count;
+		}
+	}
+
+	return count;
+}
+
+bool SceneWatcher::update()
+{
+	auto t0 = std::chrono::steady_clock::now();
+
+	// Read into memory instead of mapping, so the file is not held open while an editor saves it.
+	std::ifstream file(filePath, std::ios::binary);
+
+	if (!file)
+	{
+		std::cout << "Could not read " << filePath << std::endl;
+		return false;
+	}
+
+	std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	std::unordered_multimap<uint64_t, size_t> previousIndices;
+
+	for (size_t i = 0; i < watched.size(); ++i)
+	{
+		previousIndices.emplace(watched[i].hash, i);
+	}
+
+	std::vector<bool> kept(watched.size(), false);
+	std::vector<WatchedObject> current;
+	std::vector<size_t> parsed;
+
+	const char* end = text.data() + text.size();
+
+	for (const char* p = text.data(); p < end;)
+	{
+		const char* next = nextObjectBoundary(p, end);
+
+		WatchedObject& object = current.emplace_back();
+		object.hash = hashText(p, next);
+
+		auto range = previousIndices.equal_range(object.hash);
+
+		bool reused = false;
+
+		for (auto it = range.first; it != range.second && !reused; ++it)
+		{
+			if (!kept[it->second])
+			{
+				kept[it->second] = true;
+				object.objects = std::move(watched[it->second].objects);
+				reused = true;
+			}
+		}
+
+		if (!reused)
+		{
+			Tokenizer tokenizer(p, next);
+			parseObjects(tokenizer, object.objects);
+
+			parsed.push_back(current.size() - 1);
+		}
+
+		p = next;
+	}
+
+	// An edited object that sits where the old one was and has as many geometries is a replacement: its geometries can take the
+	// place of the old ones in the BVH leaves. Everything else changes the primitive set.
+	std::unordered_map<GeometryObject*, GeometryObject*> replacements;
+
+	size_t removedGeometries = 0;
+	size_t addedGeometries = 0;
+
+	for (size_t i = 0; i < watched.size(); ++i)
+	{
+		if (!kept[i])
+		{
+			removedGeometries += watched[i].getGeometryCount();
+		}
+	}
+
+	for (size_t i : parsed)
+	{
+		size_t geometries = current[i].getGeometryCount();
+
+		addedGeometries += geometries;
+
+		if (i < watched.size() && !kept[i] && watched[i].getGeometryCount() == geometries)
+		{
+			for (size_t j = 0, k = 0; j < current[i].objects.size(); ++j)
+			{
+				if (current[i].objects[j]->getType() != SceneObjectType::GEOMETRY) { continue; }
+
+				while (watched[i].objects[k]->getType() != SceneObjectType::GEOMETRY) { ++k; }
+
+				replacements[static_cast<GeometryObject*>(watched[i].objects[k++].get())] = static_cast<GeometryObject*>(current[i].objects[j].get());
+			}
+		}
+	}
+
+	// The previous objects still referenced by the BVH are released here; 'replacements' only uses their addresses as keys.
+	watched = std::move(current);
+
+	std::vector<SceneObject*> objects;
+
+	for (WatchedObject& object : watched)
+	{
+		for (std::unique_ptr<SceneObject>& sceneObject : object.objects)
+		{
+			objects.push_back(sceneObject.get());
+		}
+	}
+
+	BVH& bvh = scene.getBVH();
+
+	if (objects.empty() || !scene.setObjects(objects))
+	{
+		// The BVH may point at released objects now; build it from scratch once the file is valid again.
+		bvh.clear();
+		return false;
+	}
+
+	size_t geometryCount = scene.getGeometries().size();
+
+	const char* bvhUpdate = "unchanged";
+
+	if (bvh.isBuilt() && addedGeometries == replacements.size() && removedGeometries == replacements.size() && replacements.size() * 4 <= geometryCount)
+	{
+		if (!replacements.empty())
+		{
+			bvh.refit(replacements);
+			bvhUpdate = "refit";
+		}
+	}
+	else
+	{
+		// Building overwrites the centroids with Morton grid coordinates, so kept geometries get theirs back first.
+		for (GeometryObject* geometry : scene.getGeometries())
+		{
+			geometry->getBoundingBox().computeCentroid();
+		}
+
+		bvh.clear();
+		scene.buildAccelerator();
+		bvhUpdate = "rebuilt";
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	std::cout << "Scene updated in " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms: parsed " << parsed.size() << " of " << watched.size()
+		<< " objects, BVH " << bvhUpdate << " (" << replacements.size() << " geometries replaced, " << geometryCount << " total)" << std::endl;
+
+	return true;
+}
+
+void SceneWatcher::run(int32_t interval, int32_t maxRenders)
+{
+	int32_t renders = 0;
+	bool loaded = false;
+
+	std::cout << "Watching " << filePath << std::endl;
+
+	while (maxRenders == 0 || renders < maxRenders)
+	{
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(filePath, error);
+
+		if (!error && (!loaded || time != writeTime))
+		{
+			writeTime = time;
+			loaded = true;
+
+			if (update())
+			{
+				auto t0 = std::chrono::steady_clock::now();
+
+				scene.render();
+
+				auto t1 = std::chrono::steady_clock::now();
+
+				std::cout << "Rendered in " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms" << std::endl;
+
+				++renders;
+			}
+
+			continue;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+	}
+}
\ No newline at end of file